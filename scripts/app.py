@@ -370,6 +370,12 @@ def expand_defines(config):
             defines.append(config['defines'])
         result['all'] = defines
     
+    # A dispatch table replaces the loader prototypes with function pointers
+    if 'dispatch' in config and config['dispatch']:
+        result.setdefault('all',[])
+        if not 'VK_NO_PROTOTYPES' in result['all']:
+            result['all'].append('VK_NO_PROTOTYPES')
+    
     # Get the auxiliary defines
     for target in ['android','apple','windows','cmake']:
         defines = []
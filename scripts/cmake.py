@@ -236,6 +236,19 @@ def config_cmake(config,project):
         defstr = ''
     context['__EXTRA_DEFINES__'] = defstr
 
+    # Link the Vulkan loader, unless the app opens it at runtime (see expand_defines)
+    if 'dispatch' in config and config['dispatch']:
+        context['__VULKAN_LOADER__'] = 'OFF'
+    else:
+        context['__VULKAN_LOADER__'] = 'ON'
+
+    # Set the benchmark script (optional)
+    if 'bench' in config and config['bench']:
+        path = os.path.join(*prefix,config['build_to_root'],config['bench'])
+        context['__BENCH_SCRIPT__'] = '${PROJECT_SOURCE_DIR}/'+util.path_to_posix(path)
+    else:
+        context['__BENCH_SCRIPT__'] = ''
+
     util.file_replace(cmake,context)
 
 
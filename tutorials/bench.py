@@ -0,0 +1,347 @@
+"""
+Python Script for Tutorial Benchmarks
+
+This is vulkansdl-bench, which runs built tutorials in headless mode with the
+same warm-up, frame count, and resolution, and merges the JSON reports they
+save into a single file. As the runs need no display, they work on a build
+machine with a software driver like lavapipe, which makes it possible to
+compare the frame times of different SDL and VulkanSDL releases.
+
+Every tutorial has a headless mode, so each workload can be benchmarked:
+
+    tutorial1       a single triangle
+    tutorial2-3     indexed quads (with a uniform buffer in 3)
+    tutorial4-5     textured quads (with a depth buffer in 5)
+    tutorial6-7     a textured model (with mipmaps in 7)
+    tutorial8       the textured model with MSAA, drawn --scene N times
+    tutorial9-10    compute particles (with async compute in 10)
+    tutorial11      a triangle with dynamic rendering
+
+Each executable is given --headless, --warmup, --size, --draws, --layout, and
+--bench (and --particles, --emit, or --scene if set), and is run from its own
+directory so that it finds its assets. A tutorial ignores the options it does
+not have, and the report it saves lists the parameters it actually used. So
+--scene only scales tutorial8, while --particles and --emit only scale the
+particle tutorials. Only the particle tutorials report GPU times, as they are
+the only ones with a GPU profiler. The others report an empty set of scopes.
+
+With --dispatch both, each particle tutorial is also run with --trampolines, which
+calls the device through the Vulkan loader rather than directly, and the
+script reports how much faster the command recording is without it. Use
+--draws to split the particles into many draw calls, as the difference is
+only visible when there are many commands to record.
+
+With --layout all, each particle tutorial is run with the particles stored as an
+array of structs (the original layout), a structure of arrays, and a structure
+of arrays with half precision velocity and color. The script reports how many
+particles each layout simulates per millisecond of compute, and how that
+compares to the array of structs. Use --particles to simulate enough
+particles for the memory bandwidth to matter (up to 10 million).
+
+With --emit, the particles spawn at the given rate per second and die after a
+few seconds, and --particles is the size of the pool they spawn from. Only the
+live particles are simulated, so the particles per millisecond are then an
+upper bound, as the rate still counts the whole pool.
+
+Date:   10/18/26
+"""
+import os, os.path
+import sys
+import json
+import argparse
+import subprocess
+import tempfile
+
+# The arguments of each dispatch mode
+DISPATCH_ARGS = {'direct': [], 'trampoline': ['--trampolines']}
+
+# The particle layouts, in the order they are run
+LAYOUTS = ['aos', 'soa', 'half']
+
+# The options that scale a workload, which are only passed if positive
+SCALING_OPTIONS = ('draws', 'particles', 'emit', 'scene')
+
+# The GPU scope of the particle simulation
+SIMULATE_SCOPE = 'compute/simulate'
+
+
+def driver_environment(icd):
+    """
+    Returns the environment for a run, restricted to the given driver
+
+    :param icd: The ICD manifest of the driver (None for the system drivers)
+    :type icd:  ``str``
+
+    :return: The environment for a run, restricted to the given driver
+    :rtype:  ``dict``
+    """
+    env = dict(os.environ)
+    if icd:
+        # The first is the current loader variable, and the second is for older loaders
+        env['VK_DRIVER_FILES'] = os.path.abspath(icd)
+        env['VK_ICD_FILENAMES'] = os.path.abspath(icd)
+    return env
+
+
+def run_workload(executable, args, env, extra=None):
+    """
+    Returns the report of a single headless run of the given executable
+
+    The report is None if the run failed or saved no report.
+
+    :param executable: The path to the tutorial executable
+    :type executable:  ``str``
+
+    :param args: The parsed command line arguments
+    :type args:  ``Namespace``
+
+    :param env: The environment for the run
+    :type env:  ``dict``
+
+    :param extra: Any additional arguments for the executable
+    :type extra:  ``list``
+
+    :return: The report of a single headless run of the given executable
+    :rtype:  ``dict``
+    """
+    handle, report = tempfile.mkstemp(suffix='.json')
+    os.close(handle)
+    command = [os.path.abspath(executable),
+               '--headless', str(args.frames + args.warmup),
+               '--warmup', str(args.warmup),
+               '--size', '%dx%d' % (args.width, args.height),
+               '--bench', report] + (extra or [])
+    # The scaling options are optional, as vulkansdl-compare runs the defaults
+    for option in SCALING_OPTIONS:
+        value = getattr(args, option, 0)
+        if value > 0:
+            command += ['--' + option, str(value)]
+    try:
+        result = subprocess.run(command, cwd=os.path.dirname(os.path.abspath(executable)), env=env,
+                                stdout=subprocess.PIPE, stderr=subprocess.STDOUT, timeout=args.timeout)
+        if result.returncode != 0:
+            print('%s failed with code %d' % (executable, result.returncode))
+            print(result.stdout.decode('utf-8', 'replace'))
+            return None
+        with open(report) as file:
+            return json.load(file)
+    except (OSError, ValueError, subprocess.TimeoutExpired) as e:
+        print('%s failed: %s' % (executable, e))
+        return None
+    finally:
+        os.remove(report)
+
+
+def particle_rate(report):
+    """
+    Returns the particles simulated per millisecond of compute in the given report
+
+    The rate is 0 if the report has no time for the simulation.
+
+    :param report: The report of a headless run
+    :type report:  ``dict``
+
+    :return: The particles simulated per millisecond of compute in the given report
+    :rtype:  ``float``
+    """
+    simulate = report.get('gpu_ms', {}).get(SIMULATE_SCOPE)
+    particles = report.get('parameters', {}).get('particles')
+    if not simulate or not particles:
+        return 0.0
+    return particles / simulate
+
+
+def summarize(report):
+    """
+    Returns a one line summary of the given report
+
+    :param report: The report of a headless run
+    :type report:  ``dict``
+
+    :return: A one line summary of the given report
+    :rtype:  ``str``
+    """
+    cpu = report.get('cpu_frame_ms') or {}
+    record = report.get('record_ms') or {}
+    gpu = sum(report.get('gpu_ms', {}).values())
+    rss = report.get('peak_rss_bytes') or 0
+    dispatch = report.get('parameters', {}).get('dispatch', '-')
+    layout = report.get('parameters', {}).get('layout', '-')
+    return ('%-28s %-10s %-4s p50 %7.3f ms  p99 %7.3f ms  record %7.3f ms  gpu %7.3f ms  %10.0f particles/ms  '
+            'startup %8.1f ms  rss %6.1f MB') % (
+        report.get('workload', '?'), dispatch, layout, cpu.get('p50', 0), cpu.get('p99', 0), record.get('p50', 0),
+        gpu, particle_rate(report), report.get('startup_ms') or 0, rss / (1024.0 * 1024.0))
+
+
+def recording_speedup(reports):
+    """
+    Returns the speedup of direct dispatch for the recording of each workload
+
+    The speedup is the median recording time with trampolines divided by the
+    median without them, using the best run of each. Workloads that were not
+    run both ways are omitted.
+
+    :param reports: The reports of every run
+    :type reports:  ``list``
+
+    :return: The speedup of direct dispatch for the recording of each workload
+    :rtype:  ``dict``
+    """
+    best = {}
+    for report in reports:
+        record = (report.get('record_ms') or {}).get('p50')
+        if not record:
+            continue
+        key = (report.get('workload', '?'), report.get('parameters', {}).get('dispatch'))
+        best[key] = min(best.get(key, record), record)
+    result = {}
+    for (workload, dispatch), record in best.items():
+        if dispatch == 'direct' and (workload, 'trampoline') in best:
+            result[workload] = best[(workload, 'trampoline')] / record
+    return result
+
+
+def layout_speedup(reports):
+    """
+    Returns the speedup of each particle layout over the array of structs
+
+    The speedup is the particles per millisecond of compute in a layout
+    divided by that of the array of structs, using the best run of each.
+    Workloads that were not run with the array of structs are omitted.
+
+    :param reports: The reports of every run
+    :type reports:  ``list``
+
+    :return: The speedup of each layout for each workload
+    :rtype:  ``dict``
+    """
+    best = {}
+    for report in reports:
+        rate = particle_rate(report)
+        if not rate:
+            continue
+        key = (report.get('workload', '?'), report.get('parameters', {}).get('layout'))
+        best[key] = max(best.get(key, rate), rate)
+    result = {}
+    for (workload, layout), rate in best.items():
+        if layout != 'aos' and (workload, 'aos') in best:
+            result.setdefault(workload, {})[layout] = rate / best[(workload, 'aos')]
+    return result
+
+
+def run_executable(executable, run, args, env, layouts, modes):
+    """
+    Returns the reports of every variant of the given executable, and the number of failed runs
+
+    The dispatch modes and particle layouts are only varied if the first
+    report has those parameters, as the other tutorials ignore the options.
+
+    :param executable: The path to the tutorial executable
+    :type executable:  ``str``
+
+    :param run: The index of this run
+    :type run:  ``int``
+
+    :param args: The parsed command line arguments
+    :type args:  ``Namespace``
+
+    :param env: The environment for the run
+    :type env:  ``dict``
+
+    :param layouts: The particle layouts to run
+    :type layouts:  ``list``
+
+    :param modes: The dispatch modes to run
+    :type modes:  ``list``
+
+    :return: The reports of every variant of the given executable, and the number of failed runs
+    :rtype:  ``tuple``
+    """
+    reports = []
+    failures = 0
+    parameters = None
+    for layout in layouts:
+        for mode in modes:
+            report = run_workload(executable, args, env, DISPATCH_ARGS[mode] + ['--layout', layout])
+            if report is None:
+                failures += 1
+                continue
+            report['run'] = run
+            reports.append(report)
+            print(summarize(report))
+            parameters = report.get('parameters', {})
+            if 'dispatch' not in parameters:
+                break
+        if parameters is not None and 'layout' not in parameters:
+            break
+    return reports, failures
+
+
+def main():
+    """
+    Runs the benchmarks given on the command line
+    """
+    parser = argparse.ArgumentParser(prog='vulkansdl-bench', description='Benchmark the VulkanSDL tutorials in headless mode.')
+    parser.add_argument('executables', nargs='+', help='the built tutorial executables to run')
+    parser.add_argument('--frames',  type=int, default=600, help='the number of frames to time (default 600)')
+    parser.add_argument('--warmup',  type=int, default=60,  help='the number of frames to skip first (default 60)')
+    parser.add_argument('--width',   type=int, default=800, help='the width of the offscreen images (default 800)')
+    parser.add_argument('--height',  type=int, default=600, help='the height of the offscreen images (default 600)')
+    parser.add_argument('--repeat',  type=int, default=1,   help='the number of runs of each executable (default 1)')
+    parser.add_argument('--timeout', type=int, default=600, help='the time limit of a run in seconds (default 600)')
+    parser.add_argument('--draws',   type=int, default=1,   help='the number of draw calls for the particles (default 1)')
+    parser.add_argument('--dispatch', choices=['direct', 'trampoline', 'both'], default='direct',
+                        help='whether device calls skip the loader trampolines (default direct)')
+    parser.add_argument('--particles', type=int, default=0, help='the number of particles (default is the tutorial default)')
+    parser.add_argument('--layout', choices=LAYOUTS + ['all'], default='soa',
+                        help='how the particles are stored (default soa)')
+    parser.add_argument('--emit',    type=float, default=0, help='the particles spawned per second (default 0, which never kills any)')
+    parser.add_argument('--scene',   type=int, default=0, help='the number of model instances in tutorial8 (default is the tutorial default)')
+    parser.add_argument('--icd',     help='the ICD manifest of the driver to use, such as lavapipe')
+    parser.add_argument('--output',  default='bench.json', help='the file for the merged report (default bench.json)')
+    args = parser.parse_args()
+
+    env = driver_environment(args.icd)
+
+    reports = []
+    failures = 0
+    modes = ['direct', 'trampoline'] if args.dispatch == 'both' else [args.dispatch]
+    layouts = LAYOUTS if args.layout == 'all' else [args.layout]
+    for executable in args.executables:
+        for run in range(args.repeat):
+            runs, failed = run_executable(executable, run, args, env, layouts, modes)
+            reports += runs
+            failures += failed
+
+    speedup = recording_speedup(reports)
+    for workload, ratio in sorted(speedup.items()):
+        print('%-28s recording is %.2fx faster with direct dispatch' % (workload, ratio))
+    layouts = layout_speedup(reports)
+    for workload, ratios in sorted(layouts.items()):
+        for layout, ratio in sorted(ratios.items()):
+            print('%-28s %s simulates %.2fx the particles/ms of aos' % (workload, layout, ratio))
+
+    results = {
+        'frames': args.frames,
+        'warmup': args.warmup,
+        'width': args.width,
+        'height': args.height,
+        'draws': args.draws,
+        'dispatch': args.dispatch,
+        'particles': args.particles,
+        'layout': args.layout,
+        'emit': args.emit,
+        'scene': args.scene,
+        'icd': args.icd,
+        'runs': reports,
+        'record_speedup': speedup,
+        'layout_speedup': layouts
+    }
+    with open(args.output, 'w') as file:
+        json.dump(results, file, indent=2)
+    print('Wrote %d runs to %s' % (len(reports), args.output))
+    return 1 if failures > 0 else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,385 @@
+"""
+Python Script for Tutorial Regression Checks
+
+This is vulkansdl-compare, which checks that a change to a rendering path is
+still correct and no slower. It runs built tutorials in headless mode with a
+pinned clock, so that the final frame is the same on every run, and compares
+that frame against a stored golden image. Small differences are allowed, as
+drivers may round differently, but the tolerance is perceptual: a pixel only
+counts as different if its color difference (in YIQ space) is visible. The
+frame times of the run are also checked against the budgets of a previous
+vulkansdl-bench report.
+
+Every tutorial has a headless mode, so each one can be checked. The animated
+tutorials (3 to 10) pin their clock to 1/60 of a second per frame in headless
+mode, and --step passes another step to tutorials 3 to 8 as --fixed-step. The
+golden images are named after the tutorial in the report (tutorial3.png), so
+renaming an executable does not lose its golden image. The runs need no
+display, so this works with lavapipe on a build machine.
+
+Some tutorials are also run again with the options in VARIANTS, to cover
+paths that the defaults do not reach. Their golden images add the name of
+the variant (tutorial8-npot.png), and as they are not the benchmarked
+workload, they are not checked against the budgets.
+
+The golden images are not part of the repository, as they depend on the
+driver. Passing --update saves the current frames as the new golden images
+instead, so run it once with the reference driver (such as --icd pointing at
+lavapipe) before a change, and then compare with the same driver after it.
+
+Date:   10/18/26
+"""
+import os, os.path
+import sys
+import json
+import zlib
+import struct
+import argparse
+import tempfile
+import bench
+
+# The maximum YIQ difference between two colors (black and white)
+MAX_DELTA = 35215.0
+
+# The extra runs of each tutorial, as the name of the variant and its options
+VARIANTS = {
+    # An odd texture above 4096, which takes two passes of the compute downsampler
+    'tutorial8': [('npot', ['--texture-size', '6001x4099'])],
+}
+
+
+def read_png(path):
+    """
+    Returns the width, height, and RGBA pixels of an 8-bit PNG file
+
+    Only the formats saved by the tutorials (8-bit RGB and RGBA, with no
+    interlacing) are supported.
+
+    :param path: The PNG file to read
+    :type path:  ``str``
+
+    :return: The width, height, and RGBA pixels of an 8-bit PNG file
+    :rtype:  ``tuple``
+    """
+    with open(path, 'rb') as file:
+        data = file.read()
+    if data[:8] != b'\x89PNG\r\n\x1a\n':
+        raise ValueError('%s is not a PNG file' % path)
+
+    pos = 8
+    width = height = channels = 0
+    compressed = b''
+    while pos < len(data):
+        length, kind = struct.unpack('>I4s', data[pos:pos+8])
+        chunk = data[pos+8:pos+8+length]
+        pos += length + 12
+        if kind == b'IHDR':
+            width, height, depth, color, _, _, interlace = struct.unpack('>IIBBBBB', chunk)
+            if depth != 8 or color not in (2, 6) or interlace != 0:
+                raise ValueError('%s is not an 8-bit RGB or RGBA image' % path)
+            channels = 4 if color == 6 else 3
+        elif kind == b'IDAT':
+            compressed += chunk
+        elif kind == b'IEND':
+            break
+
+    raw = zlib.decompress(compressed)
+    stride = width * channels
+    pixels = bytearray(width * height * 4)
+    previous = bytearray(stride)
+    for row in range(height):
+        start = row * (stride + 1)
+        kind = raw[start]
+        line = bytearray(raw[start+1:start+1+stride])
+        for ii in range(stride):
+            left = line[ii-channels] if ii >= channels else 0
+            up = previous[ii]
+            corner = previous[ii-channels] if ii >= channels else 0
+            if kind == 1:
+                line[ii] = (line[ii] + left) & 0xFF
+            elif kind == 2:
+                line[ii] = (line[ii] + up) & 0xFF
+            elif kind == 3:
+                line[ii] = (line[ii] + ((left + up) >> 1)) & 0xFF
+            elif kind == 4:
+                estimate = left + up - corner
+                pa, pb, pc = abs(estimate - left), abs(estimate - up), abs(estimate - corner)
+                predictor = left if pa <= pb and pa <= pc else (up if pb <= pc else corner)
+                line[ii] = (line[ii] + predictor) & 0xFF
+        for col in range(width):
+            source = col * channels
+            target = (row * width + col) * 4
+            pixels[target:target+3] = line[source:source+3]
+            pixels[target+3] = line[source+3] if channels == 4 else 255
+        previous = line
+    return width, height, pixels
+
+
+def write_png(path, width, height, pixels):
+    """
+    Saves RGBA pixels as an 8-bit PNG file
+
+    :param path: The PNG file to write
+    :type path:  ``str``
+
+    :param width: The image width
+    :type width:  ``int``
+
+    :param height: The image height
+    :type height:  ``int``
+
+    :param pixels: The RGBA pixels
+    :type pixels:  ``bytearray``
+    """
+    def chunk(kind, body):
+        return struct.pack('>I', len(body)) + kind + body + struct.pack('>I', zlib.crc32(kind + body) & 0xFFFFFFFF)
+
+    stride = width * 4
+    raw = b''.join(b'\x00' + bytes(pixels[row*stride:(row+1)*stride]) for row in range(height))
+    with open(path, 'wb') as file:
+        file.write(b'\x89PNG\r\n\x1a\n')
+        file.write(chunk(b'IHDR', struct.pack('>IIBBBBB', width, height, 8, 6, 0, 0, 0)))
+        file.write(chunk(b'IDAT', zlib.compress(raw)))
+        file.write(chunk(b'IEND', b''))
+
+
+def color_delta(pixels1, pixels2, offset):
+    """
+    Returns the perceptual difference of a pixel in two images
+
+    This is the YIQ distance of Kotsalis and Kotsalis, with each pixel first
+    blended over white. It ranges from 0 to MAX_DELTA.
+
+    :param pixels1: The RGBA pixels of the first image
+    :type pixels1:  ``bytearray``
+
+    :param pixels2: The RGBA pixels of the second image
+    :type pixels2:  ``bytearray``
+
+    :param offset: The offset of the pixel in both images
+    :type offset:  ``int``
+
+    :return: The perceptual difference of a pixel in two images
+    :rtype:  ``float``
+    """
+    def blend(pixels):
+        alpha = pixels[offset+3] / 255.0
+        return [255 + (pixels[offset+ii] - 255) * alpha for ii in range(3)]
+
+    r1, g1, b1 = blend(pixels1)
+    r2, g2, b2 = blend(pixels2)
+    y = (r1 - r2) * 0.29889531 + (g1 - g2) * 0.58662247 + (b1 - b2) * 0.11448223
+    i = (r1 - r2) * 0.59597799 - (g1 - g2) * 0.27417610 - (b1 - b2) * 0.32180189
+    q = (r1 - r2) * 0.21147017 - (g1 - g2) * 0.52261711 + (b1 - b2) * 0.31114694
+    return 0.5053 * y * y + 0.299 * i * i + 0.1957 * q * q
+
+
+def compare_images(actual, golden, threshold, diff):
+    """
+    Returns the fraction of pixels that visibly differ between two PNG files
+
+    The fraction is 1 if the images are not the same size. If diff is not
+    None, the pixels that differ are saved there in red.
+
+    :param actual: The PNG file of the run
+    :type actual:  ``str``
+
+    :param golden: The PNG file of the golden image
+    :type golden:  ``str``
+
+    :param threshold: The smallest visible difference, from 0 to 1
+    :type threshold:  ``float``
+
+    :param diff: The PNG file for the differences (None for none)
+    :type diff:  ``str``
+
+    :return: The fraction of pixels that visibly differ between two PNG files
+    :rtype:  ``float``
+    """
+    width1, height1, pixels1 = read_png(actual)
+    width2, height2, pixels2 = read_png(golden)
+    if width1 != width2 or height1 != height2:
+        print('%s is %dx%d, but %s is %dx%d' % (actual, width1, height1, golden, width2, height2))
+        return 1.0
+
+    limit = MAX_DELTA * threshold * threshold
+    mask = bytearray(len(pixels1))
+    count = 0
+    for offset in range(0, len(pixels1), 4):
+        if pixels1[offset:offset+4] != pixels2[offset:offset+4] and color_delta(pixels1, pixels2, offset) > limit:
+            count += 1
+            mask[offset:offset+4] = b'\xff\x00\x00\xff'
+        else:
+            # Fade the golden image so that the differences stand out
+            gray = (pixels2[offset] + pixels2[offset+1] + pixels2[offset+2]) // 12 + 192
+            mask[offset:offset+4] = bytes((gray, gray, gray, 255))
+
+    if diff is not None and count > 0:
+        write_png(diff, width1, height1, mask)
+    return count / float(width1 * height1)
+
+
+def load_budgets(path):
+    """
+    Returns the CPU frame times of each workload in a vulkansdl-bench report
+
+    If a workload was run more than once, this keeps the fastest run, so
+    that a noisy baseline does not loosen the budget.
+
+    :param path: The vulkansdl-bench report
+    :type path:  ``str``
+
+    :return: The CPU frame times of each workload in a vulkansdl-bench report
+    :rtype:  ``dict``
+    """
+    with open(path) as file:
+        report = json.load(file)
+    budgets = {}
+    for run in report.get('runs', []):
+        cpu = run.get('cpu_frame_ms')
+        name = run.get('workload')
+        if cpu is None or name is None:
+            continue
+        if name not in budgets or cpu['p50'] < budgets[name]['p50']:
+            budgets[name] = cpu
+    return budgets
+
+
+def check_budget(report, budgets, slack):
+    """
+    Returns the list of frame time percentiles over budget in a run
+
+    :param report: The report of a headless run
+    :type report:  ``dict``
+
+    :param budgets: The CPU frame times of each workload
+    :type budgets:  ``dict``
+
+    :param slack: The allowed slowdown, as a fraction of the budget
+    :type slack:  ``float``
+
+    :return: The list of frame time percentiles over budget in a run
+    :rtype:  ``list``
+    """
+    budget = budgets.get(report.get('workload'))
+    cpu = report.get('cpu_frame_ms')
+    if budget is None or cpu is None:
+        return []
+    failures = []
+    for key in ('p50', 'p99'):
+        limit = budget[key] * (1 + slack)
+        if cpu[key] > limit:
+            failures.append('%s %.3f ms > %.3f ms' % (key, cpu[key], limit))
+    return failures
+
+
+def check_run(executable, name, variant, extra, args, env, budgets):
+    """
+    Returns the name of the tutorial in a run, and whether the run passed
+
+    The run is compared against the golden image of the tutorial, or the
+    golden image of the variant if it is not None. The tutorial name is taken
+    from the report, if it has one.
+
+    :param executable: The path to the tutorial executable
+    :type executable:  ``str``
+
+    :param name: The name of the tutorial, if the report has none
+    :type name:  ``str``
+
+    :param variant: The name of the variant (None for the defaults)
+    :type variant:  ``str``
+
+    :param extra: Any additional arguments for the executable
+    :type extra:  ``list``
+
+    :param args: The parsed command line arguments
+    :type args:  ``Namespace``
+
+    :param env: The environment for the run
+    :type env:  ``dict``
+
+    :param budgets: The CPU frame times of each workload
+    :type budgets:  ``dict``
+
+    :return: The name of the tutorial in a run, and whether the run passed
+    :rtype:  ``tuple``
+    """
+    handle, frame = tempfile.mkstemp(suffix='.png')
+    os.close(handle)
+    try:
+        report = bench.run_workload(executable, args, env, ['--screenshot', os.path.abspath(frame)] + extra)
+        if report is None:
+            return name, False
+
+        # The golden image is named after the tutorial, if the report has its name
+        name = report.get('parameters', {}).get('tutorial', name)
+        label = name if variant is None else name + '-' + variant
+        golden = os.path.join(args.golden, label + '.png')
+
+        if args.update:
+            os.replace(frame, golden)
+            print('%-28s saved %s' % (label, golden))
+            return name, True
+        if not os.path.exists(golden):
+            print('%-28s FAIL no golden image %s' % (label, golden))
+            return name, False
+
+        problems = []
+        diff = os.path.join(args.golden, label + '.diff.png')
+        fraction = compare_images(frame, golden, args.threshold, diff)
+        if fraction > args.tolerance:
+            problems.append('%.3f%% of pixels differ (see %s)' % (fraction * 100, diff))
+        problems += check_budget(report, budgets, args.slack)
+
+        if problems:
+            print('%-28s FAIL %s' % (label, '; '.join(problems)))
+            return name, False
+        print('%-28s ok   %s' % (label, bench.summarize(report).split(None, 1)[1]))
+        return name, True
+    finally:
+        if os.path.exists(frame):
+            os.remove(frame)
+
+
+def main():
+    """
+    Runs the regression checks given on the command line
+    """
+    parser = argparse.ArgumentParser(prog='vulkansdl-compare', description='Check the VulkanSDL tutorials against golden images and frame-time budgets.')
+    parser.add_argument('executables', nargs='+', help='the built tutorial executables to run')
+    parser.add_argument('--golden',    default='golden', help='the folder of golden images (default golden)')
+    parser.add_argument('--update',    action='store_true', help='save the frames as the new golden images')
+    parser.add_argument('--frames',    type=int,   default=120,   help='the number of frames to time (default 120)')
+    parser.add_argument('--warmup',    type=int,   default=60,    help='the number of frames to skip first (default 60)')
+    parser.add_argument('--width',     type=int,   default=800,   help='the width of the offscreen images (default 800)')
+    parser.add_argument('--height',    type=int,   default=600,   help='the height of the offscreen images (default 600)')
+    parser.add_argument('--threshold', type=float, default=0.1,   help='the smallest visible color difference, from 0 to 1 (default 0.1)')
+    parser.add_argument('--tolerance', type=float, default=0.001, help='the fraction of pixels allowed to differ (default 0.001)')
+    parser.add_argument('--budgets',   help='a vulkansdl-bench report with the frame times to stay within')
+    parser.add_argument('--slack',     type=float, default=0.15,  help='the allowed slowdown over the budgets (default 0.15)')
+    parser.add_argument('--timeout',   type=int,   default=600,   help='the time limit of a run in seconds (default 600)')
+    parser.add_argument('--step',      type=float, default=0,     help='the milliseconds the clock advances each frame (default 1000/60)')
+    parser.add_argument('--icd',       help='the ICD manifest of the driver to use, such as lavapipe')
+    args = parser.parse_args()
+
+    env = bench.driver_environment(args.icd)
+    budgets = load_budgets(args.budgets) if args.budgets else {}
+    if not os.path.isdir(args.golden):
+        os.makedirs(args.golden)
+
+    failures = 0
+    extra = ['--fixed-step', str(args.step)] if args.step > 0 else []
+    for executable in args.executables:
+        name = os.path.splitext(os.path.basename(executable))[0]
+        name, passed = check_run(executable, name, None, extra, args, env, budgets)
+        failures += 0 if passed else 1
+        for variant, options in VARIANTS.get(name, []):
+            _, passed = check_run(executable, name, variant, extra + options, args, env, {})
+            failures += 0 if passed else 1
+
+    return 1 if failures > 0 else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,230 @@
+"""
+Python Script for Tutorial Dispatch Tables
+
+This is vulkansdl-dispatch, which generates the table of Vulkan functions for
+each tutorial. The tutorials do not link against the Vulkan loader. Instead,
+VulkanLoader fetches every function they call with vkGetInstanceProcAddr and
+vkGetDeviceProcAddr, so that device functions skip the loader trampoline. The
+list of functions lives in source/VulkanFunctions.h, which this script writes.
+
+A function is listed if it is called anywhere in the sources of the tutorial
+(names in comments and strings do not count). Its level is read from its
+prototype in vulkan_core.h: global functions take no dispatchable handle,
+instance functions take a VkInstance or VkPhysicalDevice, and everything
+else is a device function. The header is found in VULKAN_SDK, in the vulkan
+folder of this repository, or with --header.
+
+Run this again after calling a new Vulkan function in a tutorial. Otherwise
+the tutorial will not compile, as there is no prototype for the function.
+The script fails if a tutorial names a vk function that has no prototype in
+the header, as that is either a typo or a header older than the tutorial,
+and a table without the function would not compile either.
+
+Date:   10/18/26
+"""
+import os, os.path
+import re
+import sys
+import glob
+import argparse
+import datetime
+
+# The functions that VulkanLoader always declares, as it needs them to load the rest
+LOADER_FUNCTIONS = ('vkGetInstanceProcAddr', 'vkGetDeviceProcAddr')
+
+# The handles of instance functions (device functions take VkDevice, VkQueue, or VkCommandBuffer)
+INSTANCE_HANDLES = ('VkInstance', 'VkPhysicalDevice')
+DEVICE_HANDLES = ('VkDevice', 'VkQueue', 'VkCommandBuffer')
+
+# The tables in the order they are written
+LEVELS = (('global', 'VK_GLOBAL_FUNCTION'), ('instance', 'VK_INSTANCE_FUNCTION'), ('device', 'VK_DEVICE_FUNCTION'))
+
+# A prototype in vulkan_core.h, with the name and the type of the first parameter
+PROTOTYPE = re.compile(r'VKAPI_ATTR\s+[\w\s\*]+?\s*VKAPI_CALL\s+(vk\w+)\s*\(\s*(?:const\s+)?(\w+)')
+
+
+def find_header(header):
+    """
+    Returns the path to vulkan_core.h
+
+    :param header: The path given on the command line (None to search for it)
+    :type header:  ``str``
+
+    :return: The path to vulkan_core.h
+    :rtype:  ``str``
+    """
+    candidates = [header] if header else []
+    if 'VULKAN_SDK' in os.environ:
+        candidates.append(os.path.join(os.environ['VULKAN_SDK'], 'include', 'vulkan', 'vulkan_core.h'))
+    root = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+    candidates.append(os.path.join(root, 'vulkan', 'include', 'vulkan', 'vulkan_core.h'))
+    candidates.append('/usr/include/vulkan/vulkan_core.h')
+    for path in candidates:
+        if os.path.isfile(path):
+            return path
+    raise FileNotFoundError('Could not find vulkan_core.h (pass --header or set VULKAN_SDK)')
+
+
+def read_levels(header):
+    """
+    Returns the level of every function in the given Vulkan header
+
+    :param header: The path to vulkan_core.h
+    :type header:  ``str``
+
+    :return: The level of every function in the given Vulkan header
+    :rtype:  ``dict``
+    """
+    with open(header) as file:
+        text = file.read()
+    levels = {}
+    for name, handle in PROTOTYPE.findall(text):
+        if handle in INSTANCE_HANDLES:
+            levels[name] = 'instance'
+        elif handle in DEVICE_HANDLES:
+            levels[name] = 'device'
+        else:
+            levels[name] = 'global'
+    return levels
+
+
+def strip_source(text):
+    """
+    Returns C++ source with its comments and string literals removed
+
+    :param text: The source code
+    :type text:  ``str``
+
+    :return: C++ source with its comments and string literals removed
+    :rtype:  ``str``
+    """
+    text = re.sub(r'/\*.*?\*/', ' ', text, flags=re.DOTALL)
+    text = re.sub(r'//[^\n]*', ' ', text)
+    return re.sub(r'"(?:[^"\\\n]|\\.)*"', '""', text)
+
+
+def find_calls(folder, levels):
+    """
+    Returns the Vulkan functions used by the sources in the given folder
+
+    Names that start with vk but have no prototype in the header are returned
+    separately, so that the caller can report them.
+
+    :param folder: The source folder of a tutorial
+    :type folder:  ``str``
+
+    :param levels: The level of every Vulkan function
+    :type levels:  ``dict``
+
+    :return: The Vulkan functions used by the sources in the given folder, and the unknown ones
+    :rtype:  ``tuple``
+    """
+    used = set()
+    unknown = set()
+    for path in sorted(glob.glob(os.path.join(folder, '*.cpp')) + glob.glob(os.path.join(folder, '*.h'))):
+        name = os.path.basename(path)
+        if name.startswith('VulkanFunctions') or name.startswith('VulkanLoader'):
+            continue
+        with open(path, encoding='utf-8', errors='replace') as file:
+            text = strip_source(file.read())
+        for word in re.findall(r'\bvk[A-Z]\w*', text):
+            if word in levels:
+                used.add(word)
+            else:
+                unknown.add(word)
+    return used - set(LOADER_FUNCTIONS), unknown - set(LOADER_FUNCTIONS)
+
+
+def read_label(tutorial):
+    """
+    Returns the short name of a tutorial, for the file header
+
+    :param tutorial: The tutorial folder
+    :type tutorial:  ``str``
+
+    :return: The short name of a tutorial
+    :rtype:  ``str``
+    """
+    config = os.path.join(tutorial, 'config.yml')
+    if os.path.isfile(config):
+        with open(config) as file:
+            match = re.search(r'^short:\s*(\S+)', file.read(), flags=re.MULTILINE)
+            if match:
+                return match.group(1)
+    return os.path.basename(os.path.abspath(tutorial))
+
+
+def write_table(path, label, used, levels):
+    """
+    Writes the function table of a tutorial
+
+    :param path: The file to write
+    :type path:  ``str``
+
+    :param label: The short name of the tutorial
+    :type label:  ``str``
+
+    :param used: The Vulkan functions used by the tutorial
+    :type used:  ``set``
+
+    :param levels: The level of every Vulkan function
+    :type levels:  ``dict``
+    """
+    lines = ['//',
+             '//  VulkanFunctions.h',
+             '//  ' + label,
+             '//',
+             '//  The Vulkan functions called by this application, for VulkanLoader. This',
+             '//  file is generated by tutorials/dispatch.py, so do not edit it by hand.',
+             '//  It has no include guard, as it is included once for each use of the',
+             '//  table: a use defines the macros it needs, and the rest are ignored.',
+             '//',
+             '//  Version: ' + datetime.date.today().strftime('%m/%d/%y'),
+             '//']
+    for level, macro in LEVELS:
+        lines.append('#ifndef %s' % macro)
+        lines.append('#define %s(name)' % macro)
+        lines.append('#endif')
+    for level, macro in LEVELS:
+        names = sorted(name for name in used if levels[name] == level)
+        lines.append('')
+        lines.append('// The %s functions' % level)
+        lines.extend('%s(%s)' % (macro, name) for name in names)
+    lines.append('')
+    for level, macro in LEVELS:
+        lines.append('#undef %s' % macro)
+    with open(path, 'w') as file:
+        file.write('\n'.join(lines) + '\n')
+
+
+def main():
+    """
+    Generates the function tables given on the command line
+    """
+    parser = argparse.ArgumentParser(prog='vulkansdl-dispatch', description='Generate the Vulkan function tables of the VulkanSDL tutorials.')
+    parser.add_argument('tutorials', nargs='+', help='the tutorial folders (each with a source folder)')
+    parser.add_argument('--header', help='the path to vulkan_core.h')
+    args = parser.parse_args()
+
+    levels = read_levels(find_header(args.header))
+    if not levels:
+        print('No Vulkan prototypes found in the header')
+        return 1
+
+    for tutorial in args.tutorials:
+        folder = os.path.join(tutorial, 'source')
+        if not os.path.isdir(folder):
+            print('%s has no source folder' % tutorial)
+            return 1
+        used, unknown = find_calls(folder, levels)
+        if unknown:
+            print('%s calls functions with no prototype in the header: %s' % (tutorial, ', '.join(sorted(unknown))))
+            return 1
+        write_table(os.path.join(folder, 'VulkanFunctions.h'), read_label(tutorial), used, levels)
+        counts = [len([name for name in used if levels[name] == level]) for level, _ in LEVELS]
+        print('%-12s %3d global, %3d instance, %3d device functions' % ((os.path.basename(os.path.abspath(tutorial)),) + tuple(counts)))
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,249 @@
+/**
+ * Vulkan Tutorials: Capture Replay
+ *
+ * This is not a tutorial, but a tool for the frame captures made by tutorials
+ * 9 and 10 (with --capture). It replays the captured frames in a loop on a
+ * headless device, and reports the time of each one. See README.md for how to
+ * make and read a capture.
+ */
+#define SDL_MAIN_USE_CALLBACKS 1 /* use the callbacks instead of main() */
+#include <SDL3/SDL.h>
+#include <SDL3/SDL_main.h>
+#include <SDL3/SDL_app.h>
+#include "VulkanLoader.h"
+#include "Replayer.h"
+
+#include <iostream>
+#include <stdexcept>
+#include <algorithm>
+#include <vector>
+#include <string>
+#include <memory>
+#include <cstring>
+#include <cstdlib>
+#include <cstdint>
+
+/**
+ * The time statistics of one frame over every loop
+ */
+struct FrameStats {
+    uint32_t count = 0;
+    double wallTotal = 0;
+    double wallMin = 0;
+    double wallMax = 0;
+    double gpuTotal = 0;
+    double gpuMin = 0;
+    double gpuMax = 0;
+
+    /**
+     * Adds the time of a replay to these statistics
+     *
+     * @param time  The time of a replay
+     */
+    void add(const Replayer::FrameTime& time) {
+        wallMin = count == 0 ? time.wall : std::min(wallMin, time.wall);
+        wallMax = count == 0 ? time.wall : std::max(wallMax, time.wall);
+        gpuMin = count == 0 ? time.gpu : std::min(gpuMin, time.gpu);
+        gpuMax = count == 0 ? time.gpu : std::max(gpuMax, time.gpu);
+        wallTotal += time.wall;
+        gpuTotal += time.gpu;
+        count++;
+    }
+};
+
+class ReplayApplication {
+public:
+    /**
+     * Sets the capture to replay and how to replay it
+     *
+     * @param file      The capture file
+     * @param loops     The number of times to replay the frames
+     * @param frame     The only frame to replay (or -1 for every frame)
+     */
+    void setCapture(const std::string& file, uint32_t loops, int frame) {
+        path = file;
+        this->loops = loops;
+        only = frame;
+    }
+
+    /**
+     * Sets the file to save the last replayed frame to
+     *
+     * The frame is saved after every loop is done, so pass --loops 1 to
+     * compare it with the same frame in the tutorial.
+     *
+     * @param file      The PNG file to write (empty for none)
+     */
+    void setScreenshot(const std::string& file) {
+        screenshot = file;
+    }
+
+    bool setup() {
+        try {
+            replayer = std::make_unique<Replayer>();
+            replayer->init();
+            replayer->load(path);
+        } catch (const std::exception& e) {
+            std::cerr << e.what() << std::endl;
+            return false;
+        }
+
+        size_t frames = replayer->getFrameCount();
+        if (frames == 0) {
+            SDL_Log("Capture %s has no frames to replay", path.c_str());
+            return false;
+        }
+        if (only >= 0 && static_cast<size_t>(only) >= frames) {
+            SDL_Log("Capture %s only has %zu frames", path.c_str(), frames);
+            return false;
+        }
+
+        stats.resize(frames);
+        SDL_Log("Replaying %zu frames (after %u more) of %s on %s, %u times", frames, replayer->getSkipped(),
+                path.c_str(), replayer->getDeviceName().c_str(), loops);
+        return true;
+    }
+
+    /**
+     * Replays the frames once, returning false when every loop is done
+     *
+     * @return false when every loop is done
+     */
+    bool run() {
+        if (loop == loops) {
+            report();
+            if (!screenshot.empty()) {
+                size_t last = only < 0 ? stats.size() - 1 : static_cast<size_t>(only);
+                if (!replayer->saveFrame(last, screenshot)) {
+                    throw std::runtime_error("failed to save the replayed frame!");
+                }
+            }
+            return false;
+        }
+
+        for (size_t ii = 0; ii < stats.size(); ii++) {
+            if (only < 0 || static_cast<size_t>(only) == ii) {
+                stats[ii].add(replayer->replayFrame(ii));
+            }
+        }
+        loop++;
+        return true;
+    }
+
+    bool consume(SDL_Event* event) {
+        return event->type != SDL_EVENT_QUIT;
+    }
+
+    void wait() {
+        replayer.reset();
+    }
+
+private:
+    /** The replay of the capture */
+    std::unique_ptr<Replayer> replayer;
+    /** The capture file */
+    std::string path;
+    /** The number of times to replay the frames */
+    uint32_t loops = 100;
+    /** The number of times replayed so far */
+    uint32_t loop = 0;
+    /** The only frame to replay (or -1 for every frame) */
+    int only = -1;
+    /** The file to save the last replayed frame to (empty for none) */
+    std::string screenshot;
+    /** The time statistics of each frame */
+    std::vector<FrameStats> stats;
+
+    /**
+     * Logs the time statistics of each frame
+     */
+    void report() {
+        for (size_t ii = 0; ii < stats.size(); ii++) {
+            const FrameStats& frame = stats[ii];
+            if (frame.count == 0) {
+                continue;
+            }
+            if (frame.gpuMin < 0) {
+                SDL_Log("Frame %zu: wall %.3f ms (min %.3f, max %.3f)", ii,
+                        frame.wallTotal / frame.count, frame.wallMin, frame.wallMax);
+            } else {
+                SDL_Log("Frame %zu: wall %.3f ms (min %.3f, max %.3f), gpu %.3f ms (min %.3f, max %.3f)", ii,
+                        frame.wallTotal / frame.count, frame.wallMin, frame.wallMax,
+                        frame.gpuTotal / frame.count, frame.gpuMin, frame.gpuMax);
+            }
+        }
+    }
+};
+
+SDL_AppResult SDL_AppInit(void **appstate, int argc, char *argv[]) {
+    // The replay is headless, so it needs no video
+    if (!SDL_Init(0)) {
+        SDL_Log("Could not initialize SDL: %s", SDL_GetError());
+        return SDL_APP_FAILURE;
+    }
+
+    ReplayApplication* app = new ReplayApplication();
+    *appstate = app;
+
+    // The capture is the first argument (or --capture FILE), replayed --loops N times, or just --frame N
+    // Passing --screenshot FILE saves the last replayed frame
+    std::string capture;
+    std::string screenshot;
+    uint32_t loops = 100;
+    int frame = -1;
+    for (int ii = 1; ii < argc; ii++) {
+        if (argv[ii][0] != '-' && capture.empty()) {
+            capture = argv[ii];
+        } else if (ii+1 == argc) {
+            break;
+        } else if (strcmp(argv[ii], "--capture") == 0) {
+            capture = argv[++ii];
+        } else if (strcmp(argv[ii], "--loops") == 0) {
+            loops = static_cast<uint32_t>(strtoul(argv[++ii], nullptr, 10));
+        } else if (strcmp(argv[ii], "--frame") == 0) {
+            frame = static_cast<int>(strtol(argv[++ii], nullptr, 10));
+        } else if (strcmp(argv[ii], "--screenshot") == 0) {
+            screenshot = argv[++ii];
+        }
+    }
+    if (capture.empty()) {
+        SDL_Log("Usage: Replay CAPTURE [--loops N] [--frame N] [--screenshot FILE]");
+        return SDL_APP_FAILURE;
+    }
+    app->setCapture(capture, loops, frame);
+    app->setScreenshot(screenshot);
+
+    if (app->setup()) {
+        return SDL_APP_CONTINUE;
+    }
+    return SDL_APP_FAILURE;
+}
+
+SDL_AppResult SDL_AppIterate(void *appstate) {
+    ReplayApplication* app = (ReplayApplication*)appstate;
+    try {
+        if (!app->run()) {
+            return SDL_APP_SUCCESS;
+        }
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return SDL_APP_FAILURE;
+    }
+    return SDL_APP_CONTINUE;
+}
+
+SDL_AppResult SDL_AppEvent(void *appstate, SDL_Event *event) {
+    ReplayApplication* app = (ReplayApplication*)appstate;
+    if (app->consume(event)) {
+        return SDL_APP_CONTINUE;
+    }
+    return SDL_APP_SUCCESS;
+}
+
+void SDL_AppQuit(void *appstate, SDL_AppResult result) {
+    ReplayApplication* app = (ReplayApplication*)appstate;
+    if (app != nullptr) {
+        app->wait();
+        delete app;
+    }
+}
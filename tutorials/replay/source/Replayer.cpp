@@ -0,0 +1,1209 @@
+//
+//  Replayer.cpp
+//  Replay
+//
+//  The replay of a frame capture. A capture made with --capture in tutorial 9
+//  or 10 holds the resources, uploads, command buffers, and submissions of a
+//  few frames. This class recreates the resources on a device of its own,
+//  with no window or surface, records the command buffers once, and can then
+//  submit the frames over and over, timing each one. So a slow frame can be
+//  measured in isolation, or bisected across driver versions, including on a
+//  software driver like lavapipe.
+//
+//  The capture has no synchronization, so everything is replayed on a single
+//  queue in submission order. Each command buffer starts with a full memory
+//  barrier, and each frame waits on a fence, which is stricter (and slower)
+//  than the original. The replay is meant for comparing runs with each other,
+//  not with the frame times of the application itself.
+//
+//  Version: 10/18/26
+//
+#include "Replayer.h"
+#include <SDL3/SDL.h>
+#include <SDL3/SDL_image.h>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+#if defined (SDL_PLATFORM_MACOS) || defined(SDL_PLATFORM_IOS)
+#define USE_MOLTEN 1
+#endif
+
+/**
+ * Returns the given image layout, with presentation replaced
+ *
+ * The replay has no swapchain, so its images cannot be presented.
+ *
+ * @param layout    The captured image layout
+ *
+ * @return the given image layout, with presentation replaced
+ */
+static VkImageLayout replay_layout(VkImageLayout layout) {
+    return layout == VK_IMAGE_LAYOUT_PRESENT_SRC_KHR ? VK_IMAGE_LAYOUT_GENERAL : layout;
+}
+
+/**
+ * Creates the instance and a headless device
+ *
+ * The device is the first one with a queue for both graphics and compute.
+ */
+void Replayer::init() {
+    if (!VulkanLoader::init()) {
+        throw std::runtime_error("failed to load Vulkan!");
+    }
+
+    uint32_t loaderVersion = VK_API_VERSION_1_0;
+    vkEnumerateInstanceVersion(&loaderVersion);
+
+    VkApplicationInfo appInfo{};
+    appInfo.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
+    appInfo.pApplicationName = "Capture Replay";
+    appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
+    appInfo.pEngineName = "No Engine";
+    appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
+    appInfo.apiVersion = std::min(loaderVersion, static_cast<uint32_t>(VK_API_VERSION_1_3));
+
+    std::vector<const char*> extensions;
+#ifdef USE_MOLTEN
+    extensions.push_back(VK_KHR_PORTABILITY_ENUMERATION_EXTENSION_NAME);
+    extensions.push_back(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME);
+#endif
+
+    VkInstanceCreateInfo createInfo{};
+    createInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+    createInfo.pApplicationInfo = &appInfo;
+#ifdef USE_MOLTEN
+    createInfo.flags |= VK_INSTANCE_CREATE_ENUMERATE_PORTABILITY_BIT_KHR;
+#endif
+    createInfo.enabledExtensionCount = static_cast<uint32_t>(extensions.size());
+    createInfo.ppEnabledExtensionNames = extensions.data();
+
+    if (vkCreateInstance(&createInfo, nullptr, &instance) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create instance!");
+    }
+    VulkanLoader::loadInstance(instance);
+
+    uint32_t deviceCount = 0;
+    vkEnumeratePhysicalDevices(instance, &deviceCount, nullptr);
+    std::vector<VkPhysicalDevice> devices(deviceCount);
+    vkEnumeratePhysicalDevices(instance, &deviceCount, devices.data());
+
+    for (VkPhysicalDevice candidate : devices) {
+        uint32_t familyCount = 0;
+        vkGetPhysicalDeviceQueueFamilyProperties(candidate, &familyCount, nullptr);
+        std::vector<VkQueueFamilyProperties> families(familyCount);
+        vkGetPhysicalDeviceQueueFamilyProperties(candidate, &familyCount, families.data());
+
+        const VkQueueFlags required = VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT;
+        for (uint32_t ii = 0; ii < familyCount && physicalDevice == VK_NULL_HANDLE; ii++) {
+            if ((families[ii].queueFlags & required) == required) {
+                physicalDevice = candidate;
+                queueFamily = ii;
+            }
+        }
+        if (physicalDevice != VK_NULL_HANDLE) {
+            break;
+        }
+    }
+    if (physicalDevice == VK_NULL_HANDLE) {
+        throw std::runtime_error("failed to find a GPU with graphics and compute!");
+    }
+
+    // The capture does not say which features the pipelines need
+    VkPhysicalDeviceFeatures features{};
+    vkGetPhysicalDeviceFeatures(physicalDevice, &features);
+
+    float priority = 1.0f;
+    VkDeviceQueueCreateInfo queueInfo{};
+    queueInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+    queueInfo.queueFamilyIndex = queueFamily;
+    queueInfo.queueCount = 1;
+    queueInfo.pQueuePriorities = &priority;
+
+    std::vector<const char*> deviceExtensions;
+#ifdef USE_MOLTEN
+    deviceExtensions.push_back("VK_KHR_portability_subset");
+#endif
+
+    VkDeviceCreateInfo deviceInfo{};
+    deviceInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+    deviceInfo.queueCreateInfoCount = 1;
+    deviceInfo.pQueueCreateInfos = &queueInfo;
+    deviceInfo.pEnabledFeatures = &features;
+    deviceInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
+    deviceInfo.ppEnabledExtensionNames = deviceExtensions.data();
+
+    if (vkCreateDevice(physicalDevice, &deviceInfo, nullptr, &device) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create logical device!");
+    }
+    VulkanLoader::loadDevice(device);
+    vkGetDeviceQueue(device, queueFamily, 0, &queue);
+
+    VkCommandPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.queueFamilyIndex = queueFamily;
+    if (vkCreateCommandPool(device, &poolInfo, nullptr, &commandPool) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create command pool!");
+    }
+
+    VkFenceCreateInfo fenceInfo{};
+    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+    if (vkCreateFence(device, &fenceInfo, nullptr, &fence) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create fence!");
+    }
+
+    createTimer();
+}
+
+/**
+ * Destroys the replayed objects and the device
+ */
+void Replayer::dispose() {
+    if (device != VK_NULL_HANDLE) {
+        vkDeviceWaitIdle(device);
+        for (auto it = destroyers.rbegin(); it != destroyers.rend(); ++it) {
+            (*it)();
+        }
+        destroyers.clear();
+        if (queryPool != VK_NULL_HANDLE) {
+            vkDestroyQueryPool(device, queryPool, nullptr);
+            queryPool = VK_NULL_HANDLE;
+        }
+        vkDestroyFence(device, fence, nullptr);
+        vkDestroyCommandPool(device, commandPool, nullptr);
+        vkDestroyDevice(device, nullptr);
+        device = VK_NULL_HANDLE;
+    }
+    if (instance != VK_NULL_HANDLE) {
+        vkDestroyInstance(instance, nullptr);
+        instance = VK_NULL_HANDLE;
+    }
+    VulkanLoader::dispose();
+    frames.clear();
+}
+
+/**
+ * Returns the name of the device
+ *
+ * @return the name of the device
+ */
+std::string Replayer::getDeviceName() const {
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+    return properties.deviceName;
+}
+
+/**
+ * Creates the timestamp queries, if the queue supports them
+ */
+void Replayer::createTimer() {
+    uint32_t familyCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &familyCount, nullptr);
+    std::vector<VkQueueFamilyProperties> families(familyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &familyCount, families.data());
+    if (families[queueFamily].timestampValidBits == 0) {
+        SDL_Log("The queue has no timestamps, so only wall times are reported");
+        return;
+    }
+
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+    timestampPeriod = properties.limits.timestampPeriod;
+
+    VkQueryPoolCreateInfo queryInfo{};
+    queryInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    queryInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    queryInfo.queryCount = 2;
+    if (vkCreateQueryPool(device, &queryInfo, nullptr, &queryPool) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create query pool!");
+    }
+
+    VkCommandBuffer timers[2];
+    VkCommandBufferAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocInfo.commandPool = commandPool;
+    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocInfo.commandBufferCount = 2;
+    if (vkAllocateCommandBuffers(device, &allocInfo, timers) != VK_SUCCESS) {
+        throw std::runtime_error("failed to allocate command buffers!");
+    }
+    timerStart = timers[0];
+    timerEnd = timers[1];
+
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+
+    vkBeginCommandBuffer(timerStart, &beginInfo);
+    vkCmdResetQueryPool(timerStart, queryPool, 0, 2);
+    vkCmdWriteTimestamp(timerStart, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, queryPool, 0);
+    if (vkEndCommandBuffer(timerStart) != VK_SUCCESS) {
+        throw std::runtime_error("failed to record command buffer!");
+    }
+
+    vkBeginCommandBuffer(timerEnd, &beginInfo);
+    vkCmdWriteTimestamp(timerEnd, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, queryPool, 1);
+    if (vkEndCommandBuffer(timerEnd) != VK_SUCCESS) {
+        throw std::runtime_error("failed to record command buffer!");
+    }
+}
+
+/**
+ * Returns the current timed frame, or null if the frame is run at load
+ *
+ * @return the current timed frame
+ */
+Replayer::Frame* Replayer::getFrame() {
+    if (frameCount < skipped) {
+        return nullptr;
+    }
+    size_t index = frameCount - skipped;
+    if (frames.size() <= index) {
+        frames.resize(index + 1);
+    }
+    return &frames[index];
+}
+
+/**
+ * Returns the index of a memory type with the given properties
+ *
+ * If there is no such type, this falls back to any allowed type.
+ *
+ * @param typeFilter    The allowed memory types
+ * @param properties    The preferred memory properties
+ *
+ * @return the index of a memory type with the given properties
+ */
+uint32_t Replayer::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) {
+    VkPhysicalDeviceMemoryProperties memProperties;
+    vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProperties);
+
+    for (uint32_t ii = 0; ii < memProperties.memoryTypeCount; ii++) {
+        if ((typeFilter & (1 << ii)) && (memProperties.memoryTypes[ii].propertyFlags & properties) == properties) {
+            return ii;
+        }
+    }
+    for (uint32_t ii = 0; ii < memProperties.memoryTypeCount; ii++) {
+        if (typeFilter & (1 << ii)) {
+            return ii;
+        }
+    }
+
+    throw std::runtime_error("failed to find suitable memory type!");
+}
+
+/**
+ * Allocates and binds memory for a buffer or image
+ *
+ * @param requirements  The memory requirements
+ * @param properties    The preferred memory properties
+ *
+ * @return the allocated memory
+ */
+VkDeviceMemory Replayer::allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties) {
+    VkMemoryAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = requirements.size;
+    allocInfo.memoryTypeIndex = findMemoryType(requirements.memoryTypeBits, properties);
+
+    VkDeviceMemory memory;
+    if (vkAllocateMemory(device, &allocInfo, nullptr, &memory) != VK_SUCCESS) {
+        throw std::runtime_error("failed to allocate memory!");
+    }
+    VkDevice owner = device;
+    destroyers.push_back([owner, memory]() { vkFreeMemory(owner, memory, nullptr); });
+    return memory;
+}
+
+/**
+ * Submits command buffers and waits for them
+ *
+ * @param commandBuffers    The command buffers
+ */
+void Replayer::submitAndWait(const std::vector<VkCommandBuffer>& commandBuffers) {
+    VkSubmitInfo submitInfo{};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.commandBufferCount = static_cast<uint32_t>(commandBuffers.size());
+    submitInfo.pCommandBuffers = commandBuffers.data();
+
+    vkResetFences(device, 1, &fence);
+    if (vkQueueSubmit(queue, 1, &submitInfo, fence) != VK_SUCCESS) {
+        throw std::runtime_error("failed to submit command buffer!");
+    }
+    vkWaitForFences(device, 1, &fence, VK_TRUE, UINT64_MAX);
+}
+
+/**
+ * Reads a capture, running the frames before the timed ones
+ *
+ * @param path  The capture file
+ */
+void Replayer::load(const std::string& path) {
+    size_t size = 0;
+    uint8_t* contents = static_cast<uint8_t*>(SDL_LoadFile(path.c_str(), &size));
+    if (contents == NULL) {
+        throw std::runtime_error("failed to open capture!");
+    }
+    std::vector<uint8_t> data(contents, contents + size);
+    SDL_free(contents);
+
+    CaptureReader reader(data.data(), data.size());
+    if (reader.get<uint32_t>() != CAPTURE_MAGIC) {
+        throw std::runtime_error("file is not a capture!");
+    }
+    uint32_t version = reader.get<uint32_t>();
+    if (version < CAPTURE_MIN_VERSION || version > CAPTURE_VERSION) {
+        throw std::runtime_error("capture was made by another version!");
+    }
+    skipped = reader.get<uint32_t>();
+    uint32_t count = reader.get<uint32_t>();
+    frameCount = 0;
+    frames.clear();
+    frames.reserve(count);
+
+    while (!reader.isDone()) {
+        CaptureOp op;
+        CaptureReader record = reader.getRecord(op);
+        switch (op) {
+            case CAPTURE_OP_BUFFER_DATA:
+            {
+                uint64_t id = record.getHandle();
+                VkDeviceSize offset = record.get<VkDeviceSize>();
+                auto it = mappedBuffers.find(id);
+                if (it == mappedBuffers.end()) {
+                    throw std::runtime_error("capture writes to a buffer that is not mapped!");
+                }
+
+                Write write;
+                write.target = it->second + offset;
+                write.data = record.getArray<uint8_t>();
+                Frame* frame = getFrame();
+                if (frame == nullptr) {
+                    memcpy(write.target, write.data.data(), write.data.size());
+                } else {
+                    frame->writes.push_back(std::move(write));
+                }
+            }
+                break;
+            case CAPTURE_OP_COMMANDS:
+            {
+                uint64_t id = record.getHandle();
+                std::vector<uint8_t> body = record.getArray<uint8_t>();
+
+                // A command buffer may be captured again before an earlier recording is replayed
+                VkCommandBuffer commandBuffer;
+                VkCommandBufferAllocateInfo allocInfo{};
+                allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+                allocInfo.commandPool = commandPool;
+                allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+                allocInfo.commandBufferCount = 1;
+                if (vkAllocateCommandBuffers(device, &allocInfo, &commandBuffer) != VK_SUCCESS) {
+                    throw std::runtime_error("failed to allocate command buffers!");
+                }
+
+                CaptureReader commands(body.data(), body.size());
+                readCommands(commandBuffer, commands);
+                commandBuffers[id] = commandBuffer;
+            }
+                break;
+            case CAPTURE_OP_SUBMIT:
+            {
+                auto it = commandBuffers.find(record.getHandle());
+                if (it == commandBuffers.end()) {
+                    throw std::runtime_error("capture submits a command buffer it never recorded!");
+                }
+                Frame* frame = getFrame();
+                if (frame == nullptr) {
+                    submitAndWait({ it->second });
+                } else {
+                    frame->submits.push_back(it->second);
+                    auto target = commandTargets.find(it->second);
+                    if (target != commandTargets.end()) {
+                        frame->target = target->second;
+                    }
+                }
+            }
+                break;
+            case CAPTURE_OP_FRAME:
+                frameCount++;
+                break;
+            default:
+                readResource(op, record);
+                break;
+        }
+    }
+
+    // A frame with no uploads or submissions is still a frame
+    if (frameCount > skipped && frames.size() < frameCount - skipped) {
+        frames.resize(frameCount - skipped);
+    }
+}
+
+/**
+ * Replays a resource record
+ *
+ * @param op        The record operation
+ * @param reader    The record reader
+ */
+void Replayer::readResource(CaptureOp op, CaptureReader& reader) {
+    VkDevice owner = device;
+    switch (op) {
+        case CAPTURE_OP_BUFFER:
+        {
+            uint64_t id = reader.getHandle();
+            VkBufferCreateInfo info{};
+            info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+            info.flags = reader.get<VkBufferCreateFlags>();
+            info.size = reader.get<VkDeviceSize>();
+            info.usage = reader.get<VkBufferUsageFlags>();
+            info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+            VkMemoryPropertyFlags properties = reader.get<VkMemoryPropertyFlags>();
+
+            VkBuffer buffer;
+            if (vkCreateBuffer(device, &info, nullptr, &buffer) != VK_SUCCESS) {
+                throw std::runtime_error("failed to create buffer!");
+            }
+            // Destroyed after its memory, as destruction runs in reverse
+            destroyers.push_back([owner, buffer]() { vkDestroyBuffer(owner, buffer, nullptr); });
+
+            VkMemoryRequirements requirements;
+            vkGetBufferMemoryRequirements(device, buffer, &requirements);
+            VkDeviceMemory memory = allocate(requirements, properties);
+            vkBindBufferMemory(device, buffer, memory, 0);
+            buffers[id] = buffer;
+
+            if (properties & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+                void* mapped;
+                if (vkMapMemory(device, memory, 0, info.size, 0, &mapped) != VK_SUCCESS) {
+                    throw std::runtime_error("failed to map buffer memory!");
+                }
+                mappedBuffers[id] = static_cast<uint8_t*>(mapped);
+            }
+        }
+            break;
+        case CAPTURE_OP_IMAGE:
+        {
+            uint64_t id = reader.getHandle();
+            VkImageCreateInfo info{};
+            info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+            info.imageType = VK_IMAGE_TYPE_2D;
+            info.format = reader.get<VkFormat>();
+            VkExtent2D extent = reader.get<VkExtent2D>();
+            info.extent = { extent.width, extent.height, 1 };
+            info.mipLevels = 1;
+            info.arrayLayers = 1;
+            info.samples = VK_SAMPLE_COUNT_1_BIT;
+            info.tiling = VK_IMAGE_TILING_OPTIMAL;
+            info.usage = reader.get<VkImageUsageFlags>();
+            info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+            // Color attachments can always be copied out, to save a frame
+            if (info.usage & VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT) {
+                info.usage |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+            }
+            info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+            VkImage image;
+            if (vkCreateImage(device, &info, nullptr, &image) != VK_SUCCESS) {
+                throw std::runtime_error("failed to create image!");
+            }
+            destroyers.push_back([owner, image]() { vkDestroyImage(owner, image, nullptr); });
+
+            VkMemoryRequirements requirements;
+            vkGetImageMemoryRequirements(device, image, &requirements);
+            vkBindImageMemory(device, image, allocate(requirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT), 0);
+            images[id] = image;
+
+            Target target;
+            target.image = image;
+            target.format = info.format;
+            target.extent = extent;
+            imageTargets[id] = target;
+        }
+            break;
+        case CAPTURE_OP_IMAGE_VIEW:
+        {
+            uint64_t id = reader.getHandle();
+            VkImageViewCreateInfo info = reader.get<VkImageViewCreateInfo>();
+            info.pNext = nullptr;
+            viewTargets[id] = imageTargets[capture_id(info.image)];
+            info.image = remap(images, info.image);
+
+            VkImageView view;
+            if (vkCreateImageView(device, &info, nullptr, &view) != VK_SUCCESS) {
+                throw std::runtime_error("failed to create image view!");
+            }
+            destroyers.push_back([owner, view]() { vkDestroyImageView(owner, view, nullptr); });
+            imageViews[id] = view;
+        }
+            break;
+        case CAPTURE_OP_RENDER_PASS:
+            readRenderPass(reader);
+            break;
+        case CAPTURE_OP_FRAMEBUFFER:
+        {
+            uint64_t id = reader.getHandle();
+            VkFramebufferCreateInfo info = reader.get<VkFramebufferCreateInfo>();
+            std::vector<VkImageView> attachments = reader.getArray<VkImageView>();
+            if (!attachments.empty()) {
+                framebufferTargets[id] = viewTargets[capture_id(attachments[0])];
+            }
+            for (VkImageView& view : attachments) {
+                view = remap(imageViews, view);
+            }
+            info.pNext = nullptr;
+            info.renderPass = remap(renderPasses, info.renderPass);
+            info.pAttachments = attachments.data();
+
+            VkFramebuffer framebuffer;
+            if (vkCreateFramebuffer(device, &info, nullptr, &framebuffer) != VK_SUCCESS) {
+                throw std::runtime_error("failed to create framebuffer!");
+            }
+            destroyers.push_back([owner, framebuffer]() { vkDestroyFramebuffer(owner, framebuffer, nullptr); });
+            framebuffers[id] = framebuffer;
+        }
+            break;
+        case CAPTURE_OP_SHADER_MODULE:
+        {
+            uint64_t id = reader.getHandle();
+            std::vector<uint32_t> code = reader.getArray<uint32_t>();
+
+            VkShaderModuleCreateInfo info{};
+            info.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+            info.codeSize = code.size() * sizeof(uint32_t);
+            info.pCode = code.data();
+
+            VkShaderModule module;
+            if (vkCreateShaderModule(device, &info, nullptr, &module) != VK_SUCCESS) {
+                throw std::runtime_error("failed to create shader module!");
+            }
+            destroyers.push_back([owner, module]() { vkDestroyShaderModule(owner, module, nullptr); });
+            shaderModules[id] = module;
+        }
+            break;
+        case CAPTURE_OP_SET_LAYOUT:
+        {
+            uint64_t id = reader.getHandle();
+            VkDescriptorSetLayoutCreateInfo info = reader.get<VkDescriptorSetLayoutCreateInfo>();
+            std::vector<VkDescriptorSetLayoutBinding> bindings = reader.getArray<VkDescriptorSetLayoutBinding>();
+            for (VkDescriptorSetLayoutBinding& binding : bindings) {
+                binding.pImmutableSamplers = nullptr;
+            }
+            info.pNext = nullptr;
+            info.pBindings = bindings.data();
+
+            VkDescriptorSetLayout layout;
+            if (vkCreateDescriptorSetLayout(device, &info, nullptr, &layout) != VK_SUCCESS) {
+                throw std::runtime_error("failed to create descriptor set layout!");
+            }
+            destroyers.push_back([owner, layout]() { vkDestroyDescriptorSetLayout(owner, layout, nullptr); });
+            setLayouts[id] = layout;
+        }
+            break;
+        case CAPTURE_OP_PIPELINE_LAYOUT:
+        {
+            uint64_t id = reader.getHandle();
+            VkPipelineLayoutCreateInfo info = reader.get<VkPipelineLayoutCreateInfo>();
+            std::vector<VkDescriptorSetLayout> layouts = reader.getArray<VkDescriptorSetLayout>();
+            std::vector<VkPushConstantRange> ranges = reader.getArray<VkPushConstantRange>();
+            for (VkDescriptorSetLayout& layout : layouts) {
+                layout = remap(setLayouts, layout);
+            }
+            info.pNext = nullptr;
+            info.pSetLayouts = layouts.data();
+            info.pPushConstantRanges = ranges.data();
+
+            VkPipelineLayout layout;
+            if (vkCreatePipelineLayout(device, &info, nullptr, &layout) != VK_SUCCESS) {
+                throw std::runtime_error("failed to create pipeline layout!");
+            }
+            destroyers.push_back([owner, layout]() { vkDestroyPipelineLayout(owner, layout, nullptr); });
+            pipelineLayouts[id] = layout;
+        }
+            break;
+        case CAPTURE_OP_GRAPHICS_PIPELINE:
+            readGraphicsPipeline(reader);
+            break;
+        case CAPTURE_OP_COMPUTE_PIPELINE:
+        {
+            uint64_t id = reader.getHandle();
+            VkComputePipelineCreateInfo info = reader.get<VkComputePipelineCreateInfo>();
+            std::string name = reader.getString();
+            info.pNext = nullptr;
+            info.stage.pNext = nullptr;
+            info.stage.module = remap(shaderModules, info.stage.module);
+            info.stage.pName = name.c_str();
+            info.stage.pSpecializationInfo = nullptr;
+            info.layout = remap(pipelineLayouts, info.layout);
+            info.basePipelineHandle = VK_NULL_HANDLE;
+            info.basePipelineIndex = -1;
+
+            VkPipeline pipeline;
+            if (vkCreateComputePipelines(device, VK_NULL_HANDLE, 1, &info, nullptr, &pipeline) != VK_SUCCESS) {
+                throw std::runtime_error("failed to create compute pipeline!");
+            }
+            destroyers.push_back([owner, pipeline]() { vkDestroyPipeline(owner, pipeline, nullptr); });
+            pipelines[id] = pipeline;
+        }
+            break;
+        case CAPTURE_OP_DESCRIPTOR_POOL:
+        {
+            uint64_t id = reader.getHandle();
+            VkDescriptorPoolCreateInfo info = reader.get<VkDescriptorPoolCreateInfo>();
+            std::vector<VkDescriptorPoolSize> sizes = reader.getArray<VkDescriptorPoolSize>();
+            info.pNext = nullptr;
+            info.pPoolSizes = sizes.data();
+
+            VkDescriptorPool pool;
+            if (vkCreateDescriptorPool(device, &info, nullptr, &pool) != VK_SUCCESS) {
+                throw std::runtime_error("failed to create descriptor pool!");
+            }
+            destroyers.push_back([owner, pool]() { vkDestroyDescriptorPool(owner, pool, nullptr); });
+            descriptorPools[id] = pool;
+        }
+            break;
+        case CAPTURE_OP_DESCRIPTOR_SETS:
+        {
+            VkDescriptorSetAllocateInfo info = reader.get<VkDescriptorSetAllocateInfo>();
+            std::vector<VkDescriptorSetLayout> layouts = reader.getArray<VkDescriptorSetLayout>();
+            std::vector<VkDescriptorSet> ids = reader.getArray<VkDescriptorSet>();
+            for (VkDescriptorSetLayout& layout : layouts) {
+                layout = remap(setLayouts, layout);
+            }
+            info.pNext = nullptr;
+            info.descriptorPool = remap(descriptorPools, info.descriptorPool);
+            info.pSetLayouts = layouts.data();
+
+            // The sets are freed with their pool
+            std::vector<VkDescriptorSet> sets(info.descriptorSetCount);
+            if (vkAllocateDescriptorSets(device, &info, sets.data()) != VK_SUCCESS) {
+                throw std::runtime_error("failed to allocate descriptor sets!");
+            }
+            for (size_t ii = 0; ii < sets.size() && ii < ids.size(); ii++) {
+                descriptorSets[capture_id(ids[ii])] = sets[ii];
+            }
+        }
+            break;
+        case CAPTURE_OP_DESCRIPTOR_WRITES:
+            readDescriptorWrites(reader);
+            break;
+        default:
+            throw std::runtime_error("capture has an unknown record!");
+    }
+}
+
+/**
+ * Replays a render pass record
+ *
+ * @param reader    The record reader
+ */
+void Replayer::readRenderPass(CaptureReader& reader) {
+    uint64_t id = reader.getHandle();
+    VkRenderPassCreateInfo info = reader.get<VkRenderPassCreateInfo>();
+    std::vector<VkAttachmentDescription> attachments = reader.getArray<VkAttachmentDescription>();
+    for (VkAttachmentDescription& attachment : attachments) {
+        attachment.initialLayout = replay_layout(attachment.initialLayout);
+        attachment.finalLayout = replay_layout(attachment.finalLayout);
+    }
+    if (!attachments.empty()) {
+        renderPassLayouts[id] = attachments[0].finalLayout;
+    }
+
+    // The references must stay put until the render pass is created
+    std::vector<VkSubpassDescription> subpasses(info.subpassCount);
+    std::vector<std::vector<VkAttachmentReference>> references(info.subpassCount * 4);
+    std::vector<std::vector<uint32_t>> preserves(info.subpassCount);
+    for (uint32_t ii = 0; ii < info.subpassCount; ii++) {
+        VkSubpassDescription& subpass = subpasses[ii];
+        subpass = reader.get<VkSubpassDescription>();
+        std::vector<VkAttachmentReference>* lists = &references[ii * 4];
+        for (int jj = 0; jj < 4; jj++) {
+            lists[jj] = reader.getArray<VkAttachmentReference>();
+            for (VkAttachmentReference& reference : lists[jj]) {
+                reference.layout = replay_layout(reference.layout);
+            }
+        }
+        preserves[ii] = reader.getArray<uint32_t>();
+
+        subpass.pInputAttachments = lists[0].data();
+        subpass.pColorAttachments = lists[1].data();
+        subpass.pResolveAttachments = lists[2].empty() ? nullptr : lists[2].data();
+        subpass.pDepthStencilAttachment = lists[3].empty() ? nullptr : lists[3].data();
+        subpass.pPreserveAttachments = preserves[ii].data();
+    }
+    std::vector<VkSubpassDependency> dependencies = reader.getArray<VkSubpassDependency>();
+
+    info.pNext = nullptr;
+    info.pAttachments = attachments.data();
+    info.pSubpasses = subpasses.data();
+    info.pDependencies = dependencies.data();
+
+    VkRenderPass renderPass;
+    if (vkCreateRenderPass(device, &info, nullptr, &renderPass) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create render pass!");
+    }
+    VkDevice owner = device;
+    destroyers.push_back([owner, renderPass]() { vkDestroyRenderPass(owner, renderPass, nullptr); });
+    renderPasses[id] = renderPass;
+}
+
+/**
+ * Replays a graphics pipeline record
+ *
+ * @param reader    The record reader
+ */
+void Replayer::readGraphicsPipeline(CaptureReader& reader) {
+    uint64_t id = reader.getHandle();
+    VkGraphicsPipelineCreateInfo info = reader.get<VkGraphicsPipelineCreateInfo>();
+
+    std::vector<VkPipelineShaderStageCreateInfo> stages(info.stageCount);
+    std::vector<std::string> names(info.stageCount);
+    for (uint32_t ii = 0; ii < info.stageCount; ii++) {
+        stages[ii] = reader.get<VkPipelineShaderStageCreateInfo>();
+        names[ii] = reader.getString();
+        stages[ii].pNext = nullptr;
+        stages[ii].module = remap(shaderModules, stages[ii].module);
+        stages[ii].pName = names[ii].c_str();
+        stages[ii].pSpecializationInfo = nullptr;
+    }
+
+    VkPipelineVertexInputStateCreateInfo vertexInput;
+    std::vector<VkVertexInputBindingDescription> vertexBindings;
+    std::vector<VkVertexInputAttributeDescription> vertexAttributes;
+    info.pVertexInputState = getState(reader, vertexInput);
+    if (info.pVertexInputState != nullptr) {
+        vertexBindings = reader.getArray<VkVertexInputBindingDescription>();
+        vertexAttributes = reader.getArray<VkVertexInputAttributeDescription>();
+        vertexInput.pVertexBindingDescriptions = vertexBindings.data();
+        vertexInput.pVertexAttributeDescriptions = vertexAttributes.data();
+    }
+
+    VkPipelineInputAssemblyStateCreateInfo inputAssembly;
+    info.pInputAssemblyState = getState(reader, inputAssembly);
+
+    VkPipelineViewportStateCreateInfo viewportState;
+    std::vector<VkViewport> viewports;
+    std::vector<VkRect2D> scissors;
+    info.pViewportState = getState(reader, viewportState);
+    if (info.pViewportState != nullptr) {
+        viewports = reader.getArray<VkViewport>();
+        scissors = reader.getArray<VkRect2D>();
+        viewportState.pViewports = viewports.empty() ? nullptr : viewports.data();
+        viewportState.pScissors = scissors.empty() ? nullptr : scissors.data();
+    }
+
+    VkPipelineRasterizationStateCreateInfo rasterizer;
+    info.pRasterizationState = getState(reader, rasterizer);
+
+    VkPipelineMultisampleStateCreateInfo multisampling;
+    info.pMultisampleState = getState(reader, multisampling);
+    if (info.pMultisampleState != nullptr) {
+        multisampling.pSampleMask = nullptr;
+    }
+
+    VkPipelineDepthStencilStateCreateInfo depthStencil;
+    info.pDepthStencilState = getState(reader, depthStencil);
+
+    VkPipelineColorBlendStateCreateInfo colorBlending;
+    std::vector<VkPipelineColorBlendAttachmentState> blendAttachments;
+    info.pColorBlendState = getState(reader, colorBlending);
+    if (info.pColorBlendState != nullptr) {
+        blendAttachments = reader.getArray<VkPipelineColorBlendAttachmentState>();
+        colorBlending.pAttachments = blendAttachments.data();
+    }
+
+    VkPipelineDynamicStateCreateInfo dynamicState;
+    std::vector<VkDynamicState> dynamicStates;
+    info.pDynamicState = getState(reader, dynamicState);
+    if (info.pDynamicState != nullptr) {
+        dynamicStates = reader.getArray<VkDynamicState>();
+        dynamicState.pDynamicStates = dynamicStates.data();
+    }
+
+    info.pNext = nullptr;
+    info.pStages = stages.data();
+    info.pTessellationState = nullptr;
+    info.layout = remap(pipelineLayouts, info.layout);
+    info.renderPass = remap(renderPasses, info.renderPass);
+    info.basePipelineHandle = VK_NULL_HANDLE;
+    info.basePipelineIndex = -1;
+
+    VkPipeline pipeline;
+    if (vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &info, nullptr, &pipeline) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create graphics pipeline!");
+    }
+    VkDevice owner = device;
+    destroyers.push_back([owner, pipeline]() { vkDestroyPipeline(owner, pipeline, nullptr); });
+    pipelines[id] = pipeline;
+}
+
+/**
+ * Replays a descriptor writes record
+ *
+ * @param reader    The record reader
+ */
+void Replayer::readDescriptorWrites(CaptureReader& reader) {
+    uint32_t count = reader.get<uint32_t>();
+    std::vector<VkWriteDescriptorSet> writes(count);
+    std::vector<std::vector<VkDescriptorBufferInfo>> bufferInfos(count);
+    for (uint32_t ii = 0; ii < count; ii++) {
+        writes[ii] = reader.get<VkWriteDescriptorSet>();
+        bufferInfos[ii] = reader.getArray<VkDescriptorBufferInfo>();
+        for (VkDescriptorBufferInfo& bufferInfo : bufferInfos[ii]) {
+            bufferInfo.buffer = remap(buffers, bufferInfo.buffer);
+        }
+        writes[ii].pNext = nullptr;
+        writes[ii].dstSet = remap(descriptorSets, writes[ii].dstSet);
+        writes[ii].pBufferInfo = bufferInfos[ii].data();
+        writes[ii].pImageInfo = nullptr;
+        writes[ii].pTexelBufferView = nullptr;
+    }
+    vkUpdateDescriptorSets(device, count, writes.data(), 0, nullptr);
+}
+
+/**
+ * Records the captured commands of a command buffer
+ *
+ * @param commandBuffer The command buffer to record into
+ * @param reader        The reader over the commands
+ */
+void Replayer::readCommands(VkCommandBuffer commandBuffer, CaptureReader& reader) {
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS) {
+        throw std::runtime_error("failed to begin recording command buffer!");
+    }
+
+    // This stands in for the semaphores the capture leaves out
+    VkMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_MEMORY_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+                         0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+    while (!reader.isDone()) {
+        CaptureOp op;
+        CaptureReader command = reader.getRecord(op);
+        switch (op) {
+            case CAPTURE_CMD_PIPELINE_BARRIER:
+                readBarrier(commandBuffer, command);
+                break;
+            case CAPTURE_CMD_BIND_PIPELINE:
+            {
+                VkPipelineBindPoint bindPoint = command.get<VkPipelineBindPoint>();
+                VkPipeline pipeline = remap(pipelines, command.get<VkPipeline>());
+                vkCmdBindPipeline(commandBuffer, bindPoint, pipeline);
+            }
+                break;
+            case CAPTURE_CMD_BIND_DESCRIPTOR_SETS:
+            {
+                VkPipelineBindPoint bindPoint = command.get<VkPipelineBindPoint>();
+                VkPipelineLayout layout = remap(pipelineLayouts, command.get<VkPipelineLayout>());
+                uint32_t firstSet = command.get<uint32_t>();
+                std::vector<VkDescriptorSet> sets = command.getArray<VkDescriptorSet>();
+                std::vector<uint32_t> offsets = command.getArray<uint32_t>();
+                for (VkDescriptorSet& set : sets) {
+                    set = remap(descriptorSets, set);
+                }
+                vkCmdBindDescriptorSets(commandBuffer, bindPoint, layout, firstSet,
+                                        static_cast<uint32_t>(sets.size()), sets.data(),
+                                        static_cast<uint32_t>(offsets.size()), offsets.data());
+            }
+                break;
+            case CAPTURE_CMD_DISPATCH:
+            {
+                uint32_t x = command.get<uint32_t>();
+                uint32_t y = command.get<uint32_t>();
+                uint32_t z = command.get<uint32_t>();
+                vkCmdDispatch(commandBuffer, x, y, z);
+            }
+                break;
+            case CAPTURE_CMD_BEGIN_RENDER_PASS:
+            {
+                VkRenderPassBeginInfo info = command.get<VkRenderPassBeginInfo>();
+                std::vector<VkClearValue> clearValues = command.getArray<VkClearValue>();
+                VkSubpassContents contents = command.get<VkSubpassContents>();
+                Target target = framebufferTargets[capture_id(info.framebuffer)];
+                target.layout = renderPassLayouts[capture_id(info.renderPass)];
+                commandTargets[commandBuffer] = target;
+                info.pNext = nullptr;
+                info.renderPass = remap(renderPasses, info.renderPass);
+                info.framebuffer = remap(framebuffers, info.framebuffer);
+                info.pClearValues = clearValues.data();
+                vkCmdBeginRenderPass(commandBuffer, &info, contents);
+            }
+                break;
+            case CAPTURE_CMD_END_RENDER_PASS:
+                vkCmdEndRenderPass(commandBuffer);
+                break;
+            case CAPTURE_CMD_SET_VIEWPORT:
+            {
+                uint32_t first = command.get<uint32_t>();
+                std::vector<VkViewport> viewports = command.getArray<VkViewport>();
+                vkCmdSetViewport(commandBuffer, first, static_cast<uint32_t>(viewports.size()), viewports.data());
+            }
+                break;
+            case CAPTURE_CMD_SET_SCISSOR:
+            {
+                uint32_t first = command.get<uint32_t>();
+                std::vector<VkRect2D> scissors = command.getArray<VkRect2D>();
+                vkCmdSetScissor(commandBuffer, first, static_cast<uint32_t>(scissors.size()), scissors.data());
+            }
+                break;
+            case CAPTURE_CMD_BIND_VERTEX_BUFFERS:
+            {
+                uint32_t first = command.get<uint32_t>();
+                std::vector<VkBuffer> vertexBuffers = command.getArray<VkBuffer>();
+                std::vector<VkDeviceSize> offsets = command.getArray<VkDeviceSize>();
+                for (VkBuffer& buffer : vertexBuffers) {
+                    buffer = remap(buffers, buffer);
+                }
+                vkCmdBindVertexBuffers(commandBuffer, first, static_cast<uint32_t>(vertexBuffers.size()),
+                                       vertexBuffers.data(), offsets.data());
+            }
+                break;
+            case CAPTURE_CMD_DRAW:
+            {
+                uint32_t vertexCount = command.get<uint32_t>();
+                uint32_t instanceCount = command.get<uint32_t>();
+                uint32_t firstVertex = command.get<uint32_t>();
+                uint32_t firstInstance = command.get<uint32_t>();
+                vkCmdDraw(commandBuffer, vertexCount, instanceCount, firstVertex, firstInstance);
+            }
+                break;
+            case CAPTURE_CMD_COPY_BUFFER:
+            {
+                VkBuffer src = remap(buffers, command.get<VkBuffer>());
+                VkBuffer dst = remap(buffers, command.get<VkBuffer>());
+                std::vector<VkBufferCopy> regions = command.getArray<VkBufferCopy>();
+                vkCmdCopyBuffer(commandBuffer, src, dst, static_cast<uint32_t>(regions.size()), regions.data());
+            }
+                break;
+            case CAPTURE_CMD_BIND_INDEX_BUFFER:
+            {
+                VkBuffer buffer = remap(buffers, command.get<VkBuffer>());
+                VkDeviceSize offset = command.get<VkDeviceSize>();
+                VkIndexType indexType = command.get<VkIndexType>();
+                vkCmdBindIndexBuffer(commandBuffer, buffer, offset, indexType);
+            }
+                break;
+            case CAPTURE_CMD_DISPATCH_INDIRECT:
+            {
+                VkBuffer buffer = remap(buffers, command.get<VkBuffer>());
+                VkDeviceSize offset = command.get<VkDeviceSize>();
+                vkCmdDispatchIndirect(commandBuffer, buffer, offset);
+            }
+                break;
+            case CAPTURE_CMD_DRAW_INDEXED_INDIRECT:
+            {
+                VkBuffer buffer = remap(buffers, command.get<VkBuffer>());
+                VkDeviceSize offset = command.get<VkDeviceSize>();
+                uint32_t drawCount = command.get<uint32_t>();
+                uint32_t stride = command.get<uint32_t>();
+                vkCmdDrawIndexedIndirect(commandBuffer, buffer, offset, drawCount, stride);
+            }
+                break;
+            default:
+                throw std::runtime_error("capture has an unknown command!");
+        }
+    }
+
+    if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+        throw std::runtime_error("failed to record command buffer!");
+    }
+}
+
+/**
+ * Records a captured pipeline barrier
+ *
+ * @param commandBuffer The command buffer to record into
+ * @param reader        The command reader
+ */
+void Replayer::readBarrier(VkCommandBuffer commandBuffer, CaptureReader& reader) {
+    VkPipelineStageFlags srcStage = reader.get<VkPipelineStageFlags>();
+    VkPipelineStageFlags dstStage = reader.get<VkPipelineStageFlags>();
+    VkDependencyFlags dependencies = reader.get<VkDependencyFlags>();
+    std::vector<VkMemoryBarrier> memoryBarriers = reader.getArray<VkMemoryBarrier>();
+    std::vector<VkBufferMemoryBarrier> bufferBarriers = reader.getArray<VkBufferMemoryBarrier>();
+    std::vector<VkImageMemoryBarrier> imageBarriers = reader.getArray<VkImageMemoryBarrier>();
+
+    // There is only one queue, so there are no ownership transfers
+    for (VkMemoryBarrier& barrier : memoryBarriers) {
+        barrier.pNext = nullptr;
+    }
+    for (VkBufferMemoryBarrier& barrier : bufferBarriers) {
+        barrier.pNext = nullptr;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.buffer = remap(buffers, barrier.buffer);
+    }
+    for (VkImageMemoryBarrier& barrier : imageBarriers) {
+        barrier.pNext = nullptr;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.oldLayout = replay_layout(barrier.oldLayout);
+        barrier.newLayout = replay_layout(barrier.newLayout);
+        barrier.image = remap(images, barrier.image);
+    }
+
+    vkCmdPipelineBarrier(commandBuffer, srcStage, dstStage, dependencies,
+                         static_cast<uint32_t>(memoryBarriers.size()), memoryBarriers.data(),
+                         static_cast<uint32_t>(bufferBarriers.size()), bufferBarriers.data(),
+                         static_cast<uint32_t>(imageBarriers.size()), imageBarriers.data());
+}
+
+/**
+ * Submits a timed frame and waits for it
+ *
+ * @param index The frame index
+ *
+ * @return the time of the frame
+ */
+Replayer::FrameTime Replayer::replayFrame(size_t index) {
+    const Frame& frame = frames.at(index);
+
+    std::vector<VkCommandBuffer> batch;
+    batch.reserve(frame.submits.size() + 2);
+    if (queryPool != VK_NULL_HANDLE) {
+        batch.push_back(timerStart);
+    }
+    batch.insert(batch.end(), frame.submits.begin(), frame.submits.end());
+    if (queryPool != VK_NULL_HANDLE) {
+        batch.push_back(timerEnd);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    for (const Write& write : frame.writes) {
+        memcpy(write.target, write.data.data(), write.data.size());
+    }
+    submitAndWait(batch);
+    auto finish = std::chrono::steady_clock::now();
+
+    FrameTime result;
+    result.wall = std::chrono::duration<double, std::milli>(finish - start).count();
+    result.gpu = -1;
+    if (queryPool != VK_NULL_HANDLE) {
+        uint64_t stamps[2];
+        if (vkGetQueryPoolResults(device, queryPool, 0, 2, sizeof(stamps), stamps, sizeof(uint64_t),
+                                  VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT) == VK_SUCCESS) {
+            result.gpu = (stamps[1] - stamps[0]) * timestampPeriod / 1000000.0;
+        }
+    }
+    return result;
+}
+
+/**
+ * Saves the color image of the last render pass in a timed frame
+ *
+ * The image is saved as a PNG file. The frame should have just been
+ * replayed, and only 8-bit RGBA and BGRA images can be saved.
+ *
+ * @param index The frame index
+ * @param path  The file to write
+ *
+ * @return true if the file was written
+ */
+bool Replayer::saveFrame(size_t index, const std::string& path) {
+    const Target& target = frames.at(index).target;
+    if (target.image == VK_NULL_HANDLE) {
+        SDL_Log("Failed to save frame to %s: the frame has no render pass", path.c_str());
+        return false;
+    }
+
+    // The byte order of the formats matches the SDL array formats
+    SDL_PixelFormat pixelFormat;
+    switch (target.format) {
+        case VK_FORMAT_R8G8B8A8_UNORM:
+        case VK_FORMAT_R8G8B8A8_SRGB:
+            pixelFormat = SDL_PIXELFORMAT_RGBA32;
+            break;
+        case VK_FORMAT_B8G8R8A8_UNORM:
+        case VK_FORMAT_B8G8R8A8_SRGB:
+            pixelFormat = SDL_PIXELFORMAT_BGRA32;
+            break;
+        default:
+            SDL_Log("Failed to save frame to %s: the image format is not 8-bit color", path.c_str());
+            return false;
+    }
+
+    VkDeviceSize size = static_cast<VkDeviceSize>(target.extent.width) * target.extent.height * 4;
+    VkBufferCreateInfo bufferInfo{};
+    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.size = size;
+    bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    VkBuffer buffer;
+    if (vkCreateBuffer(device, &bufferInfo, nullptr, &buffer) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create readback buffer!");
+    }
+    VkDevice owner = device;
+    destroyers.push_back([owner, buffer]() { vkDestroyBuffer(owner, buffer, nullptr); });
+
+    VkMemoryRequirements requirements;
+    vkGetBufferMemoryRequirements(device, buffer, &requirements);
+    VkDeviceMemory memory = allocate(requirements, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+    vkBindBufferMemory(device, buffer, memory, 0);
+
+    VkCommandBuffer commandBuffer;
+    VkCommandBufferAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocInfo.commandPool = commandPool;
+    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocInfo.commandBufferCount = 1;
+    if (vkAllocateCommandBuffers(device, &allocInfo, &commandBuffer) != VK_SUCCESS) {
+        throw std::runtime_error("failed to allocate command buffers!");
+    }
+
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    vkBeginCommandBuffer(commandBuffer, &beginInfo);
+
+    VkImageMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    barrier.oldLayout = target.layout;
+    barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = target.image;
+    barrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+    VkBufferImageCopy region{};
+    region.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+    region.imageExtent = { target.extent.width, target.extent.height, 1 };
+    vkCmdCopyImageToBuffer(commandBuffer, target.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, buffer, 1, &region);
+
+    // Put the image back, in case the frame is replayed again
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    barrier.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    barrier.newLayout = target.layout;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+                         0, 0, nullptr, 0, nullptr, 1, &barrier);
+    vkEndCommandBuffer(commandBuffer);
+
+    submitAndWait({ commandBuffer });
+    vkFreeCommandBuffers(device, commandPool, 1, &commandBuffer);
+
+    void* data;
+    vkMapMemory(device, memory, 0, VK_WHOLE_SIZE, 0, &data);
+    SDL_Surface* surface = SDL_CreateSurfaceFrom(target.extent.width, target.extent.height, pixelFormat, data, target.extent.width * 4);
+    bool success = false;
+    if (surface != nullptr) {
+        success = IMG_SavePNG(surface, path.c_str());
+        SDL_DestroySurface(surface);
+    }
+    vkUnmapMemory(device, memory);
+
+    if (success) {
+        SDL_Log("Saved frame to %s", path.c_str());
+    } else {
+        SDL_Log("Failed to save frame to %s: %s", path.c_str(), SDL_GetError());
+    }
+    return success;
+}
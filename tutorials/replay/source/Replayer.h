@@ -0,0 +1,348 @@
+//
+//  Replayer.h
+//  Replay
+//
+//  The replay of a frame capture. A capture made with --capture in tutorial 9
+//  or 10 holds the resources, uploads, command buffers, and submissions of a
+//  few frames. This class recreates the resources on a device of its own,
+//  with no window or surface, records the command buffers once, and can then
+//  submit the frames over and over, timing each one. So a slow frame can be
+//  measured in isolation, or bisected across driver versions, including on a
+//  software driver like lavapipe.
+//
+//  The capture has no synchronization, so everything is replayed on a single
+//  queue in submission order. Each command buffer starts with a full memory
+//  barrier, and each frame waits on a fence, which is stricter (and slower)
+//  than the original. The replay is meant for comparing runs with each other,
+//  not with the frame times of the application itself.
+//
+//  Version: 10/18/26
+//
+#ifndef __REPLAYER_H__
+#define __REPLAYER_H__
+#include "VulkanLoader.h"
+#include "CaptureFormat.h"
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <cstdint>
+
+/**
+ * A player of frame captures.
+ *
+ * The frames before the capture window are run once by {@link load}, so
+ * that the timed frames start from the same state as they did in the
+ * application. The timed frames are only recorded, and are submitted by
+ * {@link replayFrame}.
+ *
+ * The methods throw a runtime error if the device cannot be created or the
+ * capture cannot be read.
+ */
+class Replayer {
+public:
+    /**
+     * The time of a single replayed frame
+     */
+    struct FrameTime {
+        /** The time from submission to the fence in milliseconds */
+        double wall;
+        /** The time between the first and last timestamp in milliseconds (negative if unknown) */
+        double gpu;
+    };
+
+private:
+    /**
+     * An upload made by a timed frame
+     */
+    struct Write {
+        /** The mapped memory to write to */
+        uint8_t* target;
+        /** The data to write */
+        std::vector<uint8_t> data;
+    };
+
+    /**
+     * The color image drawn by a render pass, so that a frame can be saved
+     */
+    struct Target {
+        /** The replayed image (null if there is none) */
+        VkImage image = VK_NULL_HANDLE;
+        /** The image format */
+        VkFormat format = VK_FORMAT_UNDEFINED;
+        /** The image size */
+        VkExtent2D extent = {0, 0};
+        /** The layout the render pass leaves the image in */
+        VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+    };
+
+    /**
+     * The work of a timed frame
+     */
+    struct Frame {
+        /** The uploads of the frame, made before it is submitted */
+        std::vector<Write> writes;
+        /** The command buffers of the frame, in submission order */
+        std::vector<VkCommandBuffer> submits;
+        /** The color image of the last render pass in the frame */
+        Target target;
+    };
+
+    /** The Vulkan instance */
+    VkInstance instance = VK_NULL_HANDLE;
+    /** The physical device */
+    VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
+    /** The logical device */
+    VkDevice device = VK_NULL_HANDLE;
+    /** The queue family for graphics and compute */
+    uint32_t queueFamily = 0;
+    /** The only queue */
+    VkQueue queue = VK_NULL_HANDLE;
+    /** The pool for every command buffer */
+    VkCommandPool commandPool = VK_NULL_HANDLE;
+    /** The fence for each frame */
+    VkFence fence = VK_NULL_HANDLE;
+    /** The timestamps at the start and end of a frame (null if not supported) */
+    VkQueryPool queryPool = VK_NULL_HANDLE;
+    /** The nanoseconds per timestamp tick */
+    double timestampPeriod = 0;
+    /** The command buffer with the first timestamp */
+    VkCommandBuffer timerStart = VK_NULL_HANDLE;
+    /** The command buffer with the last timestamp */
+    VkCommandBuffer timerEnd = VK_NULL_HANDLE;
+
+    /** The replayed objects, by their capture ids */
+    std::unordered_map<uint64_t, VkBuffer> buffers;
+    std::unordered_map<uint64_t, uint8_t*> mappedBuffers;
+    std::unordered_map<uint64_t, VkImage> images;
+    std::unordered_map<uint64_t, VkImageView> imageViews;
+    std::unordered_map<uint64_t, VkRenderPass> renderPasses;
+    std::unordered_map<uint64_t, VkFramebuffer> framebuffers;
+    std::unordered_map<uint64_t, VkShaderModule> shaderModules;
+    std::unordered_map<uint64_t, VkDescriptorSetLayout> setLayouts;
+    std::unordered_map<uint64_t, VkPipelineLayout> pipelineLayouts;
+    std::unordered_map<uint64_t, VkPipeline> pipelines;
+    std::unordered_map<uint64_t, VkDescriptorPool> descriptorPools;
+    std::unordered_map<uint64_t, VkDescriptorSet> descriptorSets;
+    /** The last recording of each command buffer */
+    std::unordered_map<uint64_t, VkCommandBuffer> commandBuffers;
+    /** The color image behind each captured image, view, and framebuffer */
+    std::unordered_map<uint64_t, Target> imageTargets;
+    std::unordered_map<uint64_t, Target> viewTargets;
+    std::unordered_map<uint64_t, Target> framebufferTargets;
+    /** The final layout of the first attachment of each render pass */
+    std::unordered_map<uint64_t, VkImageLayout> renderPassLayouts;
+    /** The color image of the last render pass in each recording */
+    std::unordered_map<VkCommandBuffer, Target> commandTargets;
+    /** The destruction of every object, in creation order */
+    std::vector<std::function<void()>> destroyers;
+
+    /** The number of frames run at load */
+    uint32_t skipped = 0;
+    /** The number of frames read so far */
+    uint32_t frameCount = 0;
+    /** The timed frames */
+    std::vector<Frame> frames;
+
+    /**
+     * Returns the replayed object for a captured handle
+     *
+     * @param objects   The replayed objects of this type
+     * @param handle    The captured handle
+     *
+     * @return the replayed object for a captured handle
+     */
+    template <typename T>
+    static T remap(const std::unordered_map<uint64_t, T>& objects, T handle) {
+        uint64_t id = capture_id(handle);
+        if (id == 0) {
+            return handle;
+        }
+        auto it = objects.find(id);
+        if (it == objects.end()) {
+            throw std::runtime_error("capture uses an object it never created!");
+        }
+        return it->second;
+    }
+
+    /**
+     * Reads an optional pipeline state, returning null if it is not present
+     *
+     * @param reader    The record reader
+     * @param state     The state to read into
+     *
+     * @return the state, or null if it is not present
+     */
+    template <typename T>
+    static T* getState(CaptureReader& reader, T& state) {
+        if (reader.get<uint32_t>() == 0) {
+            return nullptr;
+        }
+        state = reader.get<T>();
+        state.pNext = nullptr;
+        return &state;
+    }
+
+    /**
+     * Returns the current timed frame, or null if the frame is run at load
+     *
+     * @return the current timed frame
+     */
+    Frame* getFrame();
+
+    /**
+     * Returns the index of a memory type with the given properties
+     *
+     * If there is no such type, this falls back to any allowed type.
+     *
+     * @param typeFilter    The allowed memory types
+     * @param properties    The preferred memory properties
+     *
+     * @return the index of a memory type with the given properties
+     */
+    uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties);
+
+    /**
+     * Allocates and binds memory for a buffer or image
+     *
+     * @param requirements  The memory requirements
+     * @param properties    The preferred memory properties
+     *
+     * @return the allocated memory
+     */
+    VkDeviceMemory allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties);
+
+    /**
+     * Submits command buffers and waits for them
+     *
+     * @param commandBuffers    The command buffers
+     */
+    void submitAndWait(const std::vector<VkCommandBuffer>& commandBuffers);
+
+    /**
+     * Creates the timestamp queries, if the queue supports them
+     */
+    void createTimer();
+
+    /**
+     * Replays a resource record
+     *
+     * @param op        The record operation
+     * @param reader    The record reader
+     */
+    void readResource(CaptureOp op, CaptureReader& reader);
+
+    /**
+     * Replays a graphics pipeline record
+     *
+     * @param reader    The record reader
+     */
+    void readGraphicsPipeline(CaptureReader& reader);
+
+    /**
+     * Replays a render pass record
+     *
+     * @param reader    The record reader
+     */
+    void readRenderPass(CaptureReader& reader);
+
+    /**
+     * Replays a descriptor writes record
+     *
+     * @param reader    The record reader
+     */
+    void readDescriptorWrites(CaptureReader& reader);
+
+    /**
+     * Records the captured commands of a command buffer
+     *
+     * @param commandBuffer The command buffer to record into
+     * @param reader        The reader over the commands
+     */
+    void readCommands(VkCommandBuffer commandBuffer, CaptureReader& reader);
+
+    /**
+     * Records a captured pipeline barrier
+     *
+     * @param commandBuffer The command buffer to record into
+     * @param reader        The command reader
+     */
+    void readBarrier(VkCommandBuffer commandBuffer, CaptureReader& reader);
+
+public:
+    /**
+     * Creates a replayer with no device
+     */
+    Replayer() {}
+
+    /**
+     * Disposes of this replayer, destroying the device
+     */
+    ~Replayer() { dispose(); }
+
+    /**
+     * Creates the instance and a headless device
+     *
+     * The device is the first one with a queue for both graphics and compute.
+     */
+    void init();
+
+    /**
+     * Destroys the replayed objects and the device
+     */
+    void dispose();
+
+    /**
+     * Reads a capture, running the frames before the timed ones
+     *
+     * @param path  The capture file
+     */
+    void load(const std::string& path);
+
+    /**
+     * Returns the name of the device
+     *
+     * @return the name of the device
+     */
+    std::string getDeviceName() const;
+
+    /**
+     * Returns the number of timed frames
+     *
+     * @return the number of timed frames
+     */
+    size_t getFrameCount() const { return frames.size(); }
+
+    /**
+     * Returns the number of frames run at load
+     *
+     * @return the number of frames run at load
+     */
+    uint32_t getSkipped() const { return skipped; }
+
+    /**
+     * Submits a timed frame and waits for it
+     *
+     * @param index The frame index
+     *
+     * @return the time of the frame
+     */
+    FrameTime replayFrame(size_t index);
+
+    /**
+     * Saves the color image of the last render pass in a timed frame
+     *
+     * The image is saved as a PNG file. The frame should have just been
+     * replayed, and only 8-bit RGBA and BGRA images can be saved. Comparing
+     * the file with a screenshot of the same frame in the application checks
+     * that the capture and the replay are faithful.
+     *
+     * @param index The frame index
+     * @param path  The file to write
+     *
+     * @return true if the file was written
+     */
+    bool saveFrame(size_t index, const std::string& path);
+};
+
+#endif /* __REPLAYER_H__ */
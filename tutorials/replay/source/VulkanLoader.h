@@ -0,0 +1,84 @@
+//
+//  VulkanLoader.h
+//  Replay
+//
+//  A loader for the Vulkan functions, in the style of volk. Linking against
+//  the Vulkan loader means that every call goes through a loader trampoline,
+//  which looks up the dispatch table of the device before calling the driver.
+//  That is one more indirect jump per call, and it adds up when recording
+//  thousands of commands a frame.
+//
+//  So this application does not link the loader at all, and is compiled with
+//  VK_NO_PROTOTYPES. Each Vulkan function it calls is instead a global
+//  function pointer with the same name, so the calls themselves are unchanged.
+//  The pointers start out as loader functions, fetched with
+//  vkGetInstanceProcAddr, and the device functions are replaced with the ones
+//  from vkGetDeviceProcAddr once there is a device. Those point straight into
+//  the driver (or the first layer, when validation is on).
+//
+//  The functions are listed in VulkanFunctions.h, which is generated by the
+//  script tutorials/dispatch.py. This header must be included instead of
+//  <vulkan/vulkan.h>.
+//
+//  Version: 10/18/26
+//
+#ifndef __VULKAN_LOADER_H__
+#define __VULKAN_LOADER_H__
+#ifndef VK_NO_PROTOTYPES
+#define VK_NO_PROTOTYPES
+#endif
+#include <vulkan/vulkan.h>
+
+/** The entry points of the loader, which fetch the other functions */
+extern PFN_vkGetInstanceProcAddr vkGetInstanceProcAddr;
+extern PFN_vkGetDeviceProcAddr vkGetDeviceProcAddr;
+
+#define VK_GLOBAL_FUNCTION(name)    extern PFN_##name name;
+#define VK_INSTANCE_FUNCTION(name)  extern PFN_##name name;
+#define VK_DEVICE_FUNCTION(name)    extern PFN_##name name;
+#include "VulkanFunctions.h"
+
+/**
+ * The loader of the Vulkan function pointers.
+ *
+ * The functions must be loaded in order: {@link init} before any Vulkan call,
+ * {@link loadInstance} right after the instance is created, and
+ * {@link loadDevice} right after the device is created. Until the last step,
+ * the device functions go through the loader trampolines, which still works.
+ *
+ * Only one instance and one device are supported, as the pointers are global.
+ */
+class VulkanLoader {
+public:
+    /**
+     * Loads the Vulkan library and the global functions
+     *
+     * If the video subsystem is initialized, this uses the library that SDL
+     * creates surfaces with. Otherwise (such as in headless mode) it loads
+     * the system library itself.
+     *
+     * @return true if the library was loaded
+     */
+    static bool init();
+
+    /**
+     * Loads the instance functions, and the device functions as trampolines
+     *
+     * @param instance  The Vulkan instance
+     */
+    static void loadInstance(VkInstance instance);
+
+    /**
+     * Loads the device functions directly from the device
+     *
+     * @param device    The logical device
+     */
+    static void loadDevice(VkDevice device);
+
+    /**
+     * Unloads the Vulkan library, once the instance is destroyed
+     */
+    static void dispose();
+};
+
+#endif /* __VULKAN_LOADER_H__ */
@@ -0,0 +1,146 @@
+"""
+Python Script for Capture Round Trips
+
+This is vulkansdl-roundtrip, which checks that a capture replays to the same
+image as the run that recorded it. It runs a built tutorial in headless mode,
+capturing the last frames of the run and saving the final frame. It then
+replays the capture once with the replay tool, saving the final replayed
+frame, and compares the two images with the same perceptual tolerance as
+vulkansdl-compare.
+
+Only tutorials 9 and 10 can record captures. The headless runs pin their
+clock, so the captured frames are the ones the run saved. A failure means
+that either the capture or the replay has lost a command (or a write to
+memory) that the frame depends on. The images are kept in the output folder,
+together with the pixels that differ if the check fails.
+
+Date:   10/18/26
+"""
+import os, os.path
+import sys
+import argparse
+import subprocess
+import bench
+import compare
+
+
+def run_command(command, env, timeout):
+    """
+    Returns True if the given command ran successfully
+
+    The command is run in the folder of its executable, so that it finds its
+    assets.
+
+    :param command: The executable and its arguments
+    :type command:  ``list``
+
+    :param env: The environment for the run
+    :type env:  ``dict``
+
+    :param timeout: The time limit of the run in seconds
+    :type timeout:  ``int``
+
+    :return: True if the given command ran successfully
+    :rtype:  ``bool``
+    """
+    try:
+        result = subprocess.run(command, cwd=os.path.dirname(command[0]), env=env,
+                                stdout=subprocess.PIPE, stderr=subprocess.STDOUT, timeout=timeout)
+        if result.returncode != 0:
+            print('%s failed with code %d' % (command[0], result.returncode))
+            print(result.stdout.decode('utf-8', 'replace'))
+            return False
+        return True
+    except (OSError, subprocess.TimeoutExpired) as e:
+        print('%s failed: %s' % (command[0], e))
+        return False
+
+
+def check_roundtrip(executable, replay, args, env):
+    """
+    Returns True if a capture of the given tutorial replays to the same image
+
+    :param executable: The path to the tutorial executable
+    :type executable:  ``str``
+
+    :param replay: The path to the replay executable
+    :type replay:  ``str``
+
+    :param args: The parsed command line arguments
+    :type args:  ``Namespace``
+
+    :param env: The environment for the runs
+    :type env:  ``dict``
+
+    :return: True if a capture of the given tutorial replays to the same image
+    :rtype:  ``bool``
+    """
+    name = os.path.splitext(os.path.basename(executable))[0]
+    capture = os.path.join(args.output, name + '.vkcap')
+    original = os.path.join(args.output, name + '.png')
+    replayed = os.path.join(args.output, name + '-replay.png')
+    diff = os.path.join(args.output, name + '.diff.png')
+    for path in (capture, original, replayed, diff):
+        if os.path.exists(path):
+            os.remove(path)
+
+    # Capture the last frames, so that the screenshot is the last captured frame
+    command = [os.path.abspath(executable),
+               '--headless', str(args.skip + args.frames),
+               '--size', '%dx%d' % (args.width, args.height),
+               '--screenshot', original,
+               '--capture', capture,
+               '--capture-skip', str(args.skip),
+               '--capture-frames', str(args.frames)]
+    if not run_command(command, env, args.timeout):
+        return False
+    if not os.path.exists(capture) or not os.path.exists(original):
+        print('%-28s FAIL the run saved no capture or screenshot' % name)
+        return False
+
+    command = [os.path.abspath(replay), capture, '--loops', '1', '--screenshot', replayed]
+    if not run_command(command, env, args.timeout):
+        return False
+    if not os.path.exists(replayed):
+        print('%-28s FAIL the replay saved no screenshot' % name)
+        return False
+
+    fraction = compare.compare_images(replayed, original, args.threshold, diff)
+    if fraction > args.tolerance:
+        print('%-28s FAIL %.3f%% of pixels differ (see %s)' % (name, fraction * 100, diff))
+        return False
+    print('%-28s ok   %d frames, %.3f%% of pixels differ' % (name, args.frames, fraction * 100))
+    return True
+
+
+def main():
+    """
+    Runs the round trips given on the command line
+    """
+    parser = argparse.ArgumentParser(prog='vulkansdl-roundtrip', description='Check that captures of the VulkanSDL tutorials replay to the same image.')
+    parser.add_argument('executables', nargs='+', help='the built tutorial executables to capture (tutorials 9 and 10)')
+    parser.add_argument('--replay',    required=True, help='the built replay executable')
+    parser.add_argument('--output',    default='roundtrip', help='the folder for the captures and images (default roundtrip)')
+    parser.add_argument('--frames',    type=int,   default=3,     help='the number of frames to capture (default 3)')
+    parser.add_argument('--skip',      type=int,   default=60,    help='the number of frames to run before capturing (default 60)')
+    parser.add_argument('--width',     type=int,   default=800,   help='the width of the offscreen images (default 800)')
+    parser.add_argument('--height',    type=int,   default=600,   help='the height of the offscreen images (default 600)')
+    parser.add_argument('--threshold', type=float, default=0.1,   help='the smallest visible color difference, from 0 to 1 (default 0.1)')
+    parser.add_argument('--tolerance', type=float, default=0.001, help='the fraction of pixels allowed to differ (default 0.001)')
+    parser.add_argument('--timeout',   type=int,   default=600,   help='the time limit of a run in seconds (default 600)')
+    parser.add_argument('--icd',       help='the ICD manifest of the driver to use, such as lavapipe')
+    args = parser.parse_args()
+
+    env = bench.driver_environment(args.icd)
+    args.output = os.path.abspath(args.output)
+    if not os.path.isdir(args.output):
+        os.makedirs(args.output)
+
+    failures = 0
+    for executable in args.executables:
+        failures += 0 if check_roundtrip(executable, args.replay, args, env) else 1
+    return 1 if failures > 0 else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
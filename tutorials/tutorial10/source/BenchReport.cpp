@@ -0,0 +1,308 @@
+//
+//  BenchReport.cpp
+//  Tutorial10
+//
+//  The results of a headless benchmark run. The frame rate in the title bar
+//  says little about a regression, and nothing about startup, memory, or the
+//  frames that hitch. So a benchmark run records the CPU time of every frame
+//  after a fixed warm-up, and saves the percentiles as JSON, along with the
+//  GPU time of each profiled scope, the time to the first frame, and the
+//  peak memory use of the process and the device.
+//
+//  The report is read by the vulkansdl-bench harness (tutorials/bench.py),
+//  which runs every workload with the same parameters and merges the results,
+//  so that runs from different releases can be compared.
+//
+//  Version: 10/18/26
+//
+#include "BenchReport.h"
+#include <SDL3/SDL.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#if defined(SDL_PLATFORM_WINDOWS)
+#define PSAPI_VERSION 2
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+/** The start of the program, to measure the time to the first frame */
+static const std::chrono::steady_clock::time_point bench_origin = std::chrono::steady_clock::now();
+
+/**
+ * Returns the given string escaped for a JSON string literal
+ *
+ * @param text  The string to escape
+ *
+ * @return the given string escaped for a JSON string literal
+ */
+static std::string json_escape(const std::string& text) {
+    std::string result;
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            result += '\\';
+            result += c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            result += ' ';
+        } else {
+            result += c;
+        }
+    }
+    return result;
+}
+
+/**
+ * Returns the given percentile of the sorted values, using the nearest rank
+ *
+ * @param sorted    The values in ascending order (not empty)
+ * @param percent   The percentile, from 0 to 100
+ *
+ * @return the given percentile of the sorted values
+ */
+static double percentile(const std::vector<double>& sorted, double percent) {
+    size_t rank = static_cast<size_t>(std::ceil(percent / 100.0 * sorted.size()));
+    return sorted[std::clamp(rank, (size_t)1, sorted.size()) - 1];
+}
+
+/**
+ * Returns the mean, percentiles, and maximum of the given times as JSON
+ *
+ * @param times The times in milliseconds
+ *
+ * @return the mean, percentiles, and maximum of the given times as JSON
+ */
+static std::string json_summary(const std::vector<double>& times) {
+    if (times.empty()) {
+        return "null";
+    }
+
+    std::vector<double> sorted = times;
+    std::sort(sorted.begin(), sorted.end());
+    double sum = 0;
+    for (double time : sorted) {
+        sum += time;
+    }
+
+    char buffer[256];
+    snprintf(buffer, sizeof(buffer), "{\"mean\": %.4f, \"p50\": %.4f, \"p90\": %.4f, \"p99\": %.4f, \"max\": %.4f}",
+             sum / sorted.size(), percentile(sorted, 50), percentile(sorted, 90),
+             percentile(sorted, 99), sorted.back());
+    return buffer;
+}
+
+/**
+ * Creates an empty report for the given workload
+ *
+ * @param workload  The workload name
+ * @param warmup    The number of frames to skip before recording
+ */
+BenchReport::BenchReport(const std::string& workload, uint32_t warmup) :
+    workload(workload),
+    warmup(warmup),
+    frames(0),
+    startup(-1),
+    deviceMemory(0) {
+}
+
+/**
+ * Returns true if the given physical device can report its memory use
+ *
+ * This requires VK_EXT_memory_budget, which must then be enabled on the
+ * logical device for {@link sampleDeviceMemory}.
+ *
+ * @param device    The physical device
+ *
+ * @return true if the given physical device can report its memory use
+ */
+bool BenchReport::isDeviceMemorySupported(VkPhysicalDevice device) {
+    uint32_t extensionCount;
+    vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
+
+    std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+    vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, availableExtensions.data());
+
+    for (const auto& extension : availableExtensions) {
+        if (strcmp(extension.extensionName, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Returns the peak resident memory of this process in bytes (0 if unknown)
+ *
+ * @return the peak resident memory of this process in bytes
+ */
+uint64_t BenchReport::getPeakMemory() {
+#if defined(SDL_PLATFORM_WINDOWS)
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        return counters.PeakWorkingSetSize;
+    }
+    return 0;
+#else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0;
+    }
+#if defined(SDL_PLATFORM_APPLE)
+    // Apple reports bytes, while everyone else reports kilobytes
+    return static_cast<uint64_t>(usage.ru_maxrss);
+#else
+    return static_cast<uint64_t>(usage.ru_maxrss) * 1024;
+#endif
+#endif
+}
+
+/**
+ * Adds a parameter of the run
+ *
+ * @param name  The parameter name
+ * @param value The parameter value
+ */
+void BenchReport::setParameter(const std::string& name, double value) {
+    char buffer[64];
+    snprintf(buffer, sizeof(buffer), "%.17g", value);
+    parameters.emplace_back(name, buffer);
+}
+
+/**
+ * Adds a parameter of the run
+ *
+ * @param name  The parameter name
+ * @param value The parameter value
+ */
+void BenchReport::setParameter(const std::string& name, const std::string& value) {
+    parameters.emplace_back(name, "\"" + json_escape(value) + "\"");
+}
+
+/**
+ * Adds the CPU time of a frame, unless it is part of the warm-up.
+ *
+ * The first frame also marks the end of startup.
+ *
+ * @param milliseconds  The CPU time of the frame in milliseconds
+ */
+void BenchReport::addFrame(double milliseconds) {
+    if (frames == 0) {
+        auto elapsed = std::chrono::steady_clock::now() - bench_origin;
+        startup = std::chrono::duration<double, std::milli>(elapsed).count();
+    }
+    if (frames >= warmup) {
+        frameTimes.push_back(milliseconds);
+    }
+    frames++;
+}
+
+/**
+ * Adds the time to record the commands of a frame, unless it is part of the warm-up.
+ *
+ * This must be called before {@link addFrame} for the same frame.
+ *
+ * @param milliseconds  The recording time in milliseconds
+ */
+void BenchReport::addRecording(double milliseconds) {
+    if (frames >= warmup) {
+        recordTimes.push_back(milliseconds);
+    }
+}
+
+/**
+ * Adds the average GPU time of a scope
+ *
+ * @param name          The scope name
+ * @param milliseconds  The average GPU time in milliseconds
+ */
+void BenchReport::addGpuTime(const std::string& name, double milliseconds) {
+    gpuTimes.emplace_back(name, milliseconds);
+}
+
+/**
+ * Samples the memory use of the device heaps, keeping the peak.
+ *
+ * This does nothing unless the logical device has VK_EXT_memory_budget.
+ *
+ * @param device    The physical device
+ */
+void BenchReport::sampleDeviceMemory(VkPhysicalDevice device) {
+    VkPhysicalDeviceMemoryBudgetPropertiesEXT budget{};
+    budget.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+
+    VkPhysicalDeviceMemoryProperties2 properties{};
+    properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
+    properties.pNext = &budget;
+    vkGetPhysicalDeviceMemoryProperties2(device, &properties);
+
+    // Integrated and CPU devices have no separate heap, so count every heap the device prefers
+    VkDeviceSize usage = 0;
+    for (uint32_t ii = 0; ii < properties.memoryProperties.memoryHeapCount; ii++) {
+        if (properties.memoryProperties.memoryHeaps[ii].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) {
+            usage += budget.heapUsage[ii];
+        }
+    }
+    deviceMemory = std::max(deviceMemory, usage);
+}
+
+/**
+ * Saves this report as JSON
+ *
+ * @param path  The file to write
+ *
+ * @return true if the file was written
+ */
+bool BenchReport::write(const std::string& path) const {
+    std::ofstream file(path);
+    if (!file.is_open()) {
+        SDL_Log("Failed to write benchmark report %s", path.c_str());
+        return false;
+    }
+
+    char buffer[256];
+    file << "{\n  \"workload\": \"" << json_escape(workload) << "\",\n";
+    file << "  \"parameters\": {";
+    for (size_t ii = 0; ii < parameters.size(); ii++) {
+        file << (ii == 0 ? "" : ", ") << "\"" << json_escape(parameters[ii].first) << "\": " << parameters[ii].second;
+    }
+    file << "},\n";
+    snprintf(buffer, sizeof(buffer), "  \"warmup\": %u,\n  \"frames\": %zu,\n", warmup, frameTimes.size());
+    file << buffer;
+    if (startup >= 0) {
+        snprintf(buffer, sizeof(buffer), "  \"startup_ms\": %.3f,\n", startup);
+        file << buffer;
+    } else {
+        file << "  \"startup_ms\": null,\n";
+    }
+
+    file << "  \"cpu_frame_ms\": " << json_summary(frameTimes) << ",\n";
+    file << "  \"record_ms\": " << json_summary(recordTimes) << ",\n";
+
+    file << "  \"gpu_ms\": {";
+    for (size_t ii = 0; ii < gpuTimes.size(); ii++) {
+        snprintf(buffer, sizeof(buffer), "%.4f", gpuTimes[ii].second);
+        file << (ii == 0 ? "" : ", ") << "\"" << json_escape(gpuTimes[ii].first) << "\": " << buffer;
+    }
+    file << "},\n";
+
+    uint64_t peak = getPeakMemory();
+    file << "  \"peak_rss_bytes\": ";
+    if (peak > 0) {
+        file << peak;
+    } else {
+        file << "null";
+    }
+    file << ",\n  \"peak_vram_bytes\": ";
+    if (deviceMemory > 0) {
+        file << deviceMemory;
+    } else {
+        file << "null";
+    }
+    file << "\n}\n";
+
+    SDL_Log("Wrote benchmark report for %zu frames to %s", frameTimes.size(), path.c_str());
+    return file.good();
+}
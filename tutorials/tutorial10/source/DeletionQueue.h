@@ -0,0 +1,101 @@
+//
+//  DeletionQueue.h
+//  Tutorial10
+//
+//  Frame-fenced destruction of Vulkan objects. The tutorial destroys objects
+//  either in cleanup, after the device is idle, or right away, after it has
+//  waited on the queue. Neither works once objects are replaced while the
+//  GPU is still drawing with them, as with swapchain recreation.
+//
+//  This class takes an object along with the last frame that may use it, and
+//  destroys it once FrameSync reports that frame as finished on every queue.
+//  Objects are collected in bulk once a frame, and checking costs a single
+//  comparison, so nothing ever waits on the GPU.
+//
+//  Version: 10/18/26
+//
+#ifndef __DELETION_QUEUE_H__
+#define __DELETION_QUEUE_H__
+#include "VulkanLoader.h"
+#include <deque>
+#include <cstdint>
+
+/**
+ * A queue of Vulkan objects waiting on the GPU to be destroyed.
+ *
+ * Objects are identified by their type and handle, as in the debug utils,
+ * since the handles are all the same integer type on 32-bit platforms.
+ * They are destroyed in the order they were pushed, so an object pushed with
+ * an earlier frame than the one before it simply waits a little longer.
+ */
+class DeletionQueue {
+private:
+    /** An object waiting to be destroyed */
+    struct Entry {
+        /** The object type */
+        VkObjectType type;
+        /** The object handle */
+        uint64_t handle;
+        /** The last frame that may use the object */
+        uint64_t frame;
+    };
+
+    /** The logical device */
+    VkDevice device;
+    /** The objects waiting to be destroyed, oldest first */
+    std::deque<Entry> entries;
+
+    /**
+     * Destroys the object of the given entry
+     *
+     * @param entry The object to destroy
+     */
+    void destroy(const Entry& entry);
+
+public:
+    /**
+     * Creates an empty deletion queue for the given device
+     *
+     * @param device    The logical device
+     */
+    DeletionQueue(VkDevice device);
+
+    /**
+     * Destroys every object still queued. The device must be idle.
+     */
+    ~DeletionQueue();
+
+    DeletionQueue(const DeletionQueue&) = delete;
+    DeletionQueue& operator=(const DeletionQueue&) = delete;
+
+    /**
+     * Queues an object to be destroyed once the given frame has finished.
+     *
+     * Buffers, images, views, samplers, memory, pipelines and their layouts,
+     * descriptor pools and set layouts, render passes, framebuffers, shader
+     * modules, command pools, query pools, semaphores and fences are all
+     * supported. Memory is only freed, so it should be pushed after anything
+     * bound to it.
+     *
+     * @param type      The object type
+     * @param handle    The object handle
+     * @param frame     The last frame that may use the object
+     */
+    void push(VkObjectType type, uint64_t handle, uint64_t frame);
+
+    /**
+     * Destroys every object whose frame has finished.
+     *
+     * This never blocks, and should be called once a frame.
+     *
+     * @param completed The last frame that finished on the GPU
+     */
+    void collect(uint64_t completed);
+
+    /**
+     * Destroys every object in the queue. The device must be idle.
+     */
+    void flush();
+};
+
+#endif /* __DELETION_QUEUE_H__ */
@@ -0,0 +1,781 @@
+//
+//  FrameCapture.cpp
+//  Tutorial10
+//
+//  A capture layer for the Vulkan calls of the tutorial. When a frame is slow
+//  it is hard to tell whether the cause is the frame itself or everything
+//  around it: the window system, the pacing, the other work on the machine.
+//  So this class wraps the calls that create resources, upload data, record
+//  commands, and submit them, and can save a few frames of them to a compact
+//  binary file. The replay tool (tutorials/replay) then runs those frames in
+//  a loop, with timing, on any device and without the tutorial or its assets.
+//
+//  Every wrapper issues its Vulkan call, and only records it when a capture
+//  is in progress, so the layer costs a branch per call otherwise. Resources
+//  are recorded from the start, as a frame needs everything created before
+//  it. The frames before the capture window are recorded too, so that the
+//  replay starts from the same state, but they are only run once at load.
+//
+//  Presentation, synchronization, and queries are not captured. The replay
+//  runs everything on a single queue, in submission order, which is stricter
+//  than the semaphores of the tutorial.
+//
+//  Version: 10/18/26
+//
+#include "FrameCapture.h"
+#include <SDL3/SDL.h>
+#include <cstring>
+
+/**
+ * Creates a capture layer for the given device
+ *
+ * If the path is empty, the wrappers only issue their Vulkan calls.
+ *
+ * @param device    The logical device
+ * @param path      The file to save the capture to
+ * @param skip      The number of frames before the timed frames
+ * @param count     The number of timed frames
+ */
+FrameCapture::FrameCapture(VkDevice device, const std::string& path, uint32_t skip, uint32_t count) :
+    device(device),
+    path(path),
+    skip(skip),
+    count(count),
+    frame(0),
+    capturing(!path.empty() && count > 0) {
+}
+
+/**
+ * Disposes of this capture layer, noting a capture that never finished
+ */
+FrameCapture::~FrameCapture() {
+    if (capturing) {
+        SDL_Log("Capture stopped after %u of %u frames, so %s was not saved", frame, skip + count, path.c_str());
+    }
+}
+
+/**
+ * Returns the writer for the given command buffer, or null if not capturing
+ *
+ * @param commandBuffer The command buffer
+ *
+ * @return the writer for the given command buffer
+ */
+CaptureWriter* FrameCapture::getCommands(VkCommandBuffer commandBuffer) {
+    if (!capturing) {
+        return nullptr;
+    }
+    auto it = commands.find(capture_id(commandBuffer));
+    return it == commands.end() ? nullptr : &it->second;
+}
+
+/**
+ * Stops capturing, discarding the capture
+ *
+ * @param reason    The call that cannot be captured
+ */
+void FrameCapture::abandon(const char* reason) {
+    SDL_Log("Capture abandoned, as it does not support %s", reason);
+    capturing = false;
+    records.clear();
+    commands.clear();
+}
+
+/**
+ * Saves the capture to the file
+ */
+void FrameCapture::write() {
+    SDL_IOStream* file = SDL_IOFromFile(path.c_str(), "wb");
+    if (file == NULL) {
+        SDL_Log("Failed to write capture %s", path.c_str());
+        return;
+    }
+
+    uint32_t header[] = { CAPTURE_MAGIC, CAPTURE_VERSION, skip, count };
+    const std::vector<uint8_t>& data = records.getData();
+    bool written = SDL_WriteIO(file, header, sizeof(header)) == sizeof(header);
+    written = written && SDL_WriteIO(file, data.data(), data.size()) == data.size();
+    SDL_CloseIO(file);
+
+    if (written) {
+        SDL_Log("Captured %u frames (after %u more) to %s, %zu bytes", count, skip, path.c_str(), data.size());
+    } else {
+        SDL_Log("Failed to write capture %s", path.c_str());
+    }
+}
+
+/**
+ * Creates a buffer
+ *
+ * The memory properties are only recorded, so the replay can allocate
+ * memory of the same kind for the buffer.
+ *
+ * @param info          The buffer info
+ * @param properties    The memory properties of the buffer
+ * @param buffer        The buffer to create
+ *
+ * @return the result of vkCreateBuffer
+ */
+VkResult FrameCapture::createBuffer(const VkBufferCreateInfo& info, VkMemoryPropertyFlags properties, VkBuffer* buffer) {
+    VkResult result = vkCreateBuffer(device, &info, nullptr, buffer);
+    if (capturing && result == VK_SUCCESS) {
+        records.begin(CAPTURE_OP_BUFFER);
+        records.putHandle(*buffer);
+        records.put(info.flags);
+        records.put(info.size);
+        records.put(info.usage);
+        records.put(properties);
+        records.end();
+    }
+    return result;
+}
+
+/**
+ * Copies data to a mapped buffer
+ *
+ * @param buffer    The buffer
+ * @param mapped    The mapped memory of the buffer
+ * @param offset    The offset in the buffer
+ * @param data      The data to copy
+ * @param size      The number of bytes
+ */
+void FrameCapture::writeBuffer(VkBuffer buffer, void* mapped, VkDeviceSize offset, const void* data, size_t size) {
+    memcpy(static_cast<uint8_t*>(mapped) + offset, data, size);
+    if (capturing) {
+        records.begin(CAPTURE_OP_BUFFER_DATA);
+        records.putHandle(buffer);
+        records.put(offset);
+        records.putArray(static_cast<const uint8_t*>(data), static_cast<uint32_t>(size));
+        records.end();
+    }
+}
+
+/**
+ * Records an image that was not created by the application
+ *
+ * @param image     The image (such as a swapchain image)
+ * @param format    The image format
+ * @param extent    The image size
+ * @param usage     The image usage
+ */
+void FrameCapture::addImage(VkImage image, VkFormat format, VkExtent2D extent, VkImageUsageFlags usage) {
+    if (capturing) {
+        records.begin(CAPTURE_OP_IMAGE);
+        records.putHandle(image);
+        records.put(format);
+        records.put(extent);
+        records.put(usage);
+        records.end();
+    }
+}
+
+/**
+ * Creates an image view
+ *
+ * @param info  The image view info
+ * @param view  The image view to create
+ *
+ * @return the result of vkCreateImageView
+ */
+VkResult FrameCapture::createImageView(const VkImageViewCreateInfo& info, VkImageView* view) {
+    VkResult result = vkCreateImageView(device, &info, nullptr, view);
+    if (capturing && result == VK_SUCCESS) {
+        records.begin(CAPTURE_OP_IMAGE_VIEW);
+        records.putHandle(*view);
+        records.put(info);
+        records.end();
+    }
+    return result;
+}
+
+/**
+ * Creates a render pass
+ *
+ * @param info          The render pass info
+ * @param renderPass    The render pass to create
+ *
+ * @return the result of vkCreateRenderPass
+ */
+VkResult FrameCapture::createRenderPass(const VkRenderPassCreateInfo& info, VkRenderPass* renderPass) {
+    VkResult result = vkCreateRenderPass(device, &info, nullptr, renderPass);
+    if (capturing && result == VK_SUCCESS) {
+        records.begin(CAPTURE_OP_RENDER_PASS);
+        records.putHandle(*renderPass);
+        records.put(info);
+        records.putArray(info.pAttachments, info.attachmentCount);
+        for (uint32_t ii = 0; ii < info.subpassCount; ii++) {
+            const VkSubpassDescription& subpass = info.pSubpasses[ii];
+            records.put(subpass);
+            records.putArray(subpass.pInputAttachments, subpass.inputAttachmentCount);
+            records.putArray(subpass.pColorAttachments, subpass.colorAttachmentCount);
+            records.putArray(subpass.pResolveAttachments, subpass.pResolveAttachments != nullptr ? subpass.colorAttachmentCount : 0);
+            records.putArray(subpass.pDepthStencilAttachment, subpass.pDepthStencilAttachment != nullptr ? 1 : 0);
+            records.putArray(subpass.pPreserveAttachments, subpass.preserveAttachmentCount);
+        }
+        records.putArray(info.pDependencies, info.dependencyCount);
+        records.end();
+    }
+    return result;
+}
+
+/**
+ * Creates a framebuffer
+ *
+ * @param info          The framebuffer info
+ * @param framebuffer   The framebuffer to create
+ *
+ * @return the result of vkCreateFramebuffer
+ */
+VkResult FrameCapture::createFramebuffer(const VkFramebufferCreateInfo& info, VkFramebuffer* framebuffer) {
+    VkResult result = vkCreateFramebuffer(device, &info, nullptr, framebuffer);
+    if (capturing && result == VK_SUCCESS) {
+        records.begin(CAPTURE_OP_FRAMEBUFFER);
+        records.putHandle(*framebuffer);
+        records.put(info);
+        records.putArray(info.pAttachments, info.attachmentCount);
+        records.end();
+    }
+    return result;
+}
+
+/**
+ * Creates a shader module
+ *
+ * @param info      The shader module info
+ * @param module    The shader module to create
+ *
+ * @return the result of vkCreateShaderModule
+ */
+VkResult FrameCapture::createShaderModule(const VkShaderModuleCreateInfo& info, VkShaderModule* module) {
+    VkResult result = vkCreateShaderModule(device, &info, nullptr, module);
+    if (capturing && result == VK_SUCCESS) {
+        records.begin(CAPTURE_OP_SHADER_MODULE);
+        records.putHandle(*module);
+        records.putArray(info.pCode, static_cast<uint32_t>(info.codeSize / sizeof(uint32_t)));
+        records.end();
+    }
+    return result;
+}
+
+/**
+ * Creates a descriptor set layout
+ *
+ * @param info      The descriptor set layout info
+ * @param layout    The descriptor set layout to create
+ *
+ * @return the result of vkCreateDescriptorSetLayout
+ */
+VkResult FrameCapture::createDescriptorSetLayout(const VkDescriptorSetLayoutCreateInfo& info, VkDescriptorSetLayout* layout) {
+    VkResult result = vkCreateDescriptorSetLayout(device, &info, nullptr, layout);
+    if (capturing && result == VK_SUCCESS) {
+        for (uint32_t ii = 0; ii < info.bindingCount; ii++) {
+            if (info.pBindings[ii].pImmutableSamplers != nullptr) {
+                abandon("immutable samplers");
+                return result;
+            }
+        }
+        records.begin(CAPTURE_OP_SET_LAYOUT);
+        records.putHandle(*layout);
+        records.put(info);
+        records.putArray(info.pBindings, info.bindingCount);
+        records.end();
+    }
+    return result;
+}
+
+/**
+ * Creates a pipeline layout
+ *
+ * @param info      The pipeline layout info
+ * @param layout    The pipeline layout to create
+ *
+ * @return the result of vkCreatePipelineLayout
+ */
+VkResult FrameCapture::createPipelineLayout(const VkPipelineLayoutCreateInfo& info, VkPipelineLayout* layout) {
+    VkResult result = vkCreatePipelineLayout(device, &info, nullptr, layout);
+    if (capturing && result == VK_SUCCESS) {
+        records.begin(CAPTURE_OP_PIPELINE_LAYOUT);
+        records.putHandle(*layout);
+        records.put(info);
+        records.putArray(info.pSetLayouts, info.setLayoutCount);
+        records.putArray(info.pPushConstantRanges, info.pushConstantRangeCount);
+        records.end();
+    }
+    return result;
+}
+
+/**
+ * Creates a graphics pipeline
+ *
+ * @param info      The pipeline info
+ * @param pipeline  The pipeline to create
+ *
+ * @return the result of vkCreateGraphicsPipelines
+ */
+VkResult FrameCapture::createGraphicsPipeline(const VkGraphicsPipelineCreateInfo& info, VkPipeline* pipeline) {
+    VkResult result = vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &info, nullptr, pipeline);
+    if (!capturing || result != VK_SUCCESS) {
+        return result;
+    }
+
+    if (info.pNext != nullptr) {
+        abandon("pipeline extensions");
+        return result;
+    } else if (info.pTessellationState != nullptr) {
+        abandon("tessellation");
+        return result;
+    } else if (info.pMultisampleState != nullptr && info.pMultisampleState->pSampleMask != nullptr) {
+        abandon("sample masks");
+        return result;
+    }
+    for (uint32_t ii = 0; ii < info.stageCount; ii++) {
+        if (info.pStages[ii].pSpecializationInfo != nullptr) {
+            abandon("specialization constants");
+            return result;
+        }
+    }
+
+    records.begin(CAPTURE_OP_GRAPHICS_PIPELINE);
+    records.putHandle(*pipeline);
+    records.put(info);
+    for (uint32_t ii = 0; ii < info.stageCount; ii++) {
+        records.put(info.pStages[ii]);
+        records.putString(info.pStages[ii].pName);
+    }
+
+    putState(info.pVertexInputState);
+    if (info.pVertexInputState != nullptr) {
+        records.putArray(info.pVertexInputState->pVertexBindingDescriptions, info.pVertexInputState->vertexBindingDescriptionCount);
+        records.putArray(info.pVertexInputState->pVertexAttributeDescriptions, info.pVertexInputState->vertexAttributeDescriptionCount);
+    }
+    putState(info.pInputAssemblyState);
+    putState(info.pViewportState);
+    if (info.pViewportState != nullptr) {
+        // Dynamic viewports and scissors have no array
+        const VkPipelineViewportStateCreateInfo* viewport = info.pViewportState;
+        records.putArray(viewport->pViewports, viewport->pViewports != nullptr ? viewport->viewportCount : 0);
+        records.putArray(viewport->pScissors, viewport->pScissors != nullptr ? viewport->scissorCount : 0);
+    }
+    putState(info.pRasterizationState);
+    putState(info.pMultisampleState);
+    putState(info.pDepthStencilState);
+    putState(info.pColorBlendState);
+    if (info.pColorBlendState != nullptr) {
+        records.putArray(info.pColorBlendState->pAttachments, info.pColorBlendState->attachmentCount);
+    }
+    putState(info.pDynamicState);
+    if (info.pDynamicState != nullptr) {
+        records.putArray(info.pDynamicState->pDynamicStates, info.pDynamicState->dynamicStateCount);
+    }
+    records.end();
+    return result;
+}
+
+/**
+ * Creates a compute pipeline
+ *
+ * @param info      The pipeline info
+ * @param pipeline  The pipeline to create
+ *
+ * @return the result of vkCreateComputePipelines
+ */
+VkResult FrameCapture::createComputePipeline(const VkComputePipelineCreateInfo& info, VkPipeline* pipeline) {
+    VkResult result = vkCreateComputePipelines(device, VK_NULL_HANDLE, 1, &info, nullptr, pipeline);
+    if (capturing && result == VK_SUCCESS) {
+        if (info.stage.pSpecializationInfo != nullptr) {
+            abandon("specialization constants");
+            return result;
+        }
+        records.begin(CAPTURE_OP_COMPUTE_PIPELINE);
+        records.putHandle(*pipeline);
+        records.put(info);
+        records.putString(info.stage.pName);
+        records.end();
+    }
+    return result;
+}
+
+/**
+ * Creates a descriptor pool
+ *
+ * @param info  The descriptor pool info
+ * @param pool  The descriptor pool to create
+ *
+ * @return the result of vkCreateDescriptorPool
+ */
+VkResult FrameCapture::createDescriptorPool(const VkDescriptorPoolCreateInfo& info, VkDescriptorPool* pool) {
+    VkResult result = vkCreateDescriptorPool(device, &info, nullptr, pool);
+    if (capturing && result == VK_SUCCESS) {
+        records.begin(CAPTURE_OP_DESCRIPTOR_POOL);
+        records.putHandle(*pool);
+        records.put(info);
+        records.putArray(info.pPoolSizes, info.poolSizeCount);
+        records.end();
+    }
+    return result;
+}
+
+/**
+ * Allocates descriptor sets
+ *
+ * @param info  The allocation info
+ * @param sets  The descriptor sets to allocate
+ *
+ * @return the result of vkAllocateDescriptorSets
+ */
+VkResult FrameCapture::allocateDescriptorSets(const VkDescriptorSetAllocateInfo& info, VkDescriptorSet* sets) {
+    VkResult result = vkAllocateDescriptorSets(device, &info, sets);
+    if (capturing && result == VK_SUCCESS) {
+        records.begin(CAPTURE_OP_DESCRIPTOR_SETS);
+        records.put(info);
+        records.putArray(info.pSetLayouts, info.descriptorSetCount);
+        records.putArray(sets, info.descriptorSetCount);
+        records.end();
+    }
+    return result;
+}
+
+/**
+ * Writes descriptor sets
+ *
+ * @param count     The number of writes
+ * @param writes    The descriptor writes
+ */
+void FrameCapture::updateDescriptorSets(uint32_t count, const VkWriteDescriptorSet* writes) {
+    vkUpdateDescriptorSets(device, count, writes, 0, nullptr);
+    if (!capturing) {
+        return;
+    }
+
+    for (uint32_t ii = 0; ii < count; ii++) {
+        if (writes[ii].pBufferInfo == nullptr) {
+            abandon("image descriptors");
+            return;
+        }
+    }
+    records.begin(CAPTURE_OP_DESCRIPTOR_WRITES);
+    records.put(count);
+    for (uint32_t ii = 0; ii < count; ii++) {
+        records.put(writes[ii]);
+        records.putArray(writes[ii].pBufferInfo, writes[ii].descriptorCount);
+    }
+    records.end();
+}
+
+/**
+ * Begins a command buffer
+ *
+ * @param commandBuffer The command buffer
+ * @param info          The begin info
+ *
+ * @return the result of vkBeginCommandBuffer
+ */
+VkResult FrameCapture::beginCommandBuffer(VkCommandBuffer commandBuffer, const VkCommandBufferBeginInfo& info) {
+    if (capturing) {
+        commands[capture_id(commandBuffer)].clear();
+    }
+    return vkBeginCommandBuffer(commandBuffer, &info);
+}
+
+/**
+ * Ends a command buffer
+ *
+ * @param commandBuffer The command buffer
+ *
+ * @return the result of vkEndCommandBuffer
+ */
+VkResult FrameCapture::endCommandBuffer(VkCommandBuffer commandBuffer) {
+    CaptureWriter* writer = getCommands(commandBuffer);
+    if (writer != nullptr) {
+        const std::vector<uint8_t>& data = writer->getData();
+        records.begin(CAPTURE_OP_COMMANDS);
+        records.putHandle(commandBuffer);
+        records.putArray(data.data(), static_cast<uint32_t>(data.size()));
+        records.end();
+        commands.erase(capture_id(commandBuffer));
+    }
+    return vkEndCommandBuffer(commandBuffer);
+}
+
+/**
+ * Records a pipeline barrier
+ *
+ * The arguments are the same as vkCmdPipelineBarrier.
+ */
+void FrameCapture::cmdPipelineBarrier(VkCommandBuffer commandBuffer, VkPipelineStageFlags srcStage, VkPipelineStageFlags dstStage,
+                                      VkDependencyFlags dependencies,
+                                      uint32_t memoryCount, const VkMemoryBarrier* memoryBarriers,
+                                      uint32_t bufferCount, const VkBufferMemoryBarrier* bufferBarriers,
+                                      uint32_t imageCount, const VkImageMemoryBarrier* imageBarriers) {
+    vkCmdPipelineBarrier(commandBuffer, srcStage, dstStage, dependencies,
+                         memoryCount, memoryBarriers, bufferCount, bufferBarriers, imageCount, imageBarriers);
+    CaptureWriter* writer = getCommands(commandBuffer);
+    if (writer != nullptr) {
+        writer->begin(CAPTURE_CMD_PIPELINE_BARRIER);
+        writer->put(srcStage);
+        writer->put(dstStage);
+        writer->put(dependencies);
+        writer->putArray(memoryBarriers, memoryCount);
+        writer->putArray(bufferBarriers, bufferCount);
+        writer->putArray(imageBarriers, imageCount);
+        writer->end();
+    }
+}
+
+/**
+ * Binds a pipeline
+ *
+ * The arguments are the same as vkCmdBindPipeline.
+ */
+void FrameCapture::cmdBindPipeline(VkCommandBuffer commandBuffer, VkPipelineBindPoint bindPoint, VkPipeline pipeline) {
+    vkCmdBindPipeline(commandBuffer, bindPoint, pipeline);
+    CaptureWriter* writer = getCommands(commandBuffer);
+    if (writer != nullptr) {
+        writer->begin(CAPTURE_CMD_BIND_PIPELINE);
+        writer->put(bindPoint);
+        writer->putHandle(pipeline);
+        writer->end();
+    }
+}
+
+/**
+ * Binds descriptor sets
+ *
+ * The arguments are the same as vkCmdBindDescriptorSets.
+ */
+void FrameCapture::cmdBindDescriptorSets(VkCommandBuffer commandBuffer, VkPipelineBindPoint bindPoint, VkPipelineLayout layout,
+                                         uint32_t firstSet, uint32_t setCount, const VkDescriptorSet* sets,
+                                         uint32_t offsetCount, const uint32_t* offsets) {
+    vkCmdBindDescriptorSets(commandBuffer, bindPoint, layout, firstSet, setCount, sets, offsetCount, offsets);
+    CaptureWriter* writer = getCommands(commandBuffer);
+    if (writer != nullptr) {
+        writer->begin(CAPTURE_CMD_BIND_DESCRIPTOR_SETS);
+        writer->put(bindPoint);
+        writer->putHandle(layout);
+        writer->put(firstSet);
+        writer->putArray(sets, setCount);
+        writer->putArray(offsets, offsetCount);
+        writer->end();
+    }
+}
+
+/**
+ * Dispatches a compute shader
+ *
+ * The arguments are the same as vkCmdDispatch.
+ */
+void FrameCapture::cmdDispatch(VkCommandBuffer commandBuffer, uint32_t x, uint32_t y, uint32_t z) {
+    vkCmdDispatch(commandBuffer, x, y, z);
+    CaptureWriter* writer = getCommands(commandBuffer);
+    if (writer != nullptr) {
+        writer->begin(CAPTURE_CMD_DISPATCH);
+        writer->put(x);
+        writer->put(y);
+        writer->put(z);
+        writer->end();
+    }
+}
+
+/**
+ * Dispatches a compute shader with the workgroups in a buffer
+ *
+ * The arguments are the same as vkCmdDispatchIndirect.
+ */
+void FrameCapture::cmdDispatchIndirect(VkCommandBuffer commandBuffer, VkBuffer buffer, VkDeviceSize offset) {
+    vkCmdDispatchIndirect(commandBuffer, buffer, offset);
+    CaptureWriter* writer = getCommands(commandBuffer);
+    if (writer != nullptr) {
+        writer->begin(CAPTURE_CMD_DISPATCH_INDIRECT);
+        writer->putHandle(buffer);
+        writer->put(offset);
+        writer->end();
+    }
+}
+
+/**
+ * Begins a render pass
+ *
+ * The arguments are the same as vkCmdBeginRenderPass.
+ */
+void FrameCapture::cmdBeginRenderPass(VkCommandBuffer commandBuffer, const VkRenderPassBeginInfo& info, VkSubpassContents contents) {
+    vkCmdBeginRenderPass(commandBuffer, &info, contents);
+    CaptureWriter* writer = getCommands(commandBuffer);
+    if (writer != nullptr) {
+        writer->begin(CAPTURE_CMD_BEGIN_RENDER_PASS);
+        writer->put(info);
+        writer->putArray(info.pClearValues, info.clearValueCount);
+        writer->put(contents);
+        writer->end();
+    }
+}
+
+/**
+ * Ends a render pass
+ *
+ * The arguments are the same as vkCmdEndRenderPass.
+ */
+void FrameCapture::cmdEndRenderPass(VkCommandBuffer commandBuffer) {
+    vkCmdEndRenderPass(commandBuffer);
+    CaptureWriter* writer = getCommands(commandBuffer);
+    if (writer != nullptr) {
+        writer->begin(CAPTURE_CMD_END_RENDER_PASS);
+        writer->end();
+    }
+}
+
+/**
+ * Sets the viewports
+ *
+ * The arguments are the same as vkCmdSetViewport.
+ */
+void FrameCapture::cmdSetViewport(VkCommandBuffer commandBuffer, uint32_t first, uint32_t count, const VkViewport* viewports) {
+    vkCmdSetViewport(commandBuffer, first, count, viewports);
+    CaptureWriter* writer = getCommands(commandBuffer);
+    if (writer != nullptr) {
+        writer->begin(CAPTURE_CMD_SET_VIEWPORT);
+        writer->put(first);
+        writer->putArray(viewports, count);
+        writer->end();
+    }
+}
+
+/**
+ * Sets the scissors
+ *
+ * The arguments are the same as vkCmdSetScissor.
+ */
+void FrameCapture::cmdSetScissor(VkCommandBuffer commandBuffer, uint32_t first, uint32_t count, const VkRect2D* scissors) {
+    vkCmdSetScissor(commandBuffer, first, count, scissors);
+    CaptureWriter* writer = getCommands(commandBuffer);
+    if (writer != nullptr) {
+        writer->begin(CAPTURE_CMD_SET_SCISSOR);
+        writer->put(first);
+        writer->putArray(scissors, count);
+        writer->end();
+    }
+}
+
+/**
+ * Binds vertex buffers
+ *
+ * The arguments are the same as vkCmdBindVertexBuffers.
+ */
+void FrameCapture::cmdBindVertexBuffers(VkCommandBuffer commandBuffer, uint32_t first, uint32_t count,
+                                        const VkBuffer* buffers, const VkDeviceSize* offsets) {
+    vkCmdBindVertexBuffers(commandBuffer, first, count, buffers, offsets);
+    CaptureWriter* writer = getCommands(commandBuffer);
+    if (writer != nullptr) {
+        writer->begin(CAPTURE_CMD_BIND_VERTEX_BUFFERS);
+        writer->put(first);
+        writer->putArray(buffers, count);
+        writer->putArray(offsets, count);
+        writer->end();
+    }
+}
+
+/**
+ * Draws primitives
+ *
+ * The arguments are the same as vkCmdDraw.
+ */
+void FrameCapture::cmdDraw(VkCommandBuffer commandBuffer, uint32_t vertexCount, uint32_t instanceCount,
+                           uint32_t firstVertex, uint32_t firstInstance) {
+    vkCmdDraw(commandBuffer, vertexCount, instanceCount, firstVertex, firstInstance);
+    CaptureWriter* writer = getCommands(commandBuffer);
+    if (writer != nullptr) {
+        writer->begin(CAPTURE_CMD_DRAW);
+        writer->put(vertexCount);
+        writer->put(instanceCount);
+        writer->put(firstVertex);
+        writer->put(firstInstance);
+        writer->end();
+    }
+}
+
+/**
+ * Binds an index buffer
+ *
+ * The arguments are the same as vkCmdBindIndexBuffer.
+ */
+void FrameCapture::cmdBindIndexBuffer(VkCommandBuffer commandBuffer, VkBuffer buffer, VkDeviceSize offset, VkIndexType indexType) {
+    vkCmdBindIndexBuffer(commandBuffer, buffer, offset, indexType);
+    CaptureWriter* writer = getCommands(commandBuffer);
+    if (writer != nullptr) {
+        writer->begin(CAPTURE_CMD_BIND_INDEX_BUFFER);
+        writer->putHandle(buffer);
+        writer->put(offset);
+        writer->put(indexType);
+        writer->end();
+    }
+}
+
+/**
+ * Draws indexed primitives with the arguments in a buffer
+ *
+ * The arguments are the same as vkCmdDrawIndexedIndirect.
+ */
+void FrameCapture::cmdDrawIndexedIndirect(VkCommandBuffer commandBuffer, VkBuffer buffer, VkDeviceSize offset,
+                                          uint32_t drawCount, uint32_t stride) {
+    vkCmdDrawIndexedIndirect(commandBuffer, buffer, offset, drawCount, stride);
+    CaptureWriter* writer = getCommands(commandBuffer);
+    if (writer != nullptr) {
+        writer->begin(CAPTURE_CMD_DRAW_INDEXED_INDIRECT);
+        writer->putHandle(buffer);
+        writer->put(offset);
+        writer->put(drawCount);
+        writer->put(stride);
+        writer->end();
+    }
+}
+
+/**
+ * Copies between buffers
+ *
+ * The arguments are the same as vkCmdCopyBuffer.
+ */
+void FrameCapture::cmdCopyBuffer(VkCommandBuffer commandBuffer, VkBuffer src, VkBuffer dst,
+                                 uint32_t count, const VkBufferCopy* regions) {
+    vkCmdCopyBuffer(commandBuffer, src, dst, count, regions);
+    CaptureWriter* writer = getCommands(commandBuffer);
+    if (writer != nullptr) {
+        writer->begin(CAPTURE_CMD_COPY_BUFFER);
+        writer->putHandle(src);
+        writer->putHandle(dst);
+        writer->putArray(regions, count);
+        writer->end();
+    }
+}
+
+/**
+ * Records the submission of a command buffer
+ *
+ * The submission itself is made by the caller, as the tutorial submits
+ * through the frame sync with semaphores the capture leaves out.
+ *
+ * @param commandBuffer The submitted command buffer
+ */
+void FrameCapture::submit(VkCommandBuffer commandBuffer) {
+    if (capturing) {
+        records.begin(CAPTURE_OP_SUBMIT);
+        records.putHandle(commandBuffer);
+        records.end();
+    }
+}
+
+/**
+ * Marks the end of a frame, saving the capture after the last one
+ */
+void FrameCapture::endFrame() {
+    if (!capturing) {
+        return;
+    }
+
+    records.begin(CAPTURE_OP_FRAME);
+    records.end();
+    frame++;
+    if (frame == skip + count) {
+        write();
+        capturing = false;
+        records.clear();
+    }
+}
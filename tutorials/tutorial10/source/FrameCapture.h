@@ -0,0 +1,414 @@
+//
+//  FrameCapture.h
+//  Tutorial10
+//
+//  A capture layer for the Vulkan calls of the tutorial. When a frame is slow
+//  it is hard to tell whether the cause is the frame itself or everything
+//  around it: the window system, the pacing, the other work on the machine.
+//  So this class wraps the calls that create resources, upload data, record
+//  commands, and submit them, and can save a few frames of them to a compact
+//  binary file. The replay tool (tutorials/replay) then runs those frames in
+//  a loop, with timing, on any device and without the tutorial or its assets.
+//
+//  Every wrapper issues its Vulkan call, and only records it when a capture
+//  is in progress, so the layer costs a branch per call otherwise. Resources
+//  are recorded from the start, as a frame needs everything created before
+//  it. The frames before the capture window are recorded too, so that the
+//  replay starts from the same state, but they are only run once at load.
+//
+//  Presentation, synchronization, and queries are not captured. The replay
+//  runs everything on a single queue, in submission order, which is stricter
+//  than the semaphores of the tutorial.
+//
+//  Version: 10/18/26
+//
+#ifndef __FRAME_CAPTURE_H__
+#define __FRAME_CAPTURE_H__
+#include "VulkanLoader.h"
+#include "CaptureFormat.h"
+#include <string>
+#include <unordered_map>
+#include <cstdint>
+
+/**
+ * A recorder of Vulkan calls for offline replay.
+ *
+ * The wrappers take the same arguments as the Vulkan calls, minus the device
+ * and the allocator. Only the state the tutorial uses is supported: buffer
+ * descriptors, and pipelines with no specialization constants, tessellation,
+ * or sample masks. Anything else is still passed on to Vulkan, but ends the
+ * capture with an error, as the replay could not run without it.
+ *
+ * Most Vulkan structs are stored as they are, handles and all, and their
+ * pointers are fixed up by the replay. The arrays they point to follow them
+ * in the record.
+ *
+ * The swapchain images are not created by the application, so they must be
+ * recorded with {@link addImage}. The replay creates images with the same
+ * format and size in their place.
+ */
+class FrameCapture {
+private:
+    /** The logical device */
+    VkDevice device;
+    /** The file to save the capture to */
+    std::string path;
+    /** The number of frames to run once before the timed frames */
+    uint32_t skip;
+    /** The number of timed frames */
+    uint32_t count;
+    /** The number of frames recorded so far */
+    uint32_t frame;
+    /** Whether calls are being recorded */
+    bool capturing;
+    /** The records so far */
+    CaptureWriter records;
+    /** The commands of each command buffer being recorded */
+    std::unordered_map<uint64_t, CaptureWriter> commands;
+
+    /**
+     * Returns the writer for the given command buffer, or null if not capturing
+     *
+     * @param commandBuffer The command buffer
+     *
+     * @return the writer for the given command buffer
+     */
+    CaptureWriter* getCommands(VkCommandBuffer commandBuffer);
+
+    /**
+     * Stops capturing, discarding the capture
+     *
+     * @param reason    The call that cannot be captured
+     */
+    void abandon(const char* reason);
+
+    /**
+     * Writes an optional pipeline state, prefixed by whether it is present
+     *
+     * @param state The pipeline state (may be null)
+     */
+    template <typename T>
+    void putState(const T* state) {
+        records.put<uint32_t>(state != nullptr);
+        if (state != nullptr) {
+            records.put(*state);
+        }
+    }
+
+    /**
+     * Saves the capture to the file
+     */
+    void write();
+
+public:
+    /**
+     * Creates a capture layer for the given device
+     *
+     * If the path is empty, the wrappers only issue their Vulkan calls.
+     *
+     * @param device    The logical device
+     * @param path      The file to save the capture to
+     * @param skip      The number of frames before the timed frames
+     * @param count     The number of timed frames
+     */
+    FrameCapture(VkDevice device, const std::string& path, uint32_t skip, uint32_t count);
+
+    /**
+     * Disposes of this capture layer, noting a capture that never finished
+     */
+    ~FrameCapture();
+
+    /**
+     * Returns true if calls are being recorded
+     *
+     * @return true if calls are being recorded
+     */
+    bool isCapturing() const { return capturing; }
+
+    /**
+     * Creates a buffer
+     *
+     * The memory properties are only recorded, so the replay can allocate
+     * memory of the same kind for the buffer.
+     *
+     * @param info          The buffer info
+     * @param properties    The memory properties of the buffer
+     * @param buffer        The buffer to create
+     *
+     * @return the result of vkCreateBuffer
+     */
+    VkResult createBuffer(const VkBufferCreateInfo& info, VkMemoryPropertyFlags properties, VkBuffer* buffer);
+
+    /**
+     * Copies data to a mapped buffer
+     *
+     * @param buffer    The buffer
+     * @param mapped    The mapped memory of the buffer
+     * @param offset    The offset in the buffer
+     * @param data      The data to copy
+     * @param size      The number of bytes
+     */
+    void writeBuffer(VkBuffer buffer, void* mapped, VkDeviceSize offset, const void* data, size_t size);
+
+    /**
+     * Records an image that was not created by the application
+     *
+     * @param image     The image (such as a swapchain image)
+     * @param format    The image format
+     * @param extent    The image size
+     * @param usage     The image usage
+     */
+    void addImage(VkImage image, VkFormat format, VkExtent2D extent, VkImageUsageFlags usage);
+
+    /**
+     * Creates an image view
+     *
+     * @param info  The image view info
+     * @param view  The image view to create
+     *
+     * @return the result of vkCreateImageView
+     */
+    VkResult createImageView(const VkImageViewCreateInfo& info, VkImageView* view);
+
+    /**
+     * Creates a render pass
+     *
+     * @param info          The render pass info
+     * @param renderPass    The render pass to create
+     *
+     * @return the result of vkCreateRenderPass
+     */
+    VkResult createRenderPass(const VkRenderPassCreateInfo& info, VkRenderPass* renderPass);
+
+    /**
+     * Creates a framebuffer
+     *
+     * @param info          The framebuffer info
+     * @param framebuffer   The framebuffer to create
+     *
+     * @return the result of vkCreateFramebuffer
+     */
+    VkResult createFramebuffer(const VkFramebufferCreateInfo& info, VkFramebuffer* framebuffer);
+
+    /**
+     * Creates a shader module
+     *
+     * @param info      The shader module info
+     * @param module    The shader module to create
+     *
+     * @return the result of vkCreateShaderModule
+     */
+    VkResult createShaderModule(const VkShaderModuleCreateInfo& info, VkShaderModule* module);
+
+    /**
+     * Creates a descriptor set layout
+     *
+     * @param info      The descriptor set layout info
+     * @param layout    The descriptor set layout to create
+     *
+     * @return the result of vkCreateDescriptorSetLayout
+     */
+    VkResult createDescriptorSetLayout(const VkDescriptorSetLayoutCreateInfo& info, VkDescriptorSetLayout* layout);
+
+    /**
+     * Creates a pipeline layout
+     *
+     * @param info      The pipeline layout info
+     * @param layout    The pipeline layout to create
+     *
+     * @return the result of vkCreatePipelineLayout
+     */
+    VkResult createPipelineLayout(const VkPipelineLayoutCreateInfo& info, VkPipelineLayout* layout);
+
+    /**
+     * Creates a graphics pipeline
+     *
+     * @param info      The pipeline info
+     * @param pipeline  The pipeline to create
+     *
+     * @return the result of vkCreateGraphicsPipelines
+     */
+    VkResult createGraphicsPipeline(const VkGraphicsPipelineCreateInfo& info, VkPipeline* pipeline);
+
+    /**
+     * Creates a compute pipeline
+     *
+     * @param info      The pipeline info
+     * @param pipeline  The pipeline to create
+     *
+     * @return the result of vkCreateComputePipelines
+     */
+    VkResult createComputePipeline(const VkComputePipelineCreateInfo& info, VkPipeline* pipeline);
+
+    /**
+     * Creates a descriptor pool
+     *
+     * @param info  The descriptor pool info
+     * @param pool  The descriptor pool to create
+     *
+     * @return the result of vkCreateDescriptorPool
+     */
+    VkResult createDescriptorPool(const VkDescriptorPoolCreateInfo& info, VkDescriptorPool* pool);
+
+    /**
+     * Allocates descriptor sets
+     *
+     * @param info  The allocation info
+     * @param sets  The descriptor sets to allocate
+     *
+     * @return the result of vkAllocateDescriptorSets
+     */
+    VkResult allocateDescriptorSets(const VkDescriptorSetAllocateInfo& info, VkDescriptorSet* sets);
+
+    /**
+     * Writes descriptor sets
+     *
+     * @param count     The number of writes
+     * @param writes    The descriptor writes
+     */
+    void updateDescriptorSets(uint32_t count, const VkWriteDescriptorSet* writes);
+
+    /**
+     * Begins a command buffer
+     *
+     * @param commandBuffer The command buffer
+     * @param info          The begin info
+     *
+     * @return the result of vkBeginCommandBuffer
+     */
+    VkResult beginCommandBuffer(VkCommandBuffer commandBuffer, const VkCommandBufferBeginInfo& info);
+
+    /**
+     * Ends a command buffer
+     *
+     * @param commandBuffer The command buffer
+     *
+     * @return the result of vkEndCommandBuffer
+     */
+    VkResult endCommandBuffer(VkCommandBuffer commandBuffer);
+
+    /**
+     * Records a pipeline barrier
+     *
+     * The arguments are the same as vkCmdPipelineBarrier.
+     */
+    void cmdPipelineBarrier(VkCommandBuffer commandBuffer, VkPipelineStageFlags srcStage, VkPipelineStageFlags dstStage,
+                            VkDependencyFlags dependencies,
+                            uint32_t memoryCount, const VkMemoryBarrier* memoryBarriers,
+                            uint32_t bufferCount, const VkBufferMemoryBarrier* bufferBarriers,
+                            uint32_t imageCount, const VkImageMemoryBarrier* imageBarriers);
+
+    /**
+     * Binds a pipeline
+     *
+     * The arguments are the same as vkCmdBindPipeline.
+     */
+    void cmdBindPipeline(VkCommandBuffer commandBuffer, VkPipelineBindPoint bindPoint, VkPipeline pipeline);
+
+    /**
+     * Binds descriptor sets
+     *
+     * The arguments are the same as vkCmdBindDescriptorSets.
+     */
+    void cmdBindDescriptorSets(VkCommandBuffer commandBuffer, VkPipelineBindPoint bindPoint, VkPipelineLayout layout,
+                               uint32_t firstSet, uint32_t setCount, const VkDescriptorSet* sets,
+                               uint32_t offsetCount, const uint32_t* offsets);
+
+    /**
+     * Dispatches a compute shader
+     *
+     * The arguments are the same as vkCmdDispatch.
+     */
+    void cmdDispatch(VkCommandBuffer commandBuffer, uint32_t x, uint32_t y, uint32_t z);
+
+    /**
+     * Dispatches a compute shader with the workgroups in a buffer
+     *
+     * The arguments are the same as vkCmdDispatchIndirect.
+     */
+    void cmdDispatchIndirect(VkCommandBuffer commandBuffer, VkBuffer buffer, VkDeviceSize offset);
+
+    /**
+     * Begins a render pass
+     *
+     * The arguments are the same as vkCmdBeginRenderPass.
+     */
+    void cmdBeginRenderPass(VkCommandBuffer commandBuffer, const VkRenderPassBeginInfo& info, VkSubpassContents contents);
+
+    /**
+     * Ends a render pass
+     *
+     * The arguments are the same as vkCmdEndRenderPass.
+     */
+    void cmdEndRenderPass(VkCommandBuffer commandBuffer);
+
+    /**
+     * Sets the viewports
+     *
+     * The arguments are the same as vkCmdSetViewport.
+     */
+    void cmdSetViewport(VkCommandBuffer commandBuffer, uint32_t first, uint32_t count, const VkViewport* viewports);
+
+    /**
+     * Sets the scissors
+     *
+     * The arguments are the same as vkCmdSetScissor.
+     */
+    void cmdSetScissor(VkCommandBuffer commandBuffer, uint32_t first, uint32_t count, const VkRect2D* scissors);
+
+    /**
+     * Binds vertex buffers
+     *
+     * The arguments are the same as vkCmdBindVertexBuffers.
+     */
+    void cmdBindVertexBuffers(VkCommandBuffer commandBuffer, uint32_t first, uint32_t count,
+                              const VkBuffer* buffers, const VkDeviceSize* offsets);
+
+    /**
+     * Draws primitives
+     *
+     * The arguments are the same as vkCmdDraw.
+     */
+    void cmdDraw(VkCommandBuffer commandBuffer, uint32_t vertexCount, uint32_t instanceCount,
+                 uint32_t firstVertex, uint32_t firstInstance);
+
+    /**
+     * Binds an index buffer
+     *
+     * The arguments are the same as vkCmdBindIndexBuffer.
+     */
+    void cmdBindIndexBuffer(VkCommandBuffer commandBuffer, VkBuffer buffer, VkDeviceSize offset, VkIndexType indexType);
+
+    /**
+     * Draws indexed primitives with the arguments in a buffer
+     *
+     * The arguments are the same as vkCmdDrawIndexedIndirect.
+     */
+    void cmdDrawIndexedIndirect(VkCommandBuffer commandBuffer, VkBuffer buffer, VkDeviceSize offset,
+                                uint32_t drawCount, uint32_t stride);
+
+    /**
+     * Copies between buffers
+     *
+     * The arguments are the same as vkCmdCopyBuffer.
+     */
+    void cmdCopyBuffer(VkCommandBuffer commandBuffer, VkBuffer src, VkBuffer dst,
+                       uint32_t count, const VkBufferCopy* regions);
+
+    /**
+     * Records the submission of a command buffer
+     *
+     * The submission itself is made by the caller, as the tutorial submits
+     * through the frame sync with semaphores the capture leaves out.
+     *
+     * @param commandBuffer The submitted command buffer
+     */
+    void submit(VkCommandBuffer commandBuffer);
+
+    /**
+     * Marks the end of a frame, saving the capture after the last one
+     */
+    void endFrame();
+};
+
+#endif /* __FRAME_CAPTURE_H__ */
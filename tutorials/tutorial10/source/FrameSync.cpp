@@ -0,0 +1,346 @@
+//
+//  FrameSync.cpp
+//  Tutorial10
+//
+//  Frame synchronization built on timeline semaphores. The tutorial keeps a
+//  fence and a binary semaphore per frame in flight for each queue, and waits
+//  on two fences every frame. Every new dependency between the queues needs
+//  yet another array of binary semaphores.
+//
+//  This class gives each queue a single timeline semaphore instead, whose
+//  value is the number of the last frame that queue finished. A submission
+//  signals the current frame number on the timeline of its queue, and may
+//  wait on any value of any other timeline. The CPU waits for a frame to
+//  retire with one vkWaitSemaphores on every timeline, and can check how far
+//  the GPU has gotten (for recycling resources) without waiting at all.
+//
+//  The swapchain still requires binary semaphores for acquire and present,
+//  as timeline semaphores are not allowed there. This class owns those as
+//  well, so the application never creates a semaphore or a fence itself.
+//
+//  Version: 10/18/26
+//
+#include "FrameSync.h"
+#include <stdexcept>
+#include <algorithm>
+#include <limits>
+
+/**
+ * Creates the synchronization layer for a device.
+ *
+ * The device must have been created with the timelineSemaphore feature.
+ * Slots are assigned for the largest number of frames in flight, so that
+ * the number can change later without waiting on the GPU.
+ *
+ * @param device        The logical device
+ * @param frameCount    The number of frames in flight
+ * @param slotCount     The largest number of frames in flight
+ */
+FrameSync::FrameSync(VkDevice device, uint32_t frameCount, uint32_t slotCount) :
+    device(device),
+    frameCount(frameCount),
+    slotCount(slotCount),
+    frame(0) {
+    if (frameCount == 0 || frameCount > slotCount) {
+        throw std::runtime_error("invalid number of frames in flight!");
+    }
+
+    // The core names only resolve on a 1.2 device
+    waitSemaphores = (PFN_vkWaitSemaphoresKHR) vkGetDeviceProcAddr(device, "vkWaitSemaphores");
+    getCounterValue = (PFN_vkGetSemaphoreCounterValueKHR) vkGetDeviceProcAddr(device, "vkGetSemaphoreCounterValue");
+    if (waitSemaphores == nullptr || getCounterValue == nullptr) {
+        waitSemaphores = (PFN_vkWaitSemaphoresKHR) vkGetDeviceProcAddr(device, "vkWaitSemaphoresKHR");
+        getCounterValue = (PFN_vkGetSemaphoreCounterValueKHR) vkGetDeviceProcAddr(device, "vkGetSemaphoreCounterValueKHR");
+    }
+    if (waitSemaphores == nullptr || getCounterValue == nullptr) {
+        throw std::runtime_error("timeline semaphores are not available!");
+    }
+
+    VkSemaphoreCreateInfo semaphoreInfo{};
+    semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+    acquireSemaphores.resize(slotCount, VK_NULL_HANDLE);
+    for (size_t ii = 0; ii < acquireSemaphores.size(); ii++) {
+        if (vkCreateSemaphore(device, &semaphoreInfo, nullptr, &acquireSemaphores[ii]) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create synchronization objects for a frame!");
+        }
+    }
+}
+
+/**
+ * Destroys every semaphore. The device must be done with all of them.
+ */
+FrameSync::~FrameSync() {
+    destroySwapchainSemaphores();
+    for (size_t ii = 0; ii < acquireSemaphores.size(); ii++) {
+        vkDestroySemaphore(device, acquireSemaphores[ii], nullptr);
+    }
+    for (size_t ii = 0; ii < timelines.size(); ii++) {
+        vkDestroySemaphore(device, timelines[ii], nullptr);
+    }
+}
+
+/**
+ * Returns true if the device supports timeline semaphores
+ *
+ * @param device    The physical device
+ *
+ * @return true if the device supports timeline semaphores
+ */
+bool FrameSync::isSupported(VkPhysicalDevice device) {
+    VkPhysicalDeviceTimelineSemaphoreFeatures timelineFeatures{};
+    timelineFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES;
+
+    VkPhysicalDeviceFeatures2 features{};
+    features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    features.pNext = &timelineFeatures;
+    vkGetPhysicalDeviceFeatures2(device, &features);
+
+    return timelineFeatures.timelineSemaphore == VK_TRUE;
+}
+
+/**
+ * Adds a timeline for the given queue, returning its index.
+ *
+ * Two timelines may share a queue, if they are different roles of it.
+ *
+ * @param queue The queue to submit to
+ *
+ * @return the index of the new timeline
+ */
+uint32_t FrameSync::addQueue(VkQueue queue) {
+    VkSemaphoreTypeCreateInfo typeInfo{};
+    typeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+    typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+    typeInfo.initialValue = frame;
+
+    VkSemaphoreCreateInfo semaphoreInfo{};
+    semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    semaphoreInfo.pNext = &typeInfo;
+
+    VkSemaphore timeline;
+    if (vkCreateSemaphore(device, &semaphoreInfo, nullptr, &timeline) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create a queue timeline!");
+    }
+
+    queues.push_back(queue);
+    timelines.push_back(timeline);
+    return static_cast<uint32_t>(timelines.size()-1);
+}
+
+/**
+ * Creates the present semaphores for a new swapchain, returning the old ones.
+ *
+ * Pending presents may still wait on the old semaphores, so they are handed
+ * back to be retired along with the old swapchain. The acquire semaphores
+ * carry over, so every image acquired from the old swapchain must have been
+ * submitted (and so its acquire semaphore waited on) before this is called.
+ *
+ * @param imageCount    The number of swapchain images
+ *
+ * @return the present semaphores of the old swapchain
+ */
+std::vector<VkSemaphore> FrameSync::resetSwapchain(uint32_t imageCount) {
+    std::vector<VkSemaphore> retired;
+    retired.swap(presentSemaphores);
+
+    VkSemaphoreCreateInfo semaphoreInfo{};
+    semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+    presentSemaphores.resize(imageCount, VK_NULL_HANDLE);
+    for (size_t ii = 0; ii < presentSemaphores.size(); ii++) {
+        if (vkCreateSemaphore(device, &semaphoreInfo, nullptr, &presentSemaphores[ii]) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create synchronization objects for an image!");
+        }
+    }
+    return retired;
+}
+
+/**
+ * Changes the number of frames in flight.
+ *
+ * This takes effect with the next frame, and does not wait on the GPU. The
+ * slots are always assigned modulo the slot count, so a slot is never reused
+ * before the frame that last used it has finished, whatever the count.
+ *
+ * @param count The number of frames in flight, from 1 to the slot count
+ */
+void FrameSync::setFrameCount(uint32_t count) {
+    if (count == 0 || count > slotCount) {
+        throw std::runtime_error("invalid number of frames in flight!");
+    }
+    frameCount = count;
+}
+
+/**
+ * Destroys the binary semaphores of the swapchain
+ */
+void FrameSync::destroySwapchainSemaphores() {
+    for (size_t ii = 0; ii < presentSemaphores.size(); ii++) {
+        vkDestroySemaphore(device, presentSemaphores[ii], nullptr);
+    }
+    presentSemaphores.clear();
+}
+
+/**
+ * Starts a new frame, returning its slot.
+ *
+ * This blocks until the frame that is the number of frames in flight behind
+ * has finished on every timeline. The frame that last used the slot is no
+ * later than that one, so anything indexed by slot is then safe to reuse.
+ *
+ * @return the slot of the new frame, in [0, slotCount)
+ */
+uint32_t FrameSync::beginFrame() {
+    frame++;
+    if (frame > frameCount) {
+        wait(frame - frameCount);
+    }
+    return static_cast<uint32_t>(frame % slotCount);
+}
+
+/**
+ * Blocks until every timeline has finished the given frame
+ *
+ * @param target    The frame number to wait for
+ */
+void FrameSync::wait(uint64_t target) const {
+    if (timelines.empty()) {
+        return;
+    }
+
+    std::vector<uint64_t> values(timelines.size(), target);
+
+    VkSemaphoreWaitInfo waitInfo{};
+    waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+    waitInfo.semaphoreCount = static_cast<uint32_t>(timelines.size());
+    waitInfo.pSemaphores = timelines.data();
+    waitInfo.pValues = values.data();
+
+    if (waitSemaphores(device, &waitInfo, UINT64_MAX) != VK_SUCCESS) {
+        throw std::runtime_error("failed to wait for a frame!");
+    }
+}
+
+/**
+ * Returns the last frame that has finished on every timeline.
+ *
+ * This does not block, so it can be polled to recycle resources.
+ *
+ * @return the last frame that has finished on every timeline
+ */
+uint64_t FrameSync::getCompletedFrame() const {
+    uint64_t result = std::numeric_limits<uint64_t>::max();
+    for (size_t ii = 0; ii < timelines.size(); ii++) {
+        uint64_t value = 0;
+        getCounterValue(device, timelines[ii], &value);
+        result = std::min(result, value);
+    }
+    return timelines.empty() ? frame : result;
+}
+
+/**
+ * Returns the semaphore to pass to vkAcquireNextImageKHR this frame
+ *
+ * @return the semaphore to pass to vkAcquireNextImageKHR this frame
+ */
+VkSemaphore FrameSync::getAcquireSemaphore() const {
+    return acquireSemaphores[frame % slotCount];
+}
+
+/**
+ * Returns the semaphore to wait on when presenting the given image
+ *
+ * @param image The swapchain image index
+ *
+ * @return the semaphore to wait on when presenting the given image
+ */
+VkSemaphore FrameSync::getPresentSemaphore(uint32_t image) const {
+    return presentSemaphores[image];
+}
+
+/**
+ * Submits work to a timeline, signaling the current frame
+ *
+ * @param timeline      The timeline to submit to
+ * @param commandBuffer The command buffer to submit
+ * @param waits         The timeline values to wait on
+ */
+void FrameSync::submit(uint32_t timeline, VkCommandBuffer commandBuffer, const std::vector<Wait>& waits) {
+    submit(timeline, commandBuffer, waits, VK_NULL_HANDLE, 0, VK_NULL_HANDLE);
+}
+
+/**
+ * Submits work that renders to a swapchain image, signaling the current frame.
+ *
+ * This also waits on the acquire semaphore of the frame, and signals the
+ * present semaphore of the image.
+ *
+ * @param timeline      The timeline to submit to
+ * @param commandBuffer The command buffer to submit
+ * @param waits         The timeline values to wait on
+ * @param imageStage    The pipeline stages that wait on the acquired image
+ * @param image         The swapchain image index
+ */
+void FrameSync::submitImage(uint32_t timeline, VkCommandBuffer commandBuffer, const std::vector<Wait>& waits,
+                            VkPipelineStageFlags imageStage, uint32_t image) {
+    submit(timeline, commandBuffer, waits, getAcquireSemaphore(), imageStage, getPresentSemaphore(image));
+}
+
+/**
+ * Submits work to a timeline, signaling the current frame
+ *
+ * @param timeline      The timeline to submit to
+ * @param commandBuffer The command buffer to submit
+ * @param waits         The timeline values to wait on
+ * @param acquire       The acquire semaphore to wait on (or VK_NULL_HANDLE)
+ * @param acquireStage  The pipeline stages that wait on acquire
+ * @param present       The present semaphore to signal (or VK_NULL_HANDLE)
+ */
+void FrameSync::submit(uint32_t timeline, VkCommandBuffer commandBuffer, const std::vector<Wait>& waits,
+                       VkSemaphore acquire, VkPipelineStageFlags acquireStage, VkSemaphore present) {
+    if (timeline >= timelines.size()) {
+        throw std::runtime_error("submission to an invalid timeline!");
+    }
+
+    // Binary semaphores ignore their values, but still need an entry
+    std::vector<VkSemaphore> semaphores;
+    std::vector<uint64_t> values;
+    std::vector<VkPipelineStageFlags> stages;
+    for (const auto& wait : waits) {
+        semaphores.push_back(timelines[wait.timeline]);
+        values.push_back(wait.frame);
+        stages.push_back(wait.stage);
+    }
+    if (acquire != VK_NULL_HANDLE) {
+        semaphores.push_back(acquire);
+        values.push_back(0);
+        stages.push_back(acquireStage);
+    }
+
+    VkSemaphore signalSemaphores[] = { timelines[timeline], present };
+    uint64_t signalValues[] = { frame, 0 };
+    uint32_t signalCount = present == VK_NULL_HANDLE ? 1 : 2;
+
+    VkTimelineSemaphoreSubmitInfo timelineInfo{};
+    timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+    timelineInfo.waitSemaphoreValueCount = static_cast<uint32_t>(values.size());
+    timelineInfo.pWaitSemaphoreValues = values.data();
+    timelineInfo.signalSemaphoreValueCount = signalCount;
+    timelineInfo.pSignalSemaphoreValues = signalValues;
+
+    VkSubmitInfo submitInfo{};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.pNext = &timelineInfo;
+    submitInfo.waitSemaphoreCount = static_cast<uint32_t>(semaphores.size());
+    submitInfo.pWaitSemaphores = semaphores.data();
+    submitInfo.pWaitDstStageMask = stages.data();
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &commandBuffer;
+    submitInfo.signalSemaphoreCount = signalCount;
+    submitInfo.pSignalSemaphores = signalSemaphores;
+
+    if (vkQueueSubmit(queues[timeline], 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS) {
+        throw std::runtime_error("failed to submit a command buffer!");
+    }
+}
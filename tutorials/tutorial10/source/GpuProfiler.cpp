@@ -0,0 +1,595 @@
+//
+//  GpuProfiler.cpp
+//  Tutorial10
+//
+//  GPU timestamps for the passes of each frame. The CPU cannot see how long
+//  the simulation or the drawing take on the GPU, or whether the compute and
+//  graphics queues actually run at the same time. So this class brackets
+//  named scopes in the command buffers with timestamps, and keeps a rolling
+//  average of each one. The scopes are also emitted as debug utils labels,
+//  so they show up in frame debuggers such as RenderDoc.
+//
+//  Every frame slot has its own query pools, and the results of a frame are
+//  read once the frame has retired, so reading them never stalls. The
+//  averages, and optionally the pipeline statistics, are logged once a
+//  second. The scopes can also be saved as a Chrome trace, which can be
+//  opened in chrome://tracing or https://ui.perfetto.dev.
+//
+//  Version: 10/18/26
+//
+#include "GpuProfiler.h"
+#include <SDL3/SDL.h>
+#include <stdexcept>
+#include <algorithm>
+#include <fstream>
+
+/** The marker query of a scope that could not be timed */
+static const uint32_t NO_QUERY = UINT32_MAX;
+
+/** The pipeline statistics gathered on queues with graphics support */
+static const VkQueryPipelineStatisticFlags GRAPHICS_STATISTICS =
+    VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_VERTICES_BIT |
+    VK_QUERY_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT |
+    VK_QUERY_PIPELINE_STATISTIC_CLIPPING_PRIMITIVES_BIT |
+    VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT;
+
+/** The pipeline statistics gathered on every queue */
+static const VkQueryPipelineStatisticFlags COMPUTE_STATISTICS =
+    VK_QUERY_PIPELINE_STATISTIC_COMPUTE_SHADER_INVOCATIONS_BIT;
+
+/**
+ * Returns the position of a statistic in the results for the given flags
+ *
+ * Query results are written in the order of the flag bits.
+ *
+ * @param flags     The statistics gathered
+ * @param statistic The statistic to find
+ *
+ * @return the position of a statistic in the results for the given flags
+ */
+static size_t statistic_index(VkQueryPipelineStatisticFlags flags, VkQueryPipelineStatisticFlags statistic) {
+    size_t index = 0;
+    for (VkQueryPipelineStatisticFlags bit = 1; bit < statistic; bit <<= 1) {
+        if (flags & bit) {
+            index++;
+        }
+    }
+    return index;
+}
+
+/**
+ * Returns the number of statistics in the given flags
+ *
+ * @param flags     The statistics gathered
+ *
+ * @return the number of statistics in the given flags
+ */
+static size_t statistic_count(VkQueryPipelineStatisticFlags flags) {
+    size_t count = 0;
+    for (; flags != 0; flags &= flags - 1) {
+        count++;
+    }
+    return count;
+}
+
+/**
+ * Returns the given string escaped for a JSON string literal
+ *
+ * @param text  The string to escape
+ *
+ * @return the given string escaped for a JSON string literal
+ */
+static std::string json_escape(const std::string& text) {
+    std::string result;
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            result += '\\';
+            result += c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            result += ' ';
+        } else {
+            result += c;
+        }
+    }
+    return result;
+}
+
+/**
+ * Creates a profiler for the given device
+ *
+ * Labels require VK_EXT_debug_utils on the instance, and statistics
+ * require the pipelineStatisticsQuery feature on the device.
+ *
+ * @param instance          The Vulkan instance
+ * @param physicalDevice    The physical device
+ * @param device            The logical device
+ * @param slotCount         The number of frame slots
+ * @param labels            Whether to emit debug utils labels
+ * @param statistics        Whether to gather pipeline statistics
+ */
+GpuProfiler::GpuProfiler(VkInstance instance, VkPhysicalDevice physicalDevice, VkDevice device, uint32_t slotCount,
+                         bool labels, bool statistics) :
+    device(device),
+    slotCount(slotCount),
+    slot(0),
+    period(1.0),
+    statisticsEnabled(statistics),
+    beginLabel(nullptr),
+    endLabel(nullptr),
+    tracing(false),
+    traceOrigin(0),
+    traceStarted(false),
+    overlapTime(0),
+    overlapSamples(0) {
+    lastLog = std::chrono::steady_clock::now();
+
+    uint32_t familyCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &familyCount, nullptr);
+    families.resize(familyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &familyCount, families.data());
+
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+    period = properties.limits.timestampPeriod;
+
+    if (labels) {
+        beginLabel = (PFN_vkCmdBeginDebugUtilsLabelEXT) vkGetInstanceProcAddr(instance, "vkCmdBeginDebugUtilsLabelEXT");
+        endLabel = (PFN_vkCmdEndDebugUtilsLabelEXT) vkGetInstanceProcAddr(instance, "vkCmdEndDebugUtilsLabelEXT");
+        if (beginLabel == nullptr || endLabel == nullptr) {
+            beginLabel = nullptr;
+            endLabel = nullptr;
+        }
+    }
+}
+
+/**
+ * Destroys the profiler. The device must be done with its queries.
+ */
+GpuProfiler::~GpuProfiler() {
+    for (auto& queue : queues) {
+        for (VkQueryPool pool : queue.pools) {
+            vkDestroyQueryPool(device, pool, nullptr);
+        }
+        if (queue.statisticsPool != VK_NULL_HANDLE) {
+            vkDestroyQueryPool(device, queue.statisticsPool, nullptr);
+        }
+    }
+}
+
+/**
+ * Returns true if the device supports pipeline statistics queries
+ *
+ * @param device    The physical device
+ *
+ * @return true if the device supports pipeline statistics queries
+ */
+bool GpuProfiler::isStatisticsSupported(VkPhysicalDevice device) {
+    VkPhysicalDeviceFeatures features;
+    vkGetPhysicalDeviceFeatures(device, &features);
+    return features.pipelineStatisticsQuery == VK_TRUE;
+}
+
+/**
+ * Adds a queue to profile, returning its index
+ *
+ * The first two queues added are the ones whose overlap is measured.
+ *
+ * @param family    The queue family
+ * @param name      The queue name
+ *
+ * @return the index of the queue
+ */
+uint32_t GpuProfiler::addQueue(uint32_t family, const std::string& name) {
+    Queue queue;
+    queue.name = name;
+    queue.statisticsPool = VK_NULL_HANDLE;
+    queue.statisticFlags = 0;
+    queue.statisticSamples = 0;
+    queue.spanStart = 0;
+    queue.spanEnd = 0;
+    queue.frames.resize(slotCount, { {}, {}, 0, false });
+
+    uint32_t validBits = families[family].timestampValidBits;
+    queue.validMask = validBits == 0 ? 0 : validBits >= 64 ? UINT64_MAX : (1ull << validBits) - 1;
+    if (validBits == 0) {
+        SDL_Log("Queue family %u does not support timestamps; %s is not timed", family, name.c_str());
+    } else {
+        VkQueryPoolCreateInfo poolInfo{};
+        poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+        poolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+        poolInfo.queryCount = MAX_QUERIES;
+
+        queue.pools.resize(slotCount, VK_NULL_HANDLE);
+        for (uint32_t ii = 0; ii < slotCount; ii++) {
+            if (vkCreateQueryPool(device, &poolInfo, nullptr, &queue.pools[ii]) != VK_SUCCESS) {
+                throw std::runtime_error("failed to create timestamp query pool!");
+            }
+        }
+    }
+
+    if (statisticsEnabled) {
+        // Graphics statistics are only valid on a queue family that can draw
+        queue.statisticFlags = COMPUTE_STATISTICS;
+        if (families[family].queueFlags & VK_QUEUE_GRAPHICS_BIT) {
+            queue.statisticFlags |= GRAPHICS_STATISTICS;
+        }
+        queue.statistics.resize(statistic_count(queue.statisticFlags), 0);
+        queue.statisticSums.resize(queue.statistics.size(), 0);
+
+        VkQueryPoolCreateInfo poolInfo{};
+        poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+        poolInfo.queryType = VK_QUERY_TYPE_PIPELINE_STATISTICS;
+        poolInfo.queryCount = slotCount;
+        poolInfo.pipelineStatistics = queue.statisticFlags;
+
+        if (vkCreateQueryPool(device, &poolInfo, nullptr, &queue.statisticsPool) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create pipeline statistics query pool!");
+        }
+    }
+
+    queues.push_back(std::move(queue));
+    return static_cast<uint32_t>(queues.size() - 1);
+}
+
+/**
+ * Starts a new frame in the given slot.
+ *
+ * This collects the results of the last frame in that slot, which must
+ * have retired on every queue, and logs the averages once a second.
+ *
+ * @param index The frame slot
+ */
+void GpuProfiler::beginFrame(uint32_t index) {
+    slot = index;
+    collect(index);
+
+    auto now = std::chrono::steady_clock::now();
+    if (now - lastLog >= std::chrono::seconds(1) && !passes.empty()) {
+        log();
+        lastLog = now;
+    }
+}
+
+/**
+ * Collects the results of every slot. The device must be idle.
+ */
+void GpuProfiler::finish() {
+    for (uint32_t ii = 0; ii < slotCount; ii++) {
+        collect(ii);
+    }
+}
+
+/**
+ * Starts profiling a command buffer, outside of any render pass
+ *
+ * @param commandBuffer The command buffer to record to
+ * @param queue         The queue the command buffer is submitted to
+ */
+void GpuProfiler::beginCommands(VkCommandBuffer commandBuffer, uint32_t queue) {
+    Queue& current = queues[queue];
+    Frame& frame = current.frames[slot];
+    frame.markers.clear();
+    frame.open.clear();
+    frame.queries = 0;
+    frame.recorded = false;
+
+    if (current.validMask != 0) {
+        vkCmdResetQueryPool(commandBuffer, current.pools[slot], 0, MAX_QUERIES);
+    }
+    if (current.statisticsPool != VK_NULL_HANDLE) {
+        vkCmdResetQueryPool(commandBuffer, current.statisticsPool, slot, 1);
+        vkCmdBeginQuery(commandBuffer, current.statisticsPool, slot, 0);
+    }
+}
+
+/**
+ * Stops profiling a command buffer, outside of any render pass
+ *
+ * @param commandBuffer The command buffer to record to
+ * @param queue         The queue the command buffer is submitted to
+ */
+void GpuProfiler::endCommands(VkCommandBuffer commandBuffer, uint32_t queue) {
+    Queue& current = queues[queue];
+    Frame& frame = current.frames[slot];
+    while (!frame.open.empty()) {
+        endScope(commandBuffer, queue);
+    }
+    if (current.statisticsPool != VK_NULL_HANDLE) {
+        vkCmdEndQuery(commandBuffer, current.statisticsPool, slot);
+    }
+    frame.recorded = true;
+}
+
+/**
+ * Begins a scope with the given name
+ *
+ * The name is not copied, so it should be a string literal.
+ *
+ * @param commandBuffer The command buffer to record to
+ * @param queue         The queue the command buffer is submitted to
+ * @param name          The scope name
+ */
+void GpuProfiler::beginScope(VkCommandBuffer commandBuffer, uint32_t queue, const char* name) {
+    Queue& current = queues[queue];
+    Frame& frame = current.frames[slot];
+
+    if (beginLabel != nullptr) {
+        // Alternate queues are blue and orange in a frame debugger
+        VkDebugUtilsLabelEXT label{};
+        label.sType = VK_STRUCTURE_TYPE_DEBUG_UTILS_LABEL_EXT;
+        label.pLabelName = name;
+        label.color[0] = queue % 2 == 0 ? 0.3f : 1.0f;
+        label.color[1] = 0.6f;
+        label.color[2] = queue % 2 == 0 ? 1.0f : 0.2f;
+        label.color[3] = 1.0f;
+        beginLabel(commandBuffer, &label);
+    }
+
+    // Scopes past the capacity of the pool are labeled, but not timed
+    Marker marker;
+    marker.name = name;
+    marker.depth = static_cast<uint32_t>(frame.open.size());
+    marker.query = NO_QUERY;
+    if (current.validMask != 0 && frame.queries + 2 <= MAX_QUERIES) {
+        marker.query = frame.queries;
+        frame.queries += 2;
+        vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, current.pools[slot], marker.query);
+    }
+    frame.open.push_back(frame.markers.size());
+    frame.markers.push_back(marker);
+}
+
+/**
+ * Ends the innermost open scope
+ *
+ * @param commandBuffer The command buffer to record to
+ * @param queue         The queue the command buffer is submitted to
+ */
+void GpuProfiler::endScope(VkCommandBuffer commandBuffer, uint32_t queue) {
+    Queue& current = queues[queue];
+    Frame& frame = current.frames[slot];
+    if (frame.open.empty()) {
+        throw std::runtime_error("GPU profiler scope ended without a begin!");
+    }
+
+    const Marker& marker = frame.markers[frame.open.back()];
+    frame.open.pop_back();
+    if (marker.query != NO_QUERY) {
+        vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, current.pools[slot], marker.query + 1);
+    }
+    if (endLabel != nullptr) {
+        endLabel(commandBuffer);
+    }
+}
+
+/**
+ * Returns the rolling average of every scope timed so far
+ *
+ * @return the rolling average of every scope timed so far
+ */
+std::vector<GpuProfiler::Average> GpuProfiler::getAverages() const {
+    std::vector<Average> result;
+    for (const auto& entry : passes) {
+        const Pass& pass = entry.second;
+        Average average;
+        average.name = entry.first.second;
+        average.queue = queues[entry.first.first].name;
+        average.milliseconds = pass.window.empty() ? 0.0 : pass.sum / pass.window.size();
+        result.push_back(average);
+    }
+    return result;
+}
+
+/**
+ * Returns the rolling average of a scope in milliseconds (0 if never timed)
+ *
+ * @param queue The queue of the scope
+ * @param name  The scope name
+ *
+ * @return the rolling average of a scope in milliseconds
+ */
+double GpuProfiler::getAverage(uint32_t queue, const std::string& name) const {
+    auto it = passes.find(std::make_pair(queue, name));
+    if (it == passes.end() || it->second.window.empty()) {
+        return 0.0;
+    }
+    return it->second.sum / it->second.window.size();
+}
+
+/**
+ * Returns a pipeline statistic of the last collected frame of a queue
+ *
+ * This is 0 if statistics are disabled, or not gathered on that queue.
+ *
+ * @param queue     The queue
+ * @param statistic The statistic
+ *
+ * @return a pipeline statistic of the last collected frame of a queue
+ */
+uint64_t GpuProfiler::getStatistic(uint32_t queue, VkQueryPipelineStatisticFlagBits statistic) const {
+    const Queue& current = queues[queue];
+    if (!(current.statisticFlags & statistic)) {
+        return 0;
+    }
+    return current.statistics[statistic_index(current.statisticFlags, statistic)];
+}
+
+/**
+ * Saves the scopes kept so far as a Chrome trace
+ *
+ * @param path  The file to write
+ *
+ * @return true if the file was written
+ */
+bool GpuProfiler::writeTrace(const std::string& path) const {
+    std::ofstream file(path);
+    if (!file.is_open()) {
+        SDL_Log("Failed to write GPU trace %s", path.c_str());
+        return false;
+    }
+
+    // Work on another queue can start before the first timestamp read
+    double origin = 0;
+    for (const auto& event : events) {
+        origin = std::min(origin, event.start);
+    }
+
+    // Each queue is a thread of a single GPU process
+    char buffer[256];
+    file << "{\"traceEvents\":[\n";
+    file << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"GPU\"}}";
+    for (size_t ii = 0; ii < queues.size(); ii++) {
+        file << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << ii
+             << ",\"args\":{\"name\":\"" << json_escape(queues[ii].name) << "\"}}";
+    }
+    for (const auto& event : events) {
+        snprintf(buffer, sizeof(buffer), "\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+                 event.queue, event.start - origin, event.duration);
+        file << ",\n{\"name\":\"" << json_escape(event.name) << "\",\"cat\":\"gpu\"," << buffer;
+    }
+    file << "\n],\"displayTimeUnit\":\"ms\"}\n";
+
+    SDL_Log("Wrote %zu GPU scopes to %s", events.size(), path.c_str());
+    return file.good();
+}
+
+/**
+ * Collects the results of the given frame slot, which must have retired
+ *
+ * @param index The frame slot
+ */
+void GpuProfiler::collect(uint32_t index) {
+    double scale = period / 1000000.0;
+    for (uint32_t qi = 0; qi < queues.size(); qi++) {
+        Queue& queue = queues[qi];
+        Frame& frame = queue.frames[index];
+        queue.spanStart = 0;
+        queue.spanEnd = 0;
+        if (!frame.recorded) {
+            continue;
+        }
+        frame.recorded = false;
+
+        uint64_t stamps[MAX_QUERIES];
+        VkResult result = VK_NOT_READY;
+        if (frame.queries > 0) {
+            result = vkGetQueryPoolResults(device, queue.pools[index], 0, frame.queries, sizeof(uint64_t) * frame.queries,
+                                           stamps, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+        }
+        if (result == VK_SUCCESS) {
+            bool first = true;
+            for (const auto& marker : frame.markers) {
+                if (marker.query == NO_QUERY) {
+                    continue;
+                }
+                uint64_t start = stamps[marker.query] & queue.validMask;
+                uint64_t ticks = ((stamps[marker.query + 1] & queue.validMask) - start) & queue.validMask;
+                addSample(qi, marker.name, ticks * scale);
+
+                // The outermost scopes decide when the queue was busy
+                if (marker.depth == 0) {
+                    queue.spanStart = first ? start : std::min(queue.spanStart, start);
+                    queue.spanEnd = first ? start + ticks : std::max(queue.spanEnd, start + ticks);
+                    first = false;
+                }
+
+                if (tracing && events.size() < MAX_EVENTS) {
+                    if (!traceStarted) {
+                        traceOrigin = start;
+                        traceStarted = true;
+                    }
+                    Event event;
+                    event.name = marker.name;
+                    event.queue = qi;
+                    event.start = static_cast<double>(static_cast<int64_t>(start - traceOrigin)) * period / 1000.0;
+                    event.duration = ticks * period / 1000.0;
+                    events.push_back(event);
+                }
+            }
+        }
+
+        if (queue.statisticsPool != VK_NULL_HANDLE) {
+            result = vkGetQueryPoolResults(device, queue.statisticsPool, index, 1, sizeof(uint64_t) * queue.statistics.size(),
+                                           queue.statistics.data(), sizeof(uint64_t) * queue.statistics.size(),
+                                           VK_QUERY_RESULT_64_BIT);
+            if (result == VK_SUCCESS) {
+                for (size_t ii = 0; ii < queue.statistics.size(); ii++) {
+                    queue.statisticSums[ii] += queue.statistics[ii];
+                }
+                queue.statisticSamples++;
+            }
+        }
+    }
+
+    // The same frame on both queues, assuming they share a clock
+    if (queues.size() >= 2 && queues[0].spanEnd > queues[0].spanStart && queues[1].spanEnd > queues[1].spanStart) {
+        uint64_t overlapStart = std::max(queues[0].spanStart, queues[1].spanStart);
+        uint64_t overlapEnd = std::min(queues[0].spanEnd, queues[1].spanEnd);
+        overlapTime += overlapEnd > overlapStart ? (overlapEnd - overlapStart) * scale : 0.0;
+        overlapSamples++;
+    }
+}
+
+/**
+ * Adds a duration to the rolling window of a scope
+ *
+ * @param queue         The queue of the scope
+ * @param name          The scope name
+ * @param milliseconds  The duration in milliseconds
+ */
+void GpuProfiler::addSample(uint32_t queue, const char* name, double milliseconds) {
+    Pass& pass = passes[std::make_pair(queue, std::string(name))];
+    if (pass.window.size() < WINDOW) {
+        pass.window.push_back(milliseconds);
+        pass.next = pass.window.size() % WINDOW;
+        pass.sum += milliseconds;
+    } else {
+        pass.sum += milliseconds - pass.window[pass.next];
+        pass.window[pass.next] = milliseconds;
+        pass.next = (pass.next + 1) % WINDOW;
+    }
+}
+
+/**
+ * Logs the rolling averages and statistics, and resets the accumulators
+ */
+void GpuProfiler::log() {
+    char buffer[128];
+    std::string message = "GPU";
+    for (const auto& average : getAverages()) {
+        snprintf(buffer, sizeof(buffer), " %s/%s %.3f ms,", average.queue.c_str(), average.name.c_str(), average.milliseconds);
+        message += buffer;
+    }
+    message.pop_back();
+    if (overlapSamples > 0) {
+        snprintf(buffer, sizeof(buffer), "; %s and %s overlapped %.3f ms",
+                 queues[0].name.c_str(), queues[1].name.c_str(), overlapTime / overlapSamples);
+        message += buffer;
+    }
+    SDL_Log("%s", message.c_str());
+    overlapTime = 0;
+    overlapSamples = 0;
+
+    for (auto& queue : queues) {
+        if (queue.statisticSamples == 0) {
+            continue;
+        }
+        auto average = [&](VkQueryPipelineStatisticFlags statistic) {
+            return queue.statisticSums[statistic_index(queue.statisticFlags, statistic)] / queue.statisticSamples;
+        };
+        if (queue.statisticFlags & VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT) {
+            SDL_Log("GPU %s statistics: %llu vertices, %llu vertex invocations, %llu primitives, "
+                    "%llu fragment invocations, %llu compute invocations", queue.name.c_str(),
+                    (unsigned long long) average(VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_VERTICES_BIT),
+                    (unsigned long long) average(VK_QUERY_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT),
+                    (unsigned long long) average(VK_QUERY_PIPELINE_STATISTIC_CLIPPING_PRIMITIVES_BIT),
+                    (unsigned long long) average(VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT),
+                    (unsigned long long) average(VK_QUERY_PIPELINE_STATISTIC_COMPUTE_SHADER_INVOCATIONS_BIT));
+        } else {
+            SDL_Log("GPU %s statistics: %llu compute invocations", queue.name.c_str(),
+                    (unsigned long long) average(VK_QUERY_PIPELINE_STATISTIC_COMPUTE_SHADER_INVOCATIONS_BIT));
+        }
+        std::fill(queue.statisticSums.begin(), queue.statisticSums.end(), 0);
+        queue.statisticSamples = 0;
+    }
+}
@@ -22,7 +22,7 @@
 #include <SDL3/SDL_main.h>
 
 #include <SDL3/SDL_vulkan.h>
-#include <vulkan/vulkan.h>
+#include "VulkanLoader.h"
 
 #include <iostream>
 #include <fstream>
@@ -37,6 +37,7 @@
 #include <set>
 
 #include "RenderThread.h"
+#include "CpuProfiler.h"
 
 // TUTORIAL CODE (Provided without comments)
 const uint32_t WIDTH = 800;
@@ -105,7 +106,7 @@ private:
     VkInstance instance;
     VkDebugUtilsMessengerEXT debugMessenger;
     // Surface: must be made on thread with window
-    VkSurfaceKHR surface;
+    VkSurfaceKHR surface = VK_NULL_HANDLE;
     
     // The offscreen renderer
     RenderThread* thread;
@@ -113,6 +114,37 @@ private:
     // A promise barrier to synchronize with RenderThread
     std::future<void> barrier;
     
+    // The presentation policy requested of the render thread
+    VkPresentModeKHR presentMode = VK_PRESENT_MODE_MAILBOX_KHR;
+    uint32_t framesInFlight = 2;
+    uint32_t imageCount = 0;
+    // Whether the instance has the extensions for present fences
+    bool surfaceMaintenance = false;
+    // The options of the GPU profiler
+    bool gpuStatistics = false;
+    std::string gpuTrace;
+    // CPU zones are saved at exit if this is set, and on demand with the T key
+    std::string cpuTrace;
+    // Headless runs render this many frames offscreen, with no window or surface
+    uint32_t headlessFrames = 0;
+    VkExtent2D headlessExtent = { WIDTH, HEIGHT };
+    std::string screenshot;
+    // Benchmark runs save the frame times of a headless run here
+    std::string benchmark;
+    uint32_t warmup = 0;
+    // The render thread saves the Vulkan calls of these frames for the replay tool
+    std::string capture;
+    uint32_t captureSkip = 0;
+    uint32_t captureFrames = 1;
+    // The render thread calls the device this way, to measure the cost of the loader trampolines
+    bool directDispatch = true;
+    uint32_t drawCount = 1;
+    // The render thread stores and simulates the particles this way (0 for the default count)
+    ParticleLayout::Format particleFormat = ParticleLayout::Format::SOA;
+    uint32_t particleCount = 0;
+    // A positive rate spawns particles that die, from a pool of particleCount
+    float emitRate = 0.0f;
+    
     /**
      * Initializes the SDL window.
      *
@@ -120,6 +152,12 @@ private:
      * possible, but continuous resizing is not (as it is not thread safe).
      */
     bool initWindow() {
+        if (headlessFrames > 0) {
+            // Vulkan is used without the video subsystem, which needs a display
+            SDL_Init(0);
+            return true;
+        }
+        
         SDL_Init(SDL_INIT_VIDEO);
         
         SDL_Vulkan_LoadLibrary(nullptr);
@@ -159,8 +197,25 @@ private:
             createSurface();
             
             VkExtent2D extent = { WIDTH, HEIGHT };
+            if (headlessFrames > 0) {
+                extent = headlessExtent;
+            }
             thread = new RenderThread(instance, surface, extent);
             
+            const SDL_DisplayMode* displayMode = window != NULL ? SDL_GetCurrentDisplayMode(SDL_GetDisplayForWindow(window)) : nullptr;
+            thread->setRefreshRate(displayMode != nullptr ? displayMode->refresh_rate : 0.0f);
+            thread->setPresentation(presentMode, framesInFlight, imageCount);
+            thread->setSurfaceMaintenance(surfaceMaintenance);
+            thread->setProfiling(gpuStatistics, gpuTrace);
+            thread->setHeadless(headlessFrames, screenshot);
+            if (!benchmark.empty()) {
+                thread->setBenchmark(benchmark, warmup);
+            }
+            thread->setCapture(capture, captureSkip, captureFrames);
+            thread->setDispatch(directDispatch, drawCount);
+            thread->setParticles(particleFormat, particleCount);
+            thread->setEmitter(emitRate);
+            
             std::promise<void> p;
             barrier = p.get_future();
             thread->start(std::move(p));
@@ -185,19 +240,31 @@ private:
         thread->stop();
         delete thread;
         
+        // Every zone of the render thread is recorded by now
+        if (!cpuTrace.empty()) {
+            CpuProfiler::writeTrace(cpuTrace);
+        }
+        
         if (enableValidationLayers) {
             DestroyDebugUtilsMessengerEXT(instance, debugMessenger, nullptr);
         }
         
         vkDestroySurfaceKHR(instance, surface, nullptr);
         vkDestroyInstance(instance, nullptr);
+        VulkanLoader::dispose();
         
-        SDL_DestroyWindow(window);
+        if (window != NULL) {
+            SDL_DestroyWindow(window);
+        }
         SDL_Quit();
     }
     
     // TUTORIAL CODE (Provided without comments)
     void createInstance() {
+        if (!VulkanLoader::init()) {
+            throw std::runtime_error("failed to load Vulkan!");
+        }
+
         if (enableValidationLayers && !checkValidationLayerSupport()) {
             throw std::runtime_error("validation layers requested, but not available!");
         }
@@ -238,6 +305,9 @@ private:
         extensions.emplace_back(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME);
 #endif
         
+        // Present fences are optional, as old swapchains can be kept a few frames instead
+        surfaceMaintenance = headlessFrames == 0 && SwapchainRetirer::addInstanceExtensions(extensions);
+        
         createInfo.enabledExtensionCount = static_cast<uint32_t>(extensions.size());
         createInfo.ppEnabledExtensionNames = extensions.data();
         
@@ -257,6 +327,7 @@ private:
         if (vkCreateInstance(&createInfo, nullptr, &instance) != VK_SUCCESS) {
             throw std::runtime_error("failed to create instance!");
         }
+        VulkanLoader::loadInstance(instance);
     }
     
     void populateDebugMessengerCreateInfo(VkDebugUtilsMessengerCreateInfoEXT& createInfo) {
@@ -279,15 +350,22 @@ private:
     }
     
     void createSurface() {
+        if (headlessFrames > 0) {
+            return;
+        }
         if (!SDL_Vulkan_CreateSurface(window, instance, NULL, &surface)) {
             throw std::runtime_error("failed to create window surface!");
         }
     }
     
     std::vector<const char*> getRequiredExtensions() {
-        uint32_t extensionCount = 0;
-        const char * const *instance_extensions = SDL_Vulkan_GetInstanceExtensions(&extensionCount);
-        std::vector<const char*> extensions(instance_extensions,instance_extensions+extensionCount);
+        // Headless mode has no surface, so it needs none of the surface extensions
+        std::vector<const char*> extensions;
+        if (headlessFrames == 0) {
+            uint32_t extensionCount = 0;
+            const char * const *instance_extensions = SDL_Vulkan_GetInstanceExtensions(&extensionCount);
+            extensions.assign(instance_extensions,instance_extensions+extensionCount);
+        }
         
         if (enableValidationLayers) {
             extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
@@ -330,11 +408,12 @@ private:
     /** Class Interface */
 public:
     
-    ComputeShaderApplication() : window(NULL) {}
+    ComputeShaderApplication() : window(NULL), thread(nullptr) {}
     
     ~ComputeShaderApplication() { cleanup(); }
     
     bool setup() {
+        CPU_THREAD("main");
         // Set the basic metadata
         if (!SDL_SetAppMetadata("Compute Shader", "1.0.0","com.vulkan-tutorial.tutorial10")) {
             SDL_Log("Setup Error: %s\n", SDL_GetError());
@@ -349,11 +428,14 @@ public:
             return false;
         }
 
-        SDL_RaiseWindow(window);
+        if (window != NULL) {
+            SDL_RaiseWindow(window);
+        }
         return true;
     }
     
     bool consume(SDL_Event *event) {
+        CPU_ZONE("consume");
         switch (event->type) {
             case SDL_EVENT_QUIT:
                 return false;
@@ -368,6 +450,31 @@ public:
                     thread->resizeWindow(window, WIDTH*1.5, HEIGHT*1.5);
                 } else if (key == SDLK_MINUS && event->key.repeat == 0) {
                     thread->resizeWindow(window, WIDTH, HEIGHT);
+                } else if (key == SDLK_P && event->key.repeat == 0) {
+                    const VkPresentModeKHR modes[] = {
+                        VK_PRESENT_MODE_FIFO_KHR, VK_PRESENT_MODE_FIFO_RELAXED_KHR,
+                        VK_PRESENT_MODE_MAILBOX_KHR, VK_PRESENT_MODE_IMMEDIATE_KHR
+                    };
+                    size_t next = 0;
+                    for (size_t ii = 0; ii < 4; ii++) {
+                        if (modes[ii] == presentMode) {
+                            next = (ii + 1) % 4;
+                        }
+                    }
+                    setPresentation(modes[next], framesInFlight, imageCount);
+                } else if (key == SDLK_F && event->key.repeat == 0) {
+                    setPresentation(presentMode, framesInFlight % 3 + 1, imageCount);
+                } else if (key == SDLK_I && event->key.repeat == 0) {
+                    // Cycles through the default, 2, 3, and 4 images
+                    setPresentation(presentMode, framesInFlight, imageCount == 0 ? 2 : (imageCount + 1) % 5);
+                } else if (key == SDLK_T && event->key.repeat == 0) {
+                    // The rings are lock-free, so the render thread keeps going
+                    CpuProfiler::writeTrace(cpuTrace.empty() ? "cpu-trace.json" : cpuTrace);
+                } else if (key == SDLK_LEFTBRACKET && event->key.repeat == 0) {
+                    // The brackets halve and double the particles, up to the capacity (or the emit rate with emitters)
+                    thread->scaleParticles(-1);
+                } else if (key == SDLK_RIGHTBRACKET && event->key.repeat == 0) {
+                    thread->scaleParticles(1);
                 }
                 break;
             }
@@ -377,9 +484,140 @@ public:
         return true;
     }
     
-    void run() {
+    /**
+     * Sets the presentation policy of the render thread.
+     *
+     * This may be called before {@link setup}, in which case the policy is
+     * used when the render thread starts. The P key cycles the present mode,
+     * the F key cycles the frames in flight, and the I key cycles the number
+     * of swapchain images.
+     *
+     * @param mode      The preferred present mode
+     * @param frames    The number of frames in flight, from 1 to 3
+     * @param images    The preferred number of swapchain images (0 for the default)
+     */
+    void setPresentation(VkPresentModeKHR mode, uint32_t frames, uint32_t images) {
+        presentMode = mode;
+        framesInFlight = std::clamp(frames, 1u, 3u);
+        imageCount = images;
+        if (thread != nullptr) {
+            thread->setPresentation(presentMode, framesInFlight, imageCount);
+        }
+    }
+    
+    /**
+     * Sets the options of the GPU and CPU profilers.
+     *
+     * This must be called before {@link setup}. The T key also saves the
+     * CPU trace at any time.
+     *
+     * @param statistics    Whether to gather pipeline statistics
+     * @param trace         The file for a GPU Chrome trace (empty for none)
+     * @param cpu           The file for a CPU Chrome trace (empty for none)
+     */
+    void setProfiling(bool statistics, const std::string& trace, const std::string& cpu) {
+        gpuStatistics = statistics;
+        gpuTrace = trace;
+        cpuTrace = cpu;
+    }
+    
+    /**
+     * Sets the application to render a fixed number of frames offscreen.
+     *
+     * Headless mode has no window or surface, so it runs on machines with no
+     * display. The render thread steps a fixed clock, and the application
+     * quits once the frames are done. This must be called before
+     * {@link setup}.
+     *
+     * @param frames    The number of frames to render (0 to open a window)
+     * @param extent    The size of the offscreen images
+     * @param file      The PNG file for the last frame (empty for none)
+     */
+    void setHeadless(uint32_t frames, VkExtent2D extent, const std::string& file) {
+        headlessFrames = frames;
+        headlessExtent = extent;
+        screenshot = file;
+    }
+    
+    /**
+     * Sets the application to time a headless run and save the results.
+     *
+     * The report is saved as JSON by the render thread. This only applies in
+     * headless mode, and must be called before {@link setup}.
+     *
+     * @param file      The JSON file for the report
+     * @param frames    The number of frames to skip before timing
+     */
+    void setBenchmark(const std::string& file, uint32_t frames) {
+        benchmark = file;
+        warmup = frames;
+    }
+    
+    /**
+     * Sets the application to save the Vulkan calls of a few frames.
+     *
+     * The capture is made by the render thread, and can be run in a loop by
+     * the replay tool. This must be called before {@link setup}.
+     *
+     * @param file      The capture file (empty for none)
+     * @param skip      The number of frames before the captured ones
+     * @param frames    The number of frames to capture
+     */
+    void setCapture(const std::string& file, uint32_t skip, uint32_t frames) {
+        capture = file;
+        captureSkip = skip;
+        captureFrames = frames;
+    }
+    
+    /**
+     * Sets how the render thread calls the device, to measure the cost.
+     *
+     * This must be called before {@link setup}.
+     *
+     * @param direct    Whether device functions skip the loader trampolines
+     * @param draws     The number of draw calls for the particles
+     */
+    void setDispatch(bool direct, uint32_t draws) {
+        directDispatch = direct;
+        drawCount = draws;
+    }
+    
+    /**
+     * Sets how the render thread stores the particles, and how many there are.
+     *
+     * The count is also the capacity of the particle buffers. This must be
+     * called before {@link setup}.
+     *
+     * @param format    The particle storage
+     * @param count     The number of particles (0 for the default)
+     */
+    void setParticles(ParticleLayout::Format format, uint32_t count) {
+        particleFormat = format;
+        particleCount = count;
+    }
+    
+    /**
+     * Sets the particles the render thread spawns per second.
+     *
+     * With a positive rate, the particles die after a few seconds, and the
+     * count is the size of the pool they spawn from. This must be called
+     * before {@link setup}.
+     *
+     * @param rate  The particles spawned per second (0 keeps them all alive)
+     */
+    void setEmitter(float rate) {
+        emitRate = rate;
+    }
+    
+    /**
+     * Returns false once a headless run has rendered all of its frames
+     *
+     * @return false once a headless run has rendered all of its frames
+     */
+    bool run() {
         // 120 FPS on input
         SDL_Delay(8);
+        return !thread->isFinished();
     }
 };
 
@@ -388,6 +626,98 @@ public:
 SDL_AppResult SDL_AppInit(void **appstate, int argc, char *argv[]) {
     ComputeShaderApplication* app = new ComputeShaderApplication();
     *appstate = app;
+    
+    // Passing --present MODE, --frames N, or --images N sets the presentation policy
+    VkPresentModeKHR mode = VK_PRESENT_MODE_MAILBOX_KHR;
+    uint32_t frames = 2;
+    uint32_t images = 0;
+    // Passing --gpu-stats gathers pipeline statistics, and --gpu-trace FILE or --cpu-trace FILE saves a trace
+    bool statistics = false;
+    std::string trace;
+    std::string cpuTrace;
+    // Passing --headless FRAMES (or setting VULKANSDL_HEADLESS=FRAMES) renders offscreen, and --screenshot FILE saves the last frame
+    uint32_t headless = 0;
+    std::string screenshot;
+    VkExtent2D size = { WIDTH, HEIGHT };
+    // Passing --bench FILE saves the frame times of a headless run, after --warmup N frames
+    std::string bench;
+    uint32_t warmup = 60;
+    // Passing --capture FILE saves --capture-frames N frames for the replay tool, after --capture-skip K frames
+    std::string capturePath;
+    uint32_t captureFrames = 1;
+    uint32_t captureSkip = 0;
+    // Passing --draws N splits the particle draw into N calls, and --trampolines calls the device through the loader
+    uint32_t draws = 1;
+    bool direct = true;
+    // Passing --particles N sets the particle count (up to 10M), and --layout aos|soa|half how they are stored
+    uint32_t particles = 0;
+    ParticleLayout::Format layout = ParticleLayout::Format::SOA;
+    // Passing --emit RATE spawns RATE particles a second that live a few seconds, in a pool of --particles N
+    float emit = 0.0f;
+    const char* headlessEnv = SDL_getenv("VULKANSDL_HEADLESS");
+    if (headlessEnv != nullptr) {
+        headless = static_cast<uint32_t>(strtoul(headlessEnv, nullptr, 10));
+    }
+    for (int ii = 1; ii < argc; ii++) {
+        if (strcmp(argv[ii], "--gpu-stats") == 0) {
+            statistics = true;
+        } else if (strcmp(argv[ii], "--trampolines") == 0) {
+            direct = false;
+        } else if (ii+1 == argc) {
+            break;
+        } else if (strcmp(argv[ii], "--gpu-trace") == 0) {
+            trace = argv[ii+1];
+        } else if (strcmp(argv[ii], "--cpu-trace") == 0) {
+            cpuTrace = argv[ii+1];
+        } else if (strcmp(argv[ii], "--present") == 0 && !PresentPacer::parseMode(argv[ii+1], mode)) {
+            SDL_Log("Unknown present mode %s", argv[ii+1]);
+        } else if (strcmp(argv[ii], "--frames") == 0) {
+            frames = static_cast<uint32_t>(strtoul(argv[ii+1], nullptr, 10));
+        } else if (strcmp(argv[ii], "--images") == 0) {
+            images = static_cast<uint32_t>(strtoul(argv[ii+1], nullptr, 10));
+        } else if (strcmp(argv[ii], "--headless") == 0) {
+            headless = static_cast<uint32_t>(strtoul(argv[ii+1], nullptr, 10));
+        } else if (strcmp(argv[ii], "--screenshot") == 0) {
+            screenshot = argv[ii+1];
+        } else if (strcmp(argv[ii], "--size") == 0 && SDL_sscanf(argv[ii+1], "%ux%u", &size.width, &size.height) != 2) {
+            SDL_Log("Unknown size %s", argv[ii+1]);
+        } else if (strcmp(argv[ii], "--bench") == 0) {
+            bench = argv[ii+1];
+        } else if (strcmp(argv[ii], "--warmup") == 0) {
+            warmup = static_cast<uint32_t>(strtoul(argv[ii+1], nullptr, 10));
+        } else if (strcmp(argv[ii], "--capture") == 0) {
+            capturePath = argv[ii+1];
+        } else if (strcmp(argv[ii], "--capture-frames") == 0) {
+            captureFrames = static_cast<uint32_t>(strtoul(argv[ii+1], nullptr, 10));
+        } else if (strcmp(argv[ii], "--capture-skip") == 0) {
+            captureSkip = static_cast<uint32_t>(strtoul(argv[ii+1], nullptr, 10));
+        } else if (strcmp(argv[ii], "--draws") == 0) {
+            draws = static_cast<uint32_t>(strtoul(argv[ii+1], nullptr, 10));
+        } else if (strcmp(argv[ii], "--particles") == 0) {
+            particles = static_cast<uint32_t>(strtoul(argv[ii+1], nullptr, 10));
+        } else if (strcmp(argv[ii], "--layout") == 0 && !ParticleLayout::parseFormat(argv[ii+1], layout)) {
+            SDL_Log("Unknown particle layout %s", argv[ii+1]);
+        } else if (strcmp(argv[ii], "--emit") == 0) {
+            emit = strtof(argv[ii+1], nullptr);
+        }
+    }
+    if (!screenshot.empty() && headless == 0) {
+        SDL_Log("Screenshots are only saved in headless mode");
+    }
+    if (!bench.empty() && headless == 0) {
+        SDL_Log("Benchmarks are only run in headless mode");
+    }
+    app->setPresentation(mode, frames, images);
+    app->setProfiling(statistics, trace, cpuTrace);
+    app->setHeadless(headless, size, screenshot);
+    if (!bench.empty() && headless > 0) {
+        app->setBenchmark(bench, warmup);
+    }
+    app->setCapture(capturePath, captureSkip, captureFrames);
+    app->setDispatch(direct, draws);
+    app->setParticles(layout, particles);
+    app->setEmitter(emit);
+    
     if (app->setup()) {
         return SDL_APP_CONTINUE;
     }
@@ -397,7 +727,9 @@ SDL_AppResult SDL_AppInit(void **appstate, int argc, char *argv[]) {
 SDL_AppResult SDL_AppIterate(void *appstate) {
     ComputeShaderApplication* app = (ComputeShaderApplication*)appstate;
     try {
-        app->run();
+        if (!app->run()) {
+            return SDL_APP_SUCCESS;
+        }
     } catch (const std::exception& e) {
         std::cerr << e.what() << std::endl;
         return SDL_APP_FAILURE;
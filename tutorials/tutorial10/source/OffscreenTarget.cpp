@@ -0,0 +1,263 @@
+//
+//  OffscreenTarget.cpp
+//  Tutorial10
+//
+//  Device-local render targets that stand in for the swapchain. The tutorial
+//  always renders to a window surface, which a build machine with no display
+//  does not have. In headless mode there is no window and no surface at all,
+//  so this class allocates the color images instead, one per frame slot, and
+//  the render pass leaves them ready to be copied rather than presented.
+//
+//  Since nothing is presented, the images are never acquired. A frame simply
+//  renders to the image of its slot, which the frame sync guarantees is done
+//  with the last frame to use it. The final image can be read back by the
+//  frame that renders it, and saved as a PNG to compare runs against each
+//  other.
+//
+//  Version: 10/18/26
+//
+#include "OffscreenTarget.h"
+#include <SDL3/SDL.h>
+#include <SDL3/SDL_image.h>
+#include <stdexcept>
+
+/**
+ * Creates the given number of render targets
+ *
+ * @param physicalDevice    The physical device
+ * @param device            The logical device
+ * @param extent            The image size
+ * @param count             The number of images
+ */
+OffscreenTarget::OffscreenTarget(VkPhysicalDevice physicalDevice, VkDevice device, VkExtent2D extent, uint32_t count) :
+    physicalDevice(physicalDevice),
+    device(device),
+    format(chooseFormat(physicalDevice)),
+    extent(extent),
+    readback(VK_NULL_HANDLE),
+    readbackMemory(VK_NULL_HANDLE) {
+    images.resize(count, VK_NULL_HANDLE);
+    memory.resize(count, VK_NULL_HANDLE);
+
+    for (uint32_t ii = 0; ii < count; ii++) {
+        VkImageCreateInfo imageInfo{};
+        imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        imageInfo.imageType = VK_IMAGE_TYPE_2D;
+        imageInfo.extent.width = extent.width;
+        imageInfo.extent.height = extent.height;
+        imageInfo.extent.depth = 1;
+        imageInfo.mipLevels = 1;
+        imageInfo.arrayLayers = 1;
+        imageInfo.format = format;
+        imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+        imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        imageInfo.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+        imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+        imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+        if (vkCreateImage(device, &imageInfo, nullptr, &images[ii]) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create offscreen image!");
+        }
+
+        VkMemoryRequirements memRequirements;
+        vkGetImageMemoryRequirements(device, images[ii], &memRequirements);
+
+        VkMemoryAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        allocInfo.allocationSize = memRequirements.size;
+        allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+        if (vkAllocateMemory(device, &allocInfo, nullptr, &memory[ii]) != VK_SUCCESS) {
+            throw std::runtime_error("failed to allocate offscreen image memory!");
+        }
+
+        vkBindImageMemory(device, images[ii], memory[ii], 0);
+    }
+}
+
+/**
+ * Destroys the render targets. The device must be done with them.
+ */
+OffscreenTarget::~OffscreenTarget() {
+    for (size_t ii = 0; ii < images.size(); ii++) {
+        vkDestroyImage(device, images[ii], nullptr);
+        vkFreeMemory(device, memory[ii], nullptr);
+    }
+    if (readback != VK_NULL_HANDLE) {
+        vkDestroyBuffer(device, readback, nullptr);
+        vkFreeMemory(device, readbackMemory, nullptr);
+    }
+}
+
+/**
+ * Returns the 8-bit sRGB format the device can render to and copy from
+ *
+ * This prefers the format the tutorial picks for the swapchain, so that
+ * both modes run the same pipelines.
+ *
+ * @param physicalDevice    The physical device
+ *
+ * @return the 8-bit sRGB format the device can render to and copy from
+ */
+VkFormat OffscreenTarget::chooseFormat(VkPhysicalDevice physicalDevice) {
+    const VkFormat candidates[] = { VK_FORMAT_B8G8R8A8_SRGB, VK_FORMAT_R8G8B8A8_SRGB };
+    const VkFormatFeatureFlags required = VK_FORMAT_FEATURE_COLOR_ATTACHMENT_BIT | VK_FORMAT_FEATURE_TRANSFER_SRC_BIT;
+    for (VkFormat candidate : candidates) {
+        VkFormatProperties props;
+        vkGetPhysicalDeviceFormatProperties(physicalDevice, candidate, &props);
+        if ((props.optimalTilingFeatures & required) == required) {
+            return candidate;
+        }
+    }
+
+    throw std::runtime_error("failed to find an offscreen image format!");
+}
+
+/**
+ * Returns the index of a memory type with the given properties
+ *
+ * @param typeFilter    The allowed memory types
+ * @param properties    The required memory properties
+ *
+ * @return the index of a memory type with the given properties
+ */
+uint32_t OffscreenTarget::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const {
+    VkPhysicalDeviceMemoryProperties memProperties;
+    vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProperties);
+
+    for (uint32_t ii = 0; ii < memProperties.memoryTypeCount; ii++) {
+        if ((typeFilter & (1 << ii)) && (memProperties.memoryTypes[ii].propertyFlags & properties) == properties) {
+            return ii;
+        }
+    }
+
+    throw std::runtime_error("failed to find suitable memory type!");
+}
+
+/**
+ * Records a copy of an image to the host into the given command buffer.
+ *
+ * The copy runs at the end of the frame that rendered the image, so the
+ * GPU never stalls for it, and the host only waits when the frame is
+ * done anyway. The image must be in the transfer source layout once
+ * the commands before this one are done. The readback buffer is
+ * allocated on first use, as most runs never save an image.
+ *
+ * @param commandBuffer The command buffer to record to
+ * @param image         The image index
+ */
+void OffscreenTarget::recordReadback(VkCommandBuffer commandBuffer, uint32_t image) {
+    if (readback == VK_NULL_HANDLE) {
+        VkBufferCreateInfo bufferInfo{};
+        bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+        bufferInfo.size = static_cast<VkDeviceSize>(extent.width) * extent.height * 4;
+        bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+        bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+        if (vkCreateBuffer(device, &bufferInfo, nullptr, &readback) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create readback buffer!");
+        }
+
+        VkMemoryRequirements memRequirements;
+        vkGetBufferMemoryRequirements(device, readback, &memRequirements);
+
+        // Cached memory makes the read on the host much faster, where there is any
+        VkMemoryPropertyFlags properties = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+        uint32_t memoryType;
+        try {
+            memoryType = findMemoryType(memRequirements.memoryTypeBits, properties | VK_MEMORY_PROPERTY_HOST_CACHED_BIT);
+        } catch (const std::exception&) {
+            memoryType = findMemoryType(memRequirements.memoryTypeBits, properties);
+        }
+
+        VkMemoryAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        allocInfo.allocationSize = memRequirements.size;
+        allocInfo.memoryTypeIndex = memoryType;
+
+        if (vkAllocateMemory(device, &allocInfo, nullptr, &readbackMemory) != VK_SUCCESS) {
+            vkDestroyBuffer(device, readback, nullptr);
+            readback = VK_NULL_HANDLE;
+            throw std::runtime_error("failed to allocate readback memory!");
+        }
+        vkBindBufferMemory(device, readback, readbackMemory, 0);
+    }
+
+    // The render pass already changed the layout, but its writes must still be made visible
+    VkImageMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = images[image];
+    barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    barrier.subresourceRange.baseMipLevel = 0;
+    barrier.subresourceRange.levelCount = 1;
+    barrier.subresourceRange.baseArrayLayer = 0;
+    barrier.subresourceRange.layerCount = 1;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+    VkBufferImageCopy region{};
+    region.bufferOffset = 0;
+    region.bufferRowLength = 0;
+    region.bufferImageHeight = 0;
+    region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    region.imageSubresource.mipLevel = 0;
+    region.imageSubresource.baseArrayLayer = 0;
+    region.imageSubresource.layerCount = 1;
+    region.imageOffset = {0, 0, 0};
+    region.imageExtent = {extent.width, extent.height, 1};
+    vkCmdCopyImageToBuffer(commandBuffer, images[image], VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, readback, 1, &region);
+
+    VkBufferMemoryBarrier hostBarrier{};
+    hostBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    hostBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    hostBarrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+    hostBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    hostBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    hostBarrier.buffer = readback;
+    hostBarrier.offset = 0;
+    hostBarrier.size = VK_WHOLE_SIZE;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT,
+                         0, 0, nullptr, 1, &hostBarrier, 0, nullptr);
+}
+
+/**
+ * Saves the last image read back as a PNG file.
+ *
+ * The commands recorded by {@link recordReadback} must be complete.
+ *
+ * @param path  The file to write
+ *
+ * @return true if the file was written
+ */
+bool OffscreenTarget::saveReadback(const std::string& path) const {
+    if (readback == VK_NULL_HANDLE) {
+        SDL_Log("Failed to save frame to %s: nothing was read back", path.c_str());
+        return false;
+    }
+
+    // The byte order of the formats matches the SDL array formats
+    SDL_PixelFormat pixelFormat = format == VK_FORMAT_B8G8R8A8_SRGB ? SDL_PIXELFORMAT_BGRA32 : SDL_PIXELFORMAT_RGBA32;
+
+    void* data;
+    vkMapMemory(device, readbackMemory, 0, VK_WHOLE_SIZE, 0, &data);
+    SDL_Surface* surface = SDL_CreateSurfaceFrom(extent.width, extent.height, pixelFormat, data, extent.width * 4);
+    bool success = false;
+    if (surface != nullptr) {
+        success = IMG_SavePNG(surface, path.c_str());
+        SDL_DestroySurface(surface);
+    }
+    vkUnmapMemory(device, readbackMemory);
+
+    if (success) {
+        SDL_Log("Saved frame to %s", path.c_str());
+    } else {
+        SDL_Log("Failed to save frame to %s: %s", path.c_str(), SDL_GetError());
+    }
+    return success;
+}
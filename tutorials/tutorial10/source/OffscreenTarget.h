@@ -0,0 +1,140 @@
+//
+//  OffscreenTarget.h
+//  Tutorial10
+//
+//  Device-local render targets that stand in for the swapchain. The tutorial
+//  always renders to a window surface, which a build machine with no display
+//  does not have. In headless mode there is no window and no surface at all,
+//  so this class allocates the color images instead, one per frame slot, and
+//  the render pass leaves them ready to be copied rather than presented.
+//
+//  Since nothing is presented, the images are never acquired. A frame simply
+//  renders to the image of its slot, which the frame sync guarantees is done
+//  with the last frame to use it. The final image can be read back by the
+//  frame that renders it, and saved as a PNG to compare runs against each
+//  other.
+//
+//  Version: 10/18/26
+//
+#ifndef __OFFSCREEN_TARGET_H__
+#define __OFFSCREEN_TARGET_H__
+#include "VulkanLoader.h"
+#include <string>
+#include <vector>
+#include <cstdint>
+
+/**
+ * A set of color images to render to in place of a swapchain.
+ *
+ * The images are created with the layout undefined, and are expected to be
+ * left in VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL by the render pass, which is
+ * the layout {@link recordReadback} copies from.
+ */
+class OffscreenTarget {
+private:
+    /** The physical device, for the memory types */
+    VkPhysicalDevice physicalDevice;
+    /** The logical device */
+    VkDevice device;
+    /** The image format */
+    VkFormat format;
+    /** The image size */
+    VkExtent2D extent;
+    /** The color images */
+    std::vector<VkImage> images;
+    /** The memory of each image */
+    std::vector<VkDeviceMemory> memory;
+    /** The host buffer of the last readback (allocated on first use) */
+    VkBuffer readback;
+    /** The memory of the readback buffer */
+    VkDeviceMemory readbackMemory;
+
+    /**
+     * Returns the index of a memory type with the given properties
+     *
+     * @param typeFilter    The allowed memory types
+     * @param properties    The required memory properties
+     *
+     * @return the index of a memory type with the given properties
+     */
+    uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const;
+
+public:
+    /**
+     * Creates the given number of render targets
+     *
+     * @param physicalDevice    The physical device
+     * @param device            The logical device
+     * @param extent            The image size
+     * @param count             The number of images
+     */
+    OffscreenTarget(VkPhysicalDevice physicalDevice, VkDevice device, VkExtent2D extent, uint32_t count);
+
+    /**
+     * Destroys the render targets. The device must be done with them.
+     */
+    ~OffscreenTarget();
+
+    OffscreenTarget(const OffscreenTarget&) = delete;
+    OffscreenTarget& operator=(const OffscreenTarget&) = delete;
+
+    /**
+     * Returns the 8-bit sRGB format the device can render to and copy from
+     *
+     * This prefers the format the tutorial picks for the swapchain, so that
+     * both modes run the same pipelines.
+     *
+     * @param physicalDevice    The physical device
+     *
+     * @return the 8-bit sRGB format the device can render to and copy from
+     */
+    static VkFormat chooseFormat(VkPhysicalDevice physicalDevice);
+
+    /**
+     * Returns the color images
+     *
+     * @return the color images
+     */
+    const std::vector<VkImage>& getImages() const { return images; }
+
+    /**
+     * Returns the image format
+     *
+     * @return the image format
+     */
+    VkFormat getFormat() const { return format; }
+
+    /**
+     * Returns the image size
+     *
+     * @return the image size
+     */
+    VkExtent2D getExtent() const { return extent; }
+
+    /**
+     * Records a copy of an image to the host into the given command buffer.
+     *
+     * The copy runs at the end of the frame that rendered the image, so the
+     * GPU never stalls for it, and the host only waits when the frame is
+     * done anyway. The image must be in the transfer source layout once
+     * the commands before this one are done. The readback buffer is
+     * allocated on first use, as most runs never save an image.
+     *
+     * @param commandBuffer The command buffer to record to
+     * @param image         The image index
+     */
+    void recordReadback(VkCommandBuffer commandBuffer, uint32_t image);
+
+    /**
+     * Saves the last image read back as a PNG file.
+     *
+     * The commands recorded by {@link recordReadback} must be complete.
+     *
+     * @param path  The file to write
+     *
+     * @return true if the file was written
+     */
+    bool saveReadback(const std::string& path) const;
+};
+
+#endif /* __OFFSCREEN_TARGET_H__ */
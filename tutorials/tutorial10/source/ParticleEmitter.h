@@ -0,0 +1,120 @@
+//
+//  ParticleEmitter.h
+//  Tutorial10
+//
+//  The CPU side of the particle emitters. The particles are spawned, simulated,
+//  and killed entirely on the GPU, but something has to decide how many to
+//  spawn each frame, and where. That is a rate and a clock, so it stays on the
+//  CPU, and is passed to the compute shaders in the uniform buffer. The CPU
+//  never needs to know how many particles are alive, so it never reads back.
+//
+//  The emitters orbit the center of the window, so that the spawned particles
+//  trail behind them. Each particle lives for a random time in a fixed range.
+//
+//  Version: 10/18/26
+//
+#ifndef __PARTICLE_EMITTER_H__
+#define __PARTICLE_EMITTER_H__
+#define GLM_FORCE_RADIANS
+#include <glm/glm.hpp>
+#include <cstdint>
+
+/**
+ * A set of particle emitters, spawning at a fixed rate.
+ *
+ * The rate rarely divides evenly into frames, so the fraction of a particle
+ * left over is carried to the next frame. The spawned particles are split
+ * evenly over the emitters by the emit shader.
+ */
+class ParticleEmitter {
+public:
+    /** The number of emitters (the size of the array in the uniform buffer) */
+    static const uint32_t EMITTER_COUNT = 4;
+
+private:
+    /** The particles spawned per second */
+    float rate;
+    /** The shortest lifetime in seconds */
+    float lifeMin;
+    /** The longest lifetime in seconds */
+    float lifeMax;
+    /** The ratio of the window height to its width, so that the orbit is round */
+    float aspect;
+    /** The seconds the emitters have run */
+    double elapsed;
+    /** The part of a particle left over from the last frame */
+    double fraction;
+
+public:
+    /**
+     * Creates emitters with the given rate and lifetimes
+     *
+     * @param rate      The particles spawned per second
+     * @param lifeMin   The shortest lifetime in seconds
+     * @param lifeMax   The longest lifetime in seconds
+     * @param aspect    The ratio of the window height to its width
+     */
+    ParticleEmitter(float rate, float lifeMin, float lifeMax, float aspect);
+
+    /**
+     * Returns the particles spawned per second
+     *
+     * @return the particles spawned per second
+     */
+    float getRate() const { return rate; }
+
+    /**
+     * Sets the particles spawned per second
+     *
+     * @param rate  The particles spawned per second
+     */
+    void setRate(float rate);
+
+    /**
+     * Returns the shortest lifetime in seconds
+     *
+     * @return the shortest lifetime in seconds
+     */
+    float getLifeMin() const { return lifeMin; }
+
+    /**
+     * Returns the longest lifetime in seconds
+     *
+     * @return the longest lifetime in seconds
+     */
+    float getLifeMax() const { return lifeMax; }
+
+    /**
+     * Returns the most particles that can be alive at once
+     *
+     * Once the pool is this large, no spawn is ever dropped.
+     *
+     * @return the most particles that can be alive at once
+     */
+    uint32_t getPeakCount() const;
+
+    /**
+     * Advances the emitters, returning the particles to spawn this frame
+     *
+     * The count is clamped to the capacity, as there can be no more free
+     * particles than that. The shader also stops when the pool runs out.
+     *
+     * @param seconds   The seconds since the last frame
+     * @param capacity  The number of particles in the pool
+     *
+     * @return the particles to spawn this frame
+     */
+    uint32_t advance(double seconds, uint32_t capacity);
+
+    /**
+     * Stores the position of each emitter, in normalized device coordinates
+     *
+     * The array must have room for {@link EMITTER_COUNT} positions. Only x
+     * and y are used, as the uniform buffer pads each position to a vec4.
+     *
+     * @param positions The positions to set
+     */
+    void getPositions(glm::vec4* positions) const;
+};
+
+#endif /* __PARTICLE_EMITTER_H__ */
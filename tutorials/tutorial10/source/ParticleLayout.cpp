@@ -0,0 +1,389 @@
+//
+//  ParticleLayout.cpp
+//  Tutorial10
+//
+//  The memory layout of the particles. The tutorial stores each particle as a
+//  48 byte std140 struct, of which the simulation only needs the position and
+//  the velocity. Every frame reads and writes the whole struct anyway, and the
+//  vertex fetch skips over it, so most of the bandwidth moves padding.
+//
+//  So the particles can instead be stored as a structure of arrays. Each
+//  attribute is its own std430 array, packed end to end in the same buffer,
+//  and bound as its own storage buffer. The colors never change, so they are
+//  not simulated at all. They live in a separate buffer shared by every frame.
+//  The half precision layout also packs the velocity and the color with
+//  packHalf2x16, which halves them again. The positions stay at full
+//  precision, as the small steps of the simulation would round away in half.
+//
+//  The original layout is kept to benchmark against, and each layout has its
+//  own variants of the compute shaders (compiled by compile.sh).
+//
+//  With emitters, the particles also spawn and die. Each buffer of the ring
+//  then ends with a list of the particles alive in it, headed by the draw
+//  arguments of that list. A pool buffer only used by compute holds the
+//  lifetimes and the dead list, headed by the workgroups of the simulation.
+//  So the dispatch and the draw are both indirect, and the CPU never reads
+//  back a count.
+//
+//  Version: 10/18/26
+//
+#include "ParticleLayout.h"
+#include <algorithm>
+
+/** The size of the original std140 struct (position, velocity, color, offsides, padding) */
+static const VkDeviceSize AOS_STRIDE = 48;
+/** The offset of the color in the original struct */
+static const uint32_t AOS_COLOR_OFFSET = 16;
+/** The size of a list entry (an index or a lifetime) */
+static const VkDeviceSize LIST_STRIDE = 4;
+
+/**
+ * Creates the layout of the given number of particles
+ *
+ * The capacity is clamped to {@link MAX_PARTICLES}, and rounded up to a
+ * whole workgroup. With emitters, the capacity is the size of the pool
+ * rather than the number of particles alive.
+ *
+ * @param format    The particle storage
+ * @param capacity  The number of particles
+ * @param emitting  Whether the particles spawn and die
+ */
+ParticleLayout::ParticleLayout(Format format, uint32_t capacity, bool emitting) :
+    format(format),
+    bufferSize(0),
+    sharedSize(0),
+    emitting(emitting),
+    listOffset(0),
+    poolSize(0) {
+    capacity = std::clamp(capacity, 1u, MAX_PARTICLES);
+    this->capacity = getGroupCount(capacity) * WORKGROUP_SIZE;
+
+    // Each array is a multiple of the workgroup in length, so every offset is aligned
+    for (VkDeviceSize stride : getStrides(format, true)) {
+        streams.push_back({stride, bufferSize});
+        bufferSize += stride * this->capacity;
+    }
+    for (VkDeviceSize stride : getStrides(format, false)) {
+        shared.push_back({stride, sharedSize});
+        sharedSize += stride * this->capacity;
+    }
+
+    // The lifetimes are first in the pool, so the dead list is aligned the same as the arrays
+    if (emitting) {
+        listOffset = bufferSize;
+        bufferSize += LIST_HEADER + LIST_STRIDE * this->capacity;
+        poolSize = 2 * LIST_STRIDE * this->capacity + LIST_HEADER;
+    }
+}
+
+/**
+ * Returns the bytes of each particle in the given arrays
+ *
+ * @param format    The particle storage
+ * @param simulated Whether to count the simulated (or the shared) arrays
+ *
+ * @return the bytes of each particle in the given arrays
+ */
+std::vector<VkDeviceSize> ParticleLayout::getStrides(Format format, bool simulated) {
+    switch (format) {
+        case Format::AOS:
+            if (simulated) {
+                return {AOS_STRIDE};
+            }
+            return {};
+        case Format::SOA:
+            // Position and velocity are vec2, and color is vec4
+            if (simulated) {
+                return {8, 8};
+            }
+            return {16};
+        case Format::HALF:
+            // Velocity is one packed uint, and color is two
+            if (simulated) {
+                return {8, 4};
+            }
+            return {8};
+    }
+    return {};
+}
+
+/**
+ * Returns true if the name is a particle format, storing it in format
+ *
+ * The names are "aos", "soa", and "half".
+ *
+ * @param name      The format name
+ * @param format    The format to set
+ *
+ * @return true if the name is a particle format
+ */
+bool ParticleLayout::parseFormat(const std::string& name, Format& format) {
+    if (name == "aos") {
+        format = Format::AOS;
+    } else if (name == "soa") {
+        format = Format::SOA;
+    } else if (name == "half") {
+        format = Format::HALF;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Returns the name of the given format
+ *
+ * @param format    The particle storage
+ *
+ * @return the name of the given format
+ */
+const char* ParticleLayout::getFormatName(Format format) {
+    switch (format) {
+        case Format::AOS:
+            return "aos";
+        case Format::SOA:
+            return "soa";
+        case Format::HALF:
+            return "half";
+    }
+    return "unknown";
+}
+
+/**
+ * Returns the largest capacity that each array can be bound with
+ *
+ * A storage buffer descriptor is only guaranteed 128 MB, so the largest
+ * array limits the capacity, well before the memory runs out. This is
+ * also clamped to {@link MAX_PARTICLES}.
+ *
+ * @param format    The particle storage
+ * @param maxRange  The device limit maxStorageBufferRange
+ *
+ * @return the largest capacity that each array can be bound with
+ */
+uint32_t ParticleLayout::getMaxCapacity(Format format, VkDeviceSize maxRange) {
+    VkDeviceSize stride = 0;
+    for (VkDeviceSize size : getStrides(format, true)) {
+        stride = std::max(stride, size);
+    }
+    for (VkDeviceSize size : getStrides(format, false)) {
+        stride = std::max(stride, size);
+    }
+
+    VkDeviceSize count = maxRange / stride;
+    count -= count % WORKGROUP_SIZE;
+    return static_cast<uint32_t>(std::min(count, static_cast<VkDeviceSize>(MAX_PARTICLES)));
+}
+
+/**
+ * Returns the bytes a frame reads and writes for each particle
+ *
+ * This counts the simulated arrays read and written by compute, plus
+ * the position and color read by the vertex fetch.
+ *
+ * @return the bytes a frame reads and writes for each particle
+ */
+VkDeviceSize ParticleLayout::getFrameBytes() const {
+    VkDeviceSize bytes = 0;
+    for (const auto& stream : streams) {
+        bytes += 2 * stream.stride;
+    }
+    if (format == Format::AOS) {
+        return bytes + 8 + 16;
+    }
+    return bytes + streams[0].stride + shared[0].stride;
+}
+
+/**
+ * Returns the offset of the simulation workgroups in the pool buffer
+ *
+ * The workgroups are a VkDispatchIndirectCommand.
+ *
+ * @return the offset of the simulation workgroups in the pool buffer
+ */
+VkDeviceSize ParticleLayout::getDispatchOffset() const {
+    // The dead count comes first
+    return LIST_STRIDE * capacity + sizeof(uint32_t);
+}
+
+/**
+ * Returns the suffix of the shaders for the given format
+ *
+ * @param format    The particle storage
+ *
+ * @return the suffix of the shaders for the given format
+ */
+static const char* get_shader_suffix(ParticleLayout::Format format) {
+    switch (format) {
+        case ParticleLayout::Format::AOS:
+            return "";
+        case ParticleLayout::Format::SOA:
+            return "_soa";
+        case ParticleLayout::Format::HALF:
+            return "_half";
+    }
+    return "";
+}
+
+/**
+ * Returns the name of the simulation shader
+ *
+ * @return the name of the simulation shader
+ */
+std::string ParticleLayout::getComputeShader() const {
+    return std::string("shaders/comp") + get_shader_suffix(format) + (emitting ? "_emit" : "") + ".spv";
+}
+
+/**
+ * Returns the name of the shader that sets the initial particles
+ *
+ * @return the name of the shader that sets the initial particles
+ */
+std::string ParticleLayout::getInitShader() const {
+    return std::string("shaders/init") + get_shader_suffix(format) + (emitting ? "_emit" : "") + ".spv";
+}
+
+/**
+ * Returns the name of the shader that spawns particles
+ *
+ * @return the name of the shader that spawns particles
+ */
+std::string ParticleLayout::getEmitShader() const {
+    return std::string("shaders/emit") + get_shader_suffix(format) + ".spv";
+}
+
+/**
+ * Returns the name of the shader that sets up the lists of a frame
+ *
+ * This shader is the same in every layout.
+ *
+ * @return the name of the shader that sets up the lists of a frame
+ */
+std::string ParticleLayout::getPrepareShader() const {
+    return "shaders/prepare.spv";
+}
+
+/**
+ * Returns the storage buffer bindings, after the uniform buffer
+ *
+ * The bindings are not contiguous with emitters, as the lists start at
+ * {@link LIST_BINDING}.
+ *
+ * @return the storage buffer bindings
+ */
+std::vector<VkDescriptorSetLayoutBinding> ParticleLayout::getStorageBindings() const {
+    size_t arrays = 2 * streams.size() + shared.size();
+    size_t count = arrays + (emitting ? 4 : 0);
+    std::vector<VkDescriptorSetLayoutBinding> bindings(count);
+    for (size_t ii = 0; ii < count; ii++) {
+        if (ii < arrays) {
+            bindings[ii].binding = static_cast<uint32_t>(ii + 1);
+        } else {
+            bindings[ii].binding = static_cast<uint32_t>(LIST_BINDING + ii - arrays);
+        }
+        bindings[ii].descriptorCount = 1;
+        bindings[ii].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        bindings[ii].pImmutableSamplers = nullptr;
+        bindings[ii].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    }
+    return bindings;
+}
+
+/**
+ * Returns the storage buffer descriptors, in the order of the bindings
+ *
+ * @param input     The ring buffer the simulation reads
+ * @param output    The ring buffer the simulation writes
+ * @param shared    The shared buffer (ignored if there is nothing shared)
+ * @param pool      The pool buffer (ignored without emitters)
+ *
+ * @return the storage buffer descriptors
+ */
+std::vector<VkDescriptorBufferInfo> ParticleLayout::getStorageInfos(VkBuffer input, VkBuffer output, VkBuffer shared, VkBuffer pool) const {
+    std::vector<VkDescriptorBufferInfo> infos;
+    for (const auto& stream : streams) {
+        infos.push_back({input, stream.offset, stream.stride * capacity});
+    }
+    for (const auto& stream : streams) {
+        infos.push_back({output, stream.offset, stream.stride * capacity});
+    }
+    for (const auto& stream : this->shared) {
+        infos.push_back({shared, stream.offset, stream.stride * capacity});
+    }
+    if (emitting) {
+        VkDeviceSize listSize = LIST_HEADER + LIST_STRIDE * capacity;
+        infos.push_back({input, listOffset, listSize});
+        infos.push_back({output, listOffset, listSize});
+        infos.push_back({pool, LIST_STRIDE * capacity, listSize});
+        infos.push_back({pool, 0, LIST_STRIDE * capacity});
+    }
+    return infos;
+}
+
+/**
+ * Returns the vertex buffer bindings of the graphics pipeline
+ *
+ * @return the vertex buffer bindings of the graphics pipeline
+ */
+std::vector<VkVertexInputBindingDescription> ParticleLayout::getVertexBindings() const {
+    if (format == Format::AOS) {
+        return {{0, static_cast<uint32_t>(AOS_STRIDE), VK_VERTEX_INPUT_RATE_VERTEX}};
+    }
+    return {
+        {0, static_cast<uint32_t>(streams[0].stride), VK_VERTEX_INPUT_RATE_VERTEX},
+        {1, static_cast<uint32_t>(shared[0].stride), VK_VERTEX_INPUT_RATE_VERTEX}
+    };
+}
+
+/**
+ * Returns the vertex attributes of the graphics pipeline
+ *
+ * The position is location 0 and the color is location 1, as vec2 and
+ * vec4 in every layout.
+ *
+ * @return the vertex attributes of the graphics pipeline
+ */
+std::vector<VkVertexInputAttributeDescription> ParticleLayout::getVertexAttributes() const {
+    switch (format) {
+        case Format::AOS:
+            return {
+                {0, 0, VK_FORMAT_R32G32_SFLOAT, 0},
+                {1, 0, VK_FORMAT_R32G32B32A32_SFLOAT, AOS_COLOR_OFFSET}
+            };
+        case Format::SOA:
+            return {
+                {0, 0, VK_FORMAT_R32G32_SFLOAT, 0},
+                {1, 1, VK_FORMAT_R32G32B32A32_SFLOAT, 0}
+            };
+        case Format::HALF:
+            // Two packHalf2x16 values are the same bytes as four halfs
+            return {
+                {0, 0, VK_FORMAT_R32G32_SFLOAT, 0},
+                {1, 1, VK_FORMAT_R16G16B16A16_SFLOAT, 0}
+            };
+    }
+    return {};
+}
+
+/**
+ * Stores the vertex buffers and offsets to draw, returning their number
+ *
+ * The arrays must have room for two buffers.
+ *
+ * @param buffer    The ring buffer to draw
+ * @param shared    The shared buffer (ignored if there is nothing shared)
+ * @param buffers   The vertex buffers to bind
+ * @param offsets   The offset of each vertex buffer
+ *
+ * @return the number of vertex buffers
+ */
+uint32_t ParticleLayout::getVertexBuffers(VkBuffer buffer, VkBuffer shared, VkBuffer* buffers, VkDeviceSize* offsets) const {
+    buffers[0] = buffer;
+    offsets[0] = streams[0].offset;
+    if (this->shared.empty()) {
+        return 1;
+    }
+    buffers[1] = shared;
+    offsets[1] = this->shared[0].offset;
+    return 2;
+}
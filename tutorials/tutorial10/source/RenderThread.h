@@ -21,7 +21,18 @@
 #ifndef __SDL_WINDOW_H__
 #define __SDL_WINDOW_H__
 #include <SDL3/SDL.h>
-#include <vulkan/vulkan.h>
+#include "VulkanLoader.h"
+#include "FrameSync.h"
+#include "GpuProfiler.h"
+#include "CpuProfiler.h"
+#include "PresentPacer.h"
+#include "SwapchainRetirer.h"
+#include "DeletionQueue.h"
+#include "OffscreenTarget.h"
+#include "BenchReport.h"
+#include "FrameCapture.h"
+#include "ParticleLayout.h"
+#include "ParticleEmitter.h"
 
 #define GLM_FORCE_RADIANS
 #include <glm/glm.hpp>
@@ -31,12 +42,14 @@
 #include <mutex>
 #include <atomic>
 #include <future>
+#include <memory>
+#include <functional>
 #include <cstring>
 #include <vector>
+#include <algorithm>
 #include <array>
 #include <optional>
 #include <chrono>
-#include <random>
 
 /** The clock data type, using the steady clock from chrono */
 typedef std::chrono::steady_clock steadyclock_t;
@@ -130,6 +143,7 @@ public:
      * Executes the code for the render thread
      */
     void run() {
+        CPU_THREAD("render");
         initVulkan();
         mainLoop();
         cleanup();
@@ -171,6 +185,10 @@ public:
      * method {@link resizeWindow}. It is mainly provided to support continuous
      * window resizing as a comparison.
      *
+     * A drag sends an event every frame, so the swap chain is not recreated
+     * until the events settle (or a long drag has gone on for a while). Until
+     * then, the render thread keeps presenting to the old swap chain.
+     *
      * Note that this method is actually called on the main thread, not in the
      * render thread. Therefore it requires a lock guard to protect the critical
      * section.
@@ -205,6 +223,188 @@ public:
      */
     void resizeWindow(SDL_Window* window, int w, int h);
 
+    /**
+     * Sets the presentation policy of this render thread.
+     *
+     * The policy is applied at the start of the next frame, without waiting on
+     * the GPU. A present mode that the surface does not support falls back to
+     * FIFO.
+     *
+     * Note that this method is called on the main thread, not in the render
+     * thread. Therefore it requires a lock guard to protect the critical
+     * section.
+     *
+     * @param mode      The preferred present mode
+     * @param frames    The number of frames in flight, from 1 to 3
+     * @param images    The preferred number of swapchain images (0 for the default)
+     */
+    void setPresentation(VkPresentModeKHR mode, uint32_t frames, uint32_t images);
+
+    /**
+     * Sets the refresh rate of the display, to count missed vsyncs.
+     *
+     * This must be called before {@link start}.
+     *
+     * @param rate  The refresh rate in Hz (0 if unknown)
+     */
+    void setRefreshRate(float rate) { refreshRate = rate; }
+
+    /**
+     * Sets whether the instance has the surface maintenance extensions.
+     *
+     * Present fences (VK_EXT_swapchain_maintenance1) need these on the
+     * instance. This must be called before {@link start}.
+     *
+     * @param enabled   Whether the surface maintenance extensions are enabled
+     */
+    void setSurfaceMaintenance(bool enabled) { surfaceMaintenanceEnabled = enabled; }
+
+    /**
+     * Sets the options of the GPU profiler.
+     *
+     * Pipeline statistics are only gathered if the device supports them. The
+     * trace is saved when the render thread stops. This must be called before
+     * {@link start}.
+     *
+     * @param statistics    Whether to gather pipeline statistics
+     * @param trace         The file for a Chrome trace (empty for none)
+     */
+    void setProfiling(bool statistics, const std::string& trace) {
+        statisticsRequested = statistics;
+        tracePath = trace;
+    }
+
+    /**
+     * Sets this render thread to render a fixed number of frames offscreen.
+     *
+     * In headless mode, there is no surface, and the frames are rendered to
+     * device-local images with a fixed clock. Once the frames are done, the
+     * last one is optionally saved as a PNG, and {@link isFinished} returns
+     * true. This must be called before {@link start}.
+     *
+     * @param frames        The number of frames to render (0 to present as usual)
+     * @param screenshot    The PNG file for the last frame (empty for none)
+     */
+    void setHeadless(uint32_t frames, const std::string& screenshot);
+
+    /**
+     * Replaces the clock that animates the scene.
+     *
+     * The clock returns seconds, and is read once per frame on the render
+     * thread. Headless runs pin it to a fixed step per frame, so that every
+     * run simulates the same frames. This must be called before
+     * {@link start}.
+     *
+     * @param source    The clock in seconds
+     */
+    void setTimeSource(std::function<double()> source) {
+        timeSource = std::move(source);
+    }
+
+    /**
+     * Returns true if a headless run has rendered all of its frames.
+     *
+     * This is safe to call from the main thread, which should then stop
+     * this render thread.
+     *
+     * @return true if a headless run has rendered all of its frames
+     */
+    bool isFinished() const { return finished; }
+
+    /**
+     * Sets this render thread to time a headless run and save the results.
+     *
+     * Every frame after the warm-up is timed, and the report is saved as JSON
+     * when the last frame is done. This only applies in headless mode, and
+     * must be called before {@link start}.
+     *
+     * @param path      The JSON file for the report
+     * @param warmup    The number of frames to skip before timing
+     */
+    void setBenchmark(const std::string& path, uint32_t warmup) {
+        benchPath = path;
+        benchReport = std::make_unique<BenchReport>("compute-particles-threaded", warmup);
+    }
+
+    /**
+     * Sets this render thread to save its Vulkan calls for the replay tool.
+     *
+     * The resources are recorded from the start, and the capture is saved
+     * once the given frames are done. The frames skipped are part of the
+     * capture, but are only run once when it is loaded. This must be called
+     * before {@link start}.
+     *
+     * @param path      The capture file (empty for none)
+     * @param skip      The number of frames before the captured ones
+     * @param frames    The number of frames to capture
+     */
+    void setCapture(const std::string& path, uint32_t skip, uint32_t frames) {
+        capturePath = path;
+        captureSkip = skip;
+        captureFrames = frames;
+    }
+
+    /**
+     * Sets how this render thread calls the device, to measure the cost.
+     *
+     * Device functions normally skip the loader trampolines, but can go
+     * through them instead for comparison. The particles can also be drawn
+     * in several calls, which changes nothing on screen but makes recording
+     * slower. This must be called before {@link start}.
+     *
+     * @param direct    Whether device functions skip the loader trampolines
+     * @param draws     The number of draw calls for the particles
+     */
+    void setDispatch(bool direct, uint32_t draws) {
+        directDispatch = direct;
+        drawCount = std::max(draws, 1u);
+    }
+
+    /**
+     * Sets how the particles are stored, and how many there are.
+     *
+     * The count is also the capacity of the particle buffers, so the count
+     * can only grow back to it with {@link scaleParticles}. It is clamped to
+     * what the device can bind in the chosen layout. This must be called
+     * before {@link start}.
+     *
+     * @param format    The particle storage
+     * @param count     The number of particles (0 for the default)
+     */
+    void setParticles(ParticleLayout::Format format, uint32_t count) {
+        particleFormat = format;
+        particleCount = count;
+    }
+
+    /**
+     * Sets the particles spawned per second.
+     *
+     * With a positive rate, the particles spawn from emitters and die after
+     * a few seconds, and the count set by {@link setParticles} is the size
+     * of the pool they spawn from. A rate of 0 keeps every particle alive.
+     * This must be called before {@link start}.
+     *
+     * @param rate  The particles spawned per second
+     */
+    void setEmitter(float rate) {
+        emitRate = std::max(rate, 0.0f);
+    }
+
+    /**
+     * Doubles or halves the particles, up to the capacity of the buffers.
+     *
+     * Each step doubles (or halves if negative) the count, which is applied
+     * at the start of the next frame. The buffers are not resized, so this
+     * only changes how many particles are simulated and drawn. With
+     * emitters, this doubles or halves the emit rate instead.
+     *
+     * Note that this method is called on the main thread, not in the render
+     * thread. The steps are atomic, so it does not need the lock guard.
+     *
+     * @param steps The number of times to double the particles
+     */
+    void scaleParticles(int steps) { particleScale += steps; }
+
 private:
     // TUTORIAL CODE (Provided without comments)
     VkInstance instance;
@@ -217,7 +417,7 @@ private:
     VkQueue computeQueue;
     VkQueue presentQueue;
     
-    VkSwapchainKHR swapChain;
+    VkSwapchainKHR swapChain = VK_NULL_HANDLE;
     std::vector<VkImage> swapChainImages;
     VkFormat swapChainImageFormat;
     VkExtent2D swapChainExtent;
@@ -231,11 +431,38 @@ private:
     VkDescriptorSetLayout computeDescriptorSetLayout;
     VkPipelineLayout computePipelineLayout;
     VkPipeline computePipeline;
+    // Only used to set the initial particles
+    VkPipeline initPipeline = VK_NULL_HANDLE;
+    // Only used with emitters, to size the indirect dispatch and to spawn particles
+    VkPipeline preparePipeline = VK_NULL_HANDLE;
+    VkPipeline emitPipeline = VK_NULL_HANDLE;
     
     VkCommandPool commandPool;
+    VkCommandPool computeCommandPool;
+    uint32_t graphicsFamily = 0;
+    uint32_t computeFamily = 0;
 
     std::vector<VkBuffer> shaderStorageBuffers;
     std::vector<VkDeviceMemory> shaderStorageBuffersMemory;
+    // The particle attributes that are never simulated (none in the original layout)
+    VkBuffer particleSharedBuffer = VK_NULL_HANDLE;
+    VkDeviceMemory particleSharedBufferMemory = VK_NULL_HANDLE;
+    // The lifetimes and the dead list, which only compute uses (none without emitters)
+    VkBuffer particlePoolBuffer = VK_NULL_HANDLE;
+    VkDeviceMemory particlePoolBufferMemory = VK_NULL_HANDLE;
+
+    // The buffers hold the requested particles in the chosen layout, but fewer can be simulated
+    std::unique_ptr<ParticleLayout> particleLayout;
+    ParticleLayout::Format particleFormat = ParticleLayout::Format::SOA;
+    // 0 is replaced by the default count when the layout is created
+    uint32_t particleCount = 0;
+    uint32_t particleSeed = 0;
+    // The doublings requested by the main thread, applied at the start of a frame
+    std::atomic<int> particleScale = 0;
+    // A positive rate spawns particles that die, and the count is then the size of the pool
+    std::unique_ptr<ParticleEmitter> particleEmitter;
+    float emitRate = 0.0f;
+    uint32_t emitCount = 0;
 
     std::vector<VkBuffer> uniformBuffers;
     std::vector<VkDeviceMemory> uniformBuffersMemory;
@@ -247,15 +474,44 @@ private:
     std::vector<VkCommandBuffer> commandBuffers;
     std::vector<VkCommandBuffer> computeCommandBuffers;
 
-    std::vector<VkSemaphore> imageAvailableSemaphores;
-    std::vector<VkSemaphore> renderFinishedSemaphores;
-    std::vector<VkSemaphore> computeFinishedSemaphores;
-    std::vector<VkFence> inFlightFences;
-    std::vector<VkFence> computeInFlightFences;
+    // One timeline per queue replaces the fence and semaphore arrays
+    std::unique_ptr<FrameSync> frameSync;
+    uint32_t graphicsTimeline = 0;
+    uint32_t computeTimeline = 0;
     uint32_t currentFrame = 0;
+    // The particle buffer written this frame (frame number mod PARTICLE_BUFFERS)
+    uint32_t currentBuffer = 0;
+
+    // Named GPU scopes, averaged once a second and optionally saved as a trace
+    std::unique_ptr<GpuProfiler> gpuProfiler;
+    uint32_t computeProfile = 0;
+    uint32_t graphicsProfile = 0;
+    bool statisticsRequested = false;
+    bool statisticsEnabled = false;
+    std::string tracePath;
+
+    // The presentation policy, set from the main thread under the lock guard
+    VkPresentModeKHR preferredPresentMode = VK_PRESENT_MODE_MAILBOX_KHR;
+    VkPresentModeKHR presentMode = VK_PRESENT_MODE_FIFO_KHR;
+    uint32_t framesInFlight = 2;
+    // 0 asks for one more image than the surface minimum
+    uint32_t preferredImageCount = 0;
+    bool presentationChanged = false;
+    bool presentWaitEnabled = false;
+    float refreshRate = 0.0f;
+    std::unique_ptr<PresentPacer> presentPacer;
+
+    // Old swapchains are destroyed once their frames and presents are done
+    bool surfaceMaintenanceEnabled = false;
+    bool swapchainMaintenanceEnabled = false;
+    std::unique_ptr<SwapchainRetirer> swapchainRetirer;
+    // Anything replaced while the GPU may still use it is destroyed here
+    std::unique_ptr<DeletionQueue> deletionQueue;
     
     timestamp_t timestamp;
     float lastFrameTime = 0.0f;
+    // The seconds since startup, which headless runs pin to a fixed step per frame
+    std::function<double()> timeSource;
     
     std::thread* thread;
     std::mutex guard;
@@ -263,9 +519,38 @@ private:
 
     std::atomic<bool> running = false;
     
+    // Resizes are coalesced, and only forced when the swapchain is out of date
     bool framebufferResized = false;
+    bool swapchainOutOfDate = false;
+    timestamp_t resizeStart;
+    timestamp_t resizeLast;
     VkExtent2D theExtent;
     VkExtent2D newExtent;
+
+    // Headless runs render this many frames offscreen, with no surface
+    uint32_t headlessFrames = 0;
+    uint32_t headlessRendered = 0;
+    std::string screenshotPath;
+    std::unique_ptr<OffscreenTarget> offscreenTarget;
+    std::atomic<bool> finished = false;
+
+    // Benchmark runs time every headless frame and save the results as JSON
+    std::unique_ptr<BenchReport> benchReport;
+    std::string benchPath;
+    bool memoryBudgetEnabled = false;
+
+    // Device functions skip the loader trampolines unless disabled, and the particles can be drawn in pieces
+    bool directDispatch = true;
+    uint32_t drawCount = 1;
+    double recordTime = 0.0;
+
+    // The Vulkan calls of a few frames can be saved for the replay tool
+    std::unique_ptr<FrameCapture> capture;
+    std::string capturePath;
+    uint32_t captureSkip = 0;
+    uint32_t captureFrames = 1;
+
+    bool isHeadless() const { return headlessFrames > 0; }
         
     void initVulkan();
     void mainLoop();
@@ -275,8 +560,12 @@ private:
     void recreateSwapChain();
 
     void pickPhysicalDevice();
+    void createParticleLayout();
     void createLogicalDevice();
     void createSwapChain();
+    void createOffscreenTarget();
+    void finishHeadless(uint32_t frames, double seconds);
+    void writeBenchmark();
 
     void createImageViews();
     void createRenderPass();
@@ -289,13 +578,21 @@ private:
     void createUniformBuffers();
     void createDescriptorPool();
     void createComputeDescriptorSets();
+    void initParticles();
+    void applyParticleScale();
     void createCommandBuffers();
     void createComputeCommandBuffers();
     void createSyncObjects();
+    void applyPresentation();
+    void logPresentation();
+    bool isPresentPaced();
+    void requestResize();
+    bool isResizeSettled();
     void drawFrame();
 
     bool isDeviceSuitable(VkPhysicalDevice device);
     bool checkDeviceExtensionSupport(VkPhysicalDevice device);
+    bool hasDeviceExtension(VkPhysicalDevice device, const char* name);
     QueueFamilyIndices findQueueFamilies(VkPhysicalDevice device);
 
     VkSurfaceFormatKHR chooseSwapSurfaceFormat(const std::vector<VkSurfaceFormatKHR>& availableFormats);
@@ -310,10 +607,21 @@ private:
                       VkMemoryPropertyFlags properties, VkBuffer& buffer,
                       VkDeviceMemory& bufferMemory);
     void copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size);
+    void submitOnce(VkCommandPool pool, VkQueue queue, const std::function<void(VkCommandBuffer)>& record);
+    void recordOwnershipTransfer(VkCommandBuffer commandBuffer, VkBuffer buffer, uint32_t srcFamily, uint32_t dstFamily,
+                                 VkPipelineStageFlags srcStage, VkAccessFlags srcAccess,
+                                 VkPipelineStageFlags dstStage, VkAccessFlags dstAccess);
     uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties);
 
     void recordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t imageIndex);
     void recordComputeCommandBuffer(VkCommandBuffer commandBuffer);
+    void recordTransferCommandBuffer(VkCommandBuffer commandBuffer);
+    uint32_t getDrawBuffer();
+    void recordParticleAcquire(VkCommandBuffer commandBuffer);
+    void recordParticleRelease(VkCommandBuffer commandBuffer);
+    VkPipelineStageFlags getDrawStages();
+    VkAccessFlags getDrawAccess();
+    void recordListBarrier(VkCommandBuffer commandBuffer);
     void updateUniformBuffer(uint32_t currentImage);
 };
 
@@ -0,0 +1,133 @@
+//
+//  VulkanLoader.cpp
+//  Tutorial11
+//
+//  A loader for the Vulkan functions, in the style of volk. Linking against
+//  the Vulkan loader means that every call goes through a loader trampoline,
+//  which looks up the dispatch table of the device before calling the driver.
+//  That is one more indirect jump per call, and it adds up when recording
+//  thousands of commands a frame.
+//
+//  So this application does not link the loader at all, and is compiled with
+//  VK_NO_PROTOTYPES. Each Vulkan function it calls is instead a global
+//  function pointer with the same name, so the calls themselves are unchanged.
+//  The pointers start out as loader functions, fetched with
+//  vkGetInstanceProcAddr, and the device functions are replaced with the ones
+//  from vkGetDeviceProcAddr once there is a device. Those point straight into
+//  the driver (or the first layer, when validation is on).
+//
+//  The functions are listed in VulkanFunctions.h, which is generated by the
+//  script tutorials/dispatch.py. This header must be included instead of
+//  <vulkan/vulkan.h>.
+//
+//  Version: 10/18/26
+//
+#include "VulkanLoader.h"
+#include <SDL3/SDL.h>
+#include <SDL3/SDL_vulkan.h>
+
+PFN_vkGetInstanceProcAddr vkGetInstanceProcAddr = nullptr;
+PFN_vkGetDeviceProcAddr vkGetDeviceProcAddr = nullptr;
+
+#define VK_GLOBAL_FUNCTION(name)    PFN_##name name = nullptr;
+#define VK_INSTANCE_FUNCTION(name)  PFN_##name name = nullptr;
+#define VK_DEVICE_FUNCTION(name)    PFN_##name name = nullptr;
+#include "VulkanFunctions.h"
+
+/** The names of the system Vulkan library, in order of preference */
+#if defined(SDL_PLATFORM_WINDOWS)
+static const char* VULKAN_LIBRARIES[] = { "vulkan-1.dll" };
+#elif defined(SDL_PLATFORM_APPLE)
+static const char* VULKAN_LIBRARIES[] = { "libvulkan.1.dylib", "libvulkan.dylib", "libMoltenVK.dylib" };
+#else
+static const char* VULKAN_LIBRARIES[] = { "libvulkan.so.1", "libvulkan.so" };
+#endif
+
+/** The library loaded without SDL video (null if SDL loaded it) */
+static SDL_SharedObject* vulkan_library = nullptr;
+/** Whether SDL loaded the library */
+static bool vulkan_sdl = false;
+
+/**
+ * Loads the Vulkan library and the global functions
+ *
+ * If the video subsystem is initialized, this uses the library that SDL
+ * creates surfaces with. Otherwise (such as in headless mode) it loads
+ * the system library itself.
+ *
+ * @return true if the library was loaded
+ */
+bool VulkanLoader::init() {
+    if (vkGetInstanceProcAddr != nullptr) {
+        return true;
+    }
+
+    if (SDL_WasInit(SDL_INIT_VIDEO)) {
+        if (!SDL_Vulkan_LoadLibrary(nullptr)) {
+            SDL_Log("Error : %s", SDL_GetError());
+            return false;
+        }
+        vulkan_sdl = true;
+        vkGetInstanceProcAddr = (PFN_vkGetInstanceProcAddr) SDL_Vulkan_GetVkGetInstanceProcAddr();
+    } else {
+        for (const char* name : VULKAN_LIBRARIES) {
+            vulkan_library = SDL_LoadObject(name);
+            if (vulkan_library != nullptr) {
+                break;
+            }
+        }
+        if (vulkan_library == nullptr) {
+            SDL_Log("Error : %s", SDL_GetError());
+            return false;
+        }
+        vkGetInstanceProcAddr = (PFN_vkGetInstanceProcAddr) SDL_LoadFunction(vulkan_library, "vkGetInstanceProcAddr");
+    }
+
+    if (vkGetInstanceProcAddr == nullptr) {
+        SDL_Log("The Vulkan library has no vkGetInstanceProcAddr");
+        dispose();
+        return false;
+    }
+
+#define VK_GLOBAL_FUNCTION(name)    name = (PFN_##name) vkGetInstanceProcAddr(VK_NULL_HANDLE, #name);
+#include "VulkanFunctions.h"
+    return true;
+}
+
+/**
+ * Loads the instance functions, and the device functions as trampolines
+ *
+ * @param instance  The Vulkan instance
+ */
+void VulkanLoader::loadInstance(VkInstance instance) {
+    vkGetDeviceProcAddr = (PFN_vkGetDeviceProcAddr) vkGetInstanceProcAddr(instance, "vkGetDeviceProcAddr");
+#define VK_INSTANCE_FUNCTION(name)  name = (PFN_##name) vkGetInstanceProcAddr(instance, #name);
+#define VK_DEVICE_FUNCTION(name)    name = (PFN_##name) vkGetInstanceProcAddr(instance, #name);
+#include "VulkanFunctions.h"
+}
+
+/**
+ * Loads the device functions directly from the device
+ *
+ * @param device    The logical device
+ */
+void VulkanLoader::loadDevice(VkDevice device) {
+#define VK_DEVICE_FUNCTION(name)    name = (PFN_##name) vkGetDeviceProcAddr(device, #name);
+#include "VulkanFunctions.h"
+}
+
+/**
+ * Unloads the Vulkan library, once the instance is destroyed
+ */
+void VulkanLoader::dispose() {
+    if (vulkan_sdl) {
+        SDL_Vulkan_UnloadLibrary();
+        vulkan_sdl = false;
+    }
+    if (vulkan_library != nullptr) {
+        SDL_UnloadObject(vulkan_library);
+        vulkan_library = nullptr;
+    }
+    vkGetInstanceProcAddr = nullptr;
+    vkGetDeviceProcAddr = nullptr;
+}
@@ -0,0 +1,150 @@
+//
+//  BenchReport.h
+//  Tutorial2
+//
+//  The results of a headless benchmark run. The frame rate in the title bar
+//  says little about a regression, and nothing about startup, memory, or the
+//  frames that hitch. So a benchmark run records the CPU time of every frame
+//  after a fixed warm-up, and saves the percentiles as JSON, along with the
+//  GPU time of each profiled scope, the time to the first frame, and the
+//  peak memory use of the process and the device.
+//
+//  The report is read by the vulkansdl-bench harness (tutorials/bench.py),
+//  which runs every workload with the same parameters and merges the results,
+//  so that runs from different releases can be compared.
+//
+//  Version: 10/18/26
+//
+#ifndef __BENCH_REPORT_H__
+#define __BENCH_REPORT_H__
+#include "VulkanLoader.h"
+#include <string>
+#include <vector>
+#include <utility>
+#include <cstdint>
+
+/**
+ * A collector of frame times and resource use for a benchmark run.
+ *
+ * Frame times are kept in full, rather than in a histogram, as a run is only
+ * a few thousand frames. The percentiles are computed when the report is
+ * saved, using the nearest rank.
+ */
+class BenchReport {
+private:
+    /** The workload name */
+    std::string workload;
+    /** The number of frames to skip before recording */
+    uint32_t warmup;
+    /** The number of frames seen, including the warm-up */
+    uint32_t frames;
+    /** The CPU time of each recorded frame in milliseconds */
+    std::vector<double> frameTimes;
+    /** The time to record the commands of each recorded frame in milliseconds */
+    std::vector<double> recordTimes;
+    /** The time from program start to the first frame in milliseconds (negative if unknown) */
+    double startup;
+    /** The parameters of the run, as JSON values */
+    std::vector<std::pair<std::string, std::string>> parameters;
+    /** The GPU time of each scope in milliseconds */
+    std::vector<std::pair<std::string, double>> gpuTimes;
+    /** The peak device memory use in bytes (0 if unknown) */
+    VkDeviceSize deviceMemory;
+
+public:
+    /**
+     * Creates an empty report for the given workload
+     *
+     * @param workload  The workload name
+     * @param warmup    The number of frames to skip before recording
+     */
+    BenchReport(const std::string& workload, uint32_t warmup);
+
+    /**
+     * Returns true if the given physical device can report its memory use
+     *
+     * This requires VK_EXT_memory_budget, which must then be enabled on the
+     * logical device for {@link sampleDeviceMemory}.
+     *
+     * @param device    The physical device
+     *
+     * @return true if the given physical device can report its memory use
+     */
+    static bool isDeviceMemorySupported(VkPhysicalDevice device);
+
+    /**
+     * Returns the peak resident memory of this process in bytes (0 if unknown)
+     *
+     * @return the peak resident memory of this process in bytes
+     */
+    static uint64_t getPeakMemory();
+
+    /**
+     * Adds a parameter of the run
+     *
+     * @param name  The parameter name
+     * @param value The parameter value
+     */
+    void setParameter(const std::string& name, double value);
+
+    /**
+     * Adds a parameter of the run
+     *
+     * @param name  The parameter name
+     * @param value The parameter value
+     */
+    void setParameter(const std::string& name, const std::string& value);
+
+    /**
+     * Adds the CPU time of a frame, unless it is part of the warm-up.
+     *
+     * The first frame also marks the end of startup.
+     *
+     * @param milliseconds  The CPU time of the frame in milliseconds
+     */
+    void addFrame(double milliseconds);
+
+    /**
+     * Adds the time to record the commands of a frame, unless it is part of the warm-up.
+     *
+     * This must be called before {@link addFrame} for the same frame.
+     *
+     * @param milliseconds  The recording time in milliseconds
+     */
+    void addRecording(double milliseconds);
+
+    /**
+     * Returns true if the warm-up is over
+     *
+     * @return true if the warm-up is over
+     */
+    bool isWarm() const { return frames >= warmup; }
+
+    /**
+     * Adds the average GPU time of a scope
+     *
+     * @param name          The scope name
+     * @param milliseconds  The average GPU time in milliseconds
+     */
+    void addGpuTime(const std::string& name, double milliseconds);
+
+    /**
+     * Samples the memory use of the device heaps, keeping the peak.
+     *
+     * This does nothing unless the logical device has VK_EXT_memory_budget.
+     *
+     * @param device    The physical device
+     */
+    void sampleDeviceMemory(VkPhysicalDevice device);
+
+    /**
+     * Saves this report as JSON
+     *
+     * @param path  The file to write
+     *
+     * @return true if the file was written
+     */
+    bool write(const std::string& path) const;
+};
+
+#endif /* __BENCH_REPORT_H__ */
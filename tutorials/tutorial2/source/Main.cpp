@@ -10,7 +10,9 @@
 #include <SDL3/SDL_main.h>
 #include <SDL3/SDL_app.h>
 #include <SDL3/SDL_vulkan.h>
-#include <vulkan/vulkan.h>
+#include "VulkanLoader.h"
+#include "OffscreenTarget.h"
+#include "BenchReport.h"
 
 #include <glm/glm.hpp>
 
@@ -18,7 +20,10 @@
 #include <fstream>
 #include <stdexcept>
 #include <algorithm>
+#include <chrono>
 #include <vector>
+#include <string>
+#include <memory>
 #include <cstring>
 #include <cstdlib>
 #include <cstdint>
@@ -186,7 +191,7 @@ private:
     
     VkInstance instance;
     VkDebugUtilsMessengerEXT debugMessenger;
-    VkSurfaceKHR surface;
+    VkSurfaceKHR surface = VK_NULL_HANDLE;
     
     VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
     VkDevice device;
@@ -194,7 +199,7 @@ private:
     VkQueue graphicsQueue;
     VkQueue presentQueue;
     
-    VkSwapchainKHR swapChain;
+    VkSwapchainKHR swapChain = VK_NULL_HANDLE;
     std::vector<VkImage> swapChainImages;
     VkFormat swapChainImageFormat;
     VkExtent2D swapChainExtent;
@@ -222,7 +227,31 @@ private:
     bool framebufferResized = false;
     VkExtent2D windowExtent;
     
+    // Headless runs render this many frames offscreen, with no window or surface
+    uint32_t headlessFrames = 0;
+    uint32_t headlessRendered = 0;
+    double headlessStart = 0.0;
+    std::string screenshotPath;
+    VkExtent2D headlessExtent = {WIDTH, HEIGHT};
+    std::unique_ptr<OffscreenTarget> offscreenTarget;
+    // Benchmark runs also time every headless frame, and save the results here
+    std::unique_ptr<BenchReport> benchReport;
+    std::string benchPath;
+    bool memoryBudgetEnabled = false;
+    
+    bool isHeadless() {
+        return headlessFrames > 0;
+    }
+    
     bool initWindow() {
+        if (isHeadless()) {
+            // Vulkan is used without the video subsystem, which needs a display
+            SDL_Init(0);
+            window = NULL;
+            windowExtent = headlessExtent;
+            return true;
+        }
+        
         SDL_Init(SDL_INIT_VIDEO);
         
         if (!SDL_Vulkan_LoadLibrary(nullptr)) {
@@ -282,7 +311,9 @@ private:
             vkDestroyImageView(device, imageView, nullptr);
         }
         
-        vkDestroySwapchainKHR(device, swapChain, nullptr);
+        if (swapChain != VK_NULL_HANDLE) {
+            vkDestroySwapchainKHR(device, swapChain, nullptr);
+        }
         
         // Despite the tutorial, it is not safe to reuse these semaphores
         for (size_t ii = 0; ii < renderFinishedSemaphores.size(); ii++) {
@@ -311,6 +342,7 @@ private:
         
         vkDestroyCommandPool(device, commandPool, nullptr);
         
+        offscreenTarget.reset();
         vkDestroyDevice(device, nullptr);
         
         if (enableValidationLayers) {
@@ -319,8 +351,11 @@ private:
         
         vkDestroySurfaceKHR(instance, surface, nullptr);
         vkDestroyInstance(instance, nullptr);
+        VulkanLoader::dispose();
         
-        SDL_DestroyWindow(window);
+        if (window != NULL) {
+            SDL_DestroyWindow(window);
+        }
         SDL_Quit();
     }
     
@@ -338,6 +373,10 @@ private:
     }
     
     void createInstance() {
+        if (!VulkanLoader::init()) {
+            throw std::runtime_error("failed to load Vulkan!");
+        }
+
         if (enableValidationLayers && !checkValidationLayerSupport()) {
             throw std::runtime_error("validation layers requested, but not available!");
         }
@@ -397,6 +436,7 @@ private:
         if (vkCreateInstance(&createInfo, nullptr, &instance) != VK_SUCCESS) {
             throw std::runtime_error("failed to create instance!");
         }
+        VulkanLoader::loadInstance(instance);
     }
     
     void populateDebugMessengerCreateInfo(VkDebugUtilsMessengerCreateInfoEXT& createInfo) {
@@ -419,6 +459,9 @@ private:
     }
     
     void createSurface() {
+        if (isHeadless()) {
+            return;
+        }
         if (!SDL_Vulkan_CreateSurface(window, instance, NULL, &surface)) {
             throw std::runtime_error("failed to create window surface!");
         }
@@ -477,7 +520,16 @@ private:
         
         createInfo.pEnabledFeatures = &deviceFeatures;
         
-        std::vector<const char*> extensions = deviceExtensions;
+        // Nothing is presented in headless mode, so there is no swapchain either
+        std::vector<const char*> extensions;
+        if (!isHeadless()) {
+            extensions = deviceExtensions;
+        }
+        // The device memory use is only reported to benchmarks
+        memoryBudgetEnabled = benchReport != nullptr && BenchReport::isDeviceMemorySupported(physicalDevice);
+        if (memoryBudgetEnabled) {
+            extensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+        }
         
 #ifdef USE_MOLTEN
         extensions.push_back("VK_KHR_portability_subset");
@@ -496,12 +548,18 @@ private:
         if (vkCreateDevice(physicalDevice, &createInfo, nullptr, &device) != VK_SUCCESS) {
             throw std::runtime_error("failed to create logical device!");
         }
+        VulkanLoader::loadDevice(device);
         
         vkGetDeviceQueue(device, indices.graphicsFamily.value(), 0, &graphicsQueue);
         vkGetDeviceQueue(device, indices.presentFamily.value(), 0, &presentQueue);
     }
     
     void createSwapChain() {
+        if (isHeadless()) {
+            createOffscreenTarget();
+            return;
+        }
+        
         SwapChainSupportDetails swapChainSupport = querySwapChainSupport(physicalDevice);
         
         VkSurfaceFormatKHR surfaceFormat = chooseSwapSurfaceFormat(swapChainSupport.formats);
@@ -552,6 +610,17 @@ private:
         swapChainExtent = extent;
     }
     
+    // The offscreen images stand in for the swapchain images, one for each frame slot
+    void createOffscreenTarget() {
+        if (offscreenTarget == nullptr) {
+            offscreenTarget = std::make_unique<OffscreenTarget>(physicalDevice, device, windowExtent, MAX_FRAMES_IN_FLIGHT);
+        }
+        
+        swapChainImages = offscreenTarget->getImages();
+        swapChainImageFormat = offscreenTarget->getFormat();
+        swapChainExtent = offscreenTarget->getExtent();
+    }
+    
     void createImageViews() {
         swapChainImageViews.resize(swapChainImages.size());
         
@@ -586,7 +655,8 @@ private:
         colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
         colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
         colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-        colorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+        // Offscreen images are left ready to be read back instead
+        colorAttachment.finalLayout = isHeadless() ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
         
         VkAttachmentReference colorAttachmentRef{};
         colorAttachmentRef.attachment = 0;
@@ -942,6 +1012,11 @@ private:
         
         vkCmdEndRenderPass(commandBuffer);
         
+        // The last headless frame copies its own image, rather than stalling for a separate copy
+        if (isHeadless() && !screenshotPath.empty() && headlessRendered + 1 == headlessFrames) {
+            offscreenTarget->recordReadback(commandBuffer, imageIndex);
+        }
+        
         if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
             throw std::runtime_error("failed to record command buffer!");
         }
@@ -979,8 +1054,12 @@ private:
     void drawFrame() {
         vkWaitForFences(device, 1, &inFlightFences[currentFrame], VK_TRUE, UINT64_MAX);
         
-        uint32_t imageIndex;
-        VkResult result = vkAcquireNextImageKHR(device, swapChain, UINT64_MAX, imageAvailableSemaphores[currentFrame], VK_NULL_HANDLE, &imageIndex);
+        // Offscreen images are never acquired, as the fence already freed the image of this slot
+        uint32_t imageIndex = currentFrame;
+        VkResult result = VK_SUCCESS;
+        if (!isHeadless()) {
+            result = vkAcquireNextImageKHR(device, swapChain, UINT64_MAX, imageAvailableSemaphores[currentFrame], VK_NULL_HANDLE, &imageIndex);
+        }
         
         if (result == VK_ERROR_OUT_OF_DATE_KHR || framebufferResized) {
             recreateSwapChain();
@@ -999,7 +1078,7 @@ private:
         
         VkSemaphore waitSemaphores[] = {imageAvailableSemaphores[currentFrame]};
         VkPipelineStageFlags waitStages[] = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
-        submitInfo.waitSemaphoreCount = 1;
+        submitInfo.waitSemaphoreCount = isHeadless() ? 0 : 1;
         submitInfo.pWaitSemaphores = waitSemaphores;
         submitInfo.pWaitDstStageMask = waitStages;
         
@@ -1007,13 +1086,19 @@ private:
         submitInfo.pCommandBuffers = &commandBuffers[currentFrame];
         
         VkSemaphore signalSemaphores[] = {renderFinishedSemaphores[imageIndex]};
-        submitInfo.signalSemaphoreCount = 1;
+        submitInfo.signalSemaphoreCount = isHeadless() ? 0 : 1;
         submitInfo.pSignalSemaphores = signalSemaphores;
         
         if (vkQueueSubmit(graphicsQueue, 1, &submitInfo, inFlightFences[currentFrame]) != VK_SUCCESS) {
             throw std::runtime_error("failed to submit draw command buffer!");
         }
         
+        // There is nothing to present to, so the frame is done
+        if (isHeadless()) {
+            currentFrame = (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
+            return;
+        }
+        
         VkPresentInfoKHR presentInfo{};
         presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
         
@@ -1115,8 +1200,8 @@ private:
         
         bool extensionsSupported = checkDeviceExtensionSupport(device);
         
-        bool swapChainAdequate = false;
-        if (extensionsSupported) {
+        bool swapChainAdequate = isHeadless();
+        if (extensionsSupported && !isHeadless()) {
             SwapChainSupportDetails swapChainSupport = querySwapChainSupport(device);
             swapChainAdequate = !swapChainSupport.formats.empty() && !swapChainSupport.presentModes.empty();
         }
@@ -1125,6 +1210,10 @@ private:
     }
     
     bool checkDeviceExtensionSupport(VkPhysicalDevice device) {
+        if (isHeadless()) {
+            return true;
+        }
+        
         uint32_t extensionCount;
         vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
         
@@ -1155,8 +1244,13 @@ private:
                 indices.graphicsFamily = i;
             }
             
+            // Without a surface, the graphics family stands in for the present family
             VkBool32 presentSupport = false;
-            vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &presentSupport);
+            if (isHeadless()) {
+                presentSupport = (queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) ? VK_TRUE : VK_FALSE;
+            } else {
+                vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &presentSupport);
+            }
             
             if (presentSupport) {
                 indices.presentFamily = i;
@@ -1173,9 +1267,13 @@ private:
     }
     
     std::vector<const char*> getRequiredExtensions() {
-        uint32_t extensionCount = 0;
-        const char * const *instance_extensions = SDL_Vulkan_GetInstanceExtensions(&extensionCount);
-        std::vector<const char*> extensions(instance_extensions,instance_extensions+extensionCount);
+        // Headless mode has no surface, so it needs none of the surface extensions
+        std::vector<const char*> extensions;
+        if (!isHeadless()) {
+            uint32_t extensionCount = 0;
+            const char * const *instance_extensions = SDL_Vulkan_GetInstanceExtensions(&extensionCount);
+            extensions.assign(instance_extensions,instance_extensions+extensionCount);
+        }
         
         if (enableValidationLayers) {
             extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
@@ -1242,6 +1340,29 @@ public:
     
     ~HelloTriangleApplication() { cleanup(); }
     
+    /**
+     * Renders the given number of frames offscreen, with no window or surface.
+     *
+     * The last frame is saved as a PNG if the screenshot path is not empty.
+     * This must be called before {@link setup}, and 0 frames opens a window.
+     */
+    void setHeadless(uint32_t frames, VkExtent2D extent, const std::string& screenshot) {
+        headlessFrames = frames;
+        headlessExtent = extent;
+        screenshotPath = screenshot;
+    }
+    
+    /**
+     * Saves the frame times of a headless run to the given file as JSON.
+     *
+     * The first warmup frames are not counted. This must be called before
+     * {@link setup}, and only applies to headless runs.
+     */
+    void setBenchmark(const std::string& path, uint32_t warmup) {
+        benchPath = path;
+        benchReport = std::make_unique<BenchReport>("indexed-quad", warmup);
+    }
+    
     bool setup() {
         // Set the basic metadata
         if (!SDL_SetAppMetadata("Hello Triangle", "1.0.0","com.vulkan-tutorial.tutorial2")) {
@@ -1257,7 +1378,9 @@ public:
             return false;
         }
 
-        SDL_RaiseWindow(window);
+        if (window != NULL) {
+            SDL_RaiseWindow(window);
+        }
         return true;
     }
     
@@ -1272,8 +1395,57 @@ public:
         return true;
     }
     
-    void run() {
+    // Saves the benchmark results once the last headless frame is done
+    void writeBenchmark() {
+        if (memoryBudgetEnabled) {
+            benchReport->sampleDeviceMemory(physicalDevice);
+        }
+        
+        VkPhysicalDeviceProperties props;
+        vkGetPhysicalDeviceProperties(physicalDevice, &props);
+        benchReport->setParameter("tutorial", "tutorial2");
+        benchReport->setParameter("device", props.deviceName);
+        benchReport->setParameter("width", windowExtent.width);
+        benchReport->setParameter("height", windowExtent.height);
+        benchReport->write(benchPath);
+    }
+    
+    // Returns false once a headless run has rendered all of its frames
+    bool run() {
+        if (isHeadless() && headlessRendered == 0) {
+            headlessStart = SDL_GetTicks()/1000.0;
+        }
+        auto frameStart = std::chrono::steady_clock::now();
         drawFrame();
+        if (isHeadless()) {
+            headlessRendered++;
+            if (benchReport != nullptr) {
+                std::chrono::duration<double, std::milli> frameTime = std::chrono::steady_clock::now() - frameStart;
+                benchReport->addFrame(frameTime.count());
+                // The budget query is not free, so memory is only sampled every 30 frames
+                if (memoryBudgetEnabled && headlessRendered % 30 == 0) {
+                    benchReport->sampleDeviceMemory(physicalDevice);
+                }
+            }
+            if (headlessRendered < headlessFrames) {
+                return true;
+            }
+            
+            double elapsed = SDL_GetTicks()/1000.0 - headlessStart;
+            SDL_Log("Rendered %u headless frames in %.3f s", headlessRendered, elapsed);
+            if (!screenshotPath.empty()) {
+                // The last frame already copied its image, so this only waits for that frame
+                vkDeviceWaitIdle(device);
+                offscreenTarget->saveReadback(screenshotPath);
+            }
+            if (benchReport != nullptr) {
+                // Waits for the last frame, so that its memory is counted
+                vkDeviceWaitIdle(device);
+                writeBenchmark();
+            }
+            return false;
+        }
+        return true;
     }
 
     void wait() {
@@ -1286,6 +1458,42 @@ public:
 SDL_AppResult SDL_AppInit(void **appstate, int argc, char *argv[]) {
     HelloTriangleApplication* app = new HelloTriangleApplication();
     *appstate = app;
+    
+    // Passing --headless FRAMES (or setting VULKANSDL_HEADLESS=FRAMES) renders offscreen, and --screenshot FILE saves the last frame
+    uint32_t headless = 0;
+    std::string screenshot;
+    VkExtent2D size = {WIDTH, HEIGHT};
+    // Passing --bench FILE saves the frame times of a headless run, after --warmup N frames
+    std::string bench;
+    uint32_t warmup = 60;
+    const char* headlessEnv = SDL_getenv("VULKANSDL_HEADLESS");
+    if (headlessEnv != nullptr) {
+        headless = static_cast<uint32_t>(strtoul(headlessEnv, nullptr, 10));
+    }
+    for (int ii = 1; ii+1 < argc; ii++) {
+        if (strcmp(argv[ii], "--headless") == 0) {
+            headless = static_cast<uint32_t>(strtoul(argv[ii+1], nullptr, 10));
+        } else if (strcmp(argv[ii], "--screenshot") == 0) {
+            screenshot = argv[ii+1];
+        } else if (strcmp(argv[ii], "--size") == 0 && SDL_sscanf(argv[ii+1], "%ux%u", &size.width, &size.height) != 2) {
+            SDL_Log("Unknown size %s", argv[ii+1]);
+        } else if (strcmp(argv[ii], "--bench") == 0) {
+            bench = argv[ii+1];
+        } else if (strcmp(argv[ii], "--warmup") == 0) {
+            warmup = static_cast<uint32_t>(strtoul(argv[ii+1], nullptr, 10));
+        }
+    }
+    if (!screenshot.empty() && headless == 0) {
+        SDL_Log("Screenshots are only saved in headless mode");
+    }
+    if (!bench.empty() && headless == 0) {
+        SDL_Log("Benchmarks are only run in headless mode");
+    }
+    app->setHeadless(headless, size, screenshot);
+    if (!bench.empty() && headless > 0) {
+        app->setBenchmark(bench, warmup);
+    }
+    
     if (app->setup()) {
         return SDL_APP_CONTINUE;
     }
@@ -1295,7 +1503,9 @@ SDL_AppResult SDL_AppInit(void **appstate, int argc, char *argv[]) {
 SDL_AppResult SDL_AppIterate(void *appstate) {
     HelloTriangleApplication* app = (HelloTriangleApplication*)appstate;
     try {
-        app->run();
+        if (!app->run()) {
+            return SDL_APP_SUCCESS;
+        }
     } catch (const std::exception& e) {
         std::cerr << e.what() << std::endl;
         return SDL_APP_FAILURE;
@@ -10,7 +10,9 @@
 #include <SDL3/SDL_main.h>
 #include <SDL3/SDL_app.h>
 #include <SDL3/SDL_vulkan.h>
-#include <vulkan/vulkan.h>
+#include "VulkanLoader.h"
+#include "OffscreenTarget.h"
+#include "BenchReport.h"
 
 #define GLM_FORCE_RADIANS
 #include <glm/glm.hpp>
@@ -21,7 +23,10 @@
 #include <stdexcept>
 #include <algorithm>
 #include <chrono>
+#include <functional>
 #include <vector>
+#include <string>
+#include <memory>
 #include <cstring>
 #include <cstdlib>
 #include <cstdint>
@@ -83,6 +88,9 @@ const uint32_t HEIGHT = 600;
 
 const int MAX_FRAMES_IN_FLIGHT = 2;
 
+// Headless runs step a fixed clock, so that every run draws the same frames
+const float HEADLESS_FRAME_TIME = 1000.0f / 60.0f;
+
 const std::vector<const char*> validationLayers = {
     "VK_LAYER_KHRONOS_validation"
 };
@@ -195,7 +203,7 @@ private:
 
     VkInstance instance;
     VkDebugUtilsMessengerEXT debugMessenger;
-    VkSurfaceKHR surface;
+    VkSurfaceKHR surface = VK_NULL_HANDLE;
 
     VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
     VkDevice device;
@@ -203,7 +211,7 @@ private:
     VkQueue graphicsQueue;
     VkQueue presentQueue;
 
-    VkSwapchainKHR swapChain;
+    VkSwapchainKHR swapChain = VK_NULL_HANDLE;
     std::vector<VkImage> swapChainImages;
     VkFormat swapChainImageFormat;
     VkExtent2D swapChainExtent;
@@ -239,7 +247,31 @@ private:
     bool framebufferResized = false;
     VkExtent2D windowExtent;
 
+    // Headless runs render this many frames offscreen, with no window or surface
+    uint32_t headlessFrames = 0;
+    uint32_t headlessRendered = 0;
+    double headlessStart = 0.0;
+    std::string screenshotPath;
+    VkExtent2D headlessExtent = {WIDTH, HEIGHT};
+    std::unique_ptr<OffscreenTarget> offscreenTarget;
+    // Benchmark runs also time every headless frame, and save the results here
+    std::unique_ptr<BenchReport> benchReport;
+    std::string benchPath;
+    bool memoryBudgetEnabled = false;
+
+    bool isHeadless() {
+        return headlessFrames > 0;
+    }
+
     bool initWindow() {
+        if (isHeadless()) {
+            // Vulkan is used without the video subsystem, which needs a display
+            SDL_Init(0);
+            window = NULL;
+            windowExtent = headlessExtent;
+            return true;
+        }
+
         SDL_Init(SDL_INIT_VIDEO);
 
         if (!SDL_Vulkan_LoadLibrary(nullptr)) {
@@ -302,7 +334,9 @@ private:
             vkDestroyImageView(device, imageView, nullptr);
         }
 
-        vkDestroySwapchainKHR(device, swapChain, nullptr);
+        if (swapChain != VK_NULL_HANDLE) {
+            vkDestroySwapchainKHR(device, swapChain, nullptr);
+        }
         
         // Despite the tutorial, it is not safe to reuse these semaphores
         for (size_t ii = 0; ii < renderFinishedSemaphores.size(); ii++) {
@@ -340,6 +374,7 @@ private:
 
         vkDestroyCommandPool(device, commandPool, nullptr);
 
+        offscreenTarget.reset();
         vkDestroyDevice(device, nullptr);
 
         if (enableValidationLayers) {
@@ -348,8 +383,11 @@ private:
 
         vkDestroySurfaceKHR(instance, surface, nullptr);
         vkDestroyInstance(instance, nullptr);
+        VulkanLoader::dispose();
 
-        SDL_DestroyWindow(window);
+        if (window != NULL) {
+            SDL_DestroyWindow(window);
+        }
         SDL_Quit();
     }
 
@@ -367,6 +405,10 @@ private:
     }
 
     void createInstance() {
+        if (!VulkanLoader::init()) {
+            throw std::runtime_error("failed to load Vulkan!");
+        }
+
         if (enableValidationLayers && !checkValidationLayerSupport()) {
             throw std::runtime_error("validation layers requested, but not available!");
         }
@@ -426,6 +468,7 @@ private:
         if (vkCreateInstance(&createInfo, nullptr, &instance) != VK_SUCCESS) {
             throw std::runtime_error("failed to create instance!");
         }
+        VulkanLoader::loadInstance(instance);
     }
 
     void populateDebugMessengerCreateInfo(VkDebugUtilsMessengerCreateInfoEXT& createInfo) {
@@ -448,6 +491,9 @@ private:
     }
 
     void createSurface() {
+        if (isHeadless()) {
+            return;
+        }
         if (!SDL_Vulkan_CreateSurface(window, instance, NULL, &surface)) {
             throw std::runtime_error("failed to create window surface!");
         }
@@ -506,7 +552,16 @@ private:
 
         createInfo.pEnabledFeatures = &deviceFeatures;
 
-        std::vector<const char*> extensions = deviceExtensions;
+        // Nothing is presented in headless mode, so there is no swapchain either
+        std::vector<const char*> extensions;
+        if (!isHeadless()) {
+            extensions = deviceExtensions;
+        }
+        // The device memory use is only reported to benchmarks
+        memoryBudgetEnabled = benchReport != nullptr && BenchReport::isDeviceMemorySupported(physicalDevice);
+        if (memoryBudgetEnabled) {
+            extensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+        }
 
 #ifdef USE_MOLTEN
         extensions.push_back("VK_KHR_portability_subset");
@@ -525,12 +580,18 @@ private:
         if (vkCreateDevice(physicalDevice, &createInfo, nullptr, &device) != VK_SUCCESS) {
             throw std::runtime_error("failed to create logical device!");
         }
+        VulkanLoader::loadDevice(device);
 
         vkGetDeviceQueue(device, indices.graphicsFamily.value(), 0, &graphicsQueue);
         vkGetDeviceQueue(device, indices.presentFamily.value(), 0, &presentQueue);
     }
 
     void createSwapChain() {
+        if (isHeadless()) {
+            createOffscreenTarget();
+            return;
+        }
+
         SwapChainSupportDetails swapChainSupport = querySwapChainSupport(physicalDevice);
 
         VkSurfaceFormatKHR surfaceFormat = chooseSwapSurfaceFormat(swapChainSupport.formats);
@@ -581,6 +642,17 @@ private:
         swapChainExtent = extent;
     }
 
+    // The offscreen images stand in for the swapchain images, one for each frame slot
+    void createOffscreenTarget() {
+        if (offscreenTarget == nullptr) {
+            offscreenTarget = std::make_unique<OffscreenTarget>(physicalDevice, device, windowExtent, MAX_FRAMES_IN_FLIGHT);
+        }
+
+        swapChainImages = offscreenTarget->getImages();
+        swapChainImageFormat = offscreenTarget->getFormat();
+        swapChainExtent = offscreenTarget->getExtent();
+    }
+
     void createImageViews() {
         swapChainImageViews.resize(swapChainImages.size());
 
@@ -615,7 +687,8 @@ private:
         colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
         colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
         colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-        colorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+        // Offscreen images are left ready to be read back instead
+        colorAttachment.finalLayout = isHeadless() ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
 
         VkAttachmentReference colorAttachmentRef{};
         colorAttachmentRef.attachment = 0;
@@ -1053,6 +1126,11 @@ private:
 
         vkCmdEndRenderPass(commandBuffer);
 
+        // The last headless frame copies its own image, rather than stalling for a separate copy
+        if (isHeadless() && !screenshotPath.empty() && headlessRendered + 1 == headlessFrames) {
+            offscreenTarget->recordReadback(commandBuffer, imageIndex);
+        }
+
         if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
             throw std::runtime_error("failed to record command buffer!");
         }
@@ -1087,11 +1165,13 @@ private:
         }
     }
 
-    void updateUniformBuffer(uint32_t currentImage) {
-        static auto startTime = std::chrono::high_resolution_clock::now();
+    // The seconds since startup, which can be pinned to a fixed step per frame
+    std::function<float()> timeSource = [start = std::chrono::steady_clock::now()]() {
+        return std::chrono::duration<float>(std::chrono::steady_clock::now() - start).count();
+    };
 
-        auto currentTime = std::chrono::high_resolution_clock::now();
-        float time = std::chrono::duration<float, std::chrono::seconds::period>(currentTime - startTime).count();
+    void updateUniformBuffer(uint32_t currentImage) {
+        float time = timeSource();
 
         UniformBufferObject ubo{};
         //ubo.model = glm::rotate(glm::mat4(1.0f), time * glm::radians(90.0f), glm::vec3(0.0f, 0.0f, 1.0f));
@@ -1106,8 +1186,12 @@ private:
     void drawFrame() {
         vkWaitForFences(device, 1, &inFlightFences[currentFrame], VK_TRUE, UINT64_MAX);
 
-        uint32_t imageIndex;
-        VkResult result = vkAcquireNextImageKHR(device, swapChain, UINT64_MAX, imageAvailableSemaphores[currentFrame], VK_NULL_HANDLE, &imageIndex);
+        // Offscreen images are never acquired, as the fence already freed the image of this slot
+        uint32_t imageIndex = currentFrame;
+        VkResult result = VK_SUCCESS;
+        if (!isHeadless()) {
+            result = vkAcquireNextImageKHR(device, swapChain, UINT64_MAX, imageAvailableSemaphores[currentFrame], VK_NULL_HANDLE, &imageIndex);
+        }
 
         if (result == VK_ERROR_OUT_OF_DATE_KHR || framebufferResized) {
             recreateSwapChain();
@@ -1128,7 +1212,7 @@ private:
 
         VkSemaphore waitSemaphores[] = {imageAvailableSemaphores[currentFrame]};
         VkPipelineStageFlags waitStages[] = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
-        submitInfo.waitSemaphoreCount = 1;
+        submitInfo.waitSemaphoreCount = isHeadless() ? 0 : 1;
         submitInfo.pWaitSemaphores = waitSemaphores;
         submitInfo.pWaitDstStageMask = waitStages;
 
@@ -1136,13 +1220,19 @@ private:
         submitInfo.pCommandBuffers = &commandBuffers[currentFrame];
 
         VkSemaphore signalSemaphores[] = {renderFinishedSemaphores[imageIndex]};
-        submitInfo.signalSemaphoreCount = 1;
+        submitInfo.signalSemaphoreCount = isHeadless() ? 0 : 1;
         submitInfo.pSignalSemaphores = signalSemaphores;
 
         if (vkQueueSubmit(graphicsQueue, 1, &submitInfo, inFlightFences[currentFrame]) != VK_SUCCESS) {
             throw std::runtime_error("failed to submit draw command buffer!");
         }
 
+        // There is nothing to present to, so the frame is done
+        if (isHeadless()) {
+            currentFrame = (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
+            return;
+        }
+
         VkPresentInfoKHR presentInfo{};
         presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
 
@@ -1243,8 +1333,8 @@ private:
 
         bool extensionsSupported = checkDeviceExtensionSupport(device);
 
-        bool swapChainAdequate = false;
-        if (extensionsSupported) {
+        bool swapChainAdequate = isHeadless();
+        if (extensionsSupported && !isHeadless()) {
             SwapChainSupportDetails swapChainSupport = querySwapChainSupport(device);
             swapChainAdequate = !swapChainSupport.formats.empty() && !swapChainSupport.presentModes.empty();
         }
@@ -1253,6 +1343,10 @@ private:
     }
 
     bool checkDeviceExtensionSupport(VkPhysicalDevice device) {
+        if (isHeadless()) {
+            return true;
+        }
+
         uint32_t extensionCount;
         vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
 
@@ -1283,8 +1377,13 @@ private:
                 indices.graphicsFamily = i;
             }
 
+            // Without a surface, the graphics family stands in for the present family
             VkBool32 presentSupport = false;
-            vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &presentSupport);
+            if (isHeadless()) {
+                presentSupport = (queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) ? VK_TRUE : VK_FALSE;
+            } else {
+                vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &presentSupport);
+            }
 
             if (presentSupport) {
                 indices.presentFamily = i;
@@ -1301,9 +1400,13 @@ private:
     }
 
     std::vector<const char*> getRequiredExtensions() {
-        uint32_t extensionCount = 0;
-        const char * const *instance_extensions = SDL_Vulkan_GetInstanceExtensions(&extensionCount);
-        std::vector<const char*> extensions(instance_extensions,instance_extensions+extensionCount);
+        // Headless mode has no surface, so it needs none of the surface extensions
+        std::vector<const char*> extensions;
+        if (!isHeadless()) {
+            uint32_t extensionCount = 0;
+            const char * const *instance_extensions = SDL_Vulkan_GetInstanceExtensions(&extensionCount);
+            extensions.assign(instance_extensions,instance_extensions+extensionCount);
+        }
 
         if (enableValidationLayers) {
             extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
@@ -1368,6 +1471,43 @@ public:
     
     ~HelloTriangleApplication() { cleanup(); }
     
+    /**
+     * Replaces the clock that animates the scene.
+     *
+     * The clock returns seconds, and is read once per frame. A pinned clock
+     * makes every run draw the same frames, so that they can be compared.
+     */
+    void setTimeSource(std::function<float()> source) {
+        timeSource = std::move(source);
+    }
+    
+    /**
+     * Renders the given number of frames offscreen, with no window or surface.
+     *
+     * The last frame is saved as a PNG if the screenshot path is not empty.
+     * The clock is pinned to 1/60 s per frame, unless it is set again later.
+     * This must be called before {@link setup}, and 0 frames opens a window.
+     */
+    void setHeadless(uint32_t frames, VkExtent2D extent, const std::string& screenshot) {
+        headlessFrames = frames;
+        headlessExtent = extent;
+        screenshotPath = screenshot;
+        if (frames > 0) {
+            setTimeSource([frame = 0u]() mutable { return frame++ * HEADLESS_FRAME_TIME / 1000.0f; });
+        }
+    }
+
+    /**
+     * Saves the frame times of a headless run to the given file as JSON.
+     *
+     * The first warmup frames are not counted. This must be called before
+     * {@link setup}, and only applies to headless runs.
+     */
+    void setBenchmark(const std::string& path, uint32_t warmup) {
+        benchPath = path;
+        benchReport = std::make_unique<BenchReport>("uniform-quad", warmup);
+    }
+
     bool setup() {
         // Set the basic metadata
         if (!SDL_SetAppMetadata("Hello Triangle", "1.0.0","com.vulkan-tutorial.tutorial3")) {
@@ -1383,7 +1523,9 @@ public:
             return false;
         }
 
-        SDL_RaiseWindow(window);
+        if (window != NULL) {
+            SDL_RaiseWindow(window);
+        }
         return true;
     }
     
@@ -1398,8 +1540,57 @@ public:
         return true;
     }
     
-    void run() {
+    // Saves the benchmark results once the last headless frame is done
+    void writeBenchmark() {
+        if (memoryBudgetEnabled) {
+            benchReport->sampleDeviceMemory(physicalDevice);
+        }
+
+        VkPhysicalDeviceProperties props;
+        vkGetPhysicalDeviceProperties(physicalDevice, &props);
+        benchReport->setParameter("tutorial", "tutorial3");
+        benchReport->setParameter("device", props.deviceName);
+        benchReport->setParameter("width", windowExtent.width);
+        benchReport->setParameter("height", windowExtent.height);
+        benchReport->write(benchPath);
+    }
+
+    // Returns false once a headless run has rendered all of its frames
+    bool run() {
+        if (isHeadless() && headlessRendered == 0) {
+            headlessStart = SDL_GetTicks()/1000.0;
+        }
+        auto frameStart = std::chrono::steady_clock::now();
         drawFrame();
+        if (isHeadless()) {
+            headlessRendered++;
+            if (benchReport != nullptr) {
+                std::chrono::duration<double, std::milli> frameTime = std::chrono::steady_clock::now() - frameStart;
+                benchReport->addFrame(frameTime.count());
+                // The budget query is not free, so memory is only sampled every 30 frames
+                if (memoryBudgetEnabled && headlessRendered % 30 == 0) {
+                    benchReport->sampleDeviceMemory(physicalDevice);
+                }
+            }
+            if (headlessRendered < headlessFrames) {
+                return true;
+            }
+
+            double elapsed = SDL_GetTicks()/1000.0 - headlessStart;
+            SDL_Log("Rendered %u headless frames in %.3f s", headlessRendered, elapsed);
+            if (!screenshotPath.empty()) {
+                // The last frame already copied its image, so this only waits for that frame
+                vkDeviceWaitIdle(device);
+                offscreenTarget->saveReadback(screenshotPath);
+            }
+            if (benchReport != nullptr) {
+                // Waits for the last frame, so that its memory is counted
+                vkDeviceWaitIdle(device);
+                writeBenchmark();
+            }
+            return false;
+        }
+        return true;
     }
 
     void wait() {
@@ -1412,6 +1603,53 @@ public:
 SDL_AppResult SDL_AppInit(void **appstate, int argc, char *argv[]) {
     HelloTriangleApplication* app = new HelloTriangleApplication();
     *appstate = app;
+    
+    // Passing --headless FRAMES (or setting VULKANSDL_HEADLESS=FRAMES) renders offscreen, and --screenshot FILE saves the last frame
+    uint32_t headless = 0;
+    std::string screenshot;
+    VkExtent2D size = {WIDTH, HEIGHT};
+    const char* headlessEnv = SDL_getenv("VULKANSDL_HEADLESS");
+    if (headlessEnv != nullptr) {
+        headless = static_cast<uint32_t>(strtoul(headlessEnv, nullptr, 10));
+    }
+    for (int ii = 1; ii+1 < argc; ii++) {
+        if (strcmp(argv[ii], "--headless") == 0) {
+            headless = static_cast<uint32_t>(strtoul(argv[ii+1], nullptr, 10));
+        } else if (strcmp(argv[ii], "--screenshot") == 0) {
+            screenshot = argv[ii+1];
+        } else if (strcmp(argv[ii], "--size") == 0 && SDL_sscanf(argv[ii+1], "%ux%u", &size.width, &size.height) != 2) {
+            SDL_Log("Unknown size %s", argv[ii+1]);
+        }
+    }
+    if (!screenshot.empty() && headless == 0) {
+        SDL_Log("Screenshots are only saved in headless mode");
+    }
+    app->setHeadless(headless, size, screenshot);
+    
+    // Passing --fixed-step MS pins the animation clock, advancing it MS per frame
+    for (int ii = 1; ii+1 < argc; ii++) {
+        if (strcmp(argv[ii], "--fixed-step") == 0) {
+            float step = strtof(argv[ii+1], nullptr) / 1000.0f;
+            app->setTimeSource([step, frame = 0u]() mutable { return frame++ * step; });
+        }
+    }
+    
+    // Passing --bench FILE saves the frame times of a headless run, after --warmup N frames
+    std::string bench;
+    uint32_t warmup = 60;
+    for (int ii = 1; ii+1 < argc; ii++) {
+        if (strcmp(argv[ii], "--bench") == 0) {
+            bench = argv[ii+1];
+        } else if (strcmp(argv[ii], "--warmup") == 0) {
+            warmup = static_cast<uint32_t>(strtoul(argv[ii+1], nullptr, 10));
+        }
+    }
+    if (!bench.empty() && headless == 0) {
+        SDL_Log("Benchmarks are only run in headless mode");
+    } else if (!bench.empty()) {
+        app->setBenchmark(bench, warmup);
+    }
+    
     if (app->setup()) {
         return SDL_APP_CONTINUE;
     }
@@ -1421,7 +1659,9 @@ SDL_AppResult SDL_AppInit(void **appstate, int argc, char *argv[]) {
 SDL_AppResult SDL_AppIterate(void *appstate) {
     HelloTriangleApplication* app = (HelloTriangleApplication*)appstate;
     try {
-        app->run();
+        if (!app->run()) {
+            return SDL_APP_SUCCESS;
+        }
     } catch (const std::exception& e) {
         std::cerr << e.what() << std::endl;
         return SDL_APP_FAILURE;
@@ -0,0 +1,54 @@
+#version 450
+
+// The bindless variant of shader.vert. The model matrix and texture of each
+// instance come from a storage buffer indexed by the instance index (which
+// includes the firstInstance of the draw). The model matrix in the uniform
+// buffer is the animation shared by every instance, applied in model space.
+// ObjectData must match SceneInstance in IndirectScene.h.
+//
+// Compile with -DCULLING for the occlusion culling path (see cull.comp). The
+// instance index then selects an entry of the visible list, which holds the
+// index of the instance that survived culling.
+
+layout(set = 0, binding = 0) uniform UniformBufferObject {
+    mat4 model;
+    mat4 view;
+    mat4 proj;
+} ubo;
+
+struct ObjectData {
+    mat4 model;
+    vec4 bounds;
+    uint texture;
+    uint draw;
+};
+
+layout(std430, set = 0, binding = 1) readonly buffer ObjectBuffer {
+    ObjectData objects[];
+};
+
+#ifdef CULLING
+layout(std430, set = 0, binding = 2) readonly buffer VisibleBuffer {
+    uint visible[];
+};
+#endif
+
+layout(location = 0) in vec3 inPosition;
+layout(location = 1) in vec3 inColor;
+layout(location = 2) in vec2 inTexCoord;
+
+layout(location = 0) out vec3 fragColor;
+layout(location = 1) out vec2 fragTexCoord;
+layout(location = 2) flat out uint fragTexture;
+
+void main() {
+#ifdef CULLING
+    ObjectData object = objects[visible[gl_InstanceIndex]];
+#else
+    ObjectData object = objects[gl_InstanceIndex];
+#endif
+    gl_Position = ubo.proj * ubo.view * object.model * ubo.model * vec4(inPosition, 1.0);
+    fragColor = inColor;
+    fragTexCoord = inTexCoord;
+    fragTexture = object.texture;
+}
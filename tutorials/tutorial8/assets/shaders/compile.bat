@@ -1,3 +1,11 @@
 glslc.exe shader.vert -o vert.spv
 glslc.exe shader.frag -o frag.spv
+glslc.exe mipmap.comp -o mipmap.spv
+glslc.exe bindless.vert -o bindless_vert.spv
+glslc.exe bindless.frag -o bindless_frag.spv
+glslc.exe bindless.vert -DCULLING -o bindless_cull_vert.spv
+glslc.exe mipmap.comp -DHIZ -o mipmap_hiz.spv
+glslc.exe depthreduce.comp -o depthreduce.spv
+glslc.exe depthreduce.comp -DMULTISAMPLE -o depthreduce_ms.spv
+glslc.exe cull.comp -o cull.spv
 pause
\ No newline at end of file
@@ -46,4 +46,12 @@ while getopts ":hc" option; do
 done
 
 glslc "${SRCPATH}/shader.vert" -o vert.spv
-glslc "${SRCPATH}/shader.frag" -o frag.spv
\ No newline at end of file
+glslc "${SRCPATH}/shader.frag" -o frag.spv
+glslc "${SRCPATH}/mipmap.comp" -o mipmap.spv
+glslc "${SRCPATH}/bindless.vert" -o bindless_vert.spv
+glslc "${SRCPATH}/bindless.frag" -o bindless_frag.spv
+glslc "${SRCPATH}/bindless.vert" -DCULLING -o bindless_cull_vert.spv
+glslc "${SRCPATH}/mipmap.comp" -DHIZ -o mipmap_hiz.spv
+glslc "${SRCPATH}/depthreduce.comp" -o depthreduce.spv
+glslc "${SRCPATH}/depthreduce.comp" -DMULTISAMPLE -o depthreduce_ms.spv
+glslc "${SRCPATH}/cull.comp" -o cull.spv
\ No newline at end of file
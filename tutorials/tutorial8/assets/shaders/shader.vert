@@ -6,6 +6,14 @@ layout(binding = 0) uniform UniformBufferObject {
     mat4 proj;
 } ubo;
 
+// The per-draw data, which must match DrawConstants in Main.cpp. The view and
+// projection stay in the uniform buffer, as they only change once a frame.
+layout(push_constant) uniform DrawConstants {
+    mat4 model;     // The object transform
+    uint material;  // The material (texture) index
+    uint drawId;    // The index of the draw in the frame
+} draw;
+
 layout(location = 0) in vec3 inPosition;
 layout(location = 1) in vec3 inColor;
 layout(location = 2) in vec2 inTexCoord;
@@ -14,7 +22,7 @@ layout(location = 0) out vec3 fragColor;
 layout(location = 1) out vec2 fragTexCoord;
 
 void main() {
-    gl_Position = ubo.proj * ubo.view * ubo.model * vec4(inPosition, 1.0);
+    gl_Position = ubo.proj * ubo.view * draw.model * ubo.model * vec4(inPosition, 1.0);
     fragColor = inColor;
     fragTexCoord = inTexCoord;
 }
\ No newline at end of file
@@ -0,0 +1,157 @@
+//
+//  BindlessTable.cpp
+//  Tutorial8
+//
+//  A bindless texture table built on descriptor indexing (core in Vulkan 1.2).
+//  The tutorial binds a single combined image sampler at a fixed binding. To
+//  support many materials that way would require a descriptor set for each
+//  material, and a new bind for each draw.
+//
+//  Instead, this table is a single descriptor set with one large array of
+//  combined image samplers. The array is partially bound, so unused slots
+//  may be left empty, and it is update-after-bind, so textures may be added
+//  while the set is bound in command buffers that are still in flight. The
+//  shaders select a texture by index, so the set is bound once per frame.
+//
+//  Version: 10/18/26
+//
+#include "BindlessTable.h"
+#include <stdexcept>
+
+/**
+ * Creates a table with the given number of texture slots.
+ *
+ * The device must have enabled runtimeDescriptorArray,
+ * descriptorBindingPartiallyBound, and
+ * descriptorBindingSampledImageUpdateAfterBind.
+ *
+ * @param device    The logical device
+ * @param capacity  The number of texture slots
+ * @param stages    The shader stages that access the table
+ */
+BindlessTable::BindlessTable(VkDevice device, uint32_t capacity, VkShaderStageFlags stages) :
+    device(device),
+    layout(VK_NULL_HANDLE),
+    pool(VK_NULL_HANDLE),
+    set(VK_NULL_HANDLE),
+    capacity(capacity),
+    nextSlot(0) {
+    VkDescriptorSetLayoutBinding binding{};
+    binding.binding = TEXTURE_BINDING;
+    binding.descriptorCount = capacity;
+    binding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    binding.pImmutableSamplers = nullptr;
+    binding.stageFlags = stages;
+
+    VkDescriptorBindingFlags bindingFlags = VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT |
+                                            VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT;
+
+    VkDescriptorSetLayoutBindingFlagsCreateInfo flagsInfo{};
+    flagsInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+    flagsInfo.bindingCount = 1;
+    flagsInfo.pBindingFlags = &bindingFlags;
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.pNext = &flagsInfo;
+    layoutInfo.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
+    layoutInfo.bindingCount = 1;
+    layoutInfo.pBindings = &binding;
+
+    if (vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &layout) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create bindless descriptor set layout!");
+    }
+
+    VkDescriptorPoolSize poolSize{};
+    poolSize.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    poolSize.descriptorCount = capacity;
+
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT;
+    poolInfo.poolSizeCount = 1;
+    poolInfo.pPoolSizes = &poolSize;
+    poolInfo.maxSets = 1;
+
+    if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &pool) != VK_SUCCESS) {
+        vkDestroyDescriptorSetLayout(device, layout, nullptr);
+        throw std::runtime_error("failed to create bindless descriptor pool!");
+    }
+
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = pool;
+    allocInfo.descriptorSetCount = 1;
+    allocInfo.pSetLayouts = &layout;
+
+    if (vkAllocateDescriptorSets(device, &allocInfo, &set) != VK_SUCCESS) {
+        vkDestroyDescriptorPool(device, pool, nullptr);
+        vkDestroyDescriptorSetLayout(device, layout, nullptr);
+        throw std::runtime_error("failed to allocate bindless descriptor set!");
+    }
+}
+
+/**
+ * Destroys the table and its descriptor pool.
+ */
+BindlessTable::~BindlessTable() {
+    vkDestroyDescriptorPool(device, pool, nullptr);
+    vkDestroyDescriptorSetLayout(device, layout, nullptr);
+}
+
+/**
+ * Adds a texture to the table, returning its index.
+ *
+ * This may be called while the table is bound, and from any thread. The
+ * image must be in VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL.
+ *
+ * @param view      The image view
+ * @param sampler   The sampler for the texture
+ *
+ * @return the index of the texture in the table
+ */
+uint32_t BindlessTable::addTexture(VkImageView view, VkSampler sampler) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    uint32_t index;
+    if (!freeSlots.empty()) {
+        index = freeSlots.back();
+        freeSlots.pop_back();
+    } else if (nextSlot < capacity) {
+        index = nextSlot++;
+    } else {
+        throw std::runtime_error("bindless texture table is full!");
+    }
+
+    VkDescriptorImageInfo imageInfo{};
+    imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    imageInfo.imageView = view;
+    imageInfo.sampler = sampler;
+
+    VkWriteDescriptorSet descriptorWrite{};
+    descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    descriptorWrite.dstSet = set;
+    descriptorWrite.dstBinding = TEXTURE_BINDING;
+    descriptorWrite.dstArrayElement = index;
+    descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    descriptorWrite.descriptorCount = 1;
+    descriptorWrite.pImageInfo = &imageInfo;
+
+    vkUpdateDescriptorSets(device, 1, &descriptorWrite, 0, nullptr);
+    return index;
+}
+
+/**
+ * Releases the texture at the given index.
+ *
+ * The slot will be reused by a later call to {@link addTexture}, so the
+ * caller must ensure that no frame in flight still reads from it.
+ *
+ * @param index     The texture index
+ */
+void BindlessTable::removeTexture(uint32_t index) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (index < nextSlot) {
+        freeSlots.push_back(index);
+    }
+}
@@ -0,0 +1,117 @@
+//
+//  BindlessTable.h
+//  Tutorial8
+//
+//  A bindless texture table built on descriptor indexing (core in Vulkan 1.2).
+//  The tutorial binds a single combined image sampler at a fixed binding. To
+//  support many materials that way would require a descriptor set for each
+//  material, and a new bind for each draw.
+//
+//  Instead, this table is a single descriptor set with one large array of
+//  combined image samplers. The array is partially bound, so unused slots
+//  may be left empty, and it is update-after-bind, so textures may be added
+//  while the set is bound in command buffers that are still in flight. The
+//  shaders select a texture by index, so the set is bound once per frame.
+//
+//  Version: 10/18/26
+//
+#ifndef __BINDLESS_TABLE_H__
+#define __BINDLESS_TABLE_H__
+#include "VulkanLoader.h"
+#include <mutex>
+#include <vector>
+#include <cstdint>
+
+/**
+ * A descriptor set holding a large, sparsely populated array of textures.
+ */
+class BindlessTable {
+private:
+    /** The logical device */
+    VkDevice device;
+    /** The layout of the table */
+    VkDescriptorSetLayout layout;
+    /** The pool holding the table */
+    VkDescriptorPool pool;
+    /** The descriptor set for the table */
+    VkDescriptorSet set;
+    /** The number of slots in the table */
+    uint32_t capacity;
+    /** The next slot that has never been used */
+    uint32_t nextSlot;
+    /** Slots that have been released and may be reused */
+    std::vector<uint32_t> freeSlots;
+    /** Mutex guarding slot allocation and descriptor updates */
+    std::mutex mutex;
+
+public:
+    /** The binding of the texture array */
+    static const uint32_t TEXTURE_BINDING = 0;
+
+    /**
+     * Creates a table with the given number of texture slots.
+     *
+     * The device must have enabled runtimeDescriptorArray,
+     * descriptorBindingPartiallyBound, and
+     * descriptorBindingSampledImageUpdateAfterBind.
+     *
+     * @param device    The logical device
+     * @param capacity  The number of texture slots
+     * @param stages    The shader stages that access the table
+     */
+    BindlessTable(VkDevice device, uint32_t capacity, VkShaderStageFlags stages);
+
+    /**
+     * Destroys the table and its descriptor pool.
+     */
+    ~BindlessTable();
+
+    BindlessTable(const BindlessTable&) = delete;
+    BindlessTable& operator=(const BindlessTable&) = delete;
+
+    /**
+     * Returns the layout for the table, for use in pipeline layouts
+     *
+     * @return the layout for the table
+     */
+    VkDescriptorSetLayout getLayout() const { return layout; }
+
+    /**
+     * Returns the descriptor set for the table
+     *
+     * @return the descriptor set for the table
+     */
+    VkDescriptorSet getSet() const { return set; }
+
+    /**
+     * Returns the number of texture slots in the table
+     *
+     * @return the number of texture slots in the table
+     */
+    uint32_t getCapacity() const { return capacity; }
+
+    /**
+     * Adds a texture to the table, returning its index.
+     *
+     * This may be called while the table is bound, and from any thread. The
+     * image must be in VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL.
+     *
+     * @param view      The image view
+     * @param sampler   The sampler for the texture
+     *
+     * @return the index of the texture in the table
+     */
+    uint32_t addTexture(VkImageView view, VkSampler sampler);
+
+    /**
+     * Releases the texture at the given index.
+     *
+     * The slot will be reused by a later call to {@link addTexture}, so the
+     * caller must ensure that no frame in flight still reads from it.
+     *
+     * @param index     The texture index
+     */
+    void removeTexture(uint32_t index);
+};
+
+#endif /* __BINDLESS_TABLE_H__ */
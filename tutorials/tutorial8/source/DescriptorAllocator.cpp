@@ -0,0 +1,395 @@
+//
+//  DescriptorAllocator.cpp
+//  Tutorial8
+//
+//  Helpers for descriptor management. The tutorial sizes a single descriptor
+//  pool to exactly the sets it needs and fills those sets with hand built
+//  VkWriteDescriptorSet arrays. That works for a static scene, but any
+//  dynamic content will quickly exhaust the pool.
+//
+//  This module has three pieces. DescriptorLayoutCache deduplicates set
+//  layouts by their bindings. DescriptorAllocator hands out sets from a chain
+//  of pools, adding a new pool whenever the current one runs out, and resets
+//  all of them at once (typically once per frame). DescriptorTemplate writes
+//  a whole set from a single struct with vkUpdateDescriptorSetWithTemplate,
+//  or pushes it directly into a command buffer with VK_KHR_push_descriptor.
+//
+//  Version: 10/18/26
+//
+#include "DescriptorAllocator.h"
+#include <algorithm>
+#include <functional>
+#include <stdexcept>
+
+// LAYOUT CACHE
+
+/**
+ * Returns true if the two keys describe the same layout
+ */
+bool DescriptorLayoutCache::LayoutKey::operator==(const LayoutKey& other) const {
+    if (flags != other.flags || bindings.size() != other.bindings.size()) {
+        return false;
+    }
+    for (size_t ii = 0; ii < bindings.size(); ii++) {
+        const VkDescriptorSetLayoutBinding& a = bindings[ii];
+        const VkDescriptorSetLayoutBinding& b = other.bindings[ii];
+        if (a.binding != b.binding || a.descriptorType != b.descriptorType ||
+            a.descriptorCount != b.descriptorCount || a.stageFlags != b.stageFlags) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Returns the hash of the given key
+ */
+size_t DescriptorLayoutCache::LayoutHash::operator()(const LayoutKey& key) const {
+    std::hash<uint64_t> hasher;
+    size_t result = hasher(key.flags);
+    for (const auto& binding : key.bindings) {
+        uint64_t packed = (static_cast<uint64_t>(binding.binding) << 48) ^
+                          (static_cast<uint64_t>(binding.descriptorType) << 40) ^
+                          (static_cast<uint64_t>(binding.stageFlags) << 24) ^
+                          static_cast<uint64_t>(binding.descriptorCount);
+        result ^= hasher(packed) + 0x9e3779b9 + (result << 6) + (result >> 2);
+    }
+    return result;
+}
+
+/**
+ * Destroys all of the cached layouts
+ */
+DescriptorLayoutCache::~DescriptorLayoutCache() {
+    for (auto& entry : layouts) {
+        vkDestroyDescriptorSetLayout(device, entry.second, nullptr);
+    }
+}
+
+/**
+ * Returns a layout with the given bindings, creating it if necessary.
+ *
+ * Immutable samplers are not supported, as they cannot be hashed safely.
+ *
+ * @param bindings  The layout bindings (in any order)
+ * @param flags     The layout creation flags
+ *
+ * @return a layout with the given bindings
+ */
+VkDescriptorSetLayout DescriptorLayoutCache::get(const std::vector<VkDescriptorSetLayoutBinding>& bindings,
+                                                 VkDescriptorSetLayoutCreateFlags flags) {
+    LayoutKey key;
+    key.flags = flags;
+    key.bindings = bindings;
+    std::sort(key.bindings.begin(), key.bindings.end(),
+              [](const VkDescriptorSetLayoutBinding& a, const VkDescriptorSetLayoutBinding& b) {
+        return a.binding < b.binding;
+    });
+
+    auto it = layouts.find(key);
+    if (it != layouts.end()) {
+        return it->second;
+    }
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.flags = flags;
+    layoutInfo.bindingCount = static_cast<uint32_t>(key.bindings.size());
+    layoutInfo.pBindings = key.bindings.data();
+
+    VkDescriptorSetLayout layout;
+    if (vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &layout) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create descriptor set layout!");
+    }
+    layouts.emplace(std::move(key), layout);
+    return layout;
+}
+
+// ALLOCATOR
+
+/**
+ * Creates an allocator with the given pool mix.
+ *
+ * @param device        The logical device
+ * @param ratios        The descriptors of each type to reserve per set
+ * @param initialSets   The number of sets in the first pool
+ */
+DescriptorAllocator::DescriptorAllocator(VkDevice device, const std::vector<PoolRatio>& ratios, uint32_t initialSets) :
+    device(device),
+    ratios(ratios),
+    setsPerPool(std::max(initialSets, 1u)),
+    currentPool(VK_NULL_HANDLE) {
+}
+
+/**
+ * Destroys every pool (and hence every set) in this allocator
+ */
+DescriptorAllocator::~DescriptorAllocator() {
+    for (auto pool : usedPools) {
+        vkDestroyDescriptorPool(device, pool, nullptr);
+    }
+    for (auto pool : freePools) {
+        vkDestroyDescriptorPool(device, pool, nullptr);
+    }
+}
+
+/**
+ * Returns a fresh pool, either recycled or newly created
+ *
+ * @return a fresh pool, either recycled or newly created
+ */
+VkDescriptorPool DescriptorAllocator::grabPool() {
+    if (!freePools.empty()) {
+        VkDescriptorPool pool = freePools.back();
+        freePools.pop_back();
+        return pool;
+    }
+
+    std::vector<VkDescriptorPoolSize> poolSizes;
+    poolSizes.reserve(ratios.size());
+    for (const auto& ratio : ratios) {
+        VkDescriptorPoolSize size{};
+        size.type = ratio.type;
+        size.descriptorCount = std::max(static_cast<uint32_t>(ratio.ratio*setsPerPool), 1u);
+        poolSizes.push_back(size);
+    }
+
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+    poolInfo.pPoolSizes = poolSizes.data();
+    poolInfo.maxSets = setsPerPool;
+
+    VkDescriptorPool pool;
+    if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &pool) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create descriptor pool!");
+    }
+
+    // Each new pool is larger, so the chain stays short as demand grows
+    setsPerPool = std::min(setsPerPool + setsPerPool/2, MAX_SETS_PER_POOL);
+    return pool;
+}
+
+/**
+ * Returns a new set with the given layout.
+ *
+ * If the current pool is exhausted, the set is allocated from another
+ * pool, which is created if necessary.
+ *
+ * @param layout    The set layout
+ *
+ * @return a new set with the given layout
+ */
+VkDescriptorSet DescriptorAllocator::allocate(VkDescriptorSetLayout layout) {
+    if (currentPool == VK_NULL_HANDLE) {
+        currentPool = grabPool();
+        usedPools.push_back(currentPool);
+    }
+
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = currentPool;
+    allocInfo.descriptorSetCount = 1;
+    allocInfo.pSetLayouts = &layout;
+
+    VkDescriptorSet set;
+    VkResult result = vkAllocateDescriptorSets(device, &allocInfo, &set);
+    if (result == VK_ERROR_OUT_OF_POOL_MEMORY || result == VK_ERROR_FRAGMENTED_POOL) {
+        currentPool = grabPool();
+        usedPools.push_back(currentPool);
+        allocInfo.descriptorPool = currentPool;
+        result = vkAllocateDescriptorSets(device, &allocInfo, &set);
+    }
+
+    if (result != VK_SUCCESS) {
+        throw std::runtime_error("failed to allocate descriptor sets!");
+    }
+    return set;
+}
+
+/**
+ * Returns every set allocated since the last reset to the pools.
+ *
+ * The sets must no longer be in use by any pending command buffer.
+ */
+void DescriptorAllocator::reset() {
+    for (auto pool : usedPools) {
+        vkResetDescriptorPool(device, pool, 0);
+        freePools.push_back(pool);
+    }
+    usedPools.clear();
+    currentPool = VK_NULL_HANDLE;
+}
+
+// UPDATE TEMPLATE
+
+/**
+ * Creates a template for writing descriptor sets with the given layout
+ *
+ * If useTemplates is false, updates fall back to vkUpdateDescriptorSets.
+ *
+ * @param device        The logical device
+ * @param layout        The set layout
+ * @param entries       The bindings and where their data lives
+ * @param useTemplates  Whether the device supports update templates
+ */
+DescriptorTemplate::DescriptorTemplate(VkDevice device, VkDescriptorSetLayout layout,
+                                       const std::vector<Entry>& entries, bool useTemplates) :
+    device(device),
+    entries(entries),
+    updateTemplate(VK_NULL_HANDLE),
+    pushTemplate(false),
+    pushFunction(nullptr) {
+    if (!useTemplates) {
+        return;
+    }
+
+    std::vector<VkDescriptorUpdateTemplateEntry> templateEntries;
+    for (const auto& entry : entries) {
+        VkDescriptorUpdateTemplateEntry templateEntry{};
+        templateEntry.dstBinding = entry.binding;
+        templateEntry.dstArrayElement = 0;
+        templateEntry.descriptorCount = entry.count;
+        templateEntry.descriptorType = entry.type;
+        templateEntry.offset = entry.offset;
+        templateEntry.stride = entry.stride;
+        templateEntries.push_back(templateEntry);
+    }
+
+    VkDescriptorUpdateTemplateCreateInfo templateInfo{};
+    templateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_UPDATE_TEMPLATE_CREATE_INFO;
+    templateInfo.descriptorUpdateEntryCount = static_cast<uint32_t>(templateEntries.size());
+    templateInfo.pDescriptorUpdateEntries = templateEntries.data();
+    templateInfo.templateType = VK_DESCRIPTOR_UPDATE_TEMPLATE_TYPE_DESCRIPTOR_SET;
+    templateInfo.descriptorSetLayout = layout;
+
+    if (vkCreateDescriptorUpdateTemplate(device, &templateInfo, nullptr, &updateTemplate) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create descriptor update template!");
+    }
+}
+
+/**
+ * Creates a template for pushing descriptors into a command buffer.
+ *
+ * The device must have enabled VK_KHR_push_descriptor, and the layout
+ * must have been created with the push descriptor flag.
+ *
+ * @param device        The logical device
+ * @param layout        The pipeline layout
+ * @param set           The set number to push
+ * @param setLayout     The (push descriptor) set layout
+ * @param entries       The bindings and where their data lives
+ */
+DescriptorTemplate::DescriptorTemplate(VkDevice device, VkPipelineLayout layout, uint32_t set,
+                                       VkDescriptorSetLayout setLayout, const std::vector<Entry>& entries) :
+    device(device),
+    entries(entries),
+    updateTemplate(VK_NULL_HANDLE),
+    pushTemplate(true) {
+    pushFunction = (PFN_vkCmdPushDescriptorSetWithTemplateKHR)vkGetDeviceProcAddr(device, "vkCmdPushDescriptorSetWithTemplateKHR");
+    if (pushFunction == nullptr) {
+        throw std::runtime_error("push descriptors are not supported!");
+    }
+
+    std::vector<VkDescriptorUpdateTemplateEntry> templateEntries;
+    for (const auto& entry : entries) {
+        VkDescriptorUpdateTemplateEntry templateEntry{};
+        templateEntry.dstBinding = entry.binding;
+        templateEntry.dstArrayElement = 0;
+        templateEntry.descriptorCount = entry.count;
+        templateEntry.descriptorType = entry.type;
+        templateEntry.offset = entry.offset;
+        templateEntry.stride = entry.stride;
+        templateEntries.push_back(templateEntry);
+    }
+
+    VkDescriptorUpdateTemplateCreateInfo templateInfo{};
+    templateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_UPDATE_TEMPLATE_CREATE_INFO;
+    templateInfo.descriptorUpdateEntryCount = static_cast<uint32_t>(templateEntries.size());
+    templateInfo.pDescriptorUpdateEntries = templateEntries.data();
+    templateInfo.templateType = VK_DESCRIPTOR_UPDATE_TEMPLATE_TYPE_PUSH_DESCRIPTORS_KHR;
+    templateInfo.descriptorSetLayout = setLayout;
+    templateInfo.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+    templateInfo.pipelineLayout = layout;
+    templateInfo.set = set;
+
+    if (vkCreateDescriptorUpdateTemplate(device, &templateInfo, nullptr, &updateTemplate) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create push descriptor template!");
+    }
+}
+
+/**
+ * Destroys the update template
+ */
+DescriptorTemplate::~DescriptorTemplate() {
+    if (updateTemplate != VK_NULL_HANDLE) {
+        vkDestroyDescriptorUpdateTemplate(device, updateTemplate, nullptr);
+    }
+}
+
+/**
+ * Writes all of the descriptors of the set from the given data
+ *
+ * @param set   The descriptor set to write
+ * @param data  The struct with the descriptor infos
+ */
+void DescriptorTemplate::update(VkDescriptorSet set, const void* data) const {
+    if (pushTemplate) {
+        throw std::logic_error("cannot update a set with a push descriptor template!");
+    } else if (updateTemplate != VK_NULL_HANDLE) {
+        vkUpdateDescriptorSetWithTemplate(device, set, updateTemplate, data);
+        return;
+    }
+
+    // Vulkan 1.0 fallback: point the writes directly into the data
+    const char* bytes = static_cast<const char*>(data);
+    std::vector<VkWriteDescriptorSet> descriptorWrites(entries.size());
+    for (size_t ii = 0; ii < entries.size(); ii++) {
+        const Entry& entry = entries[ii];
+        VkWriteDescriptorSet& write = descriptorWrites[ii];
+        write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        write.dstSet = set;
+        write.dstBinding = entry.binding;
+        write.dstArrayElement = 0;
+        write.descriptorType = entry.type;
+        write.descriptorCount = entry.count;
+        switch (entry.type) {
+            case VK_DESCRIPTOR_TYPE_SAMPLER:
+            case VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER:
+            case VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE:
+            case VK_DESCRIPTOR_TYPE_STORAGE_IMAGE:
+            case VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT:
+                write.pImageInfo = reinterpret_cast<const VkDescriptorImageInfo*>(bytes+entry.offset);
+                break;
+            default:
+                write.pBufferInfo = reinterpret_cast<const VkDescriptorBufferInfo*>(bytes+entry.offset);
+                break;
+        }
+
+        // The fallback only handles tightly packed arrays
+        if (entry.count > 1 && entry.stride != (write.pImageInfo ? sizeof(VkDescriptorImageInfo) : sizeof(VkDescriptorBufferInfo))) {
+            throw std::logic_error("descriptor array stride does not match the info struct!");
+        }
+    }
+
+    vkUpdateDescriptorSets(device, static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+}
+
+/**
+ * Pushes all of the descriptors of the set into a command buffer
+ *
+ * This may only be used on templates created for push descriptors. The
+ * pipeline layout must be compatible with the one given at creation, and
+ * the set number must be the same.
+ *
+ * @param commandBuffer The command buffer to record into
+ * @param layout        The pipeline layout
+ * @param set           The set number to push
+ * @param data          The struct with the descriptor infos
+ */
+void DescriptorTemplate::push(VkCommandBuffer commandBuffer, VkPipelineLayout layout, uint32_t set, const void* data) const {
+    if (!pushTemplate) {
+        throw std::logic_error("cannot push with a descriptor set template!");
+    }
+    pushFunction(commandBuffer, updateTemplate, layout, set, data);
+}
@@ -0,0 +1,263 @@
+//
+//  DescriptorAllocator.h
+//  Tutorial8
+//
+//  Helpers for descriptor management. The tutorial sizes a single descriptor
+//  pool to exactly the sets it needs and fills those sets with hand built
+//  VkWriteDescriptorSet arrays. That works for a static scene, but any
+//  dynamic content will quickly exhaust the pool.
+//
+//  This module has three pieces. DescriptorLayoutCache deduplicates set
+//  layouts by their bindings. DescriptorAllocator hands out sets from a chain
+//  of pools, adding a new pool whenever the current one runs out, and resets
+//  all of them at once (typically once per frame). DescriptorTemplate writes
+//  a whole set from a single struct with vkUpdateDescriptorSetWithTemplate,
+//  or pushes it directly into a command buffer with VK_KHR_push_descriptor.
+//
+//  Version: 10/18/26
+//
+#ifndef __DESCRIPTOR_ALLOCATOR_H__
+#define __DESCRIPTOR_ALLOCATOR_H__
+#include "VulkanLoader.h"
+#include <unordered_map>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+// LAYOUT CACHE
+
+/**
+ * A cache of descriptor set layouts, keyed by their bindings.
+ *
+ * Layouts are owned by the cache and destroyed with it.
+ */
+class DescriptorLayoutCache {
+private:
+    /** The description of a layout, used as the cache key */
+    struct LayoutKey {
+        /** The layout creation flags */
+        VkDescriptorSetLayoutCreateFlags flags;
+        /** The bindings, sorted by binding number */
+        std::vector<VkDescriptorSetLayoutBinding> bindings;
+
+        bool operator==(const LayoutKey& other) const;
+    };
+
+    /** The hash function for layout keys */
+    struct LayoutHash {
+        size_t operator()(const LayoutKey& key) const;
+    };
+
+    /** The logical device */
+    VkDevice device;
+    /** The cached layouts */
+    std::unordered_map<LayoutKey, VkDescriptorSetLayout, LayoutHash> layouts;
+
+public:
+    /**
+     * Creates an empty cache for the given device
+     *
+     * @param device    The logical device
+     */
+    DescriptorLayoutCache(VkDevice device) : device(device) {}
+
+    /**
+     * Destroys all of the cached layouts
+     */
+    ~DescriptorLayoutCache();
+
+    DescriptorLayoutCache(const DescriptorLayoutCache&) = delete;
+    DescriptorLayoutCache& operator=(const DescriptorLayoutCache&) = delete;
+
+    /**
+     * Returns a layout with the given bindings, creating it if necessary.
+     *
+     * Immutable samplers are not supported, as they cannot be hashed safely.
+     *
+     * @param bindings  The layout bindings (in any order)
+     * @param flags     The layout creation flags
+     *
+     * @return a layout with the given bindings
+     */
+    VkDescriptorSetLayout get(const std::vector<VkDescriptorSetLayoutBinding>& bindings,
+                              VkDescriptorSetLayoutCreateFlags flags = 0);
+};
+
+// ALLOCATOR
+
+/**
+ * A growable chain of descriptor pools.
+ *
+ * Sets are never freed individually. Instead, {@link reset} recycles every
+ * pool in the chain at once, which is about as cheap as resetting one pool.
+ * Allocation therefore costs the same no matter how many sets there are.
+ */
+class DescriptorAllocator {
+public:
+    /** The number of descriptors of a type to reserve per set in a pool */
+    struct PoolRatio {
+        VkDescriptorType type;
+        float ratio;
+    };
+
+private:
+    /** The logical device */
+    VkDevice device;
+    /** The descriptor mix of each pool */
+    std::vector<PoolRatio> ratios;
+    /** The number of sets in the next pool created */
+    uint32_t setsPerPool;
+    /** The pools in use since the last reset */
+    std::vector<VkDescriptorPool> usedPools;
+    /** The pools that have been reset and are ready for reuse */
+    std::vector<VkDescriptorPool> freePools;
+    /** The pool that allocations currently come from */
+    VkDescriptorPool currentPool;
+
+    /**
+     * Returns a fresh pool, either recycled or newly created
+     *
+     * @return a fresh pool, either recycled or newly created
+     */
+    VkDescriptorPool grabPool();
+
+public:
+    /** The largest number of sets we will put in a single pool */
+    static const uint32_t MAX_SETS_PER_POOL = 4096;
+
+    /**
+     * Creates an allocator with the given pool mix.
+     *
+     * @param device        The logical device
+     * @param ratios        The descriptors of each type to reserve per set
+     * @param initialSets   The number of sets in the first pool
+     */
+    DescriptorAllocator(VkDevice device, const std::vector<PoolRatio>& ratios, uint32_t initialSets = 64);
+
+    /**
+     * Destroys every pool (and hence every set) in this allocator
+     */
+    ~DescriptorAllocator();
+
+    DescriptorAllocator(const DescriptorAllocator&) = delete;
+    DescriptorAllocator& operator=(const DescriptorAllocator&) = delete;
+
+    /**
+     * Returns a new set with the given layout.
+     *
+     * If the current pool is exhausted, the set is allocated from another
+     * pool, which is created if necessary.
+     *
+     * @param layout    The set layout
+     *
+     * @return a new set with the given layout
+     */
+    VkDescriptorSet allocate(VkDescriptorSetLayout layout);
+
+    /**
+     * Returns every set allocated since the last reset to the pools.
+     *
+     * The sets must no longer be in use by any pending command buffer.
+     */
+    void reset();
+};
+
+// UPDATE TEMPLATE
+
+/**
+ * A template for writing all of the descriptors in a set from one struct.
+ *
+ * Each entry describes one binding, and where its VkDescriptorBufferInfo or
+ * VkDescriptorImageInfo lives in the struct. If the device does not support
+ * update templates (Vulkan 1.0), the template falls back to building the
+ * equivalent VkWriteDescriptorSet array.
+ */
+class DescriptorTemplate {
+public:
+    /** A binding in the template */
+    struct Entry {
+        /** The binding number */
+        uint32_t binding;
+        /** The descriptor type */
+        VkDescriptorType type;
+        /** The number of array elements */
+        uint32_t count;
+        /** The offset of the first info struct in the data */
+        size_t offset;
+        /** The stride between the info structs for arrays */
+        size_t stride;
+    };
+
+private:
+    /** The logical device */
+    VkDevice device;
+    /** The template entries */
+    std::vector<Entry> entries;
+    /** The update template (or VK_NULL_HANDLE for the fallback) */
+    VkDescriptorUpdateTemplate updateTemplate;
+    /** Whether this is a push descriptor template */
+    bool pushTemplate;
+    /** The push descriptor command, loaded from the device */
+    PFN_vkCmdPushDescriptorSetWithTemplateKHR pushFunction;
+
+public:
+    /**
+     * Creates a template for writing descriptor sets with the given layout
+     *
+     * If useTemplates is false, updates fall back to vkUpdateDescriptorSets.
+     *
+     * @param device        The logical device
+     * @param layout        The set layout
+     * @param entries       The bindings and where their data lives
+     * @param useTemplates  Whether the device supports update templates
+     */
+    DescriptorTemplate(VkDevice device, VkDescriptorSetLayout layout,
+                       const std::vector<Entry>& entries, bool useTemplates);
+
+    /**
+     * Creates a template for pushing descriptors into a command buffer.
+     *
+     * The device must have enabled VK_KHR_push_descriptor, and the layout
+     * must have been created with the push descriptor flag.
+     *
+     * @param device        The logical device
+     * @param layout        The pipeline layout
+     * @param set           The set number to push
+     * @param setLayout     The (push descriptor) set layout
+     * @param entries       The bindings and where their data lives
+     */
+    DescriptorTemplate(VkDevice device, VkPipelineLayout layout, uint32_t set,
+                       VkDescriptorSetLayout setLayout, const std::vector<Entry>& entries);
+
+    /**
+     * Destroys the update template
+     */
+    ~DescriptorTemplate();
+
+    DescriptorTemplate(const DescriptorTemplate&) = delete;
+    DescriptorTemplate& operator=(const DescriptorTemplate&) = delete;
+
+    /**
+     * Writes all of the descriptors of the set from the given data
+     *
+     * @param set   The descriptor set to write
+     * @param data  The struct with the descriptor infos
+     */
+    void update(VkDescriptorSet set, const void* data) const;
+
+    /**
+     * Pushes all of the descriptors of the set into a command buffer
+     *
+     * This may only be used on templates created for push descriptors. The
+     * pipeline layout must be compatible with the one given at creation, and
+     * the set number must be the same.
+     *
+     * @param commandBuffer The command buffer to record into
+     * @param layout        The pipeline layout
+     * @param set           The set number to push
+     * @param data          The struct with the descriptor infos
+     */
+    void push(VkCommandBuffer commandBuffer, VkPipelineLayout layout, uint32_t set, const void* data) const;
+};
+
+#endif /* __DESCRIPTOR_ALLOCATOR_H__ */
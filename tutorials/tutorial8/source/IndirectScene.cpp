@@ -0,0 +1,117 @@
+//
+//  IndirectScene.cpp
+//  Tutorial8
+//
+//  The CPU side of instanced, indirect scene submission. The tutorial draws
+//  a single model with one vkCmdDrawIndexed, taking its transform from the
+//  uniform buffer. Drawing thousands of objects that way costs a command
+//  (and a transform update) per object every frame.
+//
+//  Instead, this class collects the instances of a scene and groups them by
+//  mesh. The instance data is packed into one array, ordered by mesh, to be
+//  uploaded to a storage buffer. Each mesh becomes a single indirect command
+//  whose instances are a contiguous range of that array, starting at its
+//  firstInstance. So the shaders find their instance at gl_InstanceIndex,
+//  and the whole scene is drawn with one vkCmdDrawIndexedIndirect, no matter
+//  how many instances there are.
+//
+//  This class does not create any Vulkan objects. The application owns the
+//  buffers, and uploads the arrays once after calling {@link build}.
+//
+//  Version: 10/18/26
+//
+#include "IndirectScene.h"
+#include <stdexcept>
+
+/**
+ * Adds a mesh to the scene, returning its index
+ *
+ * @param indexCount    The number of indices in the mesh
+ * @param firstIndex    The first index of the mesh
+ * @param vertexOffset  The value added to each index
+ * @param bounds        The bounding sphere in model space (center, radius)
+ *
+ * @return the index of the new mesh
+ */
+uint32_t IndirectScene::addMesh(uint32_t indexCount, uint32_t firstIndex, int32_t vertexOffset, const glm::vec4& bounds) {
+    Mesh mesh;
+    mesh.indexCount = indexCount;
+    mesh.firstIndex = firstIndex;
+    mesh.vertexOffset = vertexOffset;
+    mesh.bounds = bounds;
+    meshes.push_back(mesh);
+    return static_cast<uint32_t>(meshes.size()-1);
+}
+
+/**
+ * Adds an instance of a mesh to the scene.
+ *
+ * The instance is not visible in {@link getInstances} until the next
+ * call to {@link build}.
+ *
+ * @param mesh      The mesh index
+ * @param model     The instance transform
+ * @param texture   The index of the texture in the bindless table
+ */
+void IndirectScene::addInstance(uint32_t mesh, const glm::mat4& model, uint32_t texture) {
+    if (mesh >= meshes.size()) {
+        throw std::runtime_error("scene instance has an invalid mesh!");
+    }
+
+    SceneInstance instance{};
+    instance.model = model;
+    instance.texture = texture;
+    added.push_back(instance);
+    addedMeshes.push_back(mesh);
+}
+
+/**
+ * Removes every instance from the scene, keeping the meshes
+ */
+void IndirectScene::clearInstances() {
+    added.clear();
+    addedMeshes.clear();
+}
+
+/**
+ * Groups the instances by mesh and builds the indirect commands.
+ *
+ * This is a counting sort, so it is linear in the number of instances.
+ * Meshes with no instances do not produce a command. Each instance is
+ * tagged with the index of its command, for GPU culling.
+ */
+void IndirectScene::build() {
+    std::vector<uint32_t> counts(meshes.size(), 0);
+    for (uint32_t mesh : addedMeshes) {
+        counts[mesh]++;
+    }
+
+    // The first instance of each mesh is the running total of the counts
+    std::vector<uint32_t> offsets(meshes.size(), 0);
+    std::vector<uint32_t> draws(meshes.size(), 0);
+    commands.clear();
+    uint32_t total = 0;
+    for (size_t ii = 0; ii < meshes.size(); ii++) {
+        offsets[ii] = total;
+        draws[ii] = static_cast<uint32_t>(commands.size());
+        if (counts[ii] > 0) {
+            VkDrawIndexedIndirectCommand command{};
+            command.indexCount = meshes[ii].indexCount;
+            command.instanceCount = counts[ii];
+            command.firstIndex = meshes[ii].firstIndex;
+            command.vertexOffset = meshes[ii].vertexOffset;
+            command.firstInstance = total;
+            commands.push_back(command);
+        }
+        total += counts[ii];
+    }
+
+    instances.resize(added.size());
+    for (size_t ii = 0; ii < added.size(); ii++) {
+        uint32_t mesh = addedMeshes[ii];
+        SceneInstance& instance = instances[offsets[mesh]++];
+        instance = added[ii];
+        instance.bounds = meshes[mesh].bounds;
+        instance.draw = draws[mesh];
+    }
+}
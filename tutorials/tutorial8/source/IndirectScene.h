@@ -0,0 +1,143 @@
+//
+//  IndirectScene.h
+//  Tutorial8
+//
+//  The CPU side of instanced, indirect scene submission. The tutorial draws
+//  a single model with one vkCmdDrawIndexed, taking its transform from the
+//  uniform buffer. Drawing thousands of objects that way costs a command
+//  (and a transform update) per object every frame.
+//
+//  Instead, this class collects the instances of a scene and groups them by
+//  mesh. The instance data is packed into one array, ordered by mesh, to be
+//  uploaded to a storage buffer. Each mesh becomes a single indirect command
+//  whose instances are a contiguous range of that array, starting at its
+//  firstInstance. So the shaders find their instance at gl_InstanceIndex,
+//  and the whole scene is drawn with one vkCmdDrawIndexedIndirect, no matter
+//  how many instances there are.
+//
+//  This class does not create any Vulkan objects. The application owns the
+//  buffers, and uploads the arrays once after calling {@link build}.
+//
+//  Version: 10/18/26
+//
+#ifndef __INDIRECT_SCENE_H__
+#define __INDIRECT_SCENE_H__
+#include "VulkanLoader.h"
+#include <glm/glm.hpp>
+#include <vector>
+#include <cstdint>
+
+/**
+ * The data for a single instance, laid out for a std430 storage buffer.
+ *
+ * This must match ObjectData in bindless.vert.
+ */
+struct SceneInstance {
+    /** The transform of this instance */
+    alignas(16) glm::mat4 model;
+    /** The bounding sphere of the mesh in model space (center, radius) */
+    alignas(16) glm::vec4 bounds;
+    /** The index of the texture in the bindless table */
+    alignas(16) uint32_t texture;
+    /** The index of the draw command for this instance */
+    uint32_t draw;
+};
+
+/**
+ * A scene of mesh instances, submitted with indirect draws.
+ */
+class IndirectScene {
+public:
+    /** A range of the shared index buffer */
+    struct Mesh {
+        /** The number of indices in the mesh */
+        uint32_t indexCount;
+        /** The first index of the mesh */
+        uint32_t firstIndex;
+        /** The value added to each index */
+        int32_t vertexOffset;
+        /** The bounding sphere in model space (center, radius) */
+        glm::vec4 bounds;
+    };
+
+private:
+    /** The meshes in the scene */
+    std::vector<Mesh> meshes;
+    /** The instances, in the order they were added */
+    std::vector<SceneInstance> added;
+    /** The mesh of each added instance */
+    std::vector<uint32_t> addedMeshes;
+    /** The instances, grouped by mesh */
+    std::vector<SceneInstance> instances;
+    /** One indirect command per mesh with instances */
+    std::vector<VkDrawIndexedIndirectCommand> commands;
+
+public:
+    /**
+     * Adds a mesh to the scene, returning its index
+     *
+     * @param indexCount    The number of indices in the mesh
+     * @param firstIndex    The first index of the mesh
+     * @param vertexOffset  The value added to each index
+     * @param bounds        The bounding sphere in model space (center, radius)
+     *
+     * @return the index of the new mesh
+     */
+    uint32_t addMesh(uint32_t indexCount, uint32_t firstIndex, int32_t vertexOffset, const glm::vec4& bounds);
+
+    /**
+     * Adds an instance of a mesh to the scene.
+     *
+     * The instance is not visible in {@link getInstances} until the next
+     * call to {@link build}.
+     *
+     * @param mesh      The mesh index
+     * @param model     The instance transform
+     * @param texture   The index of the texture in the bindless table
+     */
+    void addInstance(uint32_t mesh, const glm::mat4& model, uint32_t texture);
+
+    /**
+     * Removes every instance from the scene, keeping the meshes
+     */
+    void clearInstances();
+
+    /**
+     * Groups the instances by mesh and builds the indirect commands.
+     *
+     * This is a counting sort, so it is linear in the number of instances.
+     * Meshes with no instances do not produce a command. Each instance is
+     * tagged with the index of its command, for GPU culling.
+     */
+    void build();
+
+    /**
+     * Returns the instances grouped by mesh, as built by {@link build}
+     *
+     * @return the instances grouped by mesh
+     */
+    const std::vector<SceneInstance>& getInstances() const { return instances; }
+
+    /**
+     * Returns the indirect commands, as built by {@link build}
+     *
+     * @return the indirect commands
+     */
+    const std::vector<VkDrawIndexedIndirectCommand>& getCommands() const { return commands; }
+
+    /**
+     * Returns the number of instances, as built by {@link build}
+     *
+     * @return the number of instances
+     */
+    uint32_t getInstanceCount() const { return static_cast<uint32_t>(instances.size()); }
+
+    /**
+     * Returns the number of indirect commands, as built by {@link build}
+     *
+     * @return the number of indirect commands
+     */
+    uint32_t getDrawCount() const { return static_cast<uint32_t>(commands.size()); }
+};
+
+#endif /* __INDIRECT_SCENE_H__ */
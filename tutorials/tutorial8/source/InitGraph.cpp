@@ -0,0 +1,326 @@
+//
+//  InitGraph.cpp
+//  Tutorial8
+//
+//  A dependency graph for application startup. Vulkan initialization is a
+//  long list of steps, but most of them only need one or two of the steps
+//  before them. Loading the model and decoding the texture do not need
+//  Vulkan at all, and the pipelines, descriptors, and attachments only need
+//  the device. Running the list in order leaves every other core idle.
+//
+//  Each step names the steps it depends on, and whether it must run on the
+//  main thread. Steps that submit to a queue (or touch the window) must, as
+//  the queue and the command pool are not thread safe. Every other step is
+//  run on the worker pool as soon as its dependencies are done. The graph
+//  also times each step, and saves the timings as a Chrome trace. That can
+//  be opened in chrome://tracing or https://ui.perfetto.dev.
+//
+//  Version: 10/18/26
+//
+#include "InitGraph.h"
+#include <SDL3/SDL.h>
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <stdexcept>
+#include <unordered_map>
+
+/** The start of the program, which every time is measured from */
+static const std::chrono::steady_clock::time_point init_origin = std::chrono::steady_clock::now();
+
+/**
+ * Creates an empty graph that runs its worker steps on the given pool
+ *
+ * The thread that creates the graph is the main thread in the trace.
+ *
+ * @param pool  The worker pool
+ */
+InitGraph::InitGraph(WorkerPool& pool) : pool(pool), running(0), completed(0) {
+    threads.push_back(std::this_thread::get_id());
+}
+
+/**
+ * Adds a step to this graph
+ *
+ * The dependencies may be added later, but they must all be added
+ * before {@link run}.
+ *
+ * @param name          The step name (which must be unique)
+ * @param dependencies  The names of the steps this one depends on
+ * @param thread        Where this step may run
+ * @param task          The work of this step
+ */
+void InitGraph::add(const std::string& name, const std::vector<std::string>& dependencies,
+                    Thread thread, std::function<void()> task) {
+    Step step;
+    step.name = name;
+    step.dependencies = dependencies;
+    step.waiting = 0;
+    step.thread = thread;
+    step.task = std::move(task);
+    steps.push_back(std::move(step));
+}
+
+/**
+ * Runs every step, returning when they are all complete
+ *
+ * The main thread steps run on the calling thread, while it waits on the
+ * worker steps. If a step throws, no further steps are started, and the
+ * first exception is rethrown here once the running steps are done.
+ * This also throws if a dependency is missing, or the steps form a cycle.
+ */
+void InitGraph::run() {
+    std::unordered_map<std::string, size_t> names;
+    for (size_t ii = 0; ii < steps.size(); ii++) {
+        if (!names.emplace(steps[ii].name, ii).second) {
+            throw std::runtime_error("startup step " + steps[ii].name + " is defined twice!");
+        }
+    }
+    for (size_t ii = 0; ii < steps.size(); ii++) {
+        steps[ii].dependents.clear();
+    }
+    for (size_t ii = 0; ii < steps.size(); ii++) {
+        Step& step = steps[ii];
+        step.waiting = step.dependencies.size();
+        for (const auto& dependency : step.dependencies) {
+            auto it = names.find(dependency);
+            if (it == names.end()) {
+                throw std::runtime_error("startup step " + step.name + " depends on missing step " + dependency + "!");
+            }
+            steps[it->second].dependents.push_back(ii);
+        }
+    }
+
+    // Check for cycles before starting anything, as a cycle would never finish
+    std::vector<size_t> waiting(steps.size());
+    std::vector<size_t> order;
+    for (size_t ii = 0; ii < steps.size(); ii++) {
+        waiting[ii] = steps[ii].waiting;
+        if (waiting[ii] == 0) {
+            order.push_back(ii);
+        }
+    }
+    for (size_t pos = 0; pos < order.size(); pos++) {
+        for (size_t dependent : steps[order[pos]].dependents) {
+            if (--waiting[dependent] == 0) {
+                order.push_back(dependent);
+            }
+        }
+    }
+    if (order.size() != steps.size()) {
+        throw std::runtime_error("startup steps depend on each other in a cycle!");
+    }
+
+    std::unique_lock<std::mutex> lock(mutex);
+    running = 0;
+    completed = 0;
+    error = nullptr;
+    mainReady.clear();
+    for (size_t ii = 0; ii < steps.size(); ii++) {
+        if (steps[ii].waiting == 0) {
+            dispatch(ii);
+        }
+    }
+
+    while (completed < steps.size()) {
+        if (error) {
+            // The queued main thread steps will never start now
+            running -= mainReady.size();
+            mainReady.clear();
+            if (running == 0) {
+                break;
+            }
+        } else if (!mainReady.empty()) {
+            size_t next = mainReady.front();
+            mainReady.erase(mainReady.begin());
+            lock.unlock();
+            execute(next);
+            lock.lock();
+            continue;
+        }
+        condition.wait(lock);
+    }
+
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+/**
+ * Starts the given ready step, or queues it for the main thread
+ *
+ * The mutex must be held.
+ *
+ * @param index The step index
+ */
+void InitGraph::dispatch(size_t index) {
+    running++;
+    if (steps[index].thread == Thread::MAIN) {
+        mainReady.push_back(index);
+        condition.notify_all();
+    } else {
+        // Errors are caught by the step, so the future is never needed
+        pool.submit([this, index] { execute(index); });
+    }
+}
+
+/**
+ * Runs the given step, and releases the steps that depend on it
+ *
+ * @param index The step index
+ */
+void InitGraph::execute(size_t index) {
+    Step& step = steps[index];
+    std::exception_ptr failure;
+    double start = now();
+    try {
+        step.task();
+    } catch (...) {
+        failure = std::current_exception();
+    }
+    double end = now();
+
+    std::lock_guard<std::mutex> lock(mutex);
+    timings.push_back({step.name, start, end, getThreadIndex(), false});
+    running--;
+    completed++;
+    if (failure && !error) {
+        error = failure;
+    }
+    if (!error) {
+        for (size_t dependent : step.dependents) {
+            if (--steps[dependent].waiting == 0) {
+                dispatch(dependent);
+            }
+        }
+    }
+    condition.notify_all();
+}
+
+/**
+ * Returns the trace index of the calling thread
+ *
+ * The mutex must be held.
+ *
+ * @return the trace index of the calling thread
+ */
+uint32_t InitGraph::getThreadIndex() {
+    std::thread::id id = std::this_thread::get_id();
+    auto it = std::find(threads.begin(), threads.end(), id);
+    if (it == threads.end()) {
+        threads.push_back(id);
+        return static_cast<uint32_t>(threads.size() - 1);
+    }
+    return static_cast<uint32_t>(it - threads.begin());
+}
+
+/**
+ * Records an event at the current time, such as the first frame
+ *
+ * @param name  The event name
+ *
+ * @return the time of the event in microseconds since the program started
+ */
+double InitGraph::mark(const std::string& name) {
+    double time = now();
+    std::lock_guard<std::mutex> lock(mutex);
+    timings.push_back({name, time, time, getThreadIndex(), true});
+    return time;
+}
+
+/**
+ * Returns the time in microseconds since the program started
+ *
+ * @return the time in microseconds since the program started
+ */
+double InitGraph::now() {
+    auto elapsed = std::chrono::steady_clock::now() - init_origin;
+    return std::chrono::duration<double, std::micro>(elapsed).count();
+}
+
+/**
+ * Logs the time of each step, and how much of it ran in parallel
+ */
+void InitGraph::logTimings() {
+    std::vector<Timing> sorted;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        sorted = timings;
+    }
+    std::stable_sort(sorted.begin(), sorted.end(), [](const Timing& a, const Timing& b) {
+        return a.start < b.start;
+    });
+
+    // The work is the total time of the steps, and the span is the time they took together
+    double first = 0;
+    double last = 0;
+    double work = 0;
+    bool started = false;
+    for (const auto& timing : sorted) {
+        if (timing.event) {
+            SDL_Log("Startup: %-24s at %9.3f ms", timing.name.c_str(), timing.start / 1000.0);
+            continue;
+        }
+        SDL_Log("Startup: %-24s at %9.3f ms for %8.3f ms (%s %u)", timing.name.c_str(), timing.start / 1000.0,
+                (timing.end - timing.start) / 1000.0, timing.thread == 0 ? "main" : "worker", timing.thread);
+        first = started ? std::min(first, timing.start) : timing.start;
+        last = started ? std::max(last, timing.end) : timing.end;
+        work += timing.end - timing.start;
+        started = true;
+    }
+    if (started && last > first) {
+        SDL_Log("Startup: %.3f ms of steps in %.3f ms (%.2fx parallel)", work / 1000.0,
+                (last - first) / 1000.0, work / (last - first));
+    }
+}
+
+/**
+ * Saves the steps and events as a Chrome trace
+ *
+ * @param path  The file to write
+ *
+ * @return true if the file was written
+ */
+bool InitGraph::writeTrace(const std::string& path) {
+    std::ofstream file(path);
+    if (!file.is_open()) {
+        SDL_Log("Failed to write startup trace %s", path.c_str());
+        return false;
+    }
+
+    std::vector<Timing> copy;
+    size_t threadCount;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        copy = timings;
+        threadCount = threads.size();
+    }
+
+    char buffer[160];
+    file << "{\"traceEvents\":[\n";
+    file << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"Startup\"}}";
+    for (size_t ii = 0; ii < threadCount; ii++) {
+        if (ii == 0) {
+            snprintf(buffer, sizeof(buffer), "main");
+        } else {
+            snprintf(buffer, sizeof(buffer), "worker %zu", ii);
+        }
+        file << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << ii
+             << ",\"args\":{\"name\":\"" << buffer << "\"}}";
+    }
+    for (const auto& timing : copy) {
+        if (timing.event) {
+            // A global instant event draws a line across every thread
+            snprintf(buffer, sizeof(buffer), "\"ph\":\"i\",\"s\":\"g\",\"pid\":1,\"tid\":%u,\"ts\":%.3f}",
+                     timing.thread, timing.start);
+        } else {
+            snprintf(buffer, sizeof(buffer), "\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+                     timing.thread, timing.start, timing.end - timing.start);
+        }
+        file << ",\n{\"name\":\"" << timing.name << "\",\"cat\":\"startup\"," << buffer;
+    }
+    file << "\n],\"displayTimeUnit\":\"ms\"}\n";
+
+    SDL_Log("Wrote %zu startup timings to %s", copy.size(), path.c_str());
+    return file.good();
+}
@@ -0,0 +1,198 @@
+//
+//  InitGraph.h
+//  Tutorial8
+//
+//  A dependency graph for application startup. Vulkan initialization is a
+//  long list of steps, but most of them only need one or two of the steps
+//  before them. Loading the model and decoding the texture do not need
+//  Vulkan at all, and the pipelines, descriptors, and attachments only need
+//  the device. Running the list in order leaves every other core idle.
+//
+//  Each step names the steps it depends on, and whether it must run on the
+//  main thread. Steps that submit to a queue (or touch the window) must, as
+//  the queue and the command pool are not thread safe. Every other step is
+//  run on the worker pool as soon as its dependencies are done. The graph
+//  also times each step, and saves the timings as a Chrome trace. That can
+//  be opened in chrome://tracing or https://ui.perfetto.dev.
+//
+//  Version: 10/18/26
+//
+#ifndef __INIT_GRAPH_H__
+#define __INIT_GRAPH_H__
+#include "WorkerPool.h"
+#include <string>
+#include <vector>
+#include <functional>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include <cstdint>
+
+/**
+ * A graph of startup steps, run on the main thread and a worker pool.
+ *
+ * Steps are added in any order, and run once with {@link run}. A step is
+ * started once all of its dependencies have completed, so a step may read
+ * anything its dependencies wrote without further synchronization. Steps
+ * that share no dependency must not write the same state.
+ *
+ * The graph also keeps the times of any events marked after it runs (such
+ * as the first frame), so that the trace covers the whole startup.
+ */
+class InitGraph {
+public:
+    /** Where a step may run */
+    enum class Thread {
+        /** The thread that calls {@link run} (for queue, pool, and window access) */
+        MAIN,
+        /** Any thread of the worker pool */
+        WORKER
+    };
+
+    /** The timing of a step (or an event) in microseconds since the program started */
+    struct Timing {
+        /** The step name */
+        std::string name;
+        /** The start of the step */
+        double start;
+        /** The end of the step (the same as the start for an event) */
+        double end;
+        /** The thread that ran the step (0 is the main thread) */
+        uint32_t thread;
+        /** Whether this is an event marked with {@link mark} */
+        bool event;
+    };
+
+private:
+    /** A step in the graph */
+    struct Step {
+        /** The step name */
+        std::string name;
+        /** The names of the steps this one depends on */
+        std::vector<std::string> dependencies;
+        /** The steps that depend on this one */
+        std::vector<size_t> dependents;
+        /** The number of dependencies not yet complete */
+        size_t waiting;
+        /** Where this step may run */
+        Thread thread;
+        /** The work of this step */
+        std::function<void()> task;
+    };
+
+    /** The worker pool */
+    WorkerPool& pool;
+    /** The steps, in the order they were added */
+    std::vector<Step> steps;
+    /** The timings of the steps (in the order they completed) and events */
+    std::vector<Timing> timings;
+    /** The threads that have run a step, indexed in the trace by their order */
+    std::vector<std::thread::id> threads;
+
+    /** Mutex protecting the step state and timings */
+    std::mutex mutex;
+    /** Condition variable to wake the main thread */
+    std::condition_variable condition;
+    /** The main thread steps ready to run */
+    std::vector<size_t> mainReady;
+    /** The number of steps started and not yet complete */
+    size_t running;
+    /** The number of steps complete */
+    size_t completed;
+    /** The first error thrown by a step */
+    std::exception_ptr error;
+
+    /**
+     * Starts the given ready step, or queues it for the main thread
+     *
+     * The mutex must be held.
+     *
+     * @param index The step index
+     */
+    void dispatch(size_t index);
+
+    /**
+     * Runs the given step, and releases the steps that depend on it
+     *
+     * @param index The step index
+     */
+    void execute(size_t index);
+
+    /**
+     * Returns the trace index of the calling thread
+     *
+     * The mutex must be held.
+     *
+     * @return the trace index of the calling thread
+     */
+    uint32_t getThreadIndex();
+
+public:
+    /**
+     * Creates an empty graph that runs its worker steps on the given pool
+     *
+     * The thread that creates the graph is the main thread in the trace.
+     *
+     * @param pool  The worker pool
+     */
+    InitGraph(WorkerPool& pool);
+
+    InitGraph(const InitGraph&) = delete;
+    InitGraph& operator=(const InitGraph&) = delete;
+
+    /**
+     * Adds a step to this graph
+     *
+     * The dependencies may be added later, but they must all be added
+     * before {@link run}.
+     *
+     * @param name          The step name (which must be unique)
+     * @param dependencies  The names of the steps this one depends on
+     * @param thread        Where this step may run
+     * @param task          The work of this step
+     */
+    void add(const std::string& name, const std::vector<std::string>& dependencies,
+             Thread thread, std::function<void()> task);
+
+    /**
+     * Runs every step, returning when they are all complete
+     *
+     * The main thread steps run on the calling thread, while it waits on the
+     * worker steps. If a step throws, no further steps are started, and the
+     * first exception is rethrown here once the running steps are done.
+     * This also throws if a dependency is missing, or the steps form a cycle.
+     */
+    void run();
+
+    /**
+     * Records an event at the current time, such as the first frame
+     *
+     * @param name  The event name
+     *
+     * @return the time of the event in microseconds since the program started
+     */
+    double mark(const std::string& name);
+
+    /**
+     * Returns the time in microseconds since the program started
+     *
+     * @return the time in microseconds since the program started
+     */
+    static double now();
+
+    /**
+     * Logs the time of each step, and how much of it ran in parallel
+     */
+    void logTimings();
+
+    /**
+     * Saves the steps and events as a Chrome trace
+     *
+     * @param path  The file to write
+     *
+     * @return true if the file was written
+     */
+    bool writeTrace(const std::string& path);
+};
+
+#endif /* __INIT_GRAPH_H__ */
@@ -9,7 +9,7 @@
 #include <SDL3/SDL_main.h>
 #include <SDL3/SDL_app.h>
 #include <SDL3/SDL_vulkan.h>
-#include <vulkan/vulkan.h>
+#include "VulkanLoader.h"
 
 #define GLM_FORCE_RADIANS
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
@@ -23,17 +23,33 @@
 #include <stdexcept>
 #include <algorithm>
 #include <chrono>
+#include <functional>
 #include <vector>
+#include <string>
 #include <cstring>
 #include <cstdlib>
+#include <cmath>
 #include <cstdint>
 #include <limits>
 #include <array>
+#include <memory>
 #include <optional>
+#include <cstddef>
 #include <set>
 #include <unordered_map>
 
 #include <image.h>
+#include "MipmapBuilder.h"
+#include "WorkerPool.h"
+#include "ParallelRecorder.h"
+#include "BindlessTable.h"
+#include "DescriptorAllocator.h"
+#include "PipelineService.h"
+#include "IndirectScene.h"
+#include "OcclusionCuller.h"
+#include "InitGraph.h"
+#include "OffscreenTarget.h"
+#include "BenchReport.h"
 
 #define TINYOBJLOADER_IMPLEMENTATION
 #include <tiny_obj_loader.h>
@@ -66,8 +82,25 @@ const uint32_t HEIGHT = 600;
 const std::string MODEL_PATH = "models/viking_room.obj";
 const std::string TEXTURE_PATH = "textures/viking_room.png";
 
+// Every compiled shader (see compile.sh), read while the device is created
+const char* const SHADER_FILES[] = {
+    "shaders/vert.spv", "shaders/frag.spv", "shaders/mipmap.spv",
+    "shaders/bindless_vert.spv", "shaders/bindless_frag.spv", "shaders/bindless_cull_vert.spv",
+    "shaders/mipmap_hiz.spv", "shaders/depthreduce.spv", "shaders/depthreduce_ms.spv", "shaders/cull.spv"
+};
+
 const int MAX_FRAMES_IN_FLIGHT = 2;
 
+// Headless runs step a fixed clock, so that every run draws the same frames
+const float HEADLESS_FRAME_TIME = 1000.0f / 60.0f;
+
+const uint32_t MIPMAP_MAX_LEVELS = 12;
+const uint32_t MIPMAP_TILE_SIZE = 64;
+const uint32_t MIPMAP_TILE_LEVELS = 6;
+const uint32_t MAX_BINDLESS_TEXTURES = 4096;
+const uint32_t MAX_SCENE_INSTANCES = 1000000;
+const float SCENE_SPACING = 2.5f;
+
 const std::vector<const char*> validationLayers = {
     "VK_LAYER_KHRONOS_validation"
 };
@@ -181,22 +214,63 @@ struct UniformBufferObject {
     alignas(16) glm::mat4 proj;
 };
 
+/**
+ * The per-draw data of the non-bindless path, pushed with vkCmdPushConstants.
+ *
+ * This must match DrawConstants in shader.vert. At 72 bytes, it fits in the
+ * 128 bytes of push constants that every device guarantees.
+ */
+struct DrawConstants {
+    /** The object transform, applied before the shared model matrix */
+    glm::mat4 model;
+    /** The material (texture) index of the object */
+    uint32_t material;
+    /** The index of the draw in the frame */
+    uint32_t drawId;
+};
+
+/** The descriptors of the per-frame set, written with a single template update */
+struct FrameBindings {
+    VkDescriptorBufferInfo uniforms;
+    VkDescriptorImageInfo texture;
+    VkDescriptorBufferInfo objects;
+    VkDescriptorBufferInfo visible;
+};
+
+/** The reduction applied by the compute downsampler (see mipmap.comp) */
+enum MipmapReduction : uint32_t {
+    MIPMAP_AVERAGE = 0,
+    MIPMAP_MIN = 1,
+    MIPMAP_MAX = 2
+};
+
+/** The push constants for the compute downsampler (see mipmap.comp) */
+struct MipmapParameters {
+    glm::ivec2 extent;
+    uint32_t levels;
+    uint32_t workgroups;
+    uint32_t mode;
+    uint32_t srgb;
+};
+
 class ModelApplication {
 private:
     SDL_Window* window;
     
     VkInstance instance;
     VkDebugUtilsMessengerEXT debugMessenger;
-    VkSurfaceKHR surface;
+    VkSurfaceKHR surface = VK_NULL_HANDLE;
     
     VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
+    QueueFamilyIndices familyIndices;
     VkSampleCountFlagBits msaaSamples = VK_SAMPLE_COUNT_1_BIT;
+    uint32_t instanceVersion = VK_API_VERSION_1_0;
     VkDevice device;
     
     VkQueue graphicsQueue;
     VkQueue presentQueue;
     
-    VkSwapchainKHR swapChain;
+    VkSwapchainKHR swapChain = VK_NULL_HANDLE;
     std::vector<VkImage> swapChainImages;
     VkFormat swapChainImageFormat;
     VkExtent2D swapChainExtent;
@@ -206,7 +280,28 @@ private:
     VkRenderPass renderPass;
     VkDescriptorSetLayout descriptorSetLayout;
     VkPipelineLayout pipelineLayout;
-    VkPipeline graphicsPipeline;
+    VkPipeline graphicsPipeline = VK_NULL_HANDLE;
+    
+    // Pipelines compile in the background (draws are skipped until ready)
+    bool pipelineLibraries = false;
+    std::unique_ptr<PipelineService> pipelines;
+    GraphicsPipelineState graphicsPipelineState;
+    PipelineService::Request graphicsPipelineRequest;
+    
+    // Single pass compute downsampler (replaces the blit chain when supported)
+    bool computeMipmaps = false;
+    bool blitMipmaps = false;
+    VkDescriptorSetLayout mipmapSetLayout = VK_NULL_HANDLE;
+    VkPipelineLayout mipmapPipelineLayout = VK_NULL_HANDLE;
+    PipelineService::Request mipmapPipelineRequest;
+    VkBuffer mipmapCounterBuffer = VK_NULL_HANDLE;
+    VkDeviceMemory mipmapCounterMemory = VK_NULL_HANDLE;
+    
+    // Descriptor indexing (falls back to the tutorial bindings when unsupported)
+    bool bindless = false;
+    uint32_t bindlessCapacity = 0;
+    std::unique_ptr<BindlessTable> bindlessTable;
+    uint32_t textureIndex = 0;
     
     VkCommandPool commandPool;
     
@@ -219,6 +314,10 @@ private:
     VkImageView depthImageView;
     
     uint32_t mipLevels;
+    uint8_t* texturePixels = nullptr;
+    int textureWidth = 0;
+    int textureHeight = 0;
+    VkExtent2D textureSize = {0, 0};
     VkImage textureImage;
     VkDeviceMemory textureImageMemory;
     VkImageView textureImageView;
@@ -235,10 +334,42 @@ private:
     std::vector<VkDeviceMemory> uniformBuffersMemory;
     std::vector<void*> uniformBuffersMapped;
     
-    VkDescriptorPool descriptorPool;
+    // Instanced scene drawn with indirect commands (requires the bindless path)
+    IndirectScene scene;
+    uint32_t sceneSize = 1;
+    uint32_t sceneSide = 1;
+    float sceneExtent = 0.0f;
+    bool multiDrawIndirect = false;
+    bool indirectCount = false;
+    PFN_vkCmdDrawIndexedIndirectCountKHR drawIndexedIndirectCount = nullptr;
+    VkBuffer instanceBuffer = VK_NULL_HANDLE;
+    VkDeviceMemory instanceBufferMemory = VK_NULL_HANDLE;
+    VkBuffer indirectBuffer = VK_NULL_HANDLE;
+    VkDeviceMemory indirectBufferMemory = VK_NULL_HANDLE;
+    VkDeviceSize drawCountOffset = 0;
+    
+    // GPU frustum and Hi-Z occlusion culling (splits the render pass in two)
+    bool cullingEnabled = true;
+    bool occlusionCulling = false;
+    bool cullingStats = false;
+    Uint64 cullingLogTime = 0;
+    VkRenderPass lateRenderPass = VK_NULL_HANDLE;
+    std::unique_ptr<OcclusionCuller> culler;
+    
+    // Per-frame sets are reallocated each frame (or pushed, if supported)
+    bool updateTemplates = false;
+    bool pushDescriptors = false;
+    std::unique_ptr<DescriptorLayoutCache> layoutCache;
+    std::vector<std::unique_ptr<DescriptorAllocator>> frameAllocators;
+    std::unique_ptr<DescriptorTemplate> frameTemplate;
+    std::vector<FrameBindings> frameBindings;
     std::vector<VkDescriptorSet> descriptorSets;
     
-    std::vector<VkCommandBuffer> commandBuffers;
+    // Per-thread, per-frame command pools (replaces the tutorial command buffers)
+    std::unique_ptr<ParallelRecorder> recorder;
+    uint32_t drawCount = 1;
+    // The object transforms of the non-bindless path, pushed per draw
+    std::vector<glm::mat4> drawTransforms;
     
     std::vector<VkSemaphore> imageAvailableSemaphores;
     std::vector<VkSemaphore> renderFinishedSemaphores;
@@ -248,7 +379,38 @@ private:
     bool framebufferResized = false;
     VkExtent2D windowExtent;
     
+    // Headless runs render this many frames offscreen, with no window or surface
+    uint32_t headlessFrames = 0;
+    uint32_t headlessRendered = 0;
+    double headlessStart = 0.0;
+    std::string screenshotPath;
+    VkExtent2D headlessExtent = {WIDTH, HEIGHT};
+    std::unique_ptr<OffscreenTarget> offscreenTarget;
+    // Benchmark runs also time every headless frame, and save the results here
+    std::unique_ptr<BenchReport> benchReport;
+    std::string benchPath;
+    bool memoryBudgetEnabled = false;
+    
+    bool isHeadless() {
+        return headlessFrames > 0;
+    }
+    
+    // Startup runs as a graph of steps (see initVulkan), timed up to the first frame
+    std::unique_ptr<InitGraph> startup;
+    std::string startupTracePath;
+    bool firstFrameMarked = false;
+    // The shader files, read by the startup steps ahead of the pipelines
+    std::unordered_map<std::string, std::shared_ptr<const std::vector<char>>> shaderCode;
+    
     bool initWindow() {
+        if (isHeadless()) {
+            // Vulkan is used without the video subsystem, which needs a display
+            SDL_Init(0);
+            window = NULL;
+            windowExtent = headlessExtent;
+            return true;
+        }
+        
         SDL_Init(SDL_INIT_VIDEO);
         
         if (!SDL_Vulkan_LoadLibrary(nullptr)) {
@@ -274,33 +436,75 @@ private:
         return true;
     }
     
+    /**
+     * Initializes Vulkan as a graph of startup steps.
+     *
+     * Each step starts as soon as the steps it needs are done. Reading the
+     * model, texture, and shaders needs no Vulkan at all, so those start
+     * right away on the worker pool. So do the steps that only create
+     * objects, which are thread safe. The steps that submit to the queue (or
+     * use the command pool, or the window) run on this thread instead.
+     */
     bool initVulkan() {
+        const InitGraph::Thread MAIN = InitGraph::Thread::MAIN;
+        const InitGraph::Thread WORKER = InitGraph::Thread::WORKER;
+        InitGraph& graph = *startup;
+        
+        // Files do not need Vulkan. SDL caches the base path on first use, so look it up before they race.
+        get_asset("");
+        graph.add("loadModel", {}, WORKER, [this] { loadModel(); });
+        graph.add("decodeTexture", {}, WORKER, [this] { decodeTexture(); });
+        std::vector<std::string> shaderSteps;
+        for (const char* path : SHADER_FILES) {
+            shaderCode[path] = nullptr;
+            shaderSteps.push_back(std::string("read ") + path);
+            graph.add(shaderSteps.back(), {}, WORKER, [this, path] { preloadShader(path); });
+        }
+        graph.add("readShaders", shaderSteps, WORKER, [] {});
+        
+        // The device needs the surface, and so the window
+        graph.add("createInstance", {}, MAIN, [this] { createInstance(); setupDebugMessenger(); });
+        graph.add("createSurface", {"createInstance"}, MAIN, [this] { createSurface(); });
+        graph.add("pickPhysicalDevice", {"createSurface"}, MAIN, [this] { pickPhysicalDevice(); });
+        graph.add("createLogicalDevice", {"pickPhysicalDevice"}, MAIN, [this] { createLogicalDevice(); });
+        graph.add("createSwapChain", {"createLogicalDevice"}, MAIN, [this] { createSwapChain(); createImageViews(); });
+        
+        // These only create objects, so they run on the workers
+        graph.add("createPipelineService", {"createLogicalDevice"}, WORKER, [this] { createPipelineService(); });
+        graph.add("createDescriptorSetLayout", {"createLogicalDevice"}, WORKER, [this] { createDescriptorSetLayout(); });
+        graph.add("createCommandPool", {"createLogicalDevice"}, WORKER, [this] { createCommandPool(); });
+        graph.add("createUniformBuffers", {"createLogicalDevice"}, WORKER, [this] { createUniformBuffers(); });
+        graph.add("createDescriptorPool", {"createLogicalDevice"}, WORKER, [this] { createDescriptorPool(); });
+        graph.add("createCommandBuffers", {"createLogicalDevice"}, WORKER, [this] { createCommandBuffers(); });
+        graph.add("createTextureSampler", {"createLogicalDevice", "decodeTexture"}, WORKER, [this] { createTextureSampler(); });
+        graph.add("createRenderPass", {"createSwapChain"}, WORKER, [this] { createRenderPass(); });
+        graph.add("createColorResources", {"createSwapChain"}, WORKER, [this] { createColorResources(); });
+        graph.add("createDepthResources", {"createSwapChain"}, WORKER, [this] { createDepthResources(); });
+        graph.add("createSyncObjects", {"createSwapChain"}, WORKER, [this] { createSyncObjects(); });
+        graph.add("createFramebuffers", {"createRenderPass", "createColorResources", "createDepthResources"}, WORKER,
+                  [this] { createFramebuffers(); });
+        graph.add("createGraphicsPipeline", {"createRenderPass", "createDescriptorSetLayout", "createPipelineService", "readShaders"}, WORKER,
+                  [this] { createGraphicsPipeline(); });
+        
+        // Uploads go through the graphics queue, so they stay on this thread
+        graph.add("createMipmapPipeline", {"createCommandPool", "createPipelineService", "readShaders"}, MAIN,
+                  [this] { createMipmapPipeline(); });
+        graph.add("createTextureImage", {"decodeTexture", "createMipmapPipeline"}, MAIN, [this] { createTextureImage(); });
+        graph.add("createVertexBuffer", {"loadModel", "createCommandPool"}, MAIN, [this] { createVertexBuffer(); });
+        graph.add("createIndexBuffer", {"loadModel", "createCommandPool"}, MAIN, [this] { createIndexBuffer(); });
+        graph.add("createTextureImageView", {"createTextureImage"}, WORKER, [this] { createTextureImageView(); });
+        graph.add("createSceneBuffers", {"loadModel", "createCommandPool", "createDescriptorSetLayout", "createTextureImageView", "createTextureSampler"}, MAIN,
+                  [this] { createSceneBuffers(); });
+        
+        // The descriptors come last, as they refer to nearly everything else
+        graph.add("createOcclusionCuller", {"createSceneBuffers", "createUniformBuffers", "createDepthResources", "createPipelineService", "readShaders"}, WORKER,
+                  [this] { createOcclusionCuller(); });
+        graph.add("createDescriptorSets", {"createUniformBuffers", "createTextureImageView", "createTextureSampler", "createSceneBuffers",
+                                           "createOcclusionCuller", "createGraphicsPipeline", "createDescriptorPool"}, WORKER,
+                  [this] { createDescriptorSets(); });
+        
         try {
-            createInstance();
-            setupDebugMessenger();
-            createSurface();
-            pickPhysicalDevice();
-            createLogicalDevice();
-            createSwapChain();
-            createImageViews();
-            createRenderPass();
-            createDescriptorSetLayout();
-            createGraphicsPipeline();
-            createCommandPool();
-            createColorResources();
-            createDepthResources();
-            createFramebuffers();
-            createTextureImage();
-            createTextureImageView();
-            createTextureSampler();
-            loadModel();
-            createVertexBuffer();
-            createIndexBuffer();
-            createUniformBuffers();
-            createDescriptorPool();
-            createDescriptorSets();
-            createCommandBuffers();
-            createSyncObjects();
+            graph.run();
         } catch (const std::exception& e) {
             std::cerr << e.what() << std::endl;
             return false;
@@ -325,7 +529,9 @@ private:
             vkDestroyImageView(device, imageView, nullptr);
         }
         
-        vkDestroySwapchainKHR(device, swapChain, nullptr);
+        if (swapChain != VK_NULL_HANDLE) {
+            vkDestroySwapchainKHR(device, swapChain, nullptr);
+        }
         
         // Despite the tutorial, it is not safe to reuse these semaphores
         for (size_t ii = 0; ii < renderFinishedSemaphores.size(); ii++) {
@@ -342,16 +548,32 @@ private:
     void cleanup() {
         cleanupSwapChain();
         
-        vkDestroyPipeline(device, graphicsPipeline, nullptr);
+        frameTemplate.reset();
+        
+        savePipelineCache();
+        pipelines.reset();
+        culler.reset();
         vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
         vkDestroyRenderPass(device, renderPass, nullptr);
+        if (lateRenderPass != VK_NULL_HANDLE) {
+            vkDestroyRenderPass(device, lateRenderPass, nullptr);
+        }
+        
+        cleanupMipmapPipeline();
         
         for (size_t i = 0; i < uniformBuffers.size(); i++) {
             vkDestroyBuffer(device, uniformBuffers[i], nullptr);
             vkFreeMemory(device, uniformBuffersMemory[i], nullptr);
         }
+        if (bindless) {
+            vkDestroyBuffer(device, instanceBuffer, nullptr);
+            vkFreeMemory(device, instanceBufferMemory, nullptr);
+            vkDestroyBuffer(device, indirectBuffer, nullptr);
+            vkFreeMemory(device, indirectBufferMemory, nullptr);
+        }
         
-        vkDestroyDescriptorPool(device, descriptorPool, nullptr);
+        frameAllocators.clear();
+        bindlessTable.reset();
         
         vkDestroySampler(device, textureSampler, nullptr);
         vkDestroyImageView(device, textureImageView, nullptr);
@@ -359,7 +581,7 @@ private:
         vkDestroyImage(device, textureImage, nullptr);
         vkFreeMemory(device, textureImageMemory, nullptr);
         
-        vkDestroyDescriptorSetLayout(device, descriptorSetLayout, nullptr);
+        layoutCache.reset();
         
         vkDestroyBuffer(device, indexBuffer, nullptr);
         vkFreeMemory(device, indexBufferMemory, nullptr);
@@ -367,8 +589,10 @@ private:
         vkDestroyBuffer(device, vertexBuffer, nullptr);
         vkFreeMemory(device, vertexBufferMemory, nullptr);
         
+        recorder.reset();
         vkDestroyCommandPool(device, commandPool, nullptr);
         
+        offscreenTarget.reset();
         vkDestroyDevice(device, nullptr);
         
         if (enableValidationLayers) {
@@ -377,8 +601,11 @@ private:
         
         vkDestroySurfaceKHR(instance, surface, nullptr);
         vkDestroyInstance(instance, nullptr);
+        VulkanLoader::dispose();
         
-        SDL_DestroyWindow(window);
+        if (window != NULL) {
+            SDL_DestroyWindow(window);
+        }
         SDL_Quit();
     }
     
@@ -395,9 +622,16 @@ private:
         createFramebuffers();
         createSyncObjects();
         
+        if (culler != nullptr) {
+            culler->resize(depthImage, depthImageView, swapChainExtent);
+        }
     }
     
     void createInstance() {
+        if (!VulkanLoader::init()) {
+            throw std::runtime_error("failed to load Vulkan!");
+        }
+
         if (enableValidationLayers && !checkValidationLayerSupport()) {
             throw std::runtime_error("validation layers requested, but not available!");
         }
@@ -422,6 +656,7 @@ private:
         appInfo.pEngineName = "No Engine";
         appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
         appInfo.apiVersion = std::min(loaderVersion, desiredVersion);
+        instanceVersion = appInfo.apiVersion;
         
         VkInstanceCreateInfo createInfo{};
         createInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
@@ -457,6 +692,7 @@ private:
         if (vkCreateInstance(&createInfo, nullptr, &instance) != VK_SUCCESS) {
             throw std::runtime_error("failed to create instance!");
         }
+        VulkanLoader::loadInstance(instance);
     }
     
     void populateDebugMessengerCreateInfo(VkDebugUtilsMessengerCreateInfoEXT& createInfo) {
@@ -479,6 +715,9 @@ private:
     }
     
     void createSurface() {
+        if (isHeadless()) {
+            return;
+        }
         if (!SDL_Vulkan_CreateSurface(window, instance, NULL, &surface)) {
             throw std::runtime_error("failed to create window surface!");
         }
@@ -495,11 +734,13 @@ private:
         std::vector<VkPhysicalDevice> devices(deviceCount);
         vkEnumeratePhysicalDevices(instance, &deviceCount, devices.data());
         
+        // Take the best suitable device, not the first (which may be software)
+        uint64_t bestScore = 0;
         for (const auto& device : devices) {
-            if (isDeviceSuitable(device)) {
+            uint64_t score = rateDevice(device);
+            if (score > bestScore) {
                 physicalDevice = device;
-                msaaSamples = getMaxUsableSampleCount();
-                break;
+                bestScore = score;
             }
         }
         
@@ -507,13 +748,77 @@ private:
             throw std::runtime_error("failed to find a suitable GPU!");
         }
         
+        // The families are looked up once, so that the workers never query the surface
+        familyIndices = findQueueFamilies(physicalDevice);
+        msaaSamples = getMaxUsableSampleCount();
+        computeMipmaps = checkComputeMipmapSupport();
+        bindless = checkBindlessSupport();
+        updateTemplates = checkUpdateTemplateSupport();
+        pushDescriptors = updateTemplates && checkDeviceExtension(VK_KHR_PUSH_DESCRIPTOR_EXTENSION_NAME);
+        pipelineLibraries = checkPipelineLibrarySupport();
+        multiDrawIndirect = checkMultiDrawIndirectSupport();
+        indirectCount = checkDeviceExtension(VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
+        occlusionCulling = cullingEnabled && bindless && computeMipmaps && checkOcclusionCullingSupport();
+        
         VkPhysicalDeviceProperties props;
         vkGetPhysicalDeviceProperties(physicalDevice, &props);
         print_version(props.deviceName,props.apiVersion);
     }
     
+    /**
+     * Returns a score for the given device, or 0 if it is not suitable.
+     *
+     * The device type matters most: discrete GPUs beat integrated ones,
+     * which beat virtual and software devices. Within a type, the score
+     * favors more device local memory, larger textures, more samples, and a
+     * single queue family that can both draw and present (so that the swap
+     * chain images are not shared between families).
+     */
+    uint64_t rateDevice(VkPhysicalDevice device) {
+        if (!isDeviceSuitable(device)) {
+            return 0;
+        }
+        
+        VkPhysicalDeviceProperties properties;
+        vkGetPhysicalDeviceProperties(device, &properties);
+        
+        uint64_t score = 1;
+        switch (properties.deviceType) {
+            case VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU:
+                score += 4000000;
+                break;
+            case VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU:
+                score += 3000000;
+                break;
+            case VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU:
+                score += 2000000;
+                break;
+            default:
+                break;
+        }
+        
+        // Each of these adds less than the gap between device types
+        VkPhysicalDeviceMemoryProperties memory;
+        vkGetPhysicalDeviceMemoryProperties(device, &memory);
+        VkDeviceSize localMemory = 0;
+        for (uint32_t ii = 0; ii < memory.memoryHeapCount; ii++) {
+            if (memory.memoryHeaps[ii].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) {
+                localMemory = std::max(localMemory, memory.memoryHeaps[ii].size);
+            }
+        }
+        score += std::min<uint64_t>(localMemory >> 20, 500000);
+        score += std::min<uint64_t>(properties.limits.maxImageDimension2D, 65536);
+        score += 1000 * (properties.limits.framebufferColorSampleCounts & properties.limits.framebufferDepthSampleCounts & 0x7F);
+        
+        QueueFamilyIndices indices = findQueueFamilies(device);
+        if (indices.graphicsFamily == indices.presentFamily) {
+            score += 100000;
+        }
+        return score;
+    }
+    
     void createLogicalDevice() {
-        QueueFamilyIndices indices = findQueueFamilies(physicalDevice);
+        QueueFamilyIndices indices = familyIndices;
         
         std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
         std::set<uint32_t> uniqueQueueFamilies = {indices.graphicsFamily.value(), indices.presentFamily.value()};
@@ -530,6 +835,8 @@ private:
         
         VkPhysicalDeviceFeatures deviceFeatures{};
         deviceFeatures.samplerAnisotropy = VK_TRUE;
+        deviceFeatures.shaderStorageImageArrayDynamicIndexing = computeMipmaps ? VK_TRUE : VK_FALSE;
+        deviceFeatures.multiDrawIndirect = multiDrawIndirect ? VK_TRUE : VK_FALSE;
         
         VkDeviceCreateInfo createInfo{};
         createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
@@ -539,7 +846,45 @@ private:
         
         createInfo.pEnabledFeatures = &deviceFeatures;
         
-        std::vector<const char*> extensions = deviceExtensions;
+        VkPhysicalDeviceDescriptorIndexingFeatures indexingFeatures{};
+        indexingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES;
+        if (bindless) {
+            indexingFeatures.runtimeDescriptorArray = VK_TRUE;
+            indexingFeatures.descriptorBindingPartiallyBound = VK_TRUE;
+            indexingFeatures.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+            indexingFeatures.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+            indexingFeatures.pNext = const_cast<void*>(createInfo.pNext);
+            createInfo.pNext = &indexingFeatures;
+        }
+        
+        VkPhysicalDeviceGraphicsPipelineLibraryFeaturesEXT libraryFeatures{};
+        libraryFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_GRAPHICS_PIPELINE_LIBRARY_FEATURES_EXT;
+        if (pipelineLibraries) {
+            libraryFeatures.graphicsPipelineLibrary = VK_TRUE;
+            libraryFeatures.pNext = const_cast<void*>(createInfo.pNext);
+            createInfo.pNext = &libraryFeatures;
+        }
+        
+        // Nothing is presented in headless mode, so there is no swapchain either
+        std::vector<const char*> extensions;
+        if (!isHeadless()) {
+            extensions = deviceExtensions;
+        }
+        // The device memory use is only reported to benchmarks
+        memoryBudgetEnabled = benchReport != nullptr && BenchReport::isDeviceMemorySupported(physicalDevice);
+        if (memoryBudgetEnabled) {
+            extensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+        }
+        if (pushDescriptors) {
+            extensions.push_back(VK_KHR_PUSH_DESCRIPTOR_EXTENSION_NAME);
+        }
+        if (pipelineLibraries) {
+            extensions.push_back(VK_KHR_PIPELINE_LIBRARY_EXTENSION_NAME);
+            extensions.push_back(VK_EXT_GRAPHICS_PIPELINE_LIBRARY_EXTENSION_NAME);
+        }
+        if (indirectCount) {
+            extensions.push_back(VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
+        }
         
 #ifdef USE_MOLTEN
         extensions.push_back("VK_KHR_portability_subset");
@@ -558,12 +903,24 @@ private:
         if (vkCreateDevice(physicalDevice, &createInfo, nullptr, &device) != VK_SUCCESS) {
             throw std::runtime_error("failed to create logical device!");
         }
+        VulkanLoader::loadDevice(device);
         
         vkGetDeviceQueue(device, indices.graphicsFamily.value(), 0, &graphicsQueue);
         vkGetDeviceQueue(device, indices.presentFamily.value(), 0, &presentQueue);
+        
+        // Extension commands are not exported by the loader
+        if (indirectCount) {
+            drawIndexedIndirectCount = (PFN_vkCmdDrawIndexedIndirectCountKHR) vkGetDeviceProcAddr(device, "vkCmdDrawIndexedIndirectCountKHR");
+            indirectCount = drawIndexedIndirectCount != nullptr;
+        }
     }
     
     void createSwapChain() {
+        if (isHeadless()) {
+            createOffscreenTarget();
+            return;
+        }
+        
         SwapChainSupportDetails swapChainSupport = querySwapChainSupport(physicalDevice);
         
         VkSurfaceFormatKHR surfaceFormat = chooseSwapSurfaceFormat(swapChainSupport.formats);
@@ -586,7 +943,7 @@ private:
         createInfo.imageArrayLayers = 1;
         createInfo.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
         
-        QueueFamilyIndices indices = findQueueFamilies(physicalDevice);
+        QueueFamilyIndices indices = familyIndices;
         uint32_t queueFamilyIndices[] = {indices.graphicsFamily.value(), indices.presentFamily.value()};
         
         if (indices.graphicsFamily != indices.presentFamily) {
@@ -614,6 +971,17 @@ private:
         swapChainExtent = extent;
     }
     
+    // The offscreen images stand in for the swapchain images, one for each frame slot
+    void createOffscreenTarget() {
+        if (offscreenTarget == nullptr) {
+            offscreenTarget = std::make_unique<OffscreenTarget>(physicalDevice, device, windowExtent, MAX_FRAMES_IN_FLIGHT);
+        }
+        
+        swapChainImages = offscreenTarget->getImages();
+        swapChainImageFormat = offscreenTarget->getFormat();
+        swapChainExtent = offscreenTarget->getExtent();
+    }
+    
     void createImageViews() {
         swapChainImageViews.resize(swapChainImages.size());
         
@@ -623,24 +991,42 @@ private:
     }
     
     void createRenderPass() {
+        if (occlusionCulling) {
+            // The early pass clears and keeps the depth; the late pass resumes and presents
+            renderPass = createRenderPass(false, false);
+            lateRenderPass = createRenderPass(true, true);
+        } else {
+            renderPass = createRenderPass(false, true);
+        }
+    }
+    
+    /**
+     * Creates a render pass, either starting or resuming the frame.
+     *
+     * All of these render passes are compatible, so they share framebuffers
+     * and pipelines. A pass that resumes loads the attachments of the one
+     * before it. A pass that does not present keeps its depth buffer, so
+     * that it can be reduced into the occlusion culling pyramid.
+     */
+    VkRenderPass createRenderPass(bool resume, bool present) {
         VkAttachmentDescription colorAttachment{};
         colorAttachment.format = swapChainImageFormat;
         colorAttachment.samples = msaaSamples;
-        colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+        colorAttachment.loadOp = resume ? VK_ATTACHMENT_LOAD_OP_LOAD : VK_ATTACHMENT_LOAD_OP_CLEAR;
         colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
         colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
         colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-        colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        colorAttachment.initialLayout = resume ? VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL : VK_IMAGE_LAYOUT_UNDEFINED;
         colorAttachment.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
         
         VkAttachmentDescription depthAttachment{};
         depthAttachment.format = findDepthFormat();
         depthAttachment.samples = msaaSamples;
-        depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-        depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        depthAttachment.loadOp = resume ? VK_ATTACHMENT_LOAD_OP_LOAD : VK_ATTACHMENT_LOAD_OP_CLEAR;
+        depthAttachment.storeOp = present ? VK_ATTACHMENT_STORE_OP_DONT_CARE : VK_ATTACHMENT_STORE_OP_STORE;
         depthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
         depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-        depthAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        depthAttachment.initialLayout = resume ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL : VK_IMAGE_LAYOUT_UNDEFINED;
         depthAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
         
         VkAttachmentDescription colorAttachmentResolve{};
@@ -651,7 +1037,9 @@ private:
         colorAttachmentResolve.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
         colorAttachmentResolve.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
         colorAttachmentResolve.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-        colorAttachmentResolve.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+        // Offscreen images are left ready to be read back instead of presented
+        VkImageLayout presentLayout = isHeadless() ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+        colorAttachmentResolve.finalLayout = present ? presentLayout : VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
         
         VkAttachmentReference colorAttachmentRef{};
         colorAttachmentRef.attachment = 0;
@@ -679,6 +1067,13 @@ private:
         dependency.srcAccessMask = 0;
         dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
         dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+        if (resume) {
+            // The loads must wait on the writes of the pass before
+            dependency.srcStageMask |= VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+            dependency.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+            dependency.dstStageMask |= VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+            dependency.dstAccessMask |= VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT;
+        }
         
         std::array<VkAttachmentDescription, 3> attachments = {colorAttachment, depthAttachment, colorAttachmentResolve };
         VkRenderPassCreateInfo renderPassInfo{};
@@ -690,12 +1085,20 @@ private:
         renderPassInfo.dependencyCount = 1;
         renderPassInfo.pDependencies = &dependency;
         
-        if (vkCreateRenderPass(device, &renderPassInfo, nullptr, &renderPass) != VK_SUCCESS) {
+        VkRenderPass result;
+        if (vkCreateRenderPass(device, &renderPassInfo, nullptr, &result) != VK_SUCCESS) {
             throw std::runtime_error("failed to create render pass!");
         }
+        return result;
     }
     
     void createDescriptorSetLayout() {
+        layoutCache = std::make_unique<DescriptorLayoutCache>(device);
+        if (bindless) {
+            createBindlessSetLayouts();
+            return;
+        }
+        
         VkDescriptorSetLayoutBinding uboLayoutBinding{};
         uboLayoutBinding.binding = 0;
         uboLayoutBinding.descriptorCount = 1;
@@ -710,138 +1113,144 @@ private:
         samplerLayoutBinding.pImmutableSamplers = nullptr;
         samplerLayoutBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
         
-        std::array<VkDescriptorSetLayoutBinding, 2> bindings = {uboLayoutBinding, samplerLayoutBinding};
-        VkDescriptorSetLayoutCreateInfo layoutInfo{};
-        layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-        layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
-        layoutInfo.pBindings = bindings.data();
+        VkDescriptorSetLayoutCreateFlags flags = pushDescriptors ? VK_DESCRIPTOR_SET_LAYOUT_CREATE_PUSH_DESCRIPTOR_BIT_KHR : 0;
+        descriptorSetLayout = layoutCache->get({uboLayoutBinding, samplerLayoutBinding}, flags);
+    }
+    
+    /**
+     * Creates the descriptor set layouts for the bindless path.
+     *
+     * Set 0 holds the per-frame uniform buffer and object buffer (and the
+     * visible instances when culling). Set 1 is the bindless texture table,
+     * shared by all frames.
+     */
+    void createBindlessSetLayouts() {
+        VkDescriptorSetLayoutBinding uboLayoutBinding{};
+        uboLayoutBinding.binding = 0;
+        uboLayoutBinding.descriptorCount = 1;
+        uboLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+        uboLayoutBinding.pImmutableSamplers = nullptr;
+        uboLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+        
+        VkDescriptorSetLayoutBinding objectLayoutBinding{};
+        objectLayoutBinding.binding = 1;
+        objectLayoutBinding.descriptorCount = 1;
+        objectLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        objectLayoutBinding.pImmutableSamplers = nullptr;
+        objectLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+        
+        std::vector<VkDescriptorSetLayoutBinding> bindings = {uboLayoutBinding, objectLayoutBinding};
         
-        if (vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &descriptorSetLayout) != VK_SUCCESS) {
-            throw std::runtime_error("failed to create descriptor set layout!");
+        // With culling, the instances are read through the list of survivors
+        if (occlusionCulling) {
+            VkDescriptorSetLayoutBinding visibleLayoutBinding = objectLayoutBinding;
+            visibleLayoutBinding.binding = 2;
+            bindings.push_back(visibleLayoutBinding);
         }
+        
+        VkDescriptorSetLayoutCreateFlags flags = pushDescriptors ? VK_DESCRIPTOR_SET_LAYOUT_CREATE_PUSH_DESCRIPTOR_BIT_KHR : 0;
+        descriptorSetLayout = layoutCache->get(bindings, flags);
+        
+        bindlessTable = std::make_unique<BindlessTable>(device, bindlessCapacity, VK_SHADER_STAGE_FRAGMENT_BIT);
     }
     
     void createGraphicsPipeline() {
-        auto vertShaderCode = readFile("shaders/vert.spv");
-        auto fragShaderCode = readFile("shaders/frag.spv");
+        std::vector<VkDescriptorSetLayout> setLayouts = {descriptorSetLayout};
+        if (bindless) {
+            setLayouts.push_back(bindlessTable->getLayout());
+        }
+        
+        VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+        pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+        pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(setLayouts.size());
+        pipelineLayoutInfo.pSetLayouts = setLayouts.data();
         
-        VkShaderModule vertShaderModule = createShaderModule(vertShaderCode);
-        VkShaderModule fragShaderModule = createShaderModule(fragShaderCode);
+        // The per-draw data, so that drawing an object never touches a descriptor
+        VkPushConstantRange pushRange{};
+        pushRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+        pushRange.offset = 0;
+        pushRange.size = sizeof(DrawConstants);
+        pipelineLayoutInfo.pushConstantRangeCount = 1;
+        pipelineLayoutInfo.pPushConstantRanges = &pushRange;
         
-        VkPipelineShaderStageCreateInfo vertShaderStageInfo{};
-        vertShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-        vertShaderStageInfo.stage = VK_SHADER_STAGE_VERTEX_BIT;
-        vertShaderStageInfo.module = vertShaderModule;
-        vertShaderStageInfo.pName = "main";
+        if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create pipeline layout!");
+        }
         
-        VkPipelineShaderStageCreateInfo fragShaderStageInfo{};
-        fragShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-        fragShaderStageInfo.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
-        fragShaderStageInfo.module = fragShaderModule;
-        fragShaderStageInfo.pName = "main";
+        GraphicsPipelineState state;
         
-        VkPipelineShaderStageCreateInfo shaderStages[] = {vertShaderStageInfo, fragShaderStageInfo};
+        PipelineShader vertShader;
+        vertShader.stage = VK_SHADER_STAGE_VERTEX_BIT;
+        const char* vertPath = bindless ? (occlusionCulling ? "shaders/bindless_cull_vert.spv" : "shaders/bindless_vert.spv") : "shaders/vert.spv";
+        vertShader.code = getShader(vertPath);
+        state.shaders.push_back(vertShader);
         
-        VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
-        vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+        PipelineShader fragShader;
+        fragShader.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+        fragShader.code = getShader(bindless ? "shaders/bindless_frag.spv" : "shaders/frag.spv");
+        state.shaders.push_back(fragShader);
         
-        auto bindingDescription = Vertex::getBindingDescription();
         auto attributeDescriptions = Vertex::getAttributeDescriptions();
-        
-        vertexInputInfo.vertexBindingDescriptionCount = 1;
-        vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescriptions.size());
-        vertexInputInfo.pVertexBindingDescriptions = &bindingDescription;
-        vertexInputInfo.pVertexAttributeDescriptions = attributeDescriptions.data();
-        
-        VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
-        inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
-        inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
-        inputAssembly.primitiveRestartEnable = VK_FALSE;
-        
-        VkPipelineViewportStateCreateInfo viewportState{};
-        viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
-        viewportState.viewportCount = 1;
-        viewportState.scissorCount = 1;
-        
-        VkPipelineRasterizationStateCreateInfo rasterizer{};
-        rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
-        rasterizer.depthClampEnable = VK_FALSE;
-        rasterizer.rasterizerDiscardEnable = VK_FALSE;
-        rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
-        rasterizer.lineWidth = 1.0f;
-        rasterizer.cullMode = VK_CULL_MODE_BACK_BIT;
-        rasterizer.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
-        rasterizer.depthBiasEnable = VK_FALSE;
-        
-        VkPipelineMultisampleStateCreateInfo multisampling{};
-        multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
-        multisampling.sampleShadingEnable = VK_FALSE;
-        multisampling.rasterizationSamples = msaaSamples;
-        
-        VkPipelineDepthStencilStateCreateInfo depthStencil{};
-        depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
-        depthStencil.depthTestEnable = VK_TRUE;
-        depthStencil.depthWriteEnable = VK_TRUE;
-        depthStencil.depthCompareOp = VK_COMPARE_OP_LESS;
-        depthStencil.depthBoundsTestEnable = VK_FALSE;
-        depthStencil.stencilTestEnable = VK_FALSE;
+        state.bindings.push_back(Vertex::getBindingDescription());
+        state.attributes.assign(attributeDescriptions.begin(), attributeDescriptions.end());
         
         VkPipelineColorBlendAttachmentState colorBlendAttachment{};
         colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
         colorBlendAttachment.blendEnable = VK_FALSE;
-        
-        VkPipelineColorBlendStateCreateInfo colorBlending{};
-        colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
-        colorBlending.logicOpEnable = VK_FALSE;
-        colorBlending.logicOp = VK_LOGIC_OP_COPY;
-        colorBlending.attachmentCount = 1;
-        colorBlending.pAttachments = &colorBlendAttachment;
-        colorBlending.blendConstants[0] = 0.0f;
-        colorBlending.blendConstants[1] = 0.0f;
-        colorBlending.blendConstants[2] = 0.0f;
-        colorBlending.blendConstants[3] = 0.0f;
-        
-        std::vector<VkDynamicState> dynamicStates = {
-            VK_DYNAMIC_STATE_VIEWPORT,
-            VK_DYNAMIC_STATE_SCISSOR
-        };
-        VkPipelineDynamicStateCreateInfo dynamicState{};
-        dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
-        dynamicState.dynamicStateCount = static_cast<uint32_t>(dynamicStates.size());
-        dynamicState.pDynamicStates = dynamicStates.data();
-        
-        VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
-        pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-        pipelineLayoutInfo.setLayoutCount = 1;
-        pipelineLayoutInfo.pSetLayouts = &descriptorSetLayout;
-        
-        if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS) {
-            throw std::runtime_error("failed to create pipeline layout!");
+        state.blendAttachments.push_back(colorBlendAttachment);
+        
+        state.samples = msaaSamples;
+        state.layout = pipelineLayout;
+        state.renderPass = renderPass;
+        state.subpass = 0;
+        
+        // This does not block; the rest of initialization overlaps the compile
+        graphicsPipelineState = state;
+        graphicsPipelineRequest = pipelines->request(state);
+    }
+    
+    /**
+     * Creates the pipeline service, seeding its cache from the last run.
+     */
+    void createPipelineService() {
+        std::vector<char> initial;
+        std::string path = getPipelineCachePath();
+        size_t size = 0;
+        void* data = path.empty() ? nullptr : SDL_LoadFile(path.c_str(), &size);
+        if (data != nullptr) {
+            initial.assign(static_cast<char*>(data), static_cast<char*>(data) + size);
+            SDL_free(data);
+        }
+        pipelines = std::make_unique<PipelineService>(device, initial, pipelineLibraries);
+    }
+    
+    /**
+     * Saves the pipeline cache so that the next run can skip the compiles.
+     */
+    void savePipelineCache() {
+        std::string path = getPipelineCachePath();
+        if (path.empty()) {
+            return;
         }
         
-        VkGraphicsPipelineCreateInfo pipelineInfo{};
-        pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-        pipelineInfo.stageCount = 2;
-        pipelineInfo.pStages = shaderStages;
-        pipelineInfo.pVertexInputState = &vertexInputInfo;
-        pipelineInfo.pInputAssemblyState = &inputAssembly;
-        pipelineInfo.pViewportState = &viewportState;
-        pipelineInfo.pRasterizationState = &rasterizer;
-        pipelineInfo.pMultisampleState = &multisampling;
-        pipelineInfo.pDepthStencilState = &depthStencil;
-        pipelineInfo.pColorBlendState = &colorBlending;
-        pipelineInfo.pDynamicState = &dynamicState;
-        pipelineInfo.layout = pipelineLayout;
-        pipelineInfo.renderPass = renderPass;
-        pipelineInfo.subpass = 0;
-        pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
-        
-        if (vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &graphicsPipeline) != VK_SUCCESS) {
-            throw std::runtime_error("failed to create graphics pipeline!");
+        pipelines->wait();
+        std::vector<char> data = pipelines->getCacheData();
+        if (!data.empty() && !SDL_SaveFile(path.c_str(), data.data(), data.size())) {
+            SDL_Log("Unable to save pipeline cache: %s", SDL_GetError());
         }
-        
-        vkDestroyShaderModule(device, fragShaderModule, nullptr);
-        vkDestroyShaderModule(device, vertShaderModule, nullptr);
+    }
+    
+    /**
+     * Returns the path of the saved pipeline cache (or "" if there is none)
+     */
+    std::string getPipelineCachePath() {
+        char* pref = SDL_GetPrefPath("GDIAC", "Tutorial8");
+        if (pref == nullptr) {
+            return "";
+        }
+        std::string path = std::string(pref) + "pipeline.cache";
+        SDL_free(pref);
+        return path;
     }
     
     void createFramebuffers() {
@@ -870,7 +1279,7 @@ private:
     }
     
     void createCommandPool() {
-        QueueFamilyIndices queueFamilyIndices = findQueueFamilies(physicalDevice);
+        QueueFamilyIndices queueFamilyIndices = familyIndices;
         
         VkCommandPoolCreateInfo poolInfo{};
         poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
@@ -892,7 +1301,12 @@ private:
     void createDepthResources() {
         VkFormat depthFormat = findDepthFormat();
         
-        createImage(swapChainExtent.width, swapChainExtent.height, 1, msaaSamples, depthFormat, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, depthImage, depthImageMemory);
+        // The culler reduces the depth buffer into its occlusion pyramid
+        VkImageUsageFlags usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+        if (occlusionCulling) {
+            usage |= VK_IMAGE_USAGE_SAMPLED_BIT;
+        }
+        createImage(swapChainExtent.width, swapChainExtent.height, 1, msaaSamples, depthFormat, VK_IMAGE_TILING_OPTIMAL, usage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, depthImage, depthImageMemory);
         depthImageView = createImageView(depthImage, depthFormat, VK_IMAGE_ASPECT_DEPTH_BIT, 1);
     }
     
@@ -923,14 +1337,62 @@ private:
         return format == VK_FORMAT_D32_SFLOAT_S8_UINT || format == VK_FORMAT_D24_UNORM_S8_UINT;
     }
     
+    /**
+     * Decodes the texture file, so that it can be uploaded later.
+     *
+     * This needs no Vulkan, so it runs on a worker while the device is
+     * created. It also sets the number of mip levels.
+     */
+    void decodeTexture() {
+        texturePixels = load_image_asset(TEXTURE_PATH.c_str(), &textureWidth, &textureHeight);
+        if (!texturePixels) {
+            throw std::runtime_error("failed to load texture image!");
+        }
+        if (textureSize.width > 0 && textureSize.height > 0) {
+            resizeTexture(textureSize.width, textureSize.height);
+        }
+        mipLevels = static_cast<uint32_t>(std::floor(std::log2(std::max(textureWidth, textureHeight)))) + 1;
+    }
+    
+    /**
+     * Resamples the decoded texture to the given size, with nearest filtering.
+     *
+     * This is only for testing the mipmaps on sizes that the asset does not
+     * have, such as odd sizes above 4096 that take several downsampler passes.
+     *
+     * @param width     The new texture width
+     * @param height    The new texture height
+     */
+    void resizeTexture(uint32_t width, uint32_t height) {
+        uint8_t* pixels = (uint8_t*)malloc(sizeof(uint8_t)*width*height*4);
+        if (!pixels) {
+            throw std::runtime_error("failed to resize texture image!");
+        }
+        for (uint32_t ii = 0; ii < height; ii++) {
+            size_t row = static_cast<uint64_t>(ii) * textureHeight / height;
+            for (uint32_t jj = 0; jj < width; jj++) {
+                size_t col = static_cast<uint64_t>(jj) * textureWidth / width;
+                memcpy(pixels + (static_cast<size_t>(ii) * width + jj) * 4, texturePixels + (row * textureWidth + col) * 4, 4);
+            }
+        }
+        free(texturePixels);
+        texturePixels = pixels;
+        textureWidth = static_cast<int>(width);
+        textureHeight = static_cast<int>(height);
+    }
+    
     void createTextureImage() {
-        int texWidth, texHeight;
-        uint8_t* pixels = load_image_asset(TEXTURE_PATH.c_str(), &texWidth, &texHeight);
+        int texWidth = textureWidth;
+        int texHeight = textureHeight;
+        uint8_t* pixels = texturePixels;
+        texturePixels = nullptr;
         VkDeviceSize imageSize = texWidth * texHeight * 4;
-        mipLevels = static_cast<uint32_t>(std::floor(std::log2(std::max(texWidth, texHeight)))) + 1;
         
-        if (!pixels) {
-            throw std::runtime_error("failed to load texture image!");
+        // Not every format supports linear blits, so build the chain on the CPU if we must
+        if (!supportsGpuMipmaps(VK_FORMAT_R8G8B8A8_SRGB)) {
+            createTextureImageOnCPU(pixels, texWidth, texHeight);
+            free(pixels);
+            return;
         }
         
         VkBuffer stagingBuffer;
@@ -944,7 +1406,15 @@ private:
         
         free(pixels);
         
-        createImage(texWidth, texHeight, mipLevels, VK_SAMPLE_COUNT_1_BIT, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, textureImage, textureImageMemory);
+        // The compute downsampler writes through UNORM storage views of the sRGB image
+        VkImageUsageFlags usage = VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+        VkImageCreateFlags flags = 0;
+        if (computeMipmaps) {
+            usage |= VK_IMAGE_USAGE_STORAGE_BIT;
+            flags |= VK_IMAGE_CREATE_MUTABLE_FORMAT_BIT | VK_IMAGE_CREATE_EXTENDED_USAGE_BIT;
+        }
+        
+        createImage(texWidth, texHeight, mipLevels, VK_SAMPLE_COUNT_1_BIT, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_TILING_OPTIMAL, usage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, textureImage, textureImageMemory, flags);
         
         transitionImageLayout(textureImage, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, mipLevels);
         copyBufferToImage(stagingBuffer, textureImage, static_cast<uint32_t>(texWidth), static_cast<uint32_t>(texHeight));
@@ -957,7 +1427,117 @@ private:
     }
     
     
+    /**
+     * Returns true if the GPU can generate mipmaps for the given format
+     *
+     * @param format    The image format
+     */
+    bool supportsGpuMipmaps(VkFormat format) {
+        if (computeMipmaps && !blitMipmaps && getStorageFormat(format) != VK_FORMAT_UNDEFINED) {
+            return true;
+        }
+        
+        VkFormatProperties formatProperties;
+        vkGetPhysicalDeviceFormatProperties(physicalDevice, format, &formatProperties);
+        return (formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT) != 0;
+    }
+    
+    /**
+     * Creates the texture image with a mip chain generated on the CPU.
+     *
+     * All of the levels are packed into a single staging buffer and uploaded
+     * with one vkCmdCopyBufferToImage, so there are no per level barriers.
+     *
+     * @param pixels    The base level pixels
+     * @param texWidth  The base level width
+     * @param texHeight The base level height
+     */
+    void createTextureImageOnCPU(const uint8_t* pixels, int32_t texWidth, int32_t texHeight) {
+        Uint64 start = SDL_GetTicksNS();
+        MipmapChain chain = build_mipmap_chain(pixels, texWidth, texHeight, mipLevels, true, MipmapFilter::KAISER, WorkerPool::shared());
+        VkDeviceSize imageSize = chain.data.size();
+        
+        VkBuffer stagingBuffer;
+        VkDeviceMemory stagingBufferMemory;
+        createBuffer(imageSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory);
+        
+        void* data;
+        vkMapMemory(device, stagingBufferMemory, 0, imageSize, 0, &data);
+        memcpy(data, chain.data.data(), static_cast<size_t>(imageSize));
+        vkUnmapMemory(device, stagingBufferMemory);
+        
+        createImage(texWidth, texHeight, mipLevels, VK_SAMPLE_COUNT_1_BIT, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, textureImage, textureImageMemory);
+        
+        VkCommandBuffer commandBuffer = beginSingleTimeCommands();
+        
+        VkImageMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barrier.image = textureImage;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        barrier.subresourceRange.baseMipLevel = 0;
+        barrier.subresourceRange.levelCount = mipLevels;
+        barrier.subresourceRange.baseArrayLayer = 0;
+        barrier.subresourceRange.layerCount = 1;
+        barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barrier.srcAccessMask = 0;
+        barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        
+        vkCmdPipelineBarrier(commandBuffer,
+                             VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+                             0, nullptr,
+                             0, nullptr,
+                             1, &barrier);
+        
+        std::vector<VkBufferImageCopy> regions(chain.levels.size());
+        for (size_t ii = 0; ii < regions.size(); ii++) {
+            const MipmapLevel& level = chain.levels[ii];
+            regions[ii].bufferOffset = level.offset;
+            regions[ii].bufferRowLength = 0;
+            regions[ii].bufferImageHeight = 0;
+            regions[ii].imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+            regions[ii].imageSubresource.mipLevel = static_cast<uint32_t>(ii);
+            regions[ii].imageSubresource.baseArrayLayer = 0;
+            regions[ii].imageSubresource.layerCount = 1;
+            regions[ii].imageOffset = {0, 0, 0};
+            regions[ii].imageExtent = { level.width, level.height, 1 };
+        }
+        
+        vkCmdCopyBufferToImage(commandBuffer, stagingBuffer, textureImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, static_cast<uint32_t>(regions.size()), regions.data());
+        
+        barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        
+        vkCmdPipelineBarrier(commandBuffer,
+                             VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
+                             0, nullptr,
+                             0, nullptr,
+                             1, &barrier);
+        
+        endSingleTimeCommands(commandBuffer);
+        
+        vkDestroyBuffer(device, stagingBuffer, nullptr);
+        vkFreeMemory(device, stagingBufferMemory, nullptr);
+        SDL_Log("Generated %u mipmaps on the CPU in %.3f ms", mipLevels, (SDL_GetTicksNS()-start)/1000000.0);
+    }
+    
     void generateMipmaps(VkImage image, VkFormat imageFormat, int32_t texWidth, int32_t texHeight, uint32_t mipLevels) {
+        Uint64 start = SDL_GetTicksNS();
+        if (computeMipmaps && !blitMipmaps && getStorageFormat(imageFormat) != VK_FORMAT_UNDEFINED) {
+            generateMipmapsCompute(image, imageFormat, texWidth, texHeight, mipLevels, MIPMAP_AVERAGE);
+            SDL_Log("Generated %u mipmaps with compute in %.3f ms", mipLevels, (SDL_GetTicksNS()-start)/1000000.0);
+            return;
+        }
+        
+        generateMipmapsBlit(image, imageFormat, texWidth, texHeight, mipLevels);
+        SDL_Log("Generated %u mipmaps with blits in %.3f ms", mipLevels, (SDL_GetTicksNS()-start)/1000000.0);
+    }
+    
+    void generateMipmapsBlit(VkImage image, VkFormat imageFormat, int32_t texWidth, int32_t texHeight, uint32_t mipLevels) {
         // Check if image format supports linear blitting
         VkFormatProperties formatProperties;
         vkGetPhysicalDeviceFormatProperties(physicalDevice, imageFormat, &formatProperties);
@@ -1044,75 +1624,525 @@ private:
         endSingleTimeCommands(commandBuffer);
     }
     
-    VkSampleCountFlagBits getMaxUsableSampleCount() {
-        VkPhysicalDeviceProperties physicalDeviceProperties;
-        vkGetPhysicalDeviceProperties(physicalDevice, &physicalDeviceProperties);
+    /**
+     * Returns true if this device supports descriptor update templates (Vulkan 1.1)
+     */
+    bool checkUpdateTemplateSupport() {
+        VkPhysicalDeviceProperties properties;
+        vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+        return properties.apiVersion >= VK_API_VERSION_1_1 && instanceVersion >= VK_API_VERSION_1_1;
+    }
+    
+    /**
+     * Returns true if this device can build pipelines from pipeline libraries.
+     *
+     * This requires VK_EXT_graphics_pipeline_library (and the features query
+     * from Vulkan 1.1). Lavapipe supports it, as do most desktop drivers.
+     */
+    bool checkPipelineLibrarySupport() {
+        VkPhysicalDeviceProperties properties;
+        vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+        if (properties.apiVersion < VK_API_VERSION_1_1 || instanceVersion < VK_API_VERSION_1_1) {
+            return false;
+        }
+        if (!checkDeviceExtension(VK_KHR_PIPELINE_LIBRARY_EXTENSION_NAME) ||
+            !checkDeviceExtension(VK_EXT_GRAPHICS_PIPELINE_LIBRARY_EXTENSION_NAME)) {
+            return false;
+        }
         
-        VkSampleCountFlags counts = physicalDeviceProperties.limits.framebufferColorSampleCounts & physicalDeviceProperties.limits.framebufferDepthSampleCounts;
-        if (counts & VK_SAMPLE_COUNT_64_BIT) { return VK_SAMPLE_COUNT_64_BIT; }
-        if (counts & VK_SAMPLE_COUNT_32_BIT) { return VK_SAMPLE_COUNT_32_BIT; }
-        if (counts & VK_SAMPLE_COUNT_16_BIT) { return VK_SAMPLE_COUNT_16_BIT; }
-        if (counts & VK_SAMPLE_COUNT_8_BIT) { return VK_SAMPLE_COUNT_8_BIT; }
-        if (counts & VK_SAMPLE_COUNT_4_BIT) { return VK_SAMPLE_COUNT_4_BIT; }
-        if (counts & VK_SAMPLE_COUNT_2_BIT) { return VK_SAMPLE_COUNT_2_BIT; }
+        VkPhysicalDeviceGraphicsPipelineLibraryFeaturesEXT libraryFeatures{};
+        libraryFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_GRAPHICS_PIPELINE_LIBRARY_FEATURES_EXT;
         
-        return VK_SAMPLE_COUNT_1_BIT;
+        VkPhysicalDeviceFeatures2 features{};
+        features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+        features.pNext = &libraryFeatures;
+        vkGetPhysicalDeviceFeatures2(physicalDevice, &features);
+        return libraryFeatures.graphicsPipelineLibrary == VK_TRUE;
     }
     
-    void createTextureImageView() {
-        textureImageView = createImageView(textureImage, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_ASPECT_COLOR_BIT, mipLevels);
+    /**
+     * Returns true if this device can issue several draws per indirect command
+     */
+    bool checkMultiDrawIndirectSupport() {
+        VkPhysicalDeviceFeatures supportedFeatures;
+        vkGetPhysicalDeviceFeatures(physicalDevice, &supportedFeatures);
+        return supportedFeatures.multiDrawIndirect == VK_TRUE;
+    }
+    
+    /**
+     * Returns true if this device can cull the scene on the GPU.
+     *
+     * The depth buffer is sampled to build the occlusion pyramid, which is
+     * an r32f storage image. The pyramid itself is built by the compute
+     * downsampler, so that must also be supported.
+     */
+    bool checkOcclusionCullingSupport() {
+        VkFormatProperties depthProperties;
+        vkGetPhysicalDeviceFormatProperties(physicalDevice, findDepthFormat(), &depthProperties);
+        if ((depthProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT) == 0) {
+            return false;
+        }
+        
+        VkFormatProperties pyramidProperties;
+        vkGetPhysicalDeviceFormatProperties(physicalDevice, VK_FORMAT_R32_SFLOAT, &pyramidProperties);
+        VkFormatFeatureFlags required = VK_FORMAT_FEATURE_STORAGE_IMAGE_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT;
+        return (pyramidProperties.optimalTilingFeatures & required) == required;
     }
     
-    void createTextureSampler() {
-        VkPhysicalDeviceProperties properties{};
-        vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+    /**
+     * Returns true if the physical device supports the given extension
+     */
+    bool checkDeviceExtension(const char* name) {
+        uint32_t extensionCount;
+        vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, nullptr);
         
-        VkSamplerCreateInfo samplerInfo{};
-        samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
-        samplerInfo.magFilter = VK_FILTER_LINEAR;
-        samplerInfo.minFilter = VK_FILTER_LINEAR;
-        samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
-        samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
-        samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
-        samplerInfo.anisotropyEnable = VK_TRUE;
-        samplerInfo.maxAnisotropy = properties.limits.maxSamplerAnisotropy;
-        samplerInfo.borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK;
-        samplerInfo.unnormalizedCoordinates = VK_FALSE;
-        samplerInfo.compareEnable = VK_FALSE;
-        samplerInfo.compareOp = VK_COMPARE_OP_ALWAYS;
-        samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
-        samplerInfo.minLod = 0.0f;
-        samplerInfo.maxLod = static_cast<float>(mipLevels);
-        samplerInfo.mipLodBias = 0.0f;
+        std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+        vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, availableExtensions.data());
         
-        if (vkCreateSampler(device, &samplerInfo, nullptr, &textureSampler) != VK_SUCCESS) {
-            throw std::runtime_error("failed to create texture sampler!");
+        for (const auto& extension : availableExtensions) {
+            if (strcmp(extension.extensionName, name) == 0) {
+                return true;
+            }
         }
+        return false;
     }
     
-    VkImageView createImageView(VkImage image, VkFormat format, VkImageAspectFlags aspectFlags, uint32_t mipLevels) {
-        VkImageViewCreateInfo viewInfo{};
-        viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
-        viewInfo.image = image;
-        viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
-        viewInfo.format = format;
-        viewInfo.subresourceRange.aspectMask = aspectFlags;
-        viewInfo.subresourceRange.baseMipLevel = 0;
-        viewInfo.subresourceRange.levelCount = mipLevels;
-        viewInfo.subresourceRange.baseArrayLayer = 0;
-        viewInfo.subresourceRange.layerCount = 1;
+    /**
+     * Returns true if this device supports the bindless descriptor path.
+     *
+     * This also sets the capacity of the texture table, which is limited by
+     * the update-after-bind limits of the device.
+     */
+    bool checkBindlessSupport() {
+        VkPhysicalDeviceProperties properties;
+        vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+        if (properties.apiVersion < VK_API_VERSION_1_2 || instanceVersion < VK_API_VERSION_1_2) {
+            return false;
+        }
         
-        VkImageView imageView;
-        if (vkCreateImageView(device, &viewInfo, nullptr, &imageView) != VK_SUCCESS) {
-            throw std::runtime_error("failed to create texture image view!");
+        VkPhysicalDeviceDescriptorIndexingFeatures indexingFeatures{};
+        indexingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES;
+        
+        VkPhysicalDeviceFeatures2 features{};
+        features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+        features.pNext = &indexingFeatures;
+        vkGetPhysicalDeviceFeatures2(physicalDevice, &features);
+        
+        if (!indexingFeatures.runtimeDescriptorArray ||
+            !indexingFeatures.descriptorBindingPartiallyBound ||
+            !indexingFeatures.descriptorBindingSampledImageUpdateAfterBind ||
+            !indexingFeatures.shaderSampledImageArrayNonUniformIndexing) {
+            return false;
+        }
+        
+        VkPhysicalDeviceDescriptorIndexingProperties indexingProperties{};
+        indexingProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES;
+        
+        VkPhysicalDeviceProperties2 properties2{};
+        properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+        properties2.pNext = &indexingProperties;
+        vkGetPhysicalDeviceProperties2(physicalDevice, &properties2);
+        
+        bindlessCapacity = std::min({MAX_BINDLESS_TEXTURES,
+                                     indexingProperties.maxDescriptorSetUpdateAfterBindSampledImages,
+                                     indexingProperties.maxPerStageDescriptorUpdateAfterBindSampledImages,
+                                     indexingProperties.maxDescriptorSetUpdateAfterBindSamplers});
+        return bindlessCapacity > 0;
+    }
+    
+    /**
+     * Returns true if this device can use the single pass compute downsampler.
+     *
+     * The downsampler writes to sRGB textures through UNORM storage views, so
+     * it needs extended image usage (Vulkan 1.1) and dynamic indexing of its
+     * storage image array.
+     */
+    bool checkComputeMipmapSupport() {
+        VkPhysicalDeviceProperties properties;
+        vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+        if (properties.apiVersion < VK_API_VERSION_1_1 || instanceVersion < VK_API_VERSION_1_1) {
+            return false;
+        }
+        
+        VkPhysicalDeviceFeatures features;
+        vkGetPhysicalDeviceFeatures(physicalDevice, &features);
+        if (!features.shaderStorageImageArrayDynamicIndexing) {
+            return false;
+        }
+        
+        VkFormatProperties formatProperties;
+        vkGetPhysicalDeviceFormatProperties(physicalDevice, VK_FORMAT_R8G8B8A8_UNORM, &formatProperties);
+        return (formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_STORAGE_IMAGE_BIT) != 0;
+    }
+    
+    /**
+     * Returns the format of the storage views used to downsample the given format
+     *
+     * If the compute downsampler cannot handle this format, this method returns
+     * VK_FORMAT_UNDEFINED.
+     */
+    VkFormat getStorageFormat(VkFormat format) {
+        switch (format) {
+            case VK_FORMAT_R8G8B8A8_SRGB:
+            case VK_FORMAT_R8G8B8A8_UNORM:
+                return VK_FORMAT_R8G8B8A8_UNORM;
+            default:
+                return VK_FORMAT_UNDEFINED;
+        }
+    }
+    
+    /**
+     * Creates the pipeline for the single pass compute downsampler.
+     *
+     * The counter buffer is shared by all dispatches. It is zeroed here once,
+     * as the last workgroup of each dispatch resets it when done.
+     */
+    void createMipmapPipeline() {
+        if (!computeMipmaps) {
+            return;
+        }
+        
+        std::array<VkDescriptorSetLayoutBinding, 2> bindings{};
+        bindings[0].binding = 0;
+        bindings[0].descriptorCount = MIPMAP_MAX_LEVELS + 1;
+        bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+        bindings[0].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+        
+        bindings[1].binding = 1;
+        bindings[1].descriptorCount = 1;
+        bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        bindings[1].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+        
+        VkDescriptorSetLayoutCreateInfo layoutInfo{};
+        layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+        layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+        layoutInfo.pBindings = bindings.data();
+        
+        if (vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &mipmapSetLayout) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create mipmap descriptor set layout!");
+        }
+        
+        VkPushConstantRange pushRange{};
+        pushRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+        pushRange.offset = 0;
+        pushRange.size = sizeof(MipmapParameters);
+        
+        VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+        pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+        pipelineLayoutInfo.setLayoutCount = 1;
+        pipelineLayoutInfo.pSetLayouts = &mipmapSetLayout;
+        pipelineLayoutInfo.pushConstantRangeCount = 1;
+        pipelineLayoutInfo.pPushConstantRanges = &pushRange;
+        
+        if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &mipmapPipelineLayout) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create mipmap pipeline layout!");
+        }
+        
+        // This compiles while the texture loads; it is not needed until the dispatch
+        ComputePipelineState state;
+        state.shader.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+        state.shader.code = getShader("shaders/mipmap.spv");
+        state.layout = mipmapPipelineLayout;
+        mipmapPipelineRequest = pipelines->request(state);
+        
+        createBuffer(sizeof(uint32_t), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, mipmapCounterBuffer, mipmapCounterMemory);
+        
+        VkCommandBuffer commandBuffer = beginSingleTimeCommands();
+        vkCmdFillBuffer(commandBuffer, mipmapCounterBuffer, 0, sizeof(uint32_t), 0);
+        endSingleTimeCommands(commandBuffer);
+    }
+    
+    /**
+     * Destroys the pipeline for the single pass compute downsampler.
+     */
+    void cleanupMipmapPipeline() {
+        if (!computeMipmaps) {
+            return;
+        }
+        
+        vkDestroyBuffer(device, mipmapCounterBuffer, nullptr);
+        vkFreeMemory(device, mipmapCounterMemory, nullptr);
+        vkDestroyPipelineLayout(device, mipmapPipelineLayout, nullptr);
+        vkDestroyDescriptorSetLayout(device, mipmapSetLayout, nullptr);
+    }
+    
+    /**
+     * Returns the number of levels that one downsampler pass makes from base.
+     *
+     * Past level MIPMAP_TILE_LEVELS of a pass, only the last workgroup is left,
+     * and it reduces a single tile. So a pass whose level MIPMAP_TILE_LEVELS is
+     * larger than a tile stops there, and the next pass picks up from it.
+     */
+    uint32_t getMipmapPassLevels(int32_t texWidth, int32_t texHeight, uint32_t mipLevels, uint32_t base) {
+        int32_t side = std::max(std::max(texWidth >> base, texHeight >> base), 1);
+        uint32_t limit = MIPMAP_MAX_LEVELS;
+        if ((side >> MIPMAP_TILE_LEVELS) > static_cast<int32_t>(MIPMAP_TILE_SIZE)) {
+            limit = MIPMAP_TILE_LEVELS;
+        }
+        return std::min(limit, mipLevels - 1 - base);
+    }
+    
+    /**
+     * Records the compute downsampler for the given image.
+     *
+     * All levels of the image must be in VK_IMAGE_LAYOUT_GENERAL, and level 0
+     * must be visible to compute shaders. Each dispatch produces up to
+     * MIPMAP_MAX_LEVELS levels, so only images larger than 4096x4096 need more
+     * than one (see getMipmapPassLevels). The caller owns the returned views
+     * and descriptor pool, and must not destroy them until the command buffer
+     * has completed.
+     */
+    VkDescriptorPool recordMipmapDispatches(VkCommandBuffer commandBuffer, VkImage image, VkFormat storageFormat, bool srgb, int32_t texWidth, int32_t texHeight, uint32_t mipLevels, MipmapReduction mode, std::vector<VkImageView>& views) {
+        views.resize(mipLevels);
+        for (uint32_t level = 0; level < mipLevels; level++) {
+            VkImageViewCreateInfo viewInfo{};
+            viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+            viewInfo.image = image;
+            viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+            viewInfo.format = storageFormat;
+            viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+            viewInfo.subresourceRange.baseMipLevel = level;
+            viewInfo.subresourceRange.levelCount = 1;
+            viewInfo.subresourceRange.baseArrayLayer = 0;
+            viewInfo.subresourceRange.layerCount = 1;
+            
+            if (vkCreateImageView(device, &viewInfo, nullptr, &views[level]) != VK_SUCCESS) {
+                throw std::runtime_error("failed to create mipmap image view!");
+            }
+        }
+        
+        uint32_t passes = 0;
+        for (uint32_t base = 0; base + 1 < mipLevels; passes++) {
+            base += getMipmapPassLevels(texWidth, texHeight, mipLevels, base);
+        }
+        
+        std::array<VkDescriptorPoolSize, 2> poolSizes{};
+        poolSizes[0].type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+        poolSizes[0].descriptorCount = passes * (MIPMAP_MAX_LEVELS + 1);
+        poolSizes[1].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        poolSizes[1].descriptorCount = passes;
+        
+        VkDescriptorPoolCreateInfo poolInfo{};
+        poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+        poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+        poolInfo.pPoolSizes = poolSizes.data();
+        poolInfo.maxSets = passes;
+        
+        VkDescriptorPool pool;
+        if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &pool) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create mipmap descriptor pool!");
+        }
+        
+        std::vector<VkDescriptorSetLayout> layouts(passes, mipmapSetLayout);
+        std::vector<VkDescriptorSet> sets(passes);
+        
+        VkDescriptorSetAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+        allocInfo.descriptorPool = pool;
+        allocInfo.descriptorSetCount = passes;
+        allocInfo.pSetLayouts = layouts.data();
+        
+        if (vkAllocateDescriptorSets(device, &allocInfo, sets.data()) != VK_SUCCESS) {
+            throw std::runtime_error("failed to allocate mipmap descriptor sets!");
+        }
+        
+        vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, mipmapPipelineRequest.get());
+        
+        uint32_t base = 0;
+        for (uint32_t pass = 0; pass < passes; pass++) {
+            uint32_t levels = getMipmapPassLevels(texWidth, texHeight, mipLevels, base);
+            
+            std::array<VkDescriptorImageInfo, MIPMAP_MAX_LEVELS + 1> imageInfos{};
+            for (uint32_t ii = 0; ii <= MIPMAP_MAX_LEVELS; ii++) {
+                imageInfos[ii].imageView = views[base + std::min(ii, levels)];
+                imageInfos[ii].imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+            }
+            
+            VkDescriptorBufferInfo bufferInfo{};
+            bufferInfo.buffer = mipmapCounterBuffer;
+            bufferInfo.offset = 0;
+            bufferInfo.range = sizeof(uint32_t);
+            
+            std::array<VkWriteDescriptorSet, 2> descriptorWrites{};
+            descriptorWrites[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            descriptorWrites[0].dstSet = sets[pass];
+            descriptorWrites[0].dstBinding = 0;
+            descriptorWrites[0].dstArrayElement = 0;
+            descriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+            descriptorWrites[0].descriptorCount = static_cast<uint32_t>(imageInfos.size());
+            descriptorWrites[0].pImageInfo = imageInfos.data();
+            
+            descriptorWrites[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            descriptorWrites[1].dstSet = sets[pass];
+            descriptorWrites[1].dstBinding = 1;
+            descriptorWrites[1].dstArrayElement = 0;
+            descriptorWrites[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+            descriptorWrites[1].descriptorCount = 1;
+            descriptorWrites[1].pBufferInfo = &bufferInfo;
+            
+            vkUpdateDescriptorSets(device, static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+            
+            MipmapParameters params{};
+            params.extent = glm::ivec2(std::max(texWidth >> base, 1), std::max(texHeight >> base, 1));
+            uint32_t groupsX = (params.extent.x + MIPMAP_TILE_SIZE - 1) / MIPMAP_TILE_SIZE;
+            uint32_t groupsY = (params.extent.y + MIPMAP_TILE_SIZE - 1) / MIPMAP_TILE_SIZE;
+            params.levels = levels;
+            params.workgroups = groupsX * groupsY;
+            params.mode = mode;
+            params.srgb = srgb ? 1 : 0;
+            
+            vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, mipmapPipelineLayout, 0, 1, &sets[pass], 0, nullptr);
+            vkCmdPushConstants(commandBuffer, mipmapPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(MipmapParameters), &params);
+            vkCmdDispatch(commandBuffer, groupsX, groupsY, 1);
+            
+            base += levels;
+            if (pass + 1 < passes) {
+                VkMemoryBarrier barrier{};
+                barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+                barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+                barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+                vkCmdPipelineBarrier(commandBuffer,
+                                     VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,
+                                     1, &barrier,
+                                     0, nullptr,
+                                     0, nullptr);
+            }
+        }
+        
+        return pool;
+    }
+    
+    /**
+     * Generates the mipmaps for the given image with the compute downsampler.
+     *
+     * This is a replacement for the blit chain in the tutorial. It does not
+     * require VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT, and it averages
+     * sRGB textures in linear space. Like the blit chain, it expects every level
+     * to be in VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, with level 0 initialized,
+     * and leaves them all in VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL.
+     */
+    void generateMipmapsCompute(VkImage image, VkFormat imageFormat, int32_t texWidth, int32_t texHeight, uint32_t mipLevels, MipmapReduction mode) {
+        VkCommandBuffer commandBuffer = beginSingleTimeCommands();
+        
+        VkImageMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barrier.image = image;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        barrier.subresourceRange.baseMipLevel = 0;
+        barrier.subresourceRange.levelCount = mipLevels;
+        barrier.subresourceRange.baseArrayLayer = 0;
+        barrier.subresourceRange.layerCount = 1;
+        barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+        
+        vkCmdPipelineBarrier(commandBuffer,
+                             VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,
+                             0, nullptr,
+                             0, nullptr,
+                             1, &barrier);
+        
+        std::vector<VkImageView> views;
+        bool srgb = imageFormat == VK_FORMAT_R8G8B8A8_SRGB;
+        VkDescriptorPool pool = VK_NULL_HANDLE;
+        if (mipLevels > 1) {
+            pool = recordMipmapDispatches(commandBuffer, image, getStorageFormat(imageFormat), srgb, texWidth, texHeight, mipLevels, mode, views);
+        }
+        
+        barrier.oldLayout = VK_IMAGE_LAYOUT_GENERAL;
+        barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        
+        vkCmdPipelineBarrier(commandBuffer,
+                             VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
+                             0, nullptr,
+                             0, nullptr,
+                             1, &barrier);
+        
+        endSingleTimeCommands(commandBuffer);
+        
+        for (auto view : views) {
+            vkDestroyImageView(device, view, nullptr);
+        }
+        if (pool != VK_NULL_HANDLE) {
+            vkDestroyDescriptorPool(device, pool, nullptr);
+        }
+    }
+    
+    VkSampleCountFlagBits getMaxUsableSampleCount() {
+        VkPhysicalDeviceProperties physicalDeviceProperties;
+        vkGetPhysicalDeviceProperties(physicalDevice, &physicalDeviceProperties);
+        
+        VkSampleCountFlags counts = physicalDeviceProperties.limits.framebufferColorSampleCounts & physicalDeviceProperties.limits.framebufferDepthSampleCounts;
+        if (counts & VK_SAMPLE_COUNT_64_BIT) { return VK_SAMPLE_COUNT_64_BIT; }
+        if (counts & VK_SAMPLE_COUNT_32_BIT) { return VK_SAMPLE_COUNT_32_BIT; }
+        if (counts & VK_SAMPLE_COUNT_16_BIT) { return VK_SAMPLE_COUNT_16_BIT; }
+        if (counts & VK_SAMPLE_COUNT_8_BIT) { return VK_SAMPLE_COUNT_8_BIT; }
+        if (counts & VK_SAMPLE_COUNT_4_BIT) { return VK_SAMPLE_COUNT_4_BIT; }
+        if (counts & VK_SAMPLE_COUNT_2_BIT) { return VK_SAMPLE_COUNT_2_BIT; }
+        
+        return VK_SAMPLE_COUNT_1_BIT;
+    }
+    
+    void createTextureImageView() {
+        textureImageView = createImageView(textureImage, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_ASPECT_COLOR_BIT, mipLevels);
+    }
+    
+    void createTextureSampler() {
+        VkPhysicalDeviceProperties properties{};
+        vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+        
+        VkSamplerCreateInfo samplerInfo{};
+        samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+        samplerInfo.magFilter = VK_FILTER_LINEAR;
+        samplerInfo.minFilter = VK_FILTER_LINEAR;
+        samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+        samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+        samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+        samplerInfo.anisotropyEnable = VK_TRUE;
+        samplerInfo.maxAnisotropy = properties.limits.maxSamplerAnisotropy;
+        samplerInfo.borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK;
+        samplerInfo.unnormalizedCoordinates = VK_FALSE;
+        samplerInfo.compareEnable = VK_FALSE;
+        samplerInfo.compareOp = VK_COMPARE_OP_ALWAYS;
+        samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+        samplerInfo.minLod = 0.0f;
+        samplerInfo.maxLod = static_cast<float>(mipLevels);
+        samplerInfo.mipLodBias = 0.0f;
+        
+        if (vkCreateSampler(device, &samplerInfo, nullptr, &textureSampler) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create texture sampler!");
+        }
+    }
+    
+    VkImageView createImageView(VkImage image, VkFormat format, VkImageAspectFlags aspectFlags, uint32_t mipLevels) {
+        VkImageViewCreateInfo viewInfo{};
+        viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+        viewInfo.image = image;
+        viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+        viewInfo.format = format;
+        viewInfo.subresourceRange.aspectMask = aspectFlags;
+        viewInfo.subresourceRange.baseMipLevel = 0;
+        viewInfo.subresourceRange.levelCount = mipLevels;
+        viewInfo.subresourceRange.baseArrayLayer = 0;
+        viewInfo.subresourceRange.layerCount = 1;
+        
+        VkImageView imageView;
+        if (vkCreateImageView(device, &viewInfo, nullptr, &imageView) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create texture image view!");
         }
         
         return imageView;
     }
     
-    void createImage(uint32_t width, uint32_t height, uint32_t mipLevels, VkSampleCountFlagBits numSamples, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkImage& image, VkDeviceMemory& imageMemory) {
+    void createImage(uint32_t width, uint32_t height, uint32_t mipLevels, VkSampleCountFlagBits numSamples, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkImage& image, VkDeviceMemory& imageMemory, VkImageCreateFlags flags = 0) {
         VkImageCreateInfo imageInfo{};
         imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        imageInfo.flags = flags;
         imageInfo.imageType = VK_IMAGE_TYPE_2D;
         imageInfo.extent.width = width;
         imageInfo.extent.height = height;
@@ -1321,6 +2351,129 @@ private:
         vkFreeMemory(device, stagingBufferMemory, nullptr);
     }
     
+    /**
+     * Returns the transform of the given object in the scene grid.
+     *
+     * The objects are laid out in a square grid centered on the origin, each
+     * turned a quarter more than the last. The grid size is set by
+     * createSceneBuffers before any object is placed.
+     */
+    glm::mat4 getScenePlacement(uint32_t index) const {
+        glm::vec3 position((index % sceneSide) * SCENE_SPACING - sceneExtent, (index / sceneSide) * SCENE_SPACING - sceneExtent, 0.0f);
+        glm::mat4 model = glm::translate(glm::mat4(1.0f), position);
+        return glm::rotate(model, (index % 4) * glm::radians(90.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+    }
+    
+    /**
+     * Builds the instanced scene and uploads it to device local buffers.
+     *
+     * The scene is a square grid of sceneSize copies of the model. All of the
+     * instance data is uploaded once, so nothing is written per frame. This
+     * requires the storage buffer and texture table of the bindless path.
+     * Otherwise, this only computes the transforms pushed with each draw.
+     */
+    void createSceneBuffers() {
+        // The extent lets the camera frame the whole grid
+        sceneSide = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<float>(sceneSize))));
+        sceneExtent = (sceneSide - 1) * SCENE_SPACING * 0.5f;
+        
+        // Without descriptor indexing, each object is its own draw with push constants
+        if (!bindless) {
+            drawTransforms.resize(sceneSize);
+            for (uint32_t ii = 0; ii < sceneSize; ii++) {
+                drawTransforms[ii] = getScenePlacement(ii);
+            }
+            drawCount = sceneSize;
+            return;
+        }
+        
+        textureIndex = bindlessTable->addTexture(textureImageView, textureSampler);
+        
+        // The bounding sphere is centered on the bounding box, for culling
+        glm::vec3 lower(std::numeric_limits<float>::max());
+        glm::vec3 upper(std::numeric_limits<float>::lowest());
+        for (const auto& vertex : vertices) {
+            lower = glm::min(lower, vertex.pos);
+            upper = glm::max(upper, vertex.pos);
+        }
+        glm::vec3 center = (lower + upper) * 0.5f;
+        float radius = 0.0f;
+        for (const auto& vertex : vertices) {
+            radius = std::max(radius, glm::length(vertex.pos - center));
+        }
+        uint32_t mesh = scene.addMesh(static_cast<uint32_t>(indices.size()), 0, 0, glm::vec4(center, radius));
+        
+        for (uint32_t ii = 0; ii < sceneSize; ii++) {
+            scene.addInstance(mesh, getScenePlacement(ii), textureIndex);
+        }
+        scene.build();
+        
+        // The shaders index the instances directly, so they must all be in range
+        const auto& instances = scene.getInstances();
+        VkPhysicalDeviceProperties properties;
+        vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+        if (sizeof(SceneInstance) * instances.size() > properties.limits.maxStorageBufferRange) {
+            throw std::runtime_error("scene has more instances than a storage buffer can hold!");
+        }
+        createStaticBuffer(instances.data(), sizeof(SceneInstance) * instances.size(), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, instanceBuffer, instanceBufferMemory);
+        
+        // The draw count follows the commands, for vkCmdDrawIndexedIndirectCount
+        const auto& commands = scene.getCommands();
+        drawCountOffset = sizeof(VkDrawIndexedIndirectCommand) * commands.size();
+        std::vector<uint8_t> indirect(drawCountOffset + sizeof(uint32_t));
+        memcpy(indirect.data(), commands.data(), drawCountOffset);
+        uint32_t commandCount = scene.getDrawCount();
+        memcpy(indirect.data() + drawCountOffset, &commandCount, sizeof(uint32_t));
+        createStaticBuffer(indirect.data(), indirect.size(), VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, indirectBuffer, indirectBufferMemory);
+    }
+    
+    /**
+     * Creates a device local buffer with the given contents.
+     *
+     * This uploads through a staging buffer, like the vertex buffer.
+     */
+    void createStaticBuffer(const void* contents, VkDeviceSize bufferSize, VkBufferUsageFlags usage, VkBuffer& buffer, VkDeviceMemory& bufferMemory) {
+        VkBuffer stagingBuffer;
+        VkDeviceMemory stagingBufferMemory;
+        createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory);
+        
+        void* data;
+        vkMapMemory(device, stagingBufferMemory, 0, bufferSize, 0, &data);
+        memcpy(data, contents, (size_t) bufferSize);
+        vkUnmapMemory(device, stagingBufferMemory);
+        
+        createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | usage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, buffer, bufferMemory);
+        
+        copyBuffer(stagingBuffer, buffer, bufferSize);
+        
+        vkDestroyBuffer(device, stagingBuffer, nullptr);
+        vkFreeMemory(device, stagingBufferMemory, nullptr);
+    }
+    
+    /**
+     * Creates the GPU culler for the instanced scene, if it is supported.
+     *
+     * The culler compiles its compute pipelines in the background. Until
+     * they are ready, the scene is not drawn (like the graphics pipeline).
+     */
+    void createOcclusionCuller() {
+        if (!occlusionCulling) {
+            return;
+        }
+        
+        OcclusionCuller::Shaders shaders;
+        shaders.reduce.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+        shaders.reduce.code = getShader(msaaSamples == VK_SAMPLE_COUNT_1_BIT ? "shaders/depthreduce.spv" : "shaders/depthreduce_ms.spv");
+        shaders.pyramid.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+        shaders.pyramid.code = getShader("shaders/mipmap_hiz.spv");
+        shaders.cull.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+        shaders.cull.code = getShader("shaders/cull.spv");
+        
+        culler = std::make_unique<OcclusionCuller>(physicalDevice, device, *pipelines, shaders, scene, instanceBuffer,
+                                                   uniformBuffers, sizeof(UniformBufferObject), msaaSamples, findDepthFormat());
+        culler->resize(depthImage, depthImageView, swapChainExtent);
+    }
+    
     void createUniformBuffers() {
         VkDeviceSize bufferSize = sizeof(UniformBufferObject);
         
@@ -1336,67 +2489,83 @@ private:
     }
     
     void createDescriptorPool() {
-        std::array<VkDescriptorPoolSize, 2> poolSizes{};
-        poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-        poolSizes[0].descriptorCount = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
-        poolSizes[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-        poolSizes[1].descriptorCount = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
+        // Push descriptors do not come from a pool at all
+        if (pushDescriptors) {
+            return;
+        }
         
-        VkDescriptorPoolCreateInfo poolInfo{};
-        poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-        poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
-        poolInfo.pPoolSizes = poolSizes.data();
-        poolInfo.maxSets = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
+        // The per-frame sets are reallocated every frame, so each frame gets a growable allocator
+        VkDescriptorType objectType = bindless ? VK_DESCRIPTOR_TYPE_STORAGE_BUFFER : VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        std::vector<DescriptorAllocator::PoolRatio> ratios = {
+            {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1.0f},
+            {objectType, occlusionCulling ? 2.0f : 1.0f}
+        };
         
-        if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &descriptorPool) != VK_SUCCESS) {
-            throw std::runtime_error("failed to create descriptor pool!");
+        for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+            frameAllocators.push_back(std::make_unique<DescriptorAllocator>(device, ratios, 16));
         }
     }
     
     void createDescriptorSets() {
-        std::vector<VkDescriptorSetLayout> layouts(MAX_FRAMES_IN_FLIGHT, descriptorSetLayout);
-        VkDescriptorSetAllocateInfo allocInfo{};
-        allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-        allocInfo.descriptorPool = descriptorPool;
-        allocInfo.descriptorSetCount = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
-        allocInfo.pSetLayouts = layouts.data();
-        
-        descriptorSets.resize(MAX_FRAMES_IN_FLIGHT);
-        if (vkAllocateDescriptorSets(device, &allocInfo, descriptorSets.data()) != VK_SUCCESS) {
-            throw std::runtime_error("failed to allocate descriptor sets!");
-        }
-        
+        frameBindings.resize(MAX_FRAMES_IN_FLIGHT);
         for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-            VkDescriptorBufferInfo bufferInfo{};
-            bufferInfo.buffer = uniformBuffers[i];
-            bufferInfo.offset = 0;
-            bufferInfo.range = sizeof(UniformBufferObject);
+            FrameBindings& bindings = frameBindings[i];
+            bindings = {};
             
-            VkDescriptorImageInfo imageInfo{};
-            imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-            imageInfo.imageView = textureImageView;
-            imageInfo.sampler = textureSampler;
+            bindings.uniforms.buffer = uniformBuffers[i];
+            bindings.uniforms.offset = 0;
+            bindings.uniforms.range = sizeof(UniformBufferObject);
             
-            std::array<VkWriteDescriptorSet, 2> descriptorWrites{};
-            
-            descriptorWrites[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-            descriptorWrites[0].dstSet = descriptorSets[i];
-            descriptorWrites[0].dstBinding = 0;
-            descriptorWrites[0].dstArrayElement = 0;
-            descriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-            descriptorWrites[0].descriptorCount = 1;
-            descriptorWrites[0].pBufferInfo = &bufferInfo;
-            
-            descriptorWrites[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-            descriptorWrites[1].dstSet = descriptorSets[i];
-            descriptorWrites[1].dstBinding = 1;
-            descriptorWrites[1].dstArrayElement = 0;
-            descriptorWrites[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-            descriptorWrites[1].descriptorCount = 1;
-            descriptorWrites[1].pImageInfo = &imageInfo;
+            bindings.texture.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+            bindings.texture.imageView = textureImageView;
+            bindings.texture.sampler = textureSampler;
             
-            vkUpdateDescriptorSets(device, static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+            if (bindless) {
+                bindings.objects.buffer = instanceBuffer;
+                bindings.objects.offset = 0;
+                bindings.objects.range = VK_WHOLE_SIZE;
+            }
+            if (occlusionCulling) {
+                bindings.visible.buffer = culler->getVisibleBuffer();
+                bindings.visible.offset = 0;
+                bindings.visible.range = VK_WHOLE_SIZE;
+            }
+        }
+        
+        std::vector<DescriptorTemplate::Entry> entries(2);
+        entries[0] = {0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1, offsetof(FrameBindings, uniforms), sizeof(VkDescriptorBufferInfo)};
+        if (bindless) {
+            entries[1] = {1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, offsetof(FrameBindings, objects), sizeof(VkDescriptorBufferInfo)};
+        } else {
+            entries[1] = {1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, offsetof(FrameBindings, texture), sizeof(VkDescriptorImageInfo)};
+        }
+        if (occlusionCulling) {
+            entries.push_back({2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, offsetof(FrameBindings, visible), sizeof(VkDescriptorBufferInfo)});
         }
+        
+        if (pushDescriptors) {
+            frameTemplate = std::make_unique<DescriptorTemplate>(device, pipelineLayout, 0, descriptorSetLayout, entries);
+        } else {
+            frameTemplate = std::make_unique<DescriptorTemplate>(device, descriptorSetLayout, entries, updateTemplates);
+        }
+        descriptorSets.assign(MAX_FRAMES_IN_FLIGHT, VK_NULL_HANDLE);
+    }
+    
+    /**
+     * Allocates and writes the descriptor set for the given frame.
+     *
+     * The frame allocator is reset in bulk first, so the fence for this frame
+     * must have signaled. There is nothing to do with push descriptors, as
+     * the set is pushed as each command buffer is recorded.
+     */
+    void updateFrameDescriptors(uint32_t frame) {
+        if (pushDescriptors) {
+            return;
+        }
+        
+        frameAllocators[frame]->reset();
+        descriptorSets[frame] = frameAllocators[frame]->allocate(descriptorSetLayout);
+        frameTemplate->update(descriptorSets[frame], &frameBindings[frame]);
     }
     
     void createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, VkDeviceMemory& bufferMemory) {
@@ -1482,30 +2651,68 @@ private:
     }
     
     void createCommandBuffers() {
-        commandBuffers.resize(MAX_FRAMES_IN_FLIGHT);
-        
-        VkCommandBufferAllocateInfo allocInfo{};
-        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-        allocInfo.commandPool = commandPool;
-        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-        allocInfo.commandBufferCount = (uint32_t) commandBuffers.size();
-        
-        if (vkAllocateCommandBuffers(device, &allocInfo, commandBuffers.data()) != VK_SUCCESS) {
-            throw std::runtime_error("failed to allocate command buffers!");
-        }
+        QueueFamilyIndices queueFamilyIndices = familyIndices;
+        recorder = std::make_unique<ParallelRecorder>(device, queueFamilyIndices.graphicsFamily.value(), MAX_FRAMES_IN_FLIGHT, WorkerPool::shared());
     }
     
     void recordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t imageIndex) {
         VkCommandBufferBeginInfo beginInfo{};
         beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
         
         if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS) {
             throw std::runtime_error("failed to begin recording command buffer!");
         }
         
+        // The scene is a handful of indirect commands, so it does not need splitting
+        uint32_t draws = graphicsPipeline == VK_NULL_HANDLE ? 0 : (bindless ? 1 : drawCount);
+        
+        if (culler != nullptr) {
+            // Draw what was visible last frame, build the pyramid, then draw what that missed
+            draws = culler->isReady() ? draws : 0;
+            if (draws > 0) {
+                culler->recordEarly(commandBuffer, currentFrame);
+            }
+            recordRenderPass(commandBuffer, imageIndex, renderPass, draws, [this](VkCommandBuffer buffer, uint32_t first, uint32_t last) {
+                recordSceneDraws(buffer, culler->getDrawBuffer(), culler->getDrawOffset(OcclusionCuller::EARLY), culler->getCountOffset(OcclusionCuller::EARLY));
+            });
+            if (draws > 0) {
+                culler->recordPyramid(commandBuffer);
+                culler->recordLate(commandBuffer, currentFrame);
+            }
+            recordRenderPass(commandBuffer, imageIndex, lateRenderPass, draws, [this](VkCommandBuffer buffer, uint32_t first, uint32_t last) {
+                recordSceneDraws(buffer, culler->getDrawBuffer(), culler->getDrawOffset(OcclusionCuller::LATE), culler->getCountOffset(OcclusionCuller::LATE));
+            });
+        } else {
+            recordRenderPass(commandBuffer, imageIndex, renderPass, draws, [this](VkCommandBuffer buffer, uint32_t first, uint32_t last) {
+                if (bindless) {
+                    recordSceneDraws(buffer, indirectBuffer, 0, drawCountOffset);
+                } else {
+                    recordDraws(buffer, first, last);
+                }
+            });
+        }
+        
+        // The last headless frame copies its own image, rather than stalling for a separate copy
+        if (isHeadless() && !screenshotPath.empty() && headlessRendered + 1 == headlessFrames) {
+            offscreenTarget->recordReadback(commandBuffer, imageIndex);
+        }
+        
+        if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+            throw std::runtime_error("failed to record command buffer!");
+        }
+    }
+    
+    /**
+     * Records a render pass whose draws are recorded in parallel.
+     *
+     * The draws are recorded into secondary buffers by the given function,
+     * which is called from the worker threads.
+     */
+    void recordRenderPass(VkCommandBuffer commandBuffer, uint32_t imageIndex, VkRenderPass pass, uint32_t draws, const ParallelRecorder::RecordFunction& record) {
         VkRenderPassBeginInfo renderPassInfo{};
         renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-        renderPassInfo.renderPass = renderPass;
+        renderPassInfo.renderPass = pass;
         renderPassInfo.framebuffer = swapChainFramebuffers[imageIndex];
         renderPassInfo.renderArea.offset = {0, 0};
         renderPassInfo.renderArea.extent = swapChainExtent;
@@ -1517,8 +2724,81 @@ private:
         renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
         renderPassInfo.pClearValues = clearValues.data();
         
-        vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+        // The draws are recorded into secondary buffers in parallel
+        vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+        
+        VkCommandBufferInheritanceInfo inheritance{};
+        inheritance.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+        inheritance.renderPass = pass;
+        inheritance.subpass = 0;
+        inheritance.framebuffer = swapChainFramebuffers[imageIndex];
         
+        const auto& secondaries = recorder->recordPass(currentFrame, inheritance, draws, record);
+        if (!secondaries.empty()) {
+            vkCmdExecuteCommands(commandBuffer, static_cast<uint32_t>(secondaries.size()), secondaries.data());
+        }
+        
+        vkCmdEndRenderPass(commandBuffer);
+    }
+    
+    /**
+     * Records the draws [first, last) into a secondary command buffer.
+     *
+     * This is called from the worker threads. Each draw is one instance, so
+     * the recording cost grows with the number of objects. The per-draw data
+     * is pushed with the draw, so no descriptor or uniform buffer changes.
+     */
+    void recordDraws(VkCommandBuffer commandBuffer, uint32_t first, uint32_t last) {
+        bindDrawState(commandBuffer);
+        
+        DrawConstants constants{};
+        constants.model = glm::mat4(1.0f);
+        constants.material = textureIndex;
+        for (uint32_t draw = first; draw < last; draw++) {
+            // The benchmark may record more draws than there are objects, so
+            // they wrap (the bindless shader reads the instance at firstInstance)
+            uint32_t object = draw % sceneSize;
+            if (!drawTransforms.empty()) {
+                constants.model = drawTransforms[object];
+            }
+            constants.drawId = draw;
+            vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(DrawConstants), &constants);
+            vkCmdDrawIndexed(commandBuffer, static_cast<uint32_t>(indices.size()), 1, 0, 0, object);
+        }
+    }
+    
+    /**
+     * Records the entire scene into a secondary command buffer.
+     *
+     * This is a single indirect draw (or one per mesh, without multi-draw
+     * support), so the cost is the same no matter how many instances there
+     * are. With VK_KHR_draw_indirect_count, the number of draws is also read
+     * from the indirect buffer. The commands are either the static ones of
+     * the scene, or those of a culling phase.
+     */
+    void recordSceneDraws(VkCommandBuffer commandBuffer, VkBuffer buffer, VkDeviceSize offset, VkDeviceSize countOffset) {
+        bindDrawState(commandBuffer);
+        
+        uint32_t commandCount = scene.getDrawCount();
+        uint32_t stride = sizeof(VkDrawIndexedIndirectCommand);
+        if (indirectCount) {
+            drawIndexedIndirectCount(commandBuffer, buffer, offset, buffer, countOffset, commandCount, stride);
+        } else if (multiDrawIndirect) {
+            vkCmdDrawIndexedIndirect(commandBuffer, buffer, offset, commandCount, stride);
+        } else {
+            for (uint32_t ii = 0; ii < commandCount; ii++) {
+                vkCmdDrawIndexedIndirect(commandBuffer, buffer, offset + ii * stride, 1, stride);
+            }
+        }
+    }
+    
+    /**
+     * Binds the pipeline, geometry and descriptors into a secondary buffer.
+     *
+     * Secondary buffers inherit no state from the primary, so everything
+     * must be bound again for each one.
+     */
+    void bindDrawState(VkCommandBuffer commandBuffer) {
         vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline);
         
         VkViewport viewport{};
@@ -1541,14 +2821,21 @@ private:
         
         vkCmdBindIndexBuffer(commandBuffer, indexBuffer, 0, VK_INDEX_TYPE_UINT32);
         
-        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &descriptorSets[currentFrame], 0, nullptr);
-        
-        vkCmdDrawIndexed(commandBuffer, static_cast<uint32_t>(indices.size()), 1, 0, 0, 0);
-        
-        vkCmdEndRenderPass(commandBuffer);
-        
-        if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
-            throw std::runtime_error("failed to record command buffer!");
+        // With descriptor indexing, this is the only bind (each draw picks its data by instance)
+        if (pushDescriptors) {
+            frameTemplate->push(commandBuffer, pipelineLayout, 0, &frameBindings[currentFrame]);
+            if (bindless) {
+                VkDescriptorSet table = bindlessTable->getSet();
+                vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 1, 1, &table, 0, nullptr);
+            }
+        } else {
+            std::array<VkDescriptorSet, 2> sets = {descriptorSets[currentFrame], VK_NULL_HANDLE};
+            uint32_t setCount = 1;
+            if (bindless) {
+                sets[1] = bindlessTable->getSet();
+                setCount = 2;
+            }
+            vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, setCount, sets.data(), 0, nullptr);
         }
     }
     
@@ -1581,16 +2868,20 @@ private:
         }
     }
     
+    // The seconds since startup, which can be pinned to a fixed step per frame
+    std::function<float()> timeSource = [start = std::chrono::steady_clock::now()]() {
+        return std::chrono::duration<float>(std::chrono::steady_clock::now() - start).count();
+    };
+    
     void updateUniformBuffer(uint32_t currentImage) {
-        static auto startTime = std::chrono::high_resolution_clock::now();
-        
-        auto currentTime = std::chrono::high_resolution_clock::now();
-        float time = std::chrono::duration<float, std::chrono::seconds::period>(currentTime - startTime).count();
+        float time = timeSource();
         
         UniformBufferObject ubo{};
         ubo.model = glm::rotate(glm::mat4(1.0f), time * glm::radians(90.0f), glm::vec3(0.0f, 0.0f, 1.0f));
-        ubo.view = glm::lookAt(glm::vec3(2.0f, 2.0f, 2.0f), glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f));
-        ubo.proj = glm::perspective(glm::radians(45.0f), swapChainExtent.width / (float) swapChainExtent.height, 0.1f, 10.0f);
+        // Back the camera away far enough to see the whole scene
+        float distance = 2.0f + 1.5f * sceneExtent;
+        ubo.view = glm::lookAt(glm::vec3(distance, distance, distance), glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+        ubo.proj = glm::perspective(glm::radians(45.0f), swapChainExtent.width / (float) swapChainExtent.height, 0.1f, 10.0f + 4.0f * sceneExtent);
         ubo.proj[1][1] *= -1;
         
         memcpy(uniformBuffersMapped[currentImage], &ubo, sizeof(ubo));
@@ -1599,8 +2890,12 @@ private:
     void drawFrame() {
         vkWaitForFences(device, 1, &inFlightFences[currentFrame], VK_TRUE, UINT64_MAX);
         
-        uint32_t imageIndex;
-        VkResult result = vkAcquireNextImageKHR(device, swapChain, UINT64_MAX, imageAvailableSemaphores[currentFrame], VK_NULL_HANDLE, &imageIndex);
+        // Offscreen images are never acquired, as the fence already freed the image of this slot
+        uint32_t imageIndex = currentFrame;
+        VkResult result = VK_SUCCESS;
+        if (!isHeadless()) {
+            result = vkAcquireNextImageKHR(device, swapChain, UINT64_MAX, imageAvailableSemaphores[currentFrame], VK_NULL_HANDLE, &imageIndex);
+        }
         
         if (result == VK_ERROR_OUT_OF_DATE_KHR || framebufferResized) {
             recreateSwapChain();
@@ -1610,32 +2905,47 @@ private:
         }
         
         updateUniformBuffer(currentFrame);
+        updateFrameDescriptors(currentFrame);
+        if (culler != nullptr && cullingStats) {
+            logCullingStats();
+        }
+        
+        // Skip the draws (but still clear) until the pipeline is compiled.
+        // With pipeline libraries, this switches to the optimized link later.
+        graphicsPipeline = PipelineService::poll(graphicsPipelineRequest);
         
         vkResetFences(device, 1, &inFlightFences[currentFrame]);
         
-        vkResetCommandBuffer(commandBuffers[currentFrame], /*VkCommandBufferResetFlagBits*/ 0);
-        recordCommandBuffer(commandBuffers[currentFrame], imageIndex);
+        VkCommandBuffer commandBuffer = recorder->beginFrame(currentFrame);
+        recordCommandBuffer(commandBuffer, imageIndex);
         
         VkSubmitInfo submitInfo{};
         submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
         
         VkSemaphore waitSemaphores[] = {imageAvailableSemaphores[currentFrame]};
         VkPipelineStageFlags waitStages[] = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
-        submitInfo.waitSemaphoreCount = 1;
+        submitInfo.waitSemaphoreCount = isHeadless() ? 0 : 1;
         submitInfo.pWaitSemaphores = waitSemaphores;
         submitInfo.pWaitDstStageMask = waitStages;
         
         submitInfo.commandBufferCount = 1;
-        submitInfo.pCommandBuffers = &commandBuffers[currentFrame];
+        submitInfo.pCommandBuffers = &commandBuffer;
         
         VkSemaphore signalSemaphores[] = {renderFinishedSemaphores[imageIndex]};
-        submitInfo.signalSemaphoreCount = 1;
+        submitInfo.signalSemaphoreCount = isHeadless() ? 0 : 1;
         submitInfo.pSignalSemaphores = signalSemaphores;
         
         if (vkQueueSubmit(graphicsQueue, 1, &submitInfo, inFlightFences[currentFrame]) != VK_SUCCESS) {
             throw std::runtime_error("failed to submit draw command buffer!");
         }
         
+        // There is nothing to present to, so the frame is done
+        if (isHeadless()) {
+            markStartup();
+            currentFrame = (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
+            return;
+        }
+        
         VkPresentInfoKHR presentInfo{};
         presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
         
@@ -1657,21 +2967,57 @@ private:
             throw std::runtime_error("failed to present swap chain image!");
         }
         
+        markStartup();
         currentFrame = (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
     }
     
-    VkShaderModule createShaderModule(const std::vector<char>& code) {
-        VkShaderModuleCreateInfo createInfo{};
-        createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-        createInfo.codeSize = code.size();
-        createInfo.pCode = reinterpret_cast<const uint32_t*>(code.data());
+    /**
+     * Marks the end of startup once a frame is presented.
+     *
+     * The first frame is only cleared if the graphics pipeline is still
+     * compiling, so startup ends at the first frame that draws the scene.
+     * Both are logged, with the full breakdown and trace if requested.
+     */
+    void markStartup() {
+        if (startup == nullptr) {
+            return;
+        }
         
-        VkShaderModule shaderModule;
-        if (vkCreateShaderModule(device, &createInfo, nullptr, &shaderModule) != VK_SUCCESS) {
-            throw std::runtime_error("failed to create shader module!");
+        if (!firstFrameMarked) {
+            startup->mark("first frame");
+            firstFrameMarked = true;
+        }
+        if (graphicsPipeline == VK_NULL_HANDLE) {
+            return;
+        }
+        
+        double drawn = startup->mark("first draw");
+        if (!startupTracePath.empty()) {
+            startup->logTimings();
+            startup->writeTrace(startupTracePath);
+        }
+        SDL_Log("Time to first frame: %.3f ms", drawn / 1000.0);
+        startup.reset();
+    }
+    
+    /**
+     * Logs the culling counts about once a second.
+     *
+     * The counts come from the readback ring, and are from the last time
+     * this frame was submitted, so the fence must have signaled.
+     */
+    void logCullingStats() {
+        Uint64 now = SDL_GetTicks();
+        if (now - cullingLogTime < 1000) {
+            return;
         }
+        cullingLogTime = now;
         
-        return shaderModule;
+        CullingStats stats = culler->getStats(currentFrame);
+        uint32_t total = scene.getInstanceCount();
+        uint32_t drawn = stats.earlyDraws + stats.lateDraws;
+        SDL_Log("Culling: %u of %u instances drawn (%u early, %u late), %u outside the frustum, %u occluded",
+                drawn, total, stats.earlyDraws, stats.lateDraws, stats.frustumCulled, stats.occlusionCulled);
     }
     
     VkSurfaceFormatKHR chooseSwapSurfaceFormat(const std::vector<VkSurfaceFormatKHR>& availableFormats) {
@@ -1736,8 +3082,8 @@ private:
         
         bool extensionsSupported = checkDeviceExtensionSupport(device);
         
-        bool swapChainAdequate = false;
-        if (extensionsSupported) {
+        bool swapChainAdequate = isHeadless();
+        if (extensionsSupported && !isHeadless()) {
             SwapChainSupportDetails swapChainSupport = querySwapChainSupport(device);
             swapChainAdequate = !swapChainSupport.formats.empty() && !swapChainSupport.presentModes.empty();
         }
@@ -1749,6 +3095,10 @@ private:
     }
     
     bool checkDeviceExtensionSupport(VkPhysicalDevice device) {
+        if (isHeadless()) {
+            return true;
+        }
+        
         uint32_t extensionCount;
         vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
         
@@ -1779,8 +3129,13 @@ private:
                 indices.graphicsFamily = i;
             }
             
+            // Without a surface, the graphics family stands in for the present family
             VkBool32 presentSupport = false;
-            vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &presentSupport);
+            if (isHeadless()) {
+                presentSupport = (queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) ? VK_TRUE : VK_FALSE;
+            } else {
+                vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &presentSupport);
+            }
             
             if (presentSupport) {
                 indices.presentFamily = i;
@@ -1797,9 +3152,13 @@ private:
     }
     
     std::vector<const char*> getRequiredExtensions() {
-        uint32_t extensionCount = 0;
-        const char * const *instance_extensions = SDL_Vulkan_GetInstanceExtensions(&extensionCount);
-        std::vector<const char*> extensions(instance_extensions,instance_extensions+extensionCount);
+        // Headless mode has no surface, so it needs none of the surface extensions
+        std::vector<const char*> extensions;
+        if (!isHeadless()) {
+            uint32_t extensionCount = 0;
+            const char * const *instance_extensions = SDL_Vulkan_GetInstanceExtensions(&extensionCount);
+            extensions.assign(instance_extensions,instance_extensions+extensionCount);
+        }
         
         if (enableValidationLayers) {
             extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
@@ -1835,6 +3194,32 @@ private:
         return true;
     }
     
+    /**
+     * Reads the given shader file ahead of the pipelines that need it.
+     *
+     * This runs on a worker during startup, and only writes the entry of this
+     * file (which must already be in the map). Every variant is read, so a
+     * file that is missing is ignored here, and reported if it is used.
+     */
+    void preloadShader(const std::string& path) {
+        try {
+            shaderCode.find(path)->second = std::make_shared<const std::vector<char>>(readFile(path));
+        } catch (const std::exception&) {
+            // getShader reports the file if it is actually needed
+        }
+    }
+    
+    /**
+     * Returns the code of the given shader file, reading it if necessary.
+     */
+    std::shared_ptr<const std::vector<char>> getShader(const std::string& path) {
+        auto it = shaderCode.find(path);
+        if (it != shaderCode.end() && it->second != nullptr) {
+            return it->second;
+        }
+        return std::make_shared<const std::vector<char>>(readFile(path));
+    }
+    
     static std::vector<char> readFile(const std::string& filename) {
         std::string path = get_asset(filename);
         SDL_IOStream* file = SDL_IOFromFile(path.c_str(), "rb");
@@ -1866,7 +3251,88 @@ public:
     
     ~ModelApplication() { cleanup(); }
     
+    /**
+     * Replaces the clock that animates the scene.
+     *
+     * The clock returns seconds, and is read once per frame. A pinned clock
+     * makes every run draw the same frames, so that they can be compared.
+     */
+    void setTimeSource(std::function<float()> source) {
+        timeSource = std::move(source);
+    }
+    
+    /**
+     * Sets the number of model instances in the scene.
+     *
+     * This must be called before {@link setup}.
+     */
+    void setSceneSize(uint32_t size) {
+        sceneSize = std::max(1u, std::min(size, MAX_SCENE_INSTANCES));
+    }
+    
+    /**
+     * Sets the size of the texture, and whether to mipmap it with blits
+     *
+     * A size of 0x0 keeps the size of the asset. Otherwise the texture is
+     * resampled to that size after it is decoded. Blits replace the compute
+     * downsampler, so that the mipmap times logged at startup can be compared.
+     * This must be called before {@link setup}.
+     */
+    void setMipmapTest(VkExtent2D size, bool blits) {
+        textureSize = size;
+        blitMipmaps = blits;
+    }
+    
+    /**
+     * Sets whether to cull the scene on the GPU, and whether to log the counts
+     *
+     * This must be called before {@link setup}.
+     */
+    void setCulling(bool enable, bool stats) {
+        cullingEnabled = enable;
+        cullingStats = stats;
+    }
+    
+    /**
+     * Sets the file to save the startup trace to
+     *
+     * The trace is a Chrome trace of every startup step, up to the first
+     * frame that draws the scene. This must be called before {@link setup}.
+     */
+    void setStartupTrace(const std::string& path) {
+        startupTracePath = path;
+    }
+    
+    /**
+     * Renders the given number of frames offscreen, with no window or surface.
+     *
+     * The last frame is saved as a PNG if the screenshot path is not empty.
+     * The clock is pinned to 1/60 s per frame, unless it is set again later.
+     * This must be called before {@link setup}, and 0 frames opens a window.
+     */
+    void setHeadless(uint32_t frames, VkExtent2D extent, const std::string& screenshot) {
+        headlessFrames = frames;
+        headlessExtent = extent;
+        screenshotPath = screenshot;
+        if (frames > 0) {
+            setTimeSource([frame = 0u]() mutable { return frame++ * HEADLESS_FRAME_TIME / 1000.0f; });
+        }
+    }
+    
+    /**
+     * Saves the frame times of a headless run to the given file as JSON.
+     *
+     * The first warmup frames are not counted. This must be called before
+     * {@link setup}, and only applies to headless runs.
+     */
+    void setBenchmark(const std::string& path, uint32_t warmup) {
+        benchPath = path;
+        benchReport = std::make_unique<BenchReport>("msaa-model", warmup);
+    }
+    
     bool setup() {
+        startup = std::make_unique<InitGraph>(WorkerPool::shared());
+        
         // Set the basic metadata
         if (!SDL_SetAppMetadata("Vulkan Tutorial", "1.0.0","com.vulkan-tutorial.tutorial8")) {
             SDL_Log("Setup Error: %s\n", SDL_GetError());
@@ -1876,12 +3342,15 @@ public:
             SDL_Log("Setup Error: Failed to create window\n");
             return false;
         }
+        startup->mark("window");
         if (!initVulkan()) {
             SDL_Log("Setup Error: Failed to initialize Vulkan\n");
             return false;
         }
 
-        SDL_RaiseWindow(window);
+        if (window != NULL) {
+            SDL_RaiseWindow(window);
+        }
         return true;
     }
     
@@ -1896,10 +3365,181 @@ public:
         return true;
     }
     
-    void run() {
+    // Saves the benchmark results once the last headless frame is done
+    void writeBenchmark() {
+        if (memoryBudgetEnabled) {
+            benchReport->sampleDeviceMemory(physicalDevice);
+        }
+        
+        VkPhysicalDeviceProperties props;
+        vkGetPhysicalDeviceProperties(physicalDevice, &props);
+        benchReport->setParameter("tutorial", "tutorial8");
+        benchReport->setParameter("device", props.deviceName);
+        benchReport->setParameter("width", windowExtent.width);
+        benchReport->setParameter("height", windowExtent.height);
+        benchReport->setParameter("instances", scene.getInstanceCount());
+        benchReport->setParameter("msaa", static_cast<double>(msaaSamples));
+        benchReport->setParameter("culling", occlusionCulling ? "gpu" : "none");
+        benchReport->write(benchPath);
+    }
+    
+    // Returns false once a headless run has rendered all of its frames
+    bool run() {
+        if (isHeadless() && headlessRendered == 0) {
+            headlessStart = SDL_GetTicks()/1000.0;
+        }
+        auto frameStart = std::chrono::steady_clock::now();
         drawFrame();
+        if (isHeadless()) {
+            headlessRendered++;
+            if (benchReport != nullptr) {
+                std::chrono::duration<double, std::milli> frameTime = std::chrono::steady_clock::now() - frameStart;
+                benchReport->addFrame(frameTime.count());
+                // The budget query is not free, so memory is only sampled every 30 frames
+                if (memoryBudgetEnabled && headlessRendered % 30 == 0) {
+                    benchReport->sampleDeviceMemory(physicalDevice);
+                }
+            }
+            if (headlessRendered < headlessFrames) {
+                return true;
+            }
+            
+            double elapsed = SDL_GetTicks()/1000.0 - headlessStart;
+            SDL_Log("Rendered %u headless frames in %.3f s", headlessRendered, elapsed);
+            if (!screenshotPath.empty()) {
+                // The last frame already copied its image, so this only waits for that frame
+                vkDeviceWaitIdle(device);
+                offscreenTarget->saveReadback(screenshotPath);
+            }
+            if (benchReport != nullptr) {
+                // Waits for the last frame, so that its memory is counted
+                vkDeviceWaitIdle(device);
+                writeBenchmark();
+            }
+            return false;
+        }
+        return true;
+    }
+    
+    /**
+     * Logs the time to record 10k-100k draws for a range of thread counts.
+     *
+     * This only measures CPU recording time; nothing is submitted. The draws
+     * are recorded against the first framebuffer with the normal pipeline.
+     */
+    void benchmarkRecording() {
+        const uint32_t drawCounts[] = { 10000, 25000, 50000, 100000 };
+        const uint32_t iterations = 10;
+        
+        uint32_t maxThreads = WorkerPool::shared().size()+1;
+        std::vector<uint32_t> threadCounts;
+        for (uint32_t threads = 1; threads < maxThreads; threads *= 2) {
+            threadCounts.push_back(threads);
+        }
+        threadCounts.push_back(maxThreads);
+        
+        VkCommandBufferInheritanceInfo inheritance{};
+        inheritance.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+        inheritance.renderPass = renderPass;
+        inheritance.subpass = 0;
+        inheritance.framebuffer = swapChainFramebuffers[0];
+        
+        // The draws need a valid descriptor set and a compiled pipeline
+        vkDeviceWaitIdle(device);
+        updateFrameDescriptors(currentFrame);
+        graphicsPipeline = graphicsPipelineRequest.get();
+        
+        QueueFamilyIndices queueFamilyIndices = familyIndices;
+        auto record = [this](VkCommandBuffer buffer, uint32_t first, uint32_t last) {
+            recordDraws(buffer, first, last);
+        };
+        
+        for (uint32_t draws : drawCounts) {
+            double baseline = 0;
+            for (uint32_t threads : threadCounts) {
+                ParallelRecorder bench(device, queueFamilyIndices.graphicsFamily.value(), 1, WorkerPool::shared(), threads);
+                
+                // The first pass allocates the buffers, so it is not timed
+                bench.beginFrame(0);
+                bench.recordPass(0, inheritance, draws, record);
+                
+                Uint64 elapsed = 0;
+                for (uint32_t ii = 0; ii < iterations; ii++) {
+                    bench.beginFrame(0);
+                    Uint64 start = SDL_GetTicksNS();
+                    bench.recordPass(0, inheritance, draws, record);
+                    elapsed += SDL_GetTicksNS()-start;
+                }
+                
+                double millis = elapsed/(iterations*1000000.0);
+                if (threads == 1) {
+                    baseline = millis;
+                }
+                SDL_Log("Recorded %6u draws on %2u threads in %8.3f ms (%.2fx)", draws, threads, millis, baseline/millis);
+            }
+        }
     }
 
+    /**
+     * Logs the time to create a set of variants of the graphics pipeline.
+     *
+     * The variants differ in cull mode, winding, and blending. Each is timed
+     * with monolithic pipelines, and with pipeline libraries if supported.
+     * A fresh service (with an empty cache) is used for each run, and the
+     * base pipeline is compiled first so that only the variants are timed.
+     */
+    void benchmarkPipelines() {
+        const VkCullModeFlags cullModes[] = { VK_CULL_MODE_NONE, VK_CULL_MODE_FRONT_BIT, VK_CULL_MODE_BACK_BIT, VK_CULL_MODE_FRONT_AND_BACK };
+        const VkFrontFace frontFaces[] = { VK_FRONT_FACE_COUNTER_CLOCKWISE, VK_FRONT_FACE_CLOCKWISE };
+        
+        std::vector<GraphicsPipelineState> variants;
+        for (auto cullMode : cullModes) {
+            for (auto frontFace : frontFaces) {
+                for (VkBool32 blend : { VK_FALSE, VK_TRUE }) {
+                    GraphicsPipelineState variant = graphicsPipelineState;
+                    variant.cullMode = cullMode;
+                    variant.frontFace = frontFace;
+                    variant.blendAttachments[0].blendEnable = blend;
+                    variant.blendAttachments[0].srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
+                    variant.blendAttachments[0].dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+                    variant.blendAttachments[0].colorBlendOp = VK_BLEND_OP_ADD;
+                    variant.blendAttachments[0].srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+                    variant.blendAttachments[0].dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
+                    variant.blendAttachments[0].alphaBlendOp = VK_BLEND_OP_ADD;
+                    variants.push_back(variant);
+                }
+            }
+        }
+        
+        for (bool useLibraries : { false, true }) {
+            if (useLibraries && !pipelineLibraries) {
+                SDL_Log("Pipeline libraries are not supported on this device");
+                break;
+            }
+            
+            PipelineService service(device, {}, useLibraries);
+            service.request(graphicsPipelineState).get();
+            service.wait();
+            
+            std::vector<PipelineService::Request> requests;
+            Uint64 start = SDL_GetTicksNS();
+            for (const auto& variant : variants) {
+                requests.push_back(service.request(variant));
+            }
+            Uint64 issued = SDL_GetTicksNS();
+            for (const auto& request : requests) {
+                request.get();
+            }
+            Uint64 usable = SDL_GetTicksNS();
+            service.wait();
+            Uint64 optimized = SDL_GetTicksNS();
+            
+            SDL_Log("%s: %zu variants requested in %.3f ms, usable in %.3f ms, final in %.3f ms",
+                    useLibraries ? "Pipeline libraries" : "Monolithic pipelines", variants.size(),
+                    (issued-start)/1000000.0, (usable-start)/1000000.0, (optimized-start)/1000000.0);
+        }
+    }
+    
     void wait() {
         vkDeviceWaitIdle(device);
     }
@@ -1910,7 +3550,111 @@ public:
 SDL_AppResult SDL_AppInit(void **appstate, int argc, char *argv[]) {
     ModelApplication* app = new ModelApplication();
     *appstate = app;
+    
+    // Passing --headless FRAMES (or setting VULKANSDL_HEADLESS=FRAMES) renders offscreen, and --screenshot FILE saves the last frame
+    uint32_t headless = 0;
+    std::string screenshot;
+    VkExtent2D size = {WIDTH, HEIGHT};
+    const char* headlessEnv = SDL_getenv("VULKANSDL_HEADLESS");
+    if (headlessEnv != nullptr) {
+        headless = static_cast<uint32_t>(strtoul(headlessEnv, nullptr, 10));
+    }
+    for (int ii = 1; ii+1 < argc; ii++) {
+        if (strcmp(argv[ii], "--headless") == 0) {
+            headless = static_cast<uint32_t>(strtoul(argv[ii+1], nullptr, 10));
+        } else if (strcmp(argv[ii], "--screenshot") == 0) {
+            screenshot = argv[ii+1];
+        } else if (strcmp(argv[ii], "--size") == 0 && SDL_sscanf(argv[ii+1], "%ux%u", &size.width, &size.height) != 2) {
+            SDL_Log("Unknown size %s", argv[ii+1]);
+        }
+    }
+    if (!screenshot.empty() && headless == 0) {
+        SDL_Log("Screenshots are only saved in headless mode");
+    }
+    app->setHeadless(headless, size, screenshot);
+    
+    // Passing --fixed-step MS pins the animation clock, advancing it MS per frame
+    for (int ii = 1; ii+1 < argc; ii++) {
+        if (strcmp(argv[ii], "--fixed-step") == 0) {
+            float step = strtof(argv[ii+1], nullptr) / 1000.0f;
+            app->setTimeSource([step, frame = 0u]() mutable { return frame++ * step; });
+        }
+    }
+    
+    // Passing --bench FILE saves the frame times of a headless run, after --warmup N frames
+    std::string bench;
+    uint32_t warmup = 60;
+    for (int ii = 1; ii+1 < argc; ii++) {
+        if (strcmp(argv[ii], "--bench") == 0) {
+            bench = argv[ii+1];
+        } else if (strcmp(argv[ii], "--warmup") == 0) {
+            warmup = static_cast<uint32_t>(strtoul(argv[ii+1], nullptr, 10));
+        }
+    }
+    if (!bench.empty() && headless == 0) {
+        SDL_Log("Benchmarks are only run in headless mode");
+    } else if (!bench.empty()) {
+        app->setBenchmark(bench, warmup);
+    }
+    
+    // Passing --scene N draws N copies of the model (e.g. 10000 to 100000)
+    for (int ii = 1; ii+1 < argc; ii++) {
+        if (strcmp(argv[ii], "--scene") == 0) {
+            app->setSceneSize(static_cast<uint32_t>(strtoul(argv[ii+1], nullptr, 10)));
+        }
+    }
+    
+    // Passing --no-culling draws every instance; --culling-stats logs the counts
+    bool culling = true;
+    bool cullingStats = false;
+    for (int ii = 1; ii < argc; ii++) {
+        culling = culling && strcmp(argv[ii], "--no-culling") != 0;
+        cullingStats = cullingStats || strcmp(argv[ii], "--culling-stats") == 0;
+    }
+    app->setCulling(culling, cullingStats);
+    
+    // Passing --texture-size WxH resamples the texture; --blit-mipmaps skips the compute downsampler
+    VkExtent2D textureSize = {0, 0};
+    bool blitMipmaps = false;
+    for (int ii = 1; ii < argc; ii++) {
+        blitMipmaps = blitMipmaps || strcmp(argv[ii], "--blit-mipmaps") == 0;
+        if (ii+1 < argc && strcmp(argv[ii], "--texture-size") == 0 && SDL_sscanf(argv[ii+1], "%ux%u", &textureSize.width, &textureSize.height) != 2) {
+            SDL_Log("Unknown texture size %s", argv[ii+1]);
+            textureSize = {0, 0};
+        }
+    }
+    app->setMipmapTest(textureSize, blitMipmaps);
+    
+    // Passing --startup-trace FILE saves the startup steps as a Chrome trace
+    for (int ii = 1; ii+1 < argc; ii++) {
+        if (strcmp(argv[ii], "--startup-trace") == 0) {
+            app->setStartupTrace(argv[ii+1]);
+        }
+    }
+    
     if (app->setup()) {
+        // Passing --record-benchmark measures command recording and quits
+        for (int ii = 1; ii < argc; ii++) {
+            if (strcmp(argv[ii], "--record-benchmark") == 0) {
+                try {
+                    app->benchmarkRecording();
+                } catch (const std::exception& e) {
+                    std::cerr << e.what() << std::endl;
+                    return SDL_APP_FAILURE;
+                }
+                return SDL_APP_SUCCESS;
+            }
+            // Passing --pipeline-benchmark measures pipeline variants and quits
+            if (strcmp(argv[ii], "--pipeline-benchmark") == 0) {
+                try {
+                    app->benchmarkPipelines();
+                } catch (const std::exception& e) {
+                    std::cerr << e.what() << std::endl;
+                    return SDL_APP_FAILURE;
+                }
+                return SDL_APP_SUCCESS;
+            }
+        }
         return SDL_APP_CONTINUE;
     }
     return SDL_APP_FAILURE;
@@ -1919,7 +3663,9 @@ SDL_AppResult SDL_AppInit(void **appstate, int argc, char *argv[]) {
 SDL_AppResult SDL_AppIterate(void *appstate) {
     ModelApplication* app = (ModelApplication*)appstate;
     try {
-        app->run();
+        if (!app->run()) {
+            return SDL_APP_SUCCESS;
+        }
     } catch (const std::exception& e) {
         std::cerr << e.what() << std::endl;
         return SDL_APP_FAILURE;
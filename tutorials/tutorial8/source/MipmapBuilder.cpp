@@ -0,0 +1,393 @@
+//
+//  MipmapBuilder.cpp
+//  Tutorial8
+//
+//  A CPU implementation of mipmap generation. The tutorial generates mipmaps
+//  with vkCmdBlitImage, which requires that the texture format support linear
+//  filtering. That is not true of every format on every (mobile) device. In
+//  that case we build the entire mip chain on the CPU and upload it in one go.
+//
+//  This module does not depend on Vulkan, so it can also be used to cook mip
+//  chains offline. The filters are vectorized with SSE2 or NEON when either
+//  is available, and the rows of each level are spread over a WorkerPool.
+//
+//  Version: 10/18/26
+//
+#include "MipmapBuilder.h"
+#include "WorkerPool.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #include <emmintrin.h>
+    #define MIPMAP_SSE2
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__) || defined(_M_ARM64)
+    #include <arm_neon.h>
+    #define MIPMAP_NEON
+#endif
+
+namespace {
+
+/** The number of entries in the linear to sRGB table */
+const uint32_t SRGB_TABLE_SIZE = 4096;
+/** Levels with fewer pixels than this are not worth splitting up */
+const uint32_t SERIAL_PIXELS = 64*64;
+/** The target number of destination pixels for each parallel task */
+const uint32_t TASK_PIXELS = 16384;
+/** The maximum number of taps in a filter kernel */
+const uint32_t MAX_TAPS = 8;
+
+// SIMD ABSTRACTION
+// Each float4 is a single RGBA pixel. This is not the widest use of the
+// vector units, but it keeps the filters simple and works on both ISAs.
+
+#if defined(MIPMAP_SSE2)
+typedef __m128 float4;
+
+inline float4 f4_load(const float* p) { return _mm_loadu_ps(p); }
+inline void f4_store(float* p, float4 v) { _mm_storeu_ps(p, v); }
+inline float4 f4_splat(float s) { return _mm_set1_ps(s); }
+inline float4 f4_madd(float4 acc, float4 a, float4 b) { return _mm_add_ps(acc, _mm_mul_ps(a, b)); }
+
+inline void f4_quantize(float4 v, float4 scale, int32_t* out) {
+    v = _mm_min_ps(_mm_max_ps(v, _mm_setzero_ps()), _mm_set1_ps(1.0f));
+    v = _mm_add_ps(_mm_mul_ps(v, scale), _mm_set1_ps(0.5f));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm_cvttps_epi32(v));
+}
+
+#elif defined(MIPMAP_NEON)
+typedef float32x4_t float4;
+
+inline float4 f4_load(const float* p) { return vld1q_f32(p); }
+inline void f4_store(float* p, float4 v) { vst1q_f32(p, v); }
+inline float4 f4_splat(float s) { return vdupq_n_f32(s); }
+inline float4 f4_madd(float4 acc, float4 a, float4 b) { return vmlaq_f32(acc, a, b); }
+
+inline void f4_quantize(float4 v, float4 scale, int32_t* out) {
+    v = vminq_f32(vmaxq_f32(v, vdupq_n_f32(0.0f)), vdupq_n_f32(1.0f));
+    v = vmlaq_f32(vdupq_n_f32(0.5f), v, scale);
+    vst1q_s32(out, vcvtq_s32_f32(v));
+}
+
+#else
+struct float4 { float v[4]; };
+
+inline float4 f4_load(const float* p) { return { p[0], p[1], p[2], p[3] }; }
+inline void f4_store(float* p, float4 v) { std::memcpy(p, v.v, sizeof(v.v)); }
+inline float4 f4_splat(float s) { return { s, s, s, s }; }
+
+inline float4 f4_madd(float4 acc, float4 a, float4 b) {
+    for (int ii = 0; ii < 4; ii++) {
+        acc.v[ii] += a.v[ii]*b.v[ii];
+    }
+    return acc;
+}
+
+inline void f4_quantize(float4 v, float4 scale, int32_t* out) {
+    for (int ii = 0; ii < 4; ii++) {
+        out[ii] = static_cast<int32_t>(std::min(std::max(v.v[ii], 0.0f), 1.0f)*scale.v[ii]+0.5f);
+    }
+}
+#endif
+
+// CONVERSION TABLES
+
+/**
+ * Lookup tables for converting between bytes and floats
+ */
+struct ConversionTables {
+    /** sRGB encoded bytes to linear floats */
+    float srgbToLinear[256];
+    /** Linear bytes to floats */
+    float unitToLinear[256];
+    /** Quantized linear floats to sRGB encoded bytes */
+    uint8_t linearToSrgb[SRGB_TABLE_SIZE];
+
+    ConversionTables() {
+        for (uint32_t ii = 0; ii < 256; ii++) {
+            float c = ii/255.0f;
+            srgbToLinear[ii] = c <= 0.04045f ? c/12.92f : std::pow((c+0.055f)/1.055f, 2.4f);
+            unitToLinear[ii] = c;
+        }
+        for (uint32_t ii = 0; ii < SRGB_TABLE_SIZE; ii++) {
+            float c = ii/float(SRGB_TABLE_SIZE-1);
+            c = c <= 0.0031308f ? c*12.92f : 1.055f*std::pow(c, 1.0f/2.4f)-0.055f;
+            linearToSrgb[ii] = static_cast<uint8_t>(std::min(c*255.0f+0.5f, 255.0f));
+        }
+    }
+};
+
+/**
+ * Returns the conversion tables, building them on first use
+ *
+ * @return the conversion tables, building them on first use
+ */
+const ConversionTables& conversion_tables() {
+    static const ConversionTables tables;
+    return tables;
+}
+
+// FILTER KERNELS
+
+/**
+ * A separable downsampling kernel.
+ *
+ * Destination texel i covers source texels 2i and 2i+1. Its taps are at the
+ * source texels 2i+first through 2i+first+taps-1, clamped to the edge.
+ */
+struct Kernel {
+    /** The offset of the first tap from 2i */
+    int32_t first;
+    /** The number of taps */
+    uint32_t taps;
+    /** The normalized tap weights */
+    float weights[MAX_TAPS];
+};
+
+/**
+ * Returns the modified Bessel function of the first kind of order 0
+ *
+ * @param x The function argument
+ *
+ * @return the modified Bessel function of the first kind of order 0
+ */
+double bessel_i0(double x) {
+    double sum  = 1.0;
+    double term = 1.0;
+    double half = x/2;
+    for (int k = 1; k < 32; k++) {
+        term *= half/k;
+        sum  += term*term;
+    }
+    return sum;
+}
+
+/**
+ * Returns the kernel for the given filter
+ *
+ * @param filter    The filter type
+ *
+ * @return the kernel for the given filter
+ */
+Kernel make_kernel(MipmapFilter filter) {
+    Kernel kernel{};
+    if (filter == MipmapFilter::BOX) {
+        kernel.first = 0;
+        kernel.taps  = 2;
+        kernel.weights[0] = 0.5f;
+        kernel.weights[1] = 0.5f;
+        return kernel;
+    }
+
+    // A windowed sinc with a cutoff at the destination Nyquist limit
+    const double pi = 3.14159265358979323846;
+    const double alpha  = 4.0;
+    const double radius = MAX_TAPS/2;
+    kernel.first = 1-static_cast<int32_t>(MAX_TAPS/2);
+    kernel.taps  = MAX_TAPS;
+
+    double total = 0;
+    double weights[MAX_TAPS];
+    for (uint32_t ii = 0; ii < MAX_TAPS; ii++) {
+        double d = std::abs(kernel.first+static_cast<int32_t>(ii)-0.5);
+        double x = pi*d/2;
+        double sinc = x == 0 ? 1.0 : std::sin(x)/x;
+        double r = d/radius;
+        double window = bessel_i0(alpha*std::sqrt(std::max(1.0-r*r, 0.0)))/bessel_i0(alpha);
+        weights[ii] = sinc*window;
+        total += weights[ii];
+    }
+    for (uint32_t ii = 0; ii < MAX_TAPS; ii++) {
+        kernel.weights[ii] = static_cast<float>(weights[ii]/total);
+    }
+    return kernel;
+}
+
+// FILTERING
+
+/**
+ * Converts a row of RGBA8 pixels to linear floats
+ *
+ * @param src       The source row
+ * @param width     The row width in pixels
+ * @param color     The table for the color channels
+ * @param tables    The conversion tables
+ * @param dst       The destination (width*4 floats)
+ */
+void decode_row(const uint8_t* src, uint32_t width, const float* color,
+                const ConversionTables& tables, float* dst) {
+    for (uint32_t x = 0; x < width; x++) {
+        dst[0] = color[src[0]];
+        dst[1] = color[src[1]];
+        dst[2] = color[src[2]];
+        dst[3] = tables.unitToLinear[src[3]];
+        src += 4;
+        dst += 4;
+    }
+}
+
+/**
+ * Downsamples the rows [row0, row1) of a level from the previous level
+ *
+ * @param src       The previous level
+ * @param srcLevel  The layout of the previous level
+ * @param dst       The level to generate
+ * @param dstLevel  The layout of the level to generate
+ * @param row0      The first row to generate
+ * @param row1      The row after the last to generate
+ * @param kernel    The filter kernel
+ * @param srgb      Whether the color channels are sRGB encoded
+ */
+void downsample_rows(const uint8_t* src, const MipmapLevel& srcLevel,
+                     uint8_t* dst, const MipmapLevel& dstLevel,
+                     uint32_t row0, uint32_t row1, const Kernel& kernel, bool srgb) {
+    const ConversionTables& tables = conversion_tables();
+    const float* color = srgb ? tables.srgbToLinear : tables.unitToLinear;
+    const int32_t srcW = static_cast<int32_t>(srcLevel.width);
+    const int32_t srcH = static_cast<int32_t>(srcLevel.height);
+    const int32_t taps = static_cast<int32_t>(kernel.taps);
+
+    // Decode every source row this band touches exactly once
+    int32_t first = std::max(2*static_cast<int32_t>(row0)+kernel.first, 0);
+    int32_t last  = std::min(2*static_cast<int32_t>(row1-1)+kernel.first+taps-1, srcH-1);
+    std::vector<float> band(static_cast<size_t>(last-first+1)*srcW*4);
+    for (int32_t y = first; y <= last; y++) {
+        decode_row(src+static_cast<size_t>(y)*srcW*4, srcW, color, tables,
+                   band.data()+static_cast<size_t>(y-first)*srcW*4);
+    }
+
+    float4 weights[MAX_TAPS];
+    for (int32_t t = 0; t < taps; t++) {
+        weights[t] = f4_splat(kernel.weights[t]);
+    }
+
+    float limits[4] = { 255.0f, 255.0f, 255.0f, 255.0f };
+    if (srgb) {
+        limits[0] = limits[1] = limits[2] = static_cast<float>(SRGB_TABLE_SIZE-1);
+    }
+    float4 scale = f4_load(limits);
+
+    std::vector<float> column(static_cast<size_t>(srcW)*4);
+    int32_t quantized[4];
+    for (uint32_t y = row0; y < row1; y++) {
+        // Vertical pass into a single row
+        std::fill(column.begin(), column.end(), 0.0f);
+        for (int32_t t = 0; t < taps; t++) {
+            int32_t sy = std::min(std::max(2*static_cast<int32_t>(y)+kernel.first+t, 0), srcH-1);
+            const float* row = band.data()+static_cast<size_t>(sy-first)*srcW*4;
+            float* out = column.data();
+            for (int32_t x = 0; x < srcW; x++) {
+                f4_store(out, f4_madd(f4_load(out), f4_load(row), weights[t]));
+                row += 4;
+                out += 4;
+            }
+        }
+
+        // Horizontal pass into the destination
+        uint8_t* out = dst+static_cast<size_t>(y)*dstLevel.width*4;
+        for (uint32_t x = 0; x < dstLevel.width; x++) {
+            float4 acc = f4_splat(0.0f);
+            for (int32_t t = 0; t < taps; t++) {
+                int32_t sx = std::min(std::max(2*static_cast<int32_t>(x)+kernel.first+t, 0), srcW-1);
+                acc = f4_madd(acc, f4_load(column.data()+sx*4), weights[t]);
+            }
+            f4_quantize(acc, scale, quantized);
+            if (srgb) {
+                out[0] = tables.linearToSrgb[quantized[0]];
+                out[1] = tables.linearToSrgb[quantized[1]];
+                out[2] = tables.linearToSrgb[quantized[2]];
+            } else {
+                out[0] = static_cast<uint8_t>(quantized[0]);
+                out[1] = static_cast<uint8_t>(quantized[1]);
+                out[2] = static_cast<uint8_t>(quantized[2]);
+            }
+            out[3] = static_cast<uint8_t>(quantized[3]);
+            out += 4;
+        }
+    }
+}
+
+}   // namespace
+
+// PUBLIC API
+
+/**
+ * Returns the number of levels in a full mip chain for the given size
+ *
+ * @param width     The base level width
+ * @param height    The base level height
+ *
+ * @return the number of levels in a full mip chain for the given size
+ */
+uint32_t mipmap_level_count(uint32_t width, uint32_t height) {
+    uint32_t size = std::max(width, height);
+    uint32_t levels = 1;
+    while (size > 1) {
+        size >>= 1;
+        levels++;
+    }
+    return levels;
+}
+
+/**
+ * Returns a full mip chain for the given RGBA8 image.
+ *
+ * If srgb is true, the color channels are converted to linear space before
+ * filtering and back afterwards. Alpha is always treated as linear. Rows of
+ * each level are filtered in parallel on the given pool, which should not be
+ * one that the calling thread belongs to.
+ *
+ * @param pixels    The base level, as width*height*4 bytes
+ * @param width     The base level width
+ * @param height    The base level height
+ * @param levels    The number of levels to generate (including the base)
+ * @param srgb      Whether the color channels are sRGB encoded
+ * @param filter    The downsampling filter
+ * @param pool      The pool to parallelize over
+ *
+ * @return a full mip chain for the given RGBA8 image.
+ */
+MipmapChain build_mipmap_chain(const uint8_t* pixels, uint32_t width, uint32_t height,
+                               uint32_t levels, bool srgb, MipmapFilter filter,
+                               WorkerPool& pool) {
+    MipmapChain chain;
+    levels = std::min(std::max(levels, 1u), mipmap_level_count(width, height));
+
+    size_t offset = 0;
+    chain.levels.resize(levels);
+    for (uint32_t ii = 0; ii < levels; ii++) {
+        MipmapLevel& level = chain.levels[ii];
+        level.width  = std::max(width >> ii, 1u);
+        level.height = std::max(height >> ii, 1u);
+        level.offset = offset;
+        level.size = static_cast<size_t>(level.width)*level.height*4;
+        offset += level.size;
+    }
+
+    chain.data.resize(offset);
+    std::memcpy(chain.data.data(), pixels, chain.levels[0].size);
+
+    // Each level depends on the one before it, so we parallelize within a
+    // level. Once the levels are small, the rest of the chain is cheaper to
+    // finish on this thread than to hand out.
+    Kernel kernel = make_kernel(filter);
+    for (uint32_t ii = 1; ii < levels; ii++) {
+        const MipmapLevel& srcLevel = chain.levels[ii-1];
+        const MipmapLevel& dstLevel = chain.levels[ii];
+        const uint8_t* src = chain.data.data()+srcLevel.offset;
+        uint8_t* dst = chain.data.data()+dstLevel.offset;
+
+        if (dstLevel.width*dstLevel.height <= SERIAL_PIXELS || pool.size() == 0) {
+            downsample_rows(src, srcLevel, dst, dstLevel, 0, dstLevel.height, kernel, srgb);
+            continue;
+        }
+
+        uint32_t grain = std::max(TASK_PIXELS/dstLevel.width, 1u);
+        pool.parallelFor(0, dstLevel.height, grain, [&](uint32_t row0, uint32_t row1) {
+            downsample_rows(src, srcLevel, dst, dstLevel, row0, row1, kernel, srgb);
+        });
+    }
+
+    return chain;
+}
@@ -0,0 +1,94 @@
+//
+//  MipmapBuilder.h
+//  Tutorial8
+//
+//  A CPU implementation of mipmap generation. The tutorial generates mipmaps
+//  with vkCmdBlitImage, which requires that the texture format support linear
+//  filtering. That is not true of every format on every (mobile) device. In
+//  that case we build the entire mip chain on the CPU and upload it in one go.
+//
+//  This module does not depend on Vulkan, so it can also be used to cook mip
+//  chains offline. The filters are vectorized with SSE2 or NEON when either
+//  is available, and the rows of each level are spread over a WorkerPool.
+//
+//  Version: 10/18/26
+//
+#ifndef __MIPMAP_BUILDER_H__
+#define __MIPMAP_BUILDER_H__
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+class WorkerPool;
+
+/**
+ * The filter used to downsample each level
+ */
+enum class MipmapFilter {
+    /** A 2x2 box filter (the same footprint as a linear blit) */
+    BOX,
+    /** An 8-tap Kaiser windowed sinc, which is sharper and aliases less */
+    KAISER
+};
+
+/**
+ * The location of a single level within a mip chain
+ */
+struct MipmapLevel {
+    /** The level width in pixels */
+    uint32_t width;
+    /** The level height in pixels */
+    uint32_t height;
+    /** The byte offset of this level in the chain data */
+    size_t offset;
+    /** The size of this level in bytes */
+    size_t size;
+};
+
+/**
+ * A complete mip chain of RGBA8 images, stored contiguously.
+ *
+ * The levels are tightly packed, so each offset is a multiple of 4. That is
+ * all vkCmdCopyBufferToImage requires of RGBA8 data, so the chain may be
+ * copied to a staging buffer as-is.
+ */
+struct MipmapChain {
+    /** The levels, starting with the base level */
+    std::vector<MipmapLevel> levels;
+    /** The pixel data for all levels */
+    std::vector<uint8_t> data;
+};
+
+/**
+ * Returns the number of levels in a full mip chain for the given size
+ *
+ * @param width     The base level width
+ * @param height    The base level height
+ *
+ * @return the number of levels in a full mip chain for the given size
+ */
+uint32_t mipmap_level_count(uint32_t width, uint32_t height);
+
+/**
+ * Returns a full mip chain for the given RGBA8 image.
+ *
+ * If srgb is true, the color channels are converted to linear space before
+ * filtering and back afterwards. Alpha is always treated as linear. Rows of
+ * each level are filtered in parallel on the given pool, which should not be
+ * one that the calling thread belongs to.
+ *
+ * @param pixels    The base level, as width*height*4 bytes
+ * @param width     The base level width
+ * @param height    The base level height
+ * @param levels    The number of levels to generate (including the base)
+ * @param srgb      Whether the color channels are sRGB encoded
+ * @param filter    The downsampling filter
+ * @param pool      The pool to parallelize over
+ *
+ * @return a full mip chain for the given RGBA8 image.
+ */
+MipmapChain build_mipmap_chain(const uint8_t* pixels, uint32_t width, uint32_t height,
+                               uint32_t levels, bool srgb, MipmapFilter filter,
+                               WorkerPool& pool);
+
+#endif /* __MIPMAP_BUILDER_H__ */
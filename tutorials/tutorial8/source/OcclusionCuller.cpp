@@ -0,0 +1,879 @@
+//
+//  OcclusionCuller.cpp
+//  Tutorial8
+//
+//  GPU frustum and occlusion culling for an IndirectScene. Even with a single
+//  indirect draw, the scene sends every instance through the vertex shader,
+//  including the ones outside the view and the ones hidden behind others.
+//
+//  This class culls the instances in a compute shader instead, testing the
+//  bounding sphere of each instance against the frustum and against a Hi-Z
+//  pyramid (the farthest depth of each texel at each level). The survivors
+//  are compacted into the instance ranges of the indirect commands with an
+//  atomic counter, so the draws only see what survived.
+//
+//  Culling happens in two phases to avoid popping. The early phase draws the
+//  instances that were visible last frame. The pyramid is built from the
+//  depth of those draws, and the late phase tests everything against it,
+//  drawing whatever the early phase missed. The late test also decides what
+//  the next early phase draws. The counts of each phase are copied to a ring
+//  of host visible buffers, one per frame in flight, so they can be read
+//  without stalling.
+//
+//  Version: 10/18/26
+//
+#include "OcclusionCuller.h"
+#include "IndirectScene.h"
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <array>
+#include <stdexcept>
+#include <cstring>
+
+/** The workgroup size of cull.comp */
+#define CULL_GROUP_SIZE   64
+/** The workgroup size of depthreduce.comp (in each dimension) */
+#define REDUCE_GROUP_SIZE 8
+/** The levels generated by one dispatch of mipmap.comp */
+#define HIZ_MAX_LEVELS    12
+/** The tile reduced by each workgroup of mipmap.comp */
+#define HIZ_TILE_SIZE     64
+/** The max reduction of mipmap.comp */
+#define HIZ_MODE_MAX      2
+
+/** The push constants for depthreduce.comp */
+struct ReduceParameters {
+    glm::ivec2 depthSize;
+    glm::ivec2 pyramidSize;
+    int32_t samples;
+};
+
+/** The push constants for mipmap.comp */
+struct PyramidParameters {
+    glm::ivec2 extent;
+    uint32_t levels;
+    uint32_t workgroups;
+    uint32_t mode;
+    uint32_t srgb;
+};
+
+/** The push constants for cull.comp */
+struct CullParameters {
+    uint32_t instances;
+    uint32_t phase;
+    uint32_t draws;
+    uint32_t levels;
+    glm::vec2 pyramidSize;
+};
+
+/**
+ * Returns the largest power of two no greater than value (and at least 1)
+ */
+static uint32_t floorPowerOfTwo(uint32_t value) {
+    uint32_t result = 1;
+    while (result <= value / 2) {
+        result *= 2;
+    }
+    return result;
+}
+
+/**
+ * Creates a descriptor set layout and a pipeline layout using only that set
+ *
+ * @param device        The logical device
+ * @param bindings      The set bindings
+ * @param pushSize      The size of the compute push constants
+ * @param setLayout     The set layout to create
+ * @param layout        The pipeline layout to create
+ */
+static void createComputeLayout(VkDevice device, const std::vector<VkDescriptorSetLayoutBinding>& bindings,
+                                uint32_t pushSize, VkDescriptorSetLayout& setLayout, VkPipelineLayout& layout) {
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+    layoutInfo.pBindings = bindings.data();
+
+    if (vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &setLayout) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create culling descriptor set layout!");
+    }
+
+    VkPushConstantRange pushRange{};
+    pushRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    pushRange.offset = 0;
+    pushRange.size = pushSize;
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = 1;
+    pipelineLayoutInfo.pSetLayouts = &setLayout;
+    pipelineLayoutInfo.pushConstantRangeCount = 1;
+    pipelineLayoutInfo.pPushConstantRanges = &pushRange;
+
+    if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &layout) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create culling pipeline layout!");
+    }
+}
+
+/**
+ * Returns a compute binding for the given descriptor type
+ */
+static VkDescriptorSetLayoutBinding computeBinding(uint32_t binding, VkDescriptorType type, uint32_t count = 1) {
+    VkDescriptorSetLayoutBinding result{};
+    result.binding = binding;
+    result.descriptorType = type;
+    result.descriptorCount = count;
+    result.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    result.pImmutableSamplers = nullptr;
+    return result;
+}
+
+// CREATION
+
+/**
+ * Creates a culler for the given scene.
+ *
+ * The scene must already be built, and its instances uploaded to the
+ * given buffer. The uniform buffers must hold a UniformBufferObject. No
+ * culling can be recorded until {@link resize} has been called.
+ *
+ * @param physicalDevice    The physical device
+ * @param device            The logical device
+ * @param pipelines         The pipeline service to compile on
+ * @param shaders           The compute shaders
+ * @param scene             The scene to cull
+ * @param instances         The instance buffer of the scene
+ * @param uniforms          The uniform buffer of each frame in flight
+ * @param uniformSize       The size of each uniform buffer
+ * @param samples           The sample count of the depth buffer
+ * @param depthFormat       The format of the depth buffer
+ */
+OcclusionCuller::OcclusionCuller(VkPhysicalDevice physicalDevice, VkDevice device, PipelineService& pipelines,
+                                 const Shaders& shaders, const IndirectScene& scene, VkBuffer instances,
+                                 const std::vector<VkBuffer>& uniforms, VkDeviceSize uniformSize,
+                                 VkSampleCountFlagBits samples, VkFormat depthFormat) :
+    physicalDevice(physicalDevice),
+    device(device),
+    instanceCount(scene.getInstanceCount()),
+    drawCount(scene.getDrawCount()),
+    frameCount(static_cast<uint32_t>(uniforms.size())),
+    samples(samples),
+    depthAspects(VK_IMAGE_ASPECT_DEPTH_BIT),
+    readback(nullptr),
+    initialized(false),
+    depthImage(VK_NULL_HANDLE),
+    depthView(VK_NULL_HANDLE),
+    depthExtent{0, 0},
+    pyramidImage(VK_NULL_HANDLE),
+    pyramidMemory(VK_NULL_HANDLE),
+    pyramidView(VK_NULL_HANDLE),
+    pyramidExtent{0, 0},
+    pyramidLevels(0),
+    pyramidFresh(false) {
+    if (depthFormat == VK_FORMAT_D32_SFLOAT_S8_UINT || depthFormat == VK_FORMAT_D24_UNORM_S8_UINT) {
+        depthAspects |= VK_IMAGE_ASPECT_STENCIL_BIT;
+    }
+
+    VkSamplerCreateInfo samplerInfo{};
+    samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+    samplerInfo.magFilter = VK_FILTER_NEAREST;
+    samplerInfo.minFilter = VK_FILTER_NEAREST;
+    samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+    samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.minLod = 0.0f;
+    samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
+
+    if (vkCreateSampler(device, &samplerInfo, nullptr, &sampler) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create culling sampler!");
+    }
+
+    createPipelines(pipelines, shaders);
+    createBuffers(scene);
+    createDescriptorSets(instances, uniforms, uniformSize);
+}
+
+/**
+ * Destroys the culler. The device must be done with all of its work.
+ */
+OcclusionCuller::~OcclusionCuller() {
+    destroyPyramid();
+
+    vkUnmapMemory(device, readbackMemory);
+    std::array<std::pair<VkBuffer, VkDeviceMemory>, 7> buffers = {{
+        {templateBuffer, templateMemory},
+        {drawBuffer, drawMemory},
+        {visibleBuffer, visibleMemory},
+        {visibilityBuffer, visibilityMemory},
+        {counterBuffer, counterMemory},
+        {statsBuffer, statsMemory},
+        {readbackBuffer, readbackMemory}
+    }};
+    for (auto& buffer : buffers) {
+        vkDestroyBuffer(device, buffer.first, nullptr);
+        vkFreeMemory(device, buffer.second, nullptr);
+    }
+
+    vkDestroyDescriptorPool(device, descriptorPool, nullptr);
+    vkDestroySampler(device, sampler, nullptr);
+
+    vkDestroyPipelineLayout(device, reduceLayout, nullptr);
+    vkDestroyPipelineLayout(device, pyramidLayout, nullptr);
+    vkDestroyPipelineLayout(device, cullLayout, nullptr);
+    vkDestroyDescriptorSetLayout(device, reduceSetLayout, nullptr);
+    vkDestroyDescriptorSetLayout(device, pyramidSetLayout, nullptr);
+    vkDestroyDescriptorSetLayout(device, cullSetLayout, nullptr);
+}
+
+/**
+ * Creates the descriptor set layouts and requests the pipelines
+ *
+ * @param pipelines The pipeline service to compile on
+ * @param shaders   The compute shaders
+ */
+void OcclusionCuller::createPipelines(PipelineService& pipelines, const Shaders& shaders) {
+    createComputeLayout(device, {
+        computeBinding(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER),
+        computeBinding(1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE)
+    }, sizeof(ReduceParameters), reduceSetLayout, reduceLayout);
+
+    createComputeLayout(device, {
+        computeBinding(0, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, HIZ_MAX_LEVELS + 1),
+        computeBinding(1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER)
+    }, sizeof(PyramidParameters), pyramidSetLayout, pyramidLayout);
+
+    createComputeLayout(device, {
+        computeBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER),
+        computeBinding(1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER),
+        computeBinding(2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER),
+        computeBinding(3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER),
+        computeBinding(4, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER),
+        computeBinding(5, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER),
+        computeBinding(6, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER)
+    }, sizeof(CullParameters), cullSetLayout, cullLayout);
+
+    ComputePipelineState state;
+    state.shader = shaders.reduce;
+    state.layout = reduceLayout;
+    reducePipeline = pipelines.request(state);
+
+    state.shader = shaders.pyramid;
+    state.layout = pyramidLayout;
+    pyramidPipeline = pipelines.request(state);
+
+    state.shader = shaders.cull;
+    state.layout = cullLayout;
+    cullPipeline = pipelines.request(state);
+}
+
+/**
+ * Creates the buffers, filling in the command template from the scene
+ *
+ * @param scene The scene to cull
+ */
+void OcclusionCuller::createBuffers(const IndirectScene& scene) {
+    // The late commands append after every instance of the early ones
+    const auto& commands = scene.getCommands();
+    std::vector<VkDrawIndexedIndirectCommand> initial(2 * drawCount);
+    for (uint32_t ii = 0; ii < drawCount; ii++) {
+        VkDrawIndexedIndirectCommand command = commands[ii];
+        command.instanceCount = 0;
+        initial[ii] = command;
+        command.firstInstance += instanceCount;
+        initial[drawCount + ii] = command;
+    }
+
+    VkDeviceSize commandSize = sizeof(VkDrawIndexedIndirectCommand) * initial.size();
+    VkDeviceSize drawSize = commandSize + 2 * sizeof(uint32_t);
+    createBuffer(drawSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                 VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                 templateBuffer, templateMemory);
+
+    void* data;
+    vkMapMemory(device, templateMemory, 0, drawSize, 0, &data);
+    memcpy(data, initial.data(), (size_t)commandSize);
+    uint32_t counts[2] = {drawCount, drawCount};
+    memcpy(static_cast<uint8_t*>(data) + commandSize, counts, sizeof(counts));
+    vkUnmapMemory(device, templateMemory);
+
+    createBuffer(drawSize, VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                 VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, drawBuffer, drawMemory);
+
+    VkDeviceSize instanceSize = sizeof(uint32_t) * std::max(instanceCount, 1u);
+    createBuffer(2 * instanceSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                 VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, visibleBuffer, visibleMemory);
+    createBuffer(instanceSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                 VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, visibilityBuffer, visibilityMemory);
+    createBuffer(sizeof(uint32_t), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                 VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, counterBuffer, counterMemory);
+    createBuffer(sizeof(CullingStats), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                 VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, statsBuffer, statsMemory);
+
+    // The ring stays mapped, and is only read once a frame's fence signals
+    VkDeviceSize readbackSize = sizeof(CullingStats) * frameCount;
+    createBuffer(readbackSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                 VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                 readbackBuffer, readbackMemory);
+    vkMapMemory(device, readbackMemory, 0, readbackSize, 0, &data);
+    readback = static_cast<CullingStats*>(data);
+    memset(readback, 0, (size_t)readbackSize);
+}
+
+/**
+ * Allocates the descriptor sets, and writes everything but the images
+ *
+ * @param instances     The instance buffer of the scene
+ * @param uniforms      The uniform buffer of each frame
+ * @param uniformSize   The size of each uniform buffer
+ */
+void OcclusionCuller::createDescriptorSets(VkBuffer instances, const std::vector<VkBuffer>& uniforms, VkDeviceSize uniformSize) {
+    std::array<VkDescriptorPoolSize, 4> poolSizes{};
+    poolSizes[0].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    poolSizes[0].descriptorCount = 1 + frameCount;
+    poolSizes[1].type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+    poolSizes[1].descriptorCount = 1 + HIZ_MAX_LEVELS + 1;
+    poolSizes[2].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    poolSizes[2].descriptorCount = 1 + 5 * frameCount;
+    poolSizes[3].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    poolSizes[3].descriptorCount = frameCount;
+
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+    poolInfo.pPoolSizes = poolSizes.data();
+    poolInfo.maxSets = 2 + frameCount;
+
+    if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &descriptorPool) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create culling descriptor pool!");
+    }
+
+    std::vector<VkDescriptorSetLayout> layouts = {reduceSetLayout, pyramidSetLayout};
+    layouts.insert(layouts.end(), frameCount, cullSetLayout);
+    std::vector<VkDescriptorSet> sets(layouts.size());
+
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = descriptorPool;
+    allocInfo.descriptorSetCount = static_cast<uint32_t>(sets.size());
+    allocInfo.pSetLayouts = layouts.data();
+
+    if (vkAllocateDescriptorSets(device, &allocInfo, sets.data()) != VK_SUCCESS) {
+        throw std::runtime_error("failed to allocate culling descriptor sets!");
+    }
+    reduceSet = sets[0];
+    pyramidSet = sets[1];
+    cullSets.assign(sets.begin() + 2, sets.end());
+
+    for (uint32_t frame = 0; frame < frameCount; frame++) {
+        std::array<VkDescriptorBufferInfo, 6> bufferInfos{};
+        bufferInfos[0] = {uniforms[frame], 0, uniformSize};
+        bufferInfos[1] = {instances, 0, VK_WHOLE_SIZE};
+        bufferInfos[2] = {visibilityBuffer, 0, VK_WHOLE_SIZE};
+        bufferInfos[3] = {drawBuffer, 0, VK_WHOLE_SIZE};
+        bufferInfos[4] = {visibleBuffer, 0, VK_WHOLE_SIZE};
+        bufferInfos[5] = {statsBuffer, 0, VK_WHOLE_SIZE};
+
+        std::array<VkWriteDescriptorSet, 6> descriptorWrites{};
+        for (uint32_t ii = 0; ii < descriptorWrites.size(); ii++) {
+            descriptorWrites[ii].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            descriptorWrites[ii].dstSet = cullSets[frame];
+            descriptorWrites[ii].dstBinding = ii;
+            descriptorWrites[ii].dstArrayElement = 0;
+            descriptorWrites[ii].descriptorType = ii == 0 ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+            descriptorWrites[ii].descriptorCount = 1;
+            descriptorWrites[ii].pBufferInfo = &bufferInfos[ii];
+        }
+
+        vkUpdateDescriptorSets(device, static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+    }
+}
+
+// PYRAMID
+
+/**
+ * Rebuilds the pyramid for a new depth buffer.
+ *
+ * The depth buffer must have been created with VK_IMAGE_USAGE_SAMPLED_BIT.
+ * It is expected in VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL at the
+ * end of the early pass, and is left in that layout for the late pass.
+ * The device must be done with the old depth buffer.
+ *
+ * @param image     The depth buffer
+ * @param view      A depth view of the depth buffer
+ * @param extent    The size of the depth buffer
+ */
+void OcclusionCuller::resize(VkImage image, VkImageView view, VkExtent2D extent) {
+    destroyPyramid();
+    depthImage = image;
+    depthView = view;
+    depthExtent = extent;
+
+    // A power of two base halves exactly, so no texel is dropped by the max
+    uint32_t maxSize = 1u << HIZ_MAX_LEVELS;
+    pyramidExtent.width = std::min(floorPowerOfTwo(extent.width), maxSize);
+    pyramidExtent.height = std::min(floorPowerOfTwo(extent.height), maxSize);
+    pyramidLevels = 1;
+    while ((1u << pyramidLevels) <= std::max(pyramidExtent.width, pyramidExtent.height)) {
+        pyramidLevels++;
+    }
+
+    VkImageCreateInfo imageInfo{};
+    imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    imageInfo.imageType = VK_IMAGE_TYPE_2D;
+    imageInfo.extent.width = pyramidExtent.width;
+    imageInfo.extent.height = pyramidExtent.height;
+    imageInfo.extent.depth = 1;
+    imageInfo.mipLevels = pyramidLevels;
+    imageInfo.arrayLayers = 1;
+    imageInfo.format = VK_FORMAT_R32_SFLOAT;
+    imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+    imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    imageInfo.usage = VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+    imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+    imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    if (vkCreateImage(device, &imageInfo, nullptr, &pyramidImage) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create depth pyramid!");
+    }
+
+    VkMemoryRequirements memRequirements;
+    vkGetImageMemoryRequirements(device, pyramidImage, &memRequirements);
+
+    VkMemoryAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = memRequirements.size;
+    allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+    if (vkAllocateMemory(device, &allocInfo, nullptr, &pyramidMemory) != VK_SUCCESS) {
+        throw std::runtime_error("failed to allocate depth pyramid memory!");
+    }
+    vkBindImageMemory(device, pyramidImage, pyramidMemory, 0);
+
+    VkImageViewCreateInfo viewInfo{};
+    viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    viewInfo.image = pyramidImage;
+    viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    viewInfo.format = VK_FORMAT_R32_SFLOAT;
+    viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    viewInfo.subresourceRange.baseMipLevel = 0;
+    viewInfo.subresourceRange.levelCount = pyramidLevels;
+    viewInfo.subresourceRange.baseArrayLayer = 0;
+    viewInfo.subresourceRange.layerCount = 1;
+
+    if (vkCreateImageView(device, &viewInfo, nullptr, &pyramidView) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create depth pyramid view!");
+    }
+
+    levelViews.resize(pyramidLevels);
+    viewInfo.subresourceRange.levelCount = 1;
+    for (uint32_t level = 0; level < pyramidLevels; level++) {
+        viewInfo.subresourceRange.baseMipLevel = level;
+        if (vkCreateImageView(device, &viewInfo, nullptr, &levelViews[level]) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create depth pyramid view!");
+        }
+    }
+
+    // The reduction reads the depth buffer and writes the base level
+    VkDescriptorImageInfo depthInfo{sampler, depthView, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL};
+    VkDescriptorImageInfo baseInfo{VK_NULL_HANDLE, levelViews[0], VK_IMAGE_LAYOUT_GENERAL};
+
+    // Unused trailing elements of the downsampler alias the last level
+    std::array<VkDescriptorImageInfo, HIZ_MAX_LEVELS + 1> levelInfos{};
+    for (uint32_t ii = 0; ii <= HIZ_MAX_LEVELS; ii++) {
+        levelInfos[ii].imageView = levelViews[std::min(ii, pyramidLevels - 1)];
+        levelInfos[ii].imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+    }
+    VkDescriptorBufferInfo counterInfo{counterBuffer, 0, sizeof(uint32_t)};
+    VkDescriptorImageInfo pyramidInfo{sampler, pyramidView, VK_IMAGE_LAYOUT_GENERAL};
+
+    std::vector<VkWriteDescriptorSet> descriptorWrites;
+    VkWriteDescriptorSet write{};
+    write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    write.dstArrayElement = 0;
+    write.descriptorCount = 1;
+
+    write.dstSet = reduceSet;
+    write.dstBinding = 0;
+    write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    write.pImageInfo = &depthInfo;
+    descriptorWrites.push_back(write);
+
+    write.dstBinding = 1;
+    write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+    write.pImageInfo = &baseInfo;
+    descriptorWrites.push_back(write);
+
+    write.dstSet = pyramidSet;
+    write.dstBinding = 0;
+    write.descriptorCount = static_cast<uint32_t>(levelInfos.size());
+    write.pImageInfo = levelInfos.data();
+    descriptorWrites.push_back(write);
+
+    write.dstBinding = 1;
+    write.descriptorCount = 1;
+    write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    write.pImageInfo = nullptr;
+    write.pBufferInfo = &counterInfo;
+    descriptorWrites.push_back(write);
+
+    write.dstBinding = 6;
+    write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    write.pImageInfo = &pyramidInfo;
+    write.pBufferInfo = nullptr;
+    for (auto set : cullSets) {
+        write.dstSet = set;
+        descriptorWrites.push_back(write);
+    }
+
+    vkUpdateDescriptorSets(device, static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+    pyramidFresh = true;
+}
+
+/**
+ * Destroys the pyramid and its views, if they exist
+ */
+void OcclusionCuller::destroyPyramid() {
+    for (auto view : levelViews) {
+        vkDestroyImageView(device, view, nullptr);
+    }
+    levelViews.clear();
+    if (pyramidView != VK_NULL_HANDLE) {
+        vkDestroyImageView(device, pyramidView, nullptr);
+        vkDestroyImage(device, pyramidImage, nullptr);
+        vkFreeMemory(device, pyramidMemory, nullptr);
+        pyramidView = VK_NULL_HANDLE;
+        pyramidImage = VK_NULL_HANDLE;
+        pyramidMemory = VK_NULL_HANDLE;
+    }
+}
+
+// RECORDING
+
+/**
+ * Returns true if every culling pipeline has compiled
+ *
+ * @return true if every culling pipeline has compiled
+ */
+bool OcclusionCuller::isReady() const {
+    return (PipelineService::poll(reducePipeline) != VK_NULL_HANDLE &&
+            PipelineService::poll(pyramidPipeline) != VK_NULL_HANDLE &&
+            PipelineService::poll(cullPipeline) != VK_NULL_HANDLE);
+}
+
+/**
+ * Records the early culling phase, outside of any render pass.
+ *
+ * This resets the commands and counts for the frame, and culls the
+ * instances visible last frame against the frustum.
+ *
+ * @param commandBuffer The command buffer to record to
+ * @param frame         The frame index
+ */
+void OcclusionCuller::recordEarly(VkCommandBuffer commandBuffer, uint32_t frame) {
+    if (pyramidImage == VK_NULL_HANDLE) {
+        throw std::runtime_error("culling recorded before the depth pyramid was created!");
+    }
+
+    // The last frame may still be drawing from these buffers, and it wrote the visibility
+    VkMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+
+    VkImageMemoryBarrier pyramidBarrier{};
+    pyramidBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    pyramidBarrier.image = pyramidImage;
+    pyramidBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    pyramidBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    pyramidBarrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    pyramidBarrier.subresourceRange.baseMipLevel = 0;
+    pyramidBarrier.subresourceRange.levelCount = pyramidLevels;
+    pyramidBarrier.subresourceRange.baseArrayLayer = 0;
+    pyramidBarrier.subresourceRange.layerCount = 1;
+    pyramidBarrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    pyramidBarrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+    pyramidBarrier.srcAccessMask = 0;
+    pyramidBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+
+    vkCmdPipelineBarrier(commandBuffer,
+                         VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT |
+                         VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,
+                         1, &barrier,
+                         0, nullptr,
+                         pyramidFresh ? 1 : 0, &pyramidBarrier);
+    pyramidFresh = false;
+
+    // Nothing was visible before the first frame
+    if (!initialized) {
+        vkCmdFillBuffer(commandBuffer, visibilityBuffer, 0, VK_WHOLE_SIZE, 0);
+        vkCmdFillBuffer(commandBuffer, counterBuffer, 0, VK_WHOLE_SIZE, 0);
+        initialized = true;
+    }
+
+    VkBufferCopy copyRegion{};
+    copyRegion.size = getCountOffset(LATE) + sizeof(uint32_t);
+    vkCmdCopyBuffer(commandBuffer, templateBuffer, drawBuffer, 1, &copyRegion);
+    vkCmdFillBuffer(commandBuffer, statsBuffer, 0, VK_WHOLE_SIZE, 0);
+
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    vkCmdPipelineBarrier(commandBuffer,
+                         VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,
+                         1, &barrier,
+                         0, nullptr,
+                         0, nullptr);
+
+    recordCull(commandBuffer, frame, EARLY);
+
+    barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+    vkCmdPipelineBarrier(commandBuffer,
+                         VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                         VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT, 0,
+                         1, &barrier,
+                         0, nullptr,
+                         0, nullptr);
+}
+
+/**
+ * Records the pyramid build, after the early draws have finished.
+ *
+ * @param commandBuffer The command buffer to record to
+ */
+void OcclusionCuller::recordPyramid(VkCommandBuffer commandBuffer) {
+    std::array<VkImageMemoryBarrier, 2> barriers{};
+    for (auto& barrier : barriers) {
+        barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.subresourceRange.baseMipLevel = 0;
+        barrier.subresourceRange.baseArrayLayer = 0;
+        barrier.subresourceRange.layerCount = 1;
+    }
+
+    VkImageMemoryBarrier& depthBarrier = barriers[0];
+    depthBarrier.image = depthImage;
+    depthBarrier.subresourceRange.aspectMask = depthAspects;
+    depthBarrier.subresourceRange.levelCount = 1;
+    depthBarrier.oldLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+    depthBarrier.newLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+    depthBarrier.srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+    depthBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+    // The last late phase read the old pyramid
+    VkImageMemoryBarrier& pyramidBarrier = barriers[1];
+    pyramidBarrier.image = pyramidImage;
+    pyramidBarrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    pyramidBarrier.subresourceRange.levelCount = pyramidLevels;
+    pyramidBarrier.oldLayout = VK_IMAGE_LAYOUT_GENERAL;
+    pyramidBarrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+    pyramidBarrier.srcAccessMask = 0;
+    pyramidBarrier.dstAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+
+    vkCmdPipelineBarrier(commandBuffer,
+                         VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT |
+                         VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                         VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,
+                         0, nullptr,
+                         0, nullptr,
+                         static_cast<uint32_t>(barriers.size()), barriers.data());
+
+    ReduceParameters reduce{};
+    reduce.depthSize = glm::ivec2(depthExtent.width, depthExtent.height);
+    reduce.pyramidSize = glm::ivec2(pyramidExtent.width, pyramidExtent.height);
+    reduce.samples = static_cast<int32_t>(samples);
+
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, reducePipeline.get());
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, reduceLayout, 0, 1, &reduceSet, 0, nullptr);
+    vkCmdPushConstants(commandBuffer, reduceLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(ReduceParameters), &reduce);
+    vkCmdDispatch(commandBuffer,
+                  (pyramidExtent.width + REDUCE_GROUP_SIZE - 1) / REDUCE_GROUP_SIZE,
+                  (pyramidExtent.height + REDUCE_GROUP_SIZE - 1) / REDUCE_GROUP_SIZE, 1);
+
+    VkMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+
+    if (pyramidLevels > 1) {
+        vkCmdPipelineBarrier(commandBuffer,
+                             VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,
+                             1, &barrier,
+                             0, nullptr,
+                             0, nullptr);
+
+        PyramidParameters pyramid{};
+        pyramid.extent = glm::ivec2(pyramidExtent.width, pyramidExtent.height);
+        uint32_t groupsX = (pyramidExtent.width + HIZ_TILE_SIZE - 1) / HIZ_TILE_SIZE;
+        uint32_t groupsY = (pyramidExtent.height + HIZ_TILE_SIZE - 1) / HIZ_TILE_SIZE;
+        pyramid.levels = pyramidLevels - 1;
+        pyramid.workgroups = groupsX * groupsY;
+        pyramid.mode = HIZ_MODE_MAX;
+        pyramid.srgb = 0;
+
+        vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pyramidPipeline.get());
+        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pyramidLayout, 0, 1, &pyramidSet, 0, nullptr);
+        vkCmdPushConstants(commandBuffer, pyramidLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(PyramidParameters), &pyramid);
+        vkCmdDispatch(commandBuffer, groupsX, groupsY, 1);
+    }
+
+    // Hand the depth buffer back to the late pass
+    depthBarrier.oldLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+    depthBarrier.newLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+    depthBarrier.srcAccessMask = 0;
+    depthBarrier.dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    vkCmdPipelineBarrier(commandBuffer,
+                         VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                         VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT |
+                         VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT, 0,
+                         1, &barrier,
+                         0, nullptr,
+                         1, &depthBarrier);
+}
+
+/**
+ * Records the late culling phase, after the pyramid has been built.
+ *
+ * This also copies the counts for the frame to the readback ring.
+ *
+ * @param commandBuffer The command buffer to record to
+ * @param frame         The frame index
+ */
+void OcclusionCuller::recordLate(VkCommandBuffer commandBuffer, uint32_t frame) {
+    recordCull(commandBuffer, frame, LATE);
+
+    VkMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_TRANSFER_READ_BIT;
+    vkCmdPipelineBarrier(commandBuffer,
+                         VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                         VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT |
+                         VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+                         1, &barrier,
+                         0, nullptr,
+                         0, nullptr);
+
+    VkBufferCopy copyRegion{};
+    copyRegion.srcOffset = 0;
+    copyRegion.dstOffset = sizeof(CullingStats) * frame;
+    copyRegion.size = sizeof(CullingStats);
+    vkCmdCopyBuffer(commandBuffer, statsBuffer, readbackBuffer, 1, &copyRegion);
+
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+    vkCmdPipelineBarrier(commandBuffer,
+                         VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0,
+                         1, &barrier,
+                         0, nullptr,
+                         0, nullptr);
+}
+
+/**
+ * Records the culling shader for the given phase
+ *
+ * @param commandBuffer The command buffer to record to
+ * @param frame         The frame index
+ * @param phase         The culling phase
+ */
+void OcclusionCuller::recordCull(VkCommandBuffer commandBuffer, uint32_t frame, Phase phase) {
+    if (instanceCount == 0) {
+        return;
+    }
+
+    CullParameters params{};
+    params.instances = instanceCount;
+    params.phase = phase;
+    params.draws = drawCount;
+    params.levels = pyramidLevels;
+    params.pyramidSize = glm::vec2(pyramidExtent.width, pyramidExtent.height);
+
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, cullPipeline.get());
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, cullLayout, 0, 1, &cullSets[frame], 0, nullptr);
+    vkCmdPushConstants(commandBuffer, cullLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(CullParameters), &params);
+    vkCmdDispatch(commandBuffer, (instanceCount + CULL_GROUP_SIZE - 1) / CULL_GROUP_SIZE, 1, 1);
+}
+
+/**
+ * Returns the offset of the first command of the given phase
+ *
+ * @param phase The culling phase
+ *
+ * @return the offset of the first command of the given phase
+ */
+VkDeviceSize OcclusionCuller::getDrawOffset(Phase phase) const {
+    return sizeof(VkDrawIndexedIndirectCommand) * drawCount * phase;
+}
+
+/**
+ * Returns the offset of the draw count of the given phase
+ *
+ * @param phase The culling phase
+ *
+ * @return the offset of the draw count of the given phase
+ */
+VkDeviceSize OcclusionCuller::getCountOffset(Phase phase) const {
+    return sizeof(VkDrawIndexedIndirectCommand) * drawCount * 2 + sizeof(uint32_t) * phase;
+}
+
+// MEMORY
+
+/**
+ * Creates a buffer and binds it to new memory
+ *
+ * @param size          The buffer size
+ * @param usage         The buffer usage
+ * @param properties    The memory properties
+ * @param buffer        The buffer to create
+ * @param memory        The memory to allocate
+ */
+void OcclusionCuller::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties,
+                                   VkBuffer& buffer, VkDeviceMemory& memory) {
+    VkBufferCreateInfo bufferInfo{};
+    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.size = size;
+    bufferInfo.usage = usage;
+    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    if (vkCreateBuffer(device, &bufferInfo, nullptr, &buffer) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create culling buffer!");
+    }
+
+    VkMemoryRequirements memRequirements;
+    vkGetBufferMemoryRequirements(device, buffer, &memRequirements);
+
+    VkMemoryAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = memRequirements.size;
+    allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties);
+
+    if (vkAllocateMemory(device, &allocInfo, nullptr, &memory) != VK_SUCCESS) {
+        throw std::runtime_error("failed to allocate culling buffer memory!");
+    }
+
+    vkBindBufferMemory(device, buffer, memory, 0);
+}
+
+/**
+ * Returns a memory type with the given properties
+ *
+ * @param typeFilter    The allowed memory types
+ * @param properties    The required memory properties
+ *
+ * @return a memory type with the given properties
+ */
+uint32_t OcclusionCuller::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const {
+    VkPhysicalDeviceMemoryProperties memProperties;
+    vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProperties);
+
+    for (uint32_t ii = 0; ii < memProperties.memoryTypeCount; ii++) {
+        if ((typeFilter & (1 << ii)) && (memProperties.memoryTypes[ii].propertyFlags & properties) == properties) {
+            return ii;
+        }
+    }
+
+    throw std::runtime_error("failed to find suitable memory type!");
+}
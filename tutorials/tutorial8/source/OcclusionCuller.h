@@ -0,0 +1,348 @@
+//
+//  OcclusionCuller.h
+//  Tutorial8
+//
+//  GPU frustum and occlusion culling for an IndirectScene. Even with a single
+//  indirect draw, the scene sends every instance through the vertex shader,
+//  including the ones outside the view and the ones hidden behind others.
+//
+//  This class culls the instances in a compute shader instead, testing the
+//  bounding sphere of each instance against the frustum and against a Hi-Z
+//  pyramid (the farthest depth of each texel at each level). The survivors
+//  are compacted into the instance ranges of the indirect commands with an
+//  atomic counter, so the draws only see what survived.
+//
+//  Culling happens in two phases to avoid popping. The early phase draws the
+//  instances that were visible last frame. The pyramid is built from the
+//  depth of those draws, and the late phase tests everything against it,
+//  drawing whatever the early phase missed. The late test also decides what
+//  the next early phase draws. The counts of each phase are copied to a ring
+//  of host visible buffers, one per frame in flight, so they can be read
+//  without stalling.
+//
+//  Version: 10/18/26
+//
+#ifndef __OCCLUSION_CULLER_H__
+#define __OCCLUSION_CULLER_H__
+#include "VulkanLoader.h"
+#include "PipelineService.h"
+#include <vector>
+#include <cstdint>
+
+class IndirectScene;
+
+/**
+ * The results of culling one frame, laid out for a storage buffer.
+ *
+ * This must match StatsBuffer in cull.comp.
+ */
+struct CullingStats {
+    /** The instances outside of the view frustum */
+    uint32_t frustumCulled;
+    /** The instances in the frustum, but behind the depth pyramid */
+    uint32_t occlusionCulled;
+    /** The instances drawn by the early phase */
+    uint32_t earlyDraws;
+    /** The instances drawn by the late phase */
+    uint32_t lateDraws;
+};
+
+/**
+ * A two-phase GPU culler for the instances of an IndirectScene.
+ *
+ * A frame records {@link recordEarly}, the draws of the early phase, then
+ * {@link recordPyramid}, {@link recordLate}, and the draws of the late phase.
+ * The late draws must load (not clear) the attachments of the early ones.
+ */
+class OcclusionCuller {
+public:
+    /** The two culling phases of a frame */
+    enum Phase : uint32_t {
+        /** Draws the instances visible last frame */
+        EARLY = 0,
+        /** Draws the instances the early phase missed */
+        LATE = 1
+    };
+
+    /** The compute shaders used by the culler */
+    struct Shaders {
+        /** The depth reduction (depthreduce.comp, matching the sample count) */
+        PipelineShader reduce;
+        /** The pyramid downsampler (mipmap.comp compiled with -DHIZ) */
+        PipelineShader pyramid;
+        /** The culling shader (cull.comp) */
+        PipelineShader cull;
+    };
+
+private:
+    /** The physical device, for memory types */
+    VkPhysicalDevice physicalDevice;
+    /** The logical device */
+    VkDevice device;
+    /** The number of instances in the scene */
+    uint32_t instanceCount;
+    /** The number of draw commands in each phase */
+    uint32_t drawCount;
+    /** The number of frames in flight */
+    uint32_t frameCount;
+    /** The sample count of the depth buffer */
+    VkSampleCountFlagBits samples;
+    /** The aspects of the depth format, for layout transitions */
+    VkImageAspectFlags depthAspects;
+
+    /** The layouts of the three compute passes */
+    VkDescriptorSetLayout reduceSetLayout;
+    VkDescriptorSetLayout pyramidSetLayout;
+    VkDescriptorSetLayout cullSetLayout;
+    VkPipelineLayout reduceLayout;
+    VkPipelineLayout pyramidLayout;
+    VkPipelineLayout cullLayout;
+    /** The pipelines of the three compute passes (compiled in the background) */
+    PipelineService::Request reducePipeline;
+    PipelineService::Request pyramidPipeline;
+    PipelineService::Request cullPipeline;
+
+    /** The pool for every set below */
+    VkDescriptorPool descriptorPool;
+    VkDescriptorSet reduceSet;
+    VkDescriptorSet pyramidSet;
+    /** One culling set per frame, as each has its own uniform buffer */
+    std::vector<VkDescriptorSet> cullSets;
+    /** The nearest sampler for the depth buffer and the pyramid */
+    VkSampler sampler;
+
+    /** The commands of both phases with no instances, copied in each frame */
+    VkBuffer templateBuffer;
+    VkDeviceMemory templateMemory;
+    /** The commands of both phases, followed by their draw counts */
+    VkBuffer drawBuffer;
+    VkDeviceMemory drawMemory;
+    /** The surviving instances of both phases */
+    VkBuffer visibleBuffer;
+    VkDeviceMemory visibleMemory;
+    /** The visibility of each instance after the last late phase */
+    VkBuffer visibilityBuffer;
+    VkDeviceMemory visibilityMemory;
+    /** The workgroup counter of the pyramid downsampler */
+    VkBuffer counterBuffer;
+    VkDeviceMemory counterMemory;
+    /** The counts of the current frame */
+    VkBuffer statsBuffer;
+    VkDeviceMemory statsMemory;
+    /** The readback ring, one CullingStats per frame in flight */
+    VkBuffer readbackBuffer;
+    VkDeviceMemory readbackMemory;
+    CullingStats* readback;
+    /** Whether the buffers above have been cleared */
+    bool initialized;
+
+    /** The depth buffer (owned by the caller) */
+    VkImage depthImage;
+    VkImageView depthView;
+    VkExtent2D depthExtent;
+    /** The Hi-Z pyramid */
+    VkImage pyramidImage;
+    VkDeviceMemory pyramidMemory;
+    /** A view of every level, for sampling */
+    VkImageView pyramidView;
+    /** A view of each level, for storage */
+    std::vector<VkImageView> levelViews;
+    VkExtent2D pyramidExtent;
+    uint32_t pyramidLevels;
+    /** Whether the pyramid still needs its initial layout transition */
+    bool pyramidFresh;
+
+    /**
+     * Creates the descriptor set layouts and requests the pipelines
+     *
+     * @param pipelines The pipeline service to compile on
+     * @param shaders   The compute shaders
+     */
+    void createPipelines(PipelineService& pipelines, const Shaders& shaders);
+
+    /**
+     * Creates the buffers, filling in the command template from the scene
+     *
+     * @param scene The scene to cull
+     */
+    void createBuffers(const IndirectScene& scene);
+
+    /**
+     * Allocates the descriptor sets, and writes everything but the images
+     *
+     * @param instances     The instance buffer of the scene
+     * @param uniforms      The uniform buffer of each frame
+     * @param uniformSize   The size of each uniform buffer
+     */
+    void createDescriptorSets(VkBuffer instances, const std::vector<VkBuffer>& uniforms, VkDeviceSize uniformSize);
+
+    /**
+     * Destroys the pyramid and its views, if they exist
+     */
+    void destroyPyramid();
+
+    /**
+     * Creates a buffer and binds it to new memory
+     *
+     * @param size          The buffer size
+     * @param usage         The buffer usage
+     * @param properties    The memory properties
+     * @param buffer        The buffer to create
+     * @param memory        The memory to allocate
+     */
+    void createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties,
+                      VkBuffer& buffer, VkDeviceMemory& memory);
+
+    /**
+     * Returns a memory type with the given properties
+     *
+     * @param typeFilter    The allowed memory types
+     * @param properties    The required memory properties
+     *
+     * @return a memory type with the given properties
+     */
+    uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const;
+
+    /**
+     * Records the culling shader for the given phase
+     *
+     * @param commandBuffer The command buffer to record to
+     * @param frame         The frame index
+     * @param phase         The culling phase
+     */
+    void recordCull(VkCommandBuffer commandBuffer, uint32_t frame, Phase phase);
+
+public:
+    /**
+     * Creates a culler for the given scene.
+     *
+     * The scene must already be built, and its instances uploaded to the
+     * given buffer. The uniform buffers must hold a UniformBufferObject. No
+     * culling can be recorded until {@link resize} has been called.
+     *
+     * @param physicalDevice    The physical device
+     * @param device            The logical device
+     * @param pipelines         The pipeline service to compile on
+     * @param shaders           The compute shaders
+     * @param scene             The scene to cull
+     * @param instances         The instance buffer of the scene
+     * @param uniforms          The uniform buffer of each frame in flight
+     * @param uniformSize       The size of each uniform buffer
+     * @param samples           The sample count of the depth buffer
+     * @param depthFormat       The format of the depth buffer
+     */
+    OcclusionCuller(VkPhysicalDevice physicalDevice, VkDevice device, PipelineService& pipelines,
+                    const Shaders& shaders, const IndirectScene& scene, VkBuffer instances,
+                    const std::vector<VkBuffer>& uniforms, VkDeviceSize uniformSize,
+                    VkSampleCountFlagBits samples, VkFormat depthFormat);
+
+    /**
+     * Destroys the culler. The device must be done with all of its work.
+     */
+    ~OcclusionCuller();
+
+    OcclusionCuller(const OcclusionCuller&) = delete;
+    OcclusionCuller& operator=(const OcclusionCuller&) = delete;
+
+    /**
+     * Rebuilds the pyramid for a new depth buffer.
+     *
+     * The depth buffer must have been created with VK_IMAGE_USAGE_SAMPLED_BIT.
+     * It is expected in VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL at the
+     * end of the early pass, and is left in that layout for the late pass.
+     * The device must be done with the old depth buffer.
+     *
+     * @param image     The depth buffer
+     * @param view      A depth view of the depth buffer
+     * @param extent    The size of the depth buffer
+     */
+    void resize(VkImage image, VkImageView view, VkExtent2D extent);
+
+    /**
+     * Returns true if every culling pipeline has compiled
+     *
+     * @return true if every culling pipeline has compiled
+     */
+    bool isReady() const;
+
+    /**
+     * Records the early culling phase, outside of any render pass.
+     *
+     * This resets the commands and counts for the frame, and culls the
+     * instances visible last frame against the frustum.
+     *
+     * @param commandBuffer The command buffer to record to
+     * @param frame         The frame index
+     */
+    void recordEarly(VkCommandBuffer commandBuffer, uint32_t frame);
+
+    /**
+     * Records the pyramid build, after the early draws have finished.
+     *
+     * @param commandBuffer The command buffer to record to
+     */
+    void recordPyramid(VkCommandBuffer commandBuffer);
+
+    /**
+     * Records the late culling phase, after the pyramid has been built.
+     *
+     * This also copies the counts for the frame to the readback ring.
+     *
+     * @param commandBuffer The command buffer to record to
+     * @param frame         The frame index
+     */
+    void recordLate(VkCommandBuffer commandBuffer, uint32_t frame);
+
+    /**
+     * Returns the buffer holding the commands and draw counts of both phases
+     *
+     * @return the buffer holding the commands and draw counts of both phases
+     */
+    VkBuffer getDrawBuffer() const { return drawBuffer; }
+
+    /**
+     * Returns the offset of the first command of the given phase
+     *
+     * @param phase The culling phase
+     *
+     * @return the offset of the first command of the given phase
+     */
+    VkDeviceSize getDrawOffset(Phase phase) const;
+
+    /**
+     * Returns the offset of the draw count of the given phase
+     *
+     * @param phase The culling phase
+     *
+     * @return the offset of the draw count of the given phase
+     */
+    VkDeviceSize getCountOffset(Phase phase) const;
+
+    /**
+     * Returns the number of commands in each phase
+     *
+     * @return the number of commands in each phase
+     */
+    uint32_t getDrawCount() const { return drawCount; }
+
+    /**
+     * Returns the buffer of surviving instances, for the vertex shader
+     *
+     * @return the buffer of surviving instances
+     */
+    VkBuffer getVisibleBuffer() const { return visibleBuffer; }
+
+    /**
+     * Returns the counts recorded for the given frame.
+     *
+     * The fence of that frame must have signaled. These are the counts from
+     * the last time the frame was submitted.
+     *
+     * @param frame The frame index
+     *
+     * @return the counts recorded for the given frame
+     */
+    CullingStats getStats(uint32_t frame) const { return readback[frame]; }
+};
+
+#endif /* __OCCLUSION_CULLER_H__ */
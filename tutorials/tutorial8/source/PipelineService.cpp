@@ -0,0 +1,803 @@
+//
+//  PipelineService.cpp
+//  Tutorial8
+//
+//  Asynchronous pipeline compilation. The tutorial creates each pipeline on
+//  the main thread inside initVulkan, so startup pays for every compile in
+//  sequence, and any new pipeline stalls whatever frame first asks for it.
+//
+//  This service takes a complete description of a pipeline, hashes it into
+//  a key, and compiles any pipeline it has not seen before on a WorkerPool.
+//  The pool belongs to the service, so that a long compile never sits in
+//  front of the per-frame work queued on the shared pool.
+//  All compiles share a single VkPipelineCache, so identical shader stages
+//  are only compiled once by the driver. Requests return a shared future
+//  immediately. The renderer can block on that future, or it can poll it
+//  each frame and either draw with a fallback pipeline or skip the draw
+//  until the compile is done.
+//
+//  If the device supports VK_EXT_graphics_pipeline_library, a graphics
+//  pipeline is instead split into four libraries: vertex input, pre-raster
+//  shaders, fragment shader, and fragment output. Each library is compiled
+//  once and shared by every variant that uses it. A new variant is then just
+//  a fast link of existing libraries, which takes microseconds instead of
+//  milliseconds. An optimized link is compiled in the background and
+//  replaces the fast-linked pipeline once it is ready.
+//
+//  Version: 10/18/26
+//
+#include "PipelineService.h"
+#include <stdexcept>
+#include <exception>
+#include <algorithm>
+#include <chrono>
+
+namespace {
+
+/** The four parts of a graphics pipeline, in link order */
+const std::array<VkGraphicsPipelineLibraryFlagsEXT, 4> LIBRARY_PARTS = {
+    VK_GRAPHICS_PIPELINE_LIBRARY_VERTEX_INPUT_INTERFACE_BIT_EXT,
+    VK_GRAPHICS_PIPELINE_LIBRARY_PRE_RASTERIZATION_SHADERS_BIT_EXT,
+    VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_SHADER_BIT_EXT,
+    VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_OUTPUT_INTERFACE_BIT_EXT
+};
+
+/** All four parts of a graphics pipeline */
+const VkGraphicsPipelineLibraryFlagsEXT ALL_PARTS = VK_GRAPHICS_PIPELINE_LIBRARY_VERTEX_INPUT_INTERFACE_BIT_EXT |
+                                                    VK_GRAPHICS_PIPELINE_LIBRARY_PRE_RASTERIZATION_SHADERS_BIT_EXT |
+                                                    VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_SHADER_BIT_EXT |
+                                                    VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_OUTPUT_INTERFACE_BIT_EXT;
+
+/**
+ * Serializes pipeline state into a flat byte string.
+ *
+ * Two states produce the same string exactly when they would produce the
+ * same pipeline, so the string can be used directly as a hash key. All of
+ * the Vulkan structs written here are tightly packed 32-bit fields.
+ */
+class KeyWriter {
+private:
+    /** The serialized state */
+    std::string key;
+
+public:
+    /**
+     * Appends a plain value to the key
+     *
+     * @param value The value to append
+     */
+    template <typename T>
+    void write(const T& value) {
+        key.append(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    /**
+     * Appends an array of plain values to the key, prefixed by its length
+     *
+     * @param values    The values to append
+     */
+    template <typename T>
+    void write(const std::vector<T>& values) {
+        write(static_cast<uint64_t>(values.size()));
+        if (!values.empty()) {
+            key.append(reinterpret_cast<const char*>(values.data()), sizeof(T)*values.size());
+        }
+    }
+
+    /**
+     * Appends a shader stage to the key.
+     *
+     * The SPIR-V is reduced to its length and a 64-bit FNV-1a hash.
+     *
+     * @param shader    The shader stage to append
+     */
+    void write(const PipelineShader& shader) {
+        uint64_t hash = 14695981039346656037ull;
+        uint64_t size = 0;
+        if (shader.code) {
+            for (char c : *shader.code) {
+                hash = (hash ^ static_cast<uint8_t>(c)) * 1099511628211ull;
+            }
+            size = shader.code->size();
+        }
+        write(shader.stage);
+        write(size);
+        write(hash);
+        write(static_cast<uint64_t>(shader.entry.size()));
+        key.append(shader.entry);
+    }
+
+    /**
+     * Appends the state of a graphics pipeline that belongs to the given parts.
+     *
+     * @param state The pipeline state
+     * @param parts The pipeline library parts to include
+     */
+    void write(const GraphicsPipelineState& state, VkGraphicsPipelineLibraryFlagsEXT parts) {
+        write(static_cast<uint32_t>(VK_PIPELINE_BIND_POINT_GRAPHICS));
+        write(parts);
+        if (parts & VK_GRAPHICS_PIPELINE_LIBRARY_VERTEX_INPUT_INTERFACE_BIT_EXT) {
+            write(state.bindings);
+            write(state.attributes);
+            write(state.topology);
+        }
+        if (parts & VK_GRAPHICS_PIPELINE_LIBRARY_PRE_RASTERIZATION_SHADERS_BIT_EXT) {
+            for (const auto& shader : state.shaders) {
+                if (shader.stage != VK_SHADER_STAGE_FRAGMENT_BIT) {
+                    write(shader);
+                }
+            }
+            write(state.polygonMode);
+            write(state.cullMode);
+            write(state.frontFace);
+        }
+        if (parts & VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_SHADER_BIT_EXT) {
+            for (const auto& shader : state.shaders) {
+                if (shader.stage == VK_SHADER_STAGE_FRAGMENT_BIT) {
+                    write(shader);
+                }
+            }
+            write(state.depthTest);
+            write(state.depthWrite);
+            write(state.depthCompare);
+        }
+        if (parts & VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_OUTPUT_INTERFACE_BIT_EXT) {
+            write(state.blendAttachments);
+        }
+        if (parts & (VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_SHADER_BIT_EXT |
+                     VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_OUTPUT_INTERFACE_BIT_EXT)) {
+            write(state.samples);
+        }
+        if (parts & ~VK_GRAPHICS_PIPELINE_LIBRARY_VERTEX_INPUT_INTERFACE_BIT_EXT) {
+            write(state.dynamicStates);
+            write(state.layout);
+            write(state.renderPass);
+            write(state.subpass);
+        }
+    }
+
+    /**
+     * Returns the serialized key, leaving this writer empty
+     *
+     * @return the serialized key
+     */
+    std::string release() { return std::move(key); }
+};
+
+/**
+ * The create info for a graphics pipeline, or for some parts of one.
+ *
+ * This owns the shader modules and every struct the create info points to,
+ * so it must not be moved. Shader stages are only included for the parts
+ * that need them, as required for pipeline libraries.
+ */
+class GraphicsCreateInfo {
+private:
+    /** The logical device */
+    VkDevice device;
+    /** The shader modules for the stages */
+    std::vector<VkShaderModule> modules;
+
+public:
+    std::vector<VkPipelineShaderStageCreateInfo> stages;
+    VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
+    VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
+    VkPipelineViewportStateCreateInfo viewportState{};
+    VkPipelineRasterizationStateCreateInfo rasterizer{};
+    VkPipelineMultisampleStateCreateInfo multisampling{};
+    VkPipelineDepthStencilStateCreateInfo depthStencil{};
+    VkPipelineColorBlendStateCreateInfo colorBlending{};
+    std::vector<VkDynamicState> dynamicStates;
+    VkPipelineDynamicStateCreateInfo dynamicState{};
+    VkGraphicsPipelineCreateInfo pipelineInfo{};
+
+    /**
+     * Creates the create info for the given parts of a pipeline
+     *
+     * @param device    The logical device
+     * @param state     The pipeline state
+     * @param parts     The pipeline library parts to include
+     */
+    GraphicsCreateInfo(VkDevice device, const GraphicsPipelineState& state, VkGraphicsPipelineLibraryFlagsEXT parts) :
+        device(device) {
+        try {
+            for (const auto& shader : state.shaders) {
+                bool fragment = shader.stage == VK_SHADER_STAGE_FRAGMENT_BIT;
+                if (fragment ? !(parts & VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_SHADER_BIT_EXT) :
+                               !(parts & VK_GRAPHICS_PIPELINE_LIBRARY_PRE_RASTERIZATION_SHADERS_BIT_EXT)) {
+                    continue;
+                }
+                if (!shader.code) {
+                    throw std::runtime_error("pipeline shader has no code!");
+                }
+
+                VkShaderModuleCreateInfo createInfo{};
+                createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+                createInfo.codeSize = shader.code->size();
+                createInfo.pCode = reinterpret_cast<const uint32_t*>(shader.code->data());
+
+                VkShaderModule shaderModule;
+                if (vkCreateShaderModule(device, &createInfo, nullptr, &shaderModule) != VK_SUCCESS) {
+                    throw std::runtime_error("failed to create shader module!");
+                }
+                modules.push_back(shaderModule);
+
+                VkPipelineShaderStageCreateInfo stageInfo{};
+                stageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+                stageInfo.stage = shader.stage;
+                stageInfo.module = shaderModule;
+                stageInfo.pName = shader.entry.c_str();
+                stages.push_back(stageInfo);
+            }
+        } catch (...) {
+            for (auto module : modules) {
+                vkDestroyShaderModule(device, module, nullptr);
+            }
+            throw;
+        }
+
+        vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+        vertexInputInfo.vertexBindingDescriptionCount = static_cast<uint32_t>(state.bindings.size());
+        vertexInputInfo.pVertexBindingDescriptions = state.bindings.data();
+        vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(state.attributes.size());
+        vertexInputInfo.pVertexAttributeDescriptions = state.attributes.data();
+
+        inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+        inputAssembly.topology = state.topology;
+        inputAssembly.primitiveRestartEnable = VK_FALSE;
+
+        viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+        viewportState.viewportCount = 1;
+        viewportState.scissorCount = 1;
+
+        rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+        rasterizer.depthClampEnable = VK_FALSE;
+        rasterizer.rasterizerDiscardEnable = VK_FALSE;
+        rasterizer.polygonMode = state.polygonMode;
+        rasterizer.lineWidth = 1.0f;
+        rasterizer.cullMode = state.cullMode;
+        rasterizer.frontFace = state.frontFace;
+        rasterizer.depthBiasEnable = VK_FALSE;
+
+        multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+        multisampling.sampleShadingEnable = VK_FALSE;
+        multisampling.rasterizationSamples = state.samples;
+
+        depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+        depthStencil.depthTestEnable = state.depthTest;
+        depthStencil.depthWriteEnable = state.depthWrite;
+        depthStencil.depthCompareOp = state.depthCompare;
+        depthStencil.depthBoundsTestEnable = VK_FALSE;
+        depthStencil.stencilTestEnable = VK_FALSE;
+
+        colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+        colorBlending.logicOpEnable = VK_FALSE;
+        colorBlending.logicOp = VK_LOGIC_OP_COPY;
+        colorBlending.attachmentCount = static_cast<uint32_t>(state.blendAttachments.size());
+        colorBlending.pAttachments = state.blendAttachments.data();
+
+        dynamicStates = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+        dynamicStates.insert(dynamicStates.end(), state.dynamicStates.begin(), state.dynamicStates.end());
+
+        dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+        dynamicState.dynamicStateCount = static_cast<uint32_t>(dynamicStates.size());
+        dynamicState.pDynamicStates = dynamicStates.data();
+
+        pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+        pipelineInfo.stageCount = static_cast<uint32_t>(stages.size());
+        pipelineInfo.pStages = stages.data();
+        pipelineInfo.pVertexInputState = &vertexInputInfo;
+        pipelineInfo.pInputAssemblyState = &inputAssembly;
+        pipelineInfo.pViewportState = &viewportState;
+        pipelineInfo.pRasterizationState = &rasterizer;
+        pipelineInfo.pMultisampleState = &multisampling;
+        pipelineInfo.pDepthStencilState = &depthStencil;
+        pipelineInfo.pColorBlendState = &colorBlending;
+        pipelineInfo.pDynamicState = &dynamicState;
+        pipelineInfo.layout = state.layout;
+        pipelineInfo.renderPass = state.renderPass;
+        pipelineInfo.subpass = state.subpass;
+        pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+    }
+
+    /**
+     * Destroys the shader modules
+     */
+    ~GraphicsCreateInfo() {
+        for (auto module : modules) {
+            vkDestroyShaderModule(device, module, nullptr);
+        }
+    }
+
+    GraphicsCreateInfo(const GraphicsCreateInfo&) = delete;
+    GraphicsCreateInfo& operator=(const GraphicsCreateInfo&) = delete;
+};
+
+/**
+ * Returns true if the request is ready, without rethrowing any error
+ *
+ * @param request   The pipeline request
+ *
+ * @return true if the request is ready
+ */
+bool is_ready(const std::shared_future<VkPipeline>& request) {
+    return request.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+}
+
+}
+
+// REQUEST
+
+/**
+ * Returns the best pipeline available, blocking until there is one.
+ *
+ * If the compile failed, the error is rethrown here.
+ *
+ * @return the best pipeline available
+ */
+VkPipeline PipelineService::Request::get() const {
+    if (optimized) {
+        VkPipeline pipeline = optimized->load();
+        if (pipeline != VK_NULL_HANDLE) {
+            return pipeline;
+        }
+    }
+    return pipeline.get();
+}
+
+// SERVICE
+
+/**
+ * Creates a service that compiles on its own pool of threads.
+ *
+ * The initial data may come from an earlier call to {@link getCacheData}.
+ * If it does not match this device, the driver will ignore it. To use
+ * pipeline libraries, the device must have enabled the feature
+ * graphicsPipelineLibrary of VK_EXT_graphics_pipeline_library.
+ *
+ * @param device    The logical device
+ * @param initial   The initial pipeline cache data
+ * @param libraries Whether to build graphics pipelines from libraries
+ * @param threads   The number of compile threads (0 for half the cores)
+ */
+PipelineService::PipelineService(VkDevice device, const std::vector<char>& initial, bool libraries, uint32_t threads) :
+    device(device),
+    // Compiles leave the other half of the cores to the frame
+    workers(threads > 0 ? threads : std::max(std::thread::hardware_concurrency()/2, 1u)),
+    cache(VK_NULL_HANDLE),
+    libraries(libraries) {
+    VkPipelineCacheCreateInfo cacheInfo{};
+    cacheInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+    cacheInfo.initialDataSize = initial.size();
+    cacheInfo.pInitialData = initial.empty() ? nullptr : initial.data();
+
+    if (vkCreatePipelineCache(device, &cacheInfo, nullptr, &cache) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create pipeline cache!");
+    }
+}
+
+/**
+ * Waits on any pending compiles, and destroys every pipeline and the cache.
+ */
+PipelineService::~PipelineService() {
+    wait();
+    // Linked pipelines are destroyed before the libraries they came from
+    for (auto it = created.rbegin(); it != created.rend(); ++it) {
+        vkDestroyPipeline(device, *it, nullptr);
+    }
+    vkDestroyPipelineCache(device, cache, nullptr);
+}
+
+/**
+ * Returns the existing request for key, or registers a new one.
+ *
+ * If the request is new, promise is set and the caller must fulfill it.
+ * Otherwise promise is left empty.
+ *
+ * @param key       The serialized pipeline state
+ * @param promise   The promise to fulfill, if the request is new
+ *
+ * @return the request for the pipeline
+ */
+PipelineService::Request PipelineService::lookup(std::string&& key, std::shared_ptr<std::promise<VkPipeline>>& promise) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = requests.find(key);
+    if (it != requests.end()) {
+        promise.reset();
+        return it->second;
+    }
+
+    promise = std::make_shared<std::promise<VkPipeline>>();
+    Request result;
+    result.pipeline = promise->get_future().share();
+    result.optimized = std::make_shared<std::atomic<VkPipeline>>(VK_NULL_HANDLE);
+    result.followers = std::make_shared<Followers>();
+    requests.emplace(std::move(key), result);
+    return result;
+}
+
+/**
+ * Returns the existing request for key, or starts a new compile
+ *
+ * @param key       The serialized pipeline state
+ * @param compile   The function to create the pipeline
+ *
+ * @return the request for the pipeline
+ */
+PipelineService::Request PipelineService::lookup(std::string&& key, std::function<VkPipeline()> compile) {
+    std::shared_ptr<std::promise<VkPipeline>> promise;
+    Request result = lookup(std::move(key), promise);
+    if (promise) {
+        submit([this, promise, compile, result] {
+            try {
+                promise->set_value(track(compile));
+            } catch (...) {
+                promise->set_exception(std::current_exception());
+            }
+            finish(result);
+        });
+    }
+    return result;
+}
+
+/**
+ * Creates a pipeline and records it for destruction
+ *
+ * @param compile   The function to create the pipeline
+ *
+ * @return the new pipeline
+ */
+VkPipeline PipelineService::track(const std::function<VkPipeline()>& compile) {
+    VkPipeline pipeline = compile();
+    std::lock_guard<std::mutex> lock(mutex);
+    created.push_back(pipeline);
+    return pipeline;
+}
+
+/**
+ * Queues a task on the pool, so that {@link wait} can find it
+ *
+ * @param task  The task to execute
+ */
+void PipelineService::submit(std::function<void()> task) {
+    std::shared_future<void> future = workers.submit(std::move(task)).share();
+    std::lock_guard<std::mutex> lock(mutex);
+    tasks.push_back(future);
+}
+
+/**
+ * Runs task once the request is complete, successfully or not.
+ *
+ * If the request is already complete, task runs immediately on this
+ * thread. Otherwise it runs on the pool thread that completes it. In
+ * either case, task must not block.
+ *
+ * @param request   The pipeline request
+ * @param task      The task to execute
+ */
+void PipelineService::then(const Request& request, std::function<void()> task) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!request.followers->done) {
+            request.followers->tasks.push_back(std::move(task));
+            return;
+        }
+    }
+    task();
+}
+
+/**
+ * Marks the request as complete, and runs every task waiting on it
+ *
+ * @param request   The pipeline request
+ */
+void PipelineService::finish(const Request& request) {
+    std::vector<std::function<void()>> ready;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        request.followers->done = true;
+        ready.swap(request.followers->tasks);
+    }
+    for (auto& task : ready) {
+        task();
+    }
+}
+
+/**
+ * Creates a graphics pipeline synchronously
+ *
+ * @param state The pipeline state
+ *
+ * @return the new pipeline
+ */
+VkPipeline PipelineService::compile(const GraphicsPipelineState& state) const {
+    GraphicsCreateInfo createInfo(device, state, ALL_PARTS);
+
+    // The cache is internally synchronized, so the workers may share it
+    VkPipeline pipeline = VK_NULL_HANDLE;
+    if (vkCreateGraphicsPipelines(device, cache, 1, &createInfo.pipelineInfo, nullptr, &pipeline) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create graphics pipeline!");
+    }
+    return pipeline;
+}
+
+/**
+ * Creates a compute pipeline synchronously
+ *
+ * @param state The pipeline state
+ *
+ * @return the new pipeline
+ */
+VkPipeline PipelineService::compile(const ComputePipelineState& state) const {
+    if (!state.shader.code) {
+        throw std::runtime_error("pipeline shader has no code!");
+    }
+
+    VkShaderModuleCreateInfo createInfo{};
+    createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+    createInfo.codeSize = state.shader.code->size();
+    createInfo.pCode = reinterpret_cast<const uint32_t*>(state.shader.code->data());
+
+    VkShaderModule module;
+    if (vkCreateShaderModule(device, &createInfo, nullptr, &module) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create shader module!");
+    }
+
+    VkPipelineShaderStageCreateInfo stageInfo{};
+    stageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    stageInfo.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    stageInfo.module = module;
+    stageInfo.pName = state.shader.entry.c_str();
+
+    VkComputePipelineCreateInfo pipelineInfo{};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipelineInfo.layout = state.layout;
+    pipelineInfo.stage = stageInfo;
+
+    VkPipeline pipeline = VK_NULL_HANDLE;
+    VkResult result = vkCreateComputePipelines(device, cache, 1, &pipelineInfo, nullptr, &pipeline);
+
+    vkDestroyShaderModule(device, module, nullptr);
+    if (result != VK_SUCCESS) {
+        throw std::runtime_error("failed to create compute pipeline!");
+    }
+    return pipeline;
+}
+
+// PIPELINE LIBRARIES
+
+/**
+ * Returns the library for one part of a graphics pipeline
+ *
+ * @param state The pipeline state
+ * @param part  The pipeline library part
+ *
+ * @return the request for the library
+ */
+PipelineService::Request PipelineService::requestLibrary(const GraphicsPipelineState& state, VkGraphicsPipelineLibraryFlagsEXT part) {
+    KeyWriter key;
+    key.write(state, part);
+    return lookup(key.release(), [this, state, part] { return compileLibrary(state, part); });
+}
+
+/**
+ * Creates one library of a graphics pipeline synchronously
+ *
+ * @param state The pipeline state
+ * @param part  The pipeline library part
+ *
+ * @return the new pipeline library
+ */
+VkPipeline PipelineService::compileLibrary(const GraphicsPipelineState& state, VkGraphicsPipelineLibraryFlagsEXT part) const {
+    GraphicsCreateInfo createInfo(device, state, part);
+
+    VkGraphicsPipelineLibraryCreateInfoEXT libraryInfo{};
+    libraryInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_LIBRARY_CREATE_INFO_EXT;
+    libraryInfo.flags = part;
+
+    // Retaining the link time info is what allows the optimized relink
+    createInfo.pipelineInfo.pNext = &libraryInfo;
+    createInfo.pipelineInfo.flags = VK_PIPELINE_CREATE_LIBRARY_BIT_KHR |
+                                    VK_PIPELINE_CREATE_RETAIN_LINK_TIME_OPTIMIZATION_INFO_BIT_EXT;
+
+    VkPipeline pipeline = VK_NULL_HANDLE;
+    if (vkCreateGraphicsPipelines(device, cache, 1, &createInfo.pipelineInfo, nullptr, &pipeline) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create graphics pipeline library!");
+    }
+    return pipeline;
+}
+
+/**
+ * Links a complete graphics pipeline from libraries
+ *
+ * @param parts     The four pipeline libraries
+ * @param layout    The pipeline layout
+ * @param optimize  Whether to perform link time optimization
+ *
+ * @return the linked pipeline
+ */
+VkPipeline PipelineService::link(const std::array<VkPipeline, 4>& parts, VkPipelineLayout layout, bool optimize) const {
+    VkPipelineLibraryCreateInfoKHR libraryInfo{};
+    libraryInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LIBRARY_CREATE_INFO_KHR;
+    libraryInfo.libraryCount = static_cast<uint32_t>(parts.size());
+    libraryInfo.pLibraries = parts.data();
+
+    VkGraphicsPipelineCreateInfo pipelineInfo{};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+    pipelineInfo.pNext = &libraryInfo;
+    pipelineInfo.flags = optimize ? VK_PIPELINE_CREATE_LINK_TIME_OPTIMIZATION_BIT_EXT : 0;
+    pipelineInfo.layout = layout;
+    pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+
+    VkPipeline pipeline = VK_NULL_HANDLE;
+    if (vkCreateGraphicsPipelines(device, cache, 1, &pipelineInfo, nullptr, &pipeline) != VK_SUCCESS) {
+        throw std::runtime_error("failed to link graphics pipeline!");
+    }
+    return pipeline;
+}
+
+// REQUESTS
+
+/**
+ * Returns the pipeline for the given state, compiling it if necessary.
+ *
+ * This does not block. Identical states return the same request. If the
+ * compile fails, the request will rethrow the error when it is read.
+ *
+ * With pipeline libraries, any missing libraries are compiled in the
+ * background. If all of them are ready, the pipeline is fast-linked
+ * before this method returns, so the request is immediately ready.
+ *
+ * @param state The pipeline state
+ *
+ * @return the request for the pipeline
+ */
+PipelineService::Request PipelineService::request(const GraphicsPipelineState& state) {
+    KeyWriter key;
+    key.write(state, ALL_PARTS);
+    if (!libraries) {
+        return lookup(key.release(), [this, state] { return compile(state); });
+    }
+
+    std::shared_ptr<std::promise<VkPipeline>> promise;
+    Request result = lookup(key.release(), promise);
+    if (!promise) {
+        return result;
+    }
+
+    std::array<Request, 4> parts;
+    for (size_t ii = 0; ii < parts.size(); ii++) {
+        parts[ii] = requestLibrary(state, LIBRARY_PARTS[ii]);
+    }
+
+    // The links are chained off the libraries rather than queued behind
+    // them, so no pool thread ever blocks on a library that is compiling
+    VkPipelineLayout layout = state.layout;
+    auto linker = [this, parts, layout](bool optimize) {
+        std::array<VkPipeline, 4> handles;
+        for (size_t ii = 0; ii < parts.size(); ii++) {
+            handles[ii] = parts[ii].pipeline.get();
+        }
+        return link(handles, layout, optimize);
+    };
+
+    // The fast link is cheap, so it runs on whichever thread finishes the last
+    // library. If every library is already compiled, that is this thread.
+    auto remaining = std::make_shared<std::atomic<uint32_t>>(static_cast<uint32_t>(parts.size()));
+    auto optimized = result.optimized;
+    auto linkAll = [this, promise, linker, optimized, result, remaining] {
+        if (remaining->fetch_sub(1) != 1) {
+            return;
+        }
+        try {
+            promise->set_value(track([&] { return linker(false); }));
+        } catch (...) {
+            promise->set_exception(std::current_exception());
+        }
+        finish(result);
+
+        // If the optimized link fails, we just keep the fast-linked pipeline
+        submit([this, optimized, linker] {
+            try {
+                optimized->store(track([&] { return linker(true); }));
+            } catch (...) {
+            }
+        });
+    };
+    for (const auto& part : parts) {
+        then(part, linkAll);
+    }
+    return result;
+}
+
+/**
+ * Returns the pipeline for the given state, compiling it if necessary.
+ *
+ * This does not block. Identical states return the same request. If the
+ * compile fails, the request will rethrow the error when it is read.
+ *
+ * @param state The pipeline state
+ *
+ * @return the request for the pipeline
+ */
+PipelineService::Request PipelineService::request(const ComputePipelineState& state) {
+    KeyWriter key;
+    key.write(static_cast<uint32_t>(VK_PIPELINE_BIND_POINT_COMPUTE));
+    key.write(state.shader);
+    key.write(state.layout);
+
+    return lookup(key.release(), [this, state] { return compile(state); });
+}
+
+/**
+ * Returns the requested pipeline if it is ready, or fallback if not.
+ *
+ * This never blocks. The optimized pipeline is returned in place of the
+ * fast-linked one as soon as it is ready. Pass VK_NULL_HANDLE as the
+ * fallback to skip the draws until the pipeline is ready. If the compile
+ * failed, the error is rethrown here.
+ *
+ * @param request   The pipeline request
+ * @param fallback  The pipeline to use in the meantime
+ *
+ * @return the requested pipeline if it is ready, or fallback if not
+ */
+VkPipeline PipelineService::poll(const Request& request, VkPipeline fallback) {
+    if (!request.valid()) {
+        return fallback;
+    }
+    if (request.optimized) {
+        VkPipeline pipeline = request.optimized->load();
+        if (pipeline != VK_NULL_HANDLE) {
+            return pipeline;
+        }
+    }
+    if (!is_ready(request.pipeline)) {
+        return fallback;
+    }
+    return request.pipeline.get();
+}
+
+/**
+ * Blocks until every compile requested so far is complete.
+ *
+ * This includes any links queued once their libraries are ready.
+ */
+void PipelineService::wait() {
+    // A finished library may queue a link, so repeat until nothing is left
+    while (true) {
+        std::vector<std::shared_future<void>> pending;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            pending = tasks;
+        }
+        if (pending.empty()) {
+            return;
+        }
+        for (const auto& task : pending) {
+            task.wait();
+        }
+
+        // Tasks are only ever appended, so the ones we waited on are at the front
+        std::lock_guard<std::mutex> lock(mutex);
+        tasks.erase(tasks.begin(), tasks.begin() + std::min(pending.size(), tasks.size()));
+    }
+}
+
+/**
+ * Returns the contents of the pipeline cache, to save for the next run
+ *
+ * @return the contents of the pipeline cache
+ */
+std::vector<char> PipelineService::getCacheData() const {
+    size_t size = 0;
+    if (vkGetPipelineCacheData(device, cache, &size, nullptr) != VK_SUCCESS) {
+        return {};
+    }
+    std::vector<char> data(size);
+    if (vkGetPipelineCacheData(device, cache, &size, data.data()) != VK_SUCCESS) {
+        return {};
+    }
+    data.resize(size);
+    return data;
+}
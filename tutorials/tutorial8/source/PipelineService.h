@@ -0,0 +1,391 @@
+//
+//  PipelineService.h
+//  Tutorial8
+//
+//  Asynchronous pipeline compilation. The tutorial creates each pipeline on
+//  the main thread inside initVulkan, so startup pays for every compile in
+//  sequence, and any new pipeline stalls whatever frame first asks for it.
+//
+//  This service takes a complete description of a pipeline, hashes it into
+//  a key, and compiles any pipeline it has not seen before on a WorkerPool.
+//  The pool belongs to the service, so that a long compile never sits in
+//  front of the per-frame work queued on the shared pool.
+//  All compiles share a single VkPipelineCache, so identical shader stages
+//  are only compiled once by the driver. Requests return a shared future
+//  immediately. The renderer can block on that future, or it can poll it
+//  each frame and either draw with a fallback pipeline or skip the draw
+//  until the compile is done.
+//
+//  If the device supports VK_EXT_graphics_pipeline_library, a graphics
+//  pipeline is instead split into four libraries: vertex input, pre-raster
+//  shaders, fragment shader, and fragment output. Each library is compiled
+//  once and shared by every variant that uses it. A new variant is then just
+//  a fast link of existing libraries, which takes microseconds instead of
+//  milliseconds. An optimized link is compiled in the background and
+//  replaces the fast-linked pipeline once it is ready.
+//
+//  Version: 10/18/26
+//
+#ifndef __PIPELINE_SERVICE_H__
+#define __PIPELINE_SERVICE_H__
+#include "VulkanLoader.h"
+#include "WorkerPool.h"
+#include <unordered_map>
+#include <array>
+#include <atomic>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+// PIPELINE STATE
+
+/**
+ * A shader stage in a pipeline description.
+ *
+ * The SPIR-V is shared, so descriptions are cheap to copy to the workers.
+ */
+struct PipelineShader {
+    /** The shader stage */
+    VkShaderStageFlagBits stage;
+    /** The SPIR-V code */
+    std::shared_ptr<const std::vector<char>> code;
+    /** The entry point */
+    std::string entry = "main";
+};
+
+/**
+ * The complete state for a graphics pipeline.
+ *
+ * The defaults match the fixed function state of the tutorial. Viewport and
+ * scissor are always dynamic. Only one subpass of a render pass is supported.
+ */
+struct GraphicsPipelineState {
+    /** The shader stages */
+    std::vector<PipelineShader> shaders;
+    /** The vertex buffer bindings */
+    std::vector<VkVertexInputBindingDescription> bindings;
+    /** The vertex attributes */
+    std::vector<VkVertexInputAttributeDescription> attributes;
+    /** The primitive topology */
+    VkPrimitiveTopology topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+    /** The polygon mode */
+    VkPolygonMode polygonMode = VK_POLYGON_MODE_FILL;
+    /** The cull mode */
+    VkCullModeFlags cullMode = VK_CULL_MODE_BACK_BIT;
+    /** The front face winding */
+    VkFrontFace frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+    /** The rasterization samples */
+    VkSampleCountFlagBits samples = VK_SAMPLE_COUNT_1_BIT;
+    /** Whether depth testing is enabled */
+    VkBool32 depthTest = VK_TRUE;
+    /** Whether depth writes are enabled */
+    VkBool32 depthWrite = VK_TRUE;
+    /** The depth comparison */
+    VkCompareOp depthCompare = VK_COMPARE_OP_LESS;
+    /** The blend state of each color attachment */
+    std::vector<VkPipelineColorBlendAttachmentState> blendAttachments;
+    /** The dynamic states in addition to viewport and scissor */
+    std::vector<VkDynamicState> dynamicStates;
+    /** The pipeline layout */
+    VkPipelineLayout layout = VK_NULL_HANDLE;
+    /** The render pass */
+    VkRenderPass renderPass = VK_NULL_HANDLE;
+    /** The subpass index */
+    uint32_t subpass = 0;
+};
+
+/**
+ * The complete state for a compute pipeline.
+ */
+struct ComputePipelineState {
+    /** The compute shader */
+    PipelineShader shader;
+    /** The pipeline layout */
+    VkPipelineLayout layout = VK_NULL_HANDLE;
+};
+
+// SERVICE
+
+/**
+ * A cache of pipelines that compiles misses in the background.
+ *
+ * The service owns every pipeline it creates, and destroys them when it is
+ * deleted. Layouts and render passes belong to the caller, and must outlive
+ * any compile that uses them.
+ */
+class PipelineService {
+private:
+    /**
+     * The tasks waiting on a pipeline to compile.
+     *
+     * This is guarded by the service mutex.
+     */
+    struct Followers {
+        /** Whether the compile has finished, successfully or not */
+        bool done = false;
+        /** The tasks to run once it has */
+        std::vector<std::function<void()>> tasks;
+    };
+
+public:
+    /**
+     * A pipeline that may still be compiling.
+     *
+     * Requests are cheap to copy, and all copies refer to the same pipeline.
+     * With pipeline libraries, the pipeline may be replaced by an optimized
+     * one after it first becomes ready, so it should be read again each frame.
+     */
+    class Request {
+    private:
+        friend class PipelineService;
+        /** The first usable pipeline (fast-linked when using libraries) */
+        std::shared_future<VkPipeline> pipeline;
+        /** The optimized pipeline, once it has been linked */
+        std::shared_ptr<std::atomic<VkPipeline>> optimized;
+        /** The tasks to run once the first pipeline is ready */
+        std::shared_ptr<Followers> followers;
+
+    public:
+        /**
+         * Returns true if this request refers to a pipeline
+         *
+         * @return true if this request refers to a pipeline
+         */
+        bool valid() const { return pipeline.valid(); }
+
+        /**
+         * Returns the best pipeline available, blocking until there is one.
+         *
+         * If the compile failed, the error is rethrown here.
+         *
+         * @return the best pipeline available
+         */
+        VkPipeline get() const;
+    };
+
+private:
+    /** The logical device */
+    VkDevice device;
+    /** The pool to compile on */
+    WorkerPool workers;
+    /** The cache shared by every compile */
+    VkPipelineCache cache;
+    /** Whether to build graphics pipelines from pipeline libraries */
+    bool libraries;
+    /** Mutex guarding the tables below */
+    std::mutex mutex;
+    /** Every request made, keyed by the serialized pipeline state */
+    std::unordered_map<std::string, Request> requests;
+    /** Every pipeline successfully created */
+    std::vector<VkPipeline> created;
+    /** The compile tasks that may still be running */
+    std::vector<std::shared_future<void>> tasks;
+
+    /**
+     * Returns the existing request for key, or registers a new one.
+     *
+     * If the request is new, promise is set and the caller must fulfill it.
+     * Otherwise promise is left empty.
+     *
+     * @param key       The serialized pipeline state
+     * @param promise   The promise to fulfill, if the request is new
+     *
+     * @return the request for the pipeline
+     */
+    Request lookup(std::string&& key, std::shared_ptr<std::promise<VkPipeline>>& promise);
+
+    /**
+     * Returns the existing request for key, or starts a new compile
+     *
+     * @param key       The serialized pipeline state
+     * @param compile   The function to create the pipeline
+     *
+     * @return the request for the pipeline
+     */
+    Request lookup(std::string&& key, std::function<VkPipeline()> compile);
+
+    /**
+     * Creates a pipeline and records it for destruction
+     *
+     * @param compile   The function to create the pipeline
+     *
+     * @return the new pipeline
+     */
+    VkPipeline track(const std::function<VkPipeline()>& compile);
+
+    /**
+     * Queues a task on the pool, so that {@link wait} can find it
+     *
+     * @param task  The task to execute
+     */
+    void submit(std::function<void()> task);
+
+    /**
+     * Runs task once the request is complete, successfully or not.
+     *
+     * If the request is already complete, task runs immediately on this
+     * thread. Otherwise it runs on the pool thread that completes it. In
+     * either case, task must not block.
+     *
+     * @param request   The pipeline request
+     * @param task      The task to execute
+     */
+    void then(const Request& request, std::function<void()> task);
+
+    /**
+     * Marks the request as complete, and runs every task waiting on it
+     *
+     * @param request   The pipeline request
+     */
+    void finish(const Request& request);
+
+    /**
+     * Returns the library for one part of a graphics pipeline
+     *
+     * @param state The pipeline state
+     * @param part  The pipeline library part
+     *
+     * @return the request for the library
+     */
+    Request requestLibrary(const GraphicsPipelineState& state, VkGraphicsPipelineLibraryFlagsEXT part);
+
+    /**
+     * Creates one library of a graphics pipeline synchronously
+     *
+     * @param state The pipeline state
+     * @param part  The pipeline library part
+     *
+     * @return the new pipeline library
+     */
+    VkPipeline compileLibrary(const GraphicsPipelineState& state, VkGraphicsPipelineLibraryFlagsEXT part) const;
+
+    /**
+     * Links a complete graphics pipeline from libraries
+     *
+     * @param parts     The four pipeline libraries
+     * @param layout    The pipeline layout
+     * @param optimize  Whether to perform link time optimization
+     *
+     * @return the linked pipeline
+     */
+    VkPipeline link(const std::array<VkPipeline, 4>& parts, VkPipelineLayout layout, bool optimize) const;
+
+    /**
+     * Creates a graphics pipeline synchronously
+     *
+     * @param state The pipeline state
+     *
+     * @return the new pipeline
+     */
+    VkPipeline compile(const GraphicsPipelineState& state) const;
+
+    /**
+     * Creates a compute pipeline synchronously
+     *
+     * @param state The pipeline state
+     *
+     * @return the new pipeline
+     */
+    VkPipeline compile(const ComputePipelineState& state) const;
+
+public:
+    /**
+     * Creates a service that compiles on its own pool of threads.
+     *
+     * The initial data may come from an earlier call to {@link getCacheData}.
+     * If it does not match this device, the driver will ignore it. To use
+     * pipeline libraries, the device must have enabled the feature
+     * graphicsPipelineLibrary of VK_EXT_graphics_pipeline_library.
+     *
+     * @param device    The logical device
+     * @param initial   The initial pipeline cache data
+     * @param libraries Whether to build graphics pipelines from libraries
+     * @param threads   The number of compile threads (0 for half the cores)
+     */
+    PipelineService(VkDevice device, const std::vector<char>& initial = {}, bool libraries = false, uint32_t threads = 0);
+
+    /**
+     * Waits on any pending compiles, and destroys every pipeline and the cache.
+     */
+    ~PipelineService();
+
+    PipelineService(const PipelineService&) = delete;
+    PipelineService& operator=(const PipelineService&) = delete;
+
+    /**
+     * Returns the pipeline for the given state, compiling it if necessary.
+     *
+     * This does not block. Identical states return the same request. If the
+     * compile fails, the request will rethrow the error when it is read.
+     *
+     * With pipeline libraries, any missing libraries are compiled in the
+     * background. If all of them are ready, the pipeline is fast-linked
+     * before this method returns, so the request is immediately ready.
+     *
+     * @param state The pipeline state
+     *
+     * @return the request for the pipeline
+     */
+    Request request(const GraphicsPipelineState& state);
+
+    /**
+     * Returns the pipeline for the given state, compiling it if necessary.
+     *
+     * This does not block. Identical states return the same request. If the
+     * compile fails, the request will rethrow the error when it is read.
+     *
+     * @param state The pipeline state
+     *
+     * @return the request for the pipeline
+     */
+    Request request(const ComputePipelineState& state);
+
+    /**
+     * Returns the requested pipeline if it is ready, or fallback if not.
+     *
+     * This never blocks. The optimized pipeline is returned in place of the
+     * fast-linked one as soon as it is ready. Pass VK_NULL_HANDLE as the
+     * fallback to skip the draws until the pipeline is ready. If the compile
+     * failed, the error is rethrown here.
+     *
+     * @param request   The pipeline request
+     * @param fallback  The pipeline to use in the meantime
+     *
+     * @return the requested pipeline if it is ready, or fallback if not
+     */
+    static VkPipeline poll(const Request& request, VkPipeline fallback = VK_NULL_HANDLE);
+
+    /**
+     * Blocks until every compile requested so far is complete.
+     *
+     * This includes any links queued once their libraries are ready.
+     */
+    void wait();
+
+    /**
+     * Returns true if graphics pipelines are built from libraries
+     *
+     * @return true if graphics pipelines are built from libraries
+     */
+    bool usesLibraries() const { return libraries; }
+
+    /**
+     * Returns the shared pipeline cache
+     *
+     * @return the shared pipeline cache
+     */
+    VkPipelineCache getCache() const { return cache; }
+
+    /**
+     * Returns the contents of the pipeline cache, to save for the next run
+     *
+     * @return the contents of the pipeline cache
+     */
+    std::vector<char> getCacheData() const;
+};
+
+#endif /* __PIPELINE_SERVICE_H__ */
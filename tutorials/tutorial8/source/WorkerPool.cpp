@@ -0,0 +1,193 @@
+//
+//  WorkerPool.cpp
+//  Tutorial8
+//
+//  A minimal pool of worker threads for CPU side work such as mipmap
+//  generation. Tasks are plain std::function objects pulled from a single
+//  shared queue. This is not meant to be a general purpose job system; it
+//  only needs to be good enough to keep all of the cores busy while loading.
+//
+//  Version: 10/18/26
+//
+#include "WorkerPool.h"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <memory>
+#include <mutex>
+
+/**
+ * Creates a pool with the given number of threads.
+ *
+ * If threads is 0, the pool uses one thread per hardware core (less one
+ * for the calling thread, which participates in {@link parallelFor}).
+ *
+ * @param threads   The number of worker threads
+ */
+WorkerPool::WorkerPool(uint32_t threads) : stopping(false) {
+    if (threads == 0) {
+        uint32_t cores = std::thread::hardware_concurrency();
+        threads = cores > 1 ? cores-1 : 1;
+    }
+    workers.reserve(threads);
+    for (uint32_t ii = 0; ii < threads; ii++) {
+        workers.emplace_back([this] { run(); });
+    }
+}
+
+/**
+ * Stops all workers, waiting on any tasks that are already queued.
+ */
+WorkerPool::~WorkerPool() {
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        stopping = true;
+    }
+    queueCondition.notify_all();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+/**
+ * Returns a process wide pool sized to the hardware
+ *
+ * @return a process wide pool sized to the hardware
+ */
+WorkerPool& WorkerPool::shared() {
+    static WorkerPool pool;
+    return pool;
+}
+
+/**
+ * The main loop for each worker thread
+ */
+void WorkerPool::run() {
+    while (true) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(queueMutex);
+            queueCondition.wait(lock, [this] { return stopping || !tasks.empty(); });
+            if (tasks.empty()) {
+                return;
+            }
+            task = std::move(tasks.front());
+            tasks.pop_front();
+        }
+        task();
+    }
+}
+
+/**
+ * Queues a task, returning a future for its completion.
+ *
+ * Exceptions thrown by the task are captured in the future.
+ *
+ * @param task  The task to execute
+ *
+ * @return a future for the task completion
+ */
+std::future<void> WorkerPool::submit(std::function<void()> task) {
+    // std::function requires a copyable target, so the packaged task is shared
+    auto packaged = std::make_shared<std::packaged_task<void()>>(std::move(task));
+    std::future<void> result = packaged->get_future();
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        tasks.emplace_back([packaged] { (*packaged)(); });
+    }
+    queueCondition.notify_one();
+    return result;
+}
+
+/**
+ * Executes body over the range [begin, end), split into chunks of grain.
+ *
+ * The calling thread works on chunks as well, and this method does not
+ * return until every chunk is complete. It never waits on a helper task
+ * that has not started, so a pool busy with long tasks (such as pipeline
+ * compiles) only costs parallelism, not latency. If any chunk throws, the
+ * first exception is rethrown here. The body receives the half-open
+ * subrange for each chunk.
+ *
+ * @param begin The start of the range
+ * @param end   The end of the range (exclusive)
+ * @param grain The maximum size of each chunk
+ * @param body  The function to apply to each chunk
+ */
+void WorkerPool::parallelFor(uint32_t begin, uint32_t end, uint32_t grain,
+                             const std::function<void(uint32_t, uint32_t)>& body) {
+    if (begin >= end) {
+        return;
+    }
+    grain = std::max(grain, 1u);
+    uint32_t chunks = (end-begin+grain-1)/grain;
+    if (chunks == 1) {
+        body(begin, end);
+        return;
+    }
+
+    // Chunks are claimed dynamically, so slow threads do not hold up the rest.
+    // The state is shared, as a helper may not start until after we return.
+    struct Progress {
+        std::atomic<uint32_t> next{0};
+        std::mutex mutex;
+        std::condition_variable done;
+        uint32_t active = 0;
+        std::exception_ptr error;
+    };
+    auto progress = std::make_shared<Progress>();
+    auto drain = [=, &body] {
+        uint32_t chunk;
+        while ((chunk = progress->next.fetch_add(1)) < chunks) {
+            uint32_t first = begin+chunk*grain;
+            body(first, std::min(first+grain, end));
+        }
+    };
+
+    // A helper only counts as active once it starts. One that is still queued
+    // behind other work when the chunks run out finds nothing to claim, and
+    // never touches body, so we do not wait on it.
+    auto helper = [progress, drain] {
+        {
+            std::lock_guard<std::mutex> lock(progress->mutex);
+            progress->active++;
+        }
+        std::exception_ptr error;
+        try {
+            drain();
+        } catch (...) {
+            error = std::current_exception();
+        }
+        std::lock_guard<std::mutex> lock(progress->mutex);
+        if (error && !progress->error) {
+            progress->error = error;
+        }
+        if (--progress->active == 0) {
+            progress->done.notify_all();
+        }
+    };
+
+    uint32_t helpers = std::min(size(), chunks-1);
+    for (uint32_t ii = 0; ii < helpers; ii++) {
+        submit(helper);
+    }
+
+    std::exception_ptr error;
+    try {
+        drain();
+    } catch (...) {
+        error = std::current_exception();
+    }
+
+    // Every chunk is claimed now, so only the helpers still running one matter
+    std::unique_lock<std::mutex> lock(progress->mutex);
+    progress->done.wait(lock, [&] { return progress->active == 0; });
+    if (!error) {
+        error = progress->error;
+    }
+    lock.unlock();
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
@@ -0,0 +1,107 @@
+//
+//  WorkerPool.h
+//  Tutorial8
+//
+//  A minimal pool of worker threads for CPU side work such as mipmap
+//  generation. Tasks are plain std::function objects pulled from a single
+//  shared queue. This is not meant to be a general purpose job system; it
+//  only needs to be good enough to keep all of the cores busy while loading.
+//
+//  Version: 10/18/26
+//
+#ifndef __WORKER_POOL_H__
+#define __WORKER_POOL_H__
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <deque>
+#include <vector>
+#include <cstdint>
+
+/**
+ * A fixed size pool of worker threads sharing a single task queue.
+ */
+class WorkerPool {
+private:
+    /** The worker threads */
+    std::vector<std::thread> workers;
+    /** The pending tasks */
+    std::deque<std::function<void()>> tasks;
+    /** Mutex protecting the task queue */
+    std::mutex queueMutex;
+    /** Condition variable to wake the workers */
+    std::condition_variable queueCondition;
+    /** Whether the pool is shutting down */
+    bool stopping;
+
+    /**
+     * The main loop for each worker thread
+     */
+    void run();
+
+public:
+    /**
+     * Creates a pool with the given number of threads.
+     *
+     * If threads is 0, the pool uses one thread per hardware core (less one
+     * for the calling thread, which participates in {@link parallelFor}).
+     *
+     * @param threads   The number of worker threads
+     */
+    WorkerPool(uint32_t threads = 0);
+
+    /**
+     * Stops all workers, waiting on any tasks that are already queued.
+     */
+    ~WorkerPool();
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    /**
+     * Returns the number of worker threads in this pool
+     *
+     * @return the number of worker threads in this pool
+     */
+    uint32_t size() const { return static_cast<uint32_t>(workers.size()); }
+
+    /**
+     * Returns a process wide pool sized to the hardware
+     *
+     * @return a process wide pool sized to the hardware
+     */
+    static WorkerPool& shared();
+
+    /**
+     * Queues a task, returning a future for its completion.
+     *
+     * Exceptions thrown by the task are captured in the future.
+     *
+     * @param task  The task to execute
+     *
+     * @return a future for the task completion
+     */
+    std::future<void> submit(std::function<void()> task);
+
+    /**
+     * Executes body over the range [begin, end), split into chunks of grain.
+     *
+     * The calling thread works on chunks as well, and this method does not
+     * return until every chunk is complete. It never waits on a helper task
+     * that has not started, so a pool busy with long tasks (such as pipeline
+     * compiles) only costs parallelism, not latency. If any chunk throws, the
+     * first exception is rethrown here. The body receives the half-open
+     * subrange for each chunk.
+     *
+     * @param begin The start of the range
+     * @param end   The end of the range (exclusive)
+     * @param grain The maximum size of each chunk
+     * @param body  The function to apply to each chunk
+     */
+    void parallelFor(uint32_t begin, uint32_t end, uint32_t grain,
+                     const std::function<void(uint32_t, uint32_t)>& body);
+};
+
+#endif /* __WORKER_POOL_H__ */
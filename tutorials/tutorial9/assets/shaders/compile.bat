@@ -1,4 +1,19 @@
 glslc.exe shader.vert -o vert.spv
 glslc.exe shader.frag -o frag.spv
 glslc.exe shader.comp -o comp.spv
+glslc.exe shader.comp -DSOA -o comp_soa.spv
+glslc.exe shader.comp -DSOA -DHALF -o comp_half.spv
+glslc.exe init.comp -o init.spv
+glslc.exe init.comp -DSOA -o init_soa.spv
+glslc.exe init.comp -DSOA -DHALF -o init_half.spv
+glslc.exe shader.comp -DEMIT -o comp_emit.spv
+glslc.exe shader.comp -DSOA -DEMIT -o comp_soa_emit.spv
+glslc.exe shader.comp -DSOA -DHALF -DEMIT -o comp_half_emit.spv
+glslc.exe init.comp -DEMIT -o init_emit.spv
+glslc.exe init.comp -DSOA -DEMIT -o init_soa_emit.spv
+glslc.exe init.comp -DSOA -DHALF -DEMIT -o init_half_emit.spv
+glslc.exe emit.comp -o emit.spv
+glslc.exe emit.comp -DSOA -o emit_soa.spv
+glslc.exe emit.comp -DSOA -DHALF -o emit_half.spv
+glslc.exe prepare.comp -o prepare.spv
 pause
\ No newline at end of file
@@ -47,4 +47,19 @@ done
 
 glslc "${SRCPATH}/shader.vert" -o vert.spv
 glslc "${SRCPATH}/shader.frag" -o frag.spv
-glslc "${SRCPATH}/shader.comp" -o comp.spv
\ No newline at end of file
+glslc "${SRCPATH}/shader.comp" -o comp.spv
+glslc "${SRCPATH}/shader.comp" -DSOA -o comp_soa.spv
+glslc "${SRCPATH}/shader.comp" -DSOA -DHALF -o comp_half.spv
+glslc "${SRCPATH}/init.comp" -o init.spv
+glslc "${SRCPATH}/init.comp" -DSOA -o init_soa.spv
+glslc "${SRCPATH}/init.comp" -DSOA -DHALF -o init_half.spv
+glslc "${SRCPATH}/shader.comp" -DEMIT -o comp_emit.spv
+glslc "${SRCPATH}/shader.comp" -DSOA -DEMIT -o comp_soa_emit.spv
+glslc "${SRCPATH}/shader.comp" -DSOA -DHALF -DEMIT -o comp_half_emit.spv
+glslc "${SRCPATH}/init.comp" -DEMIT -o init_emit.spv
+glslc "${SRCPATH}/init.comp" -DSOA -DEMIT -o init_soa_emit.spv
+glslc "${SRCPATH}/init.comp" -DSOA -DHALF -DEMIT -o init_half_emit.spv
+glslc "${SRCPATH}/emit.comp" -o emit.spv
+glslc "${SRCPATH}/emit.comp" -DSOA -o emit_soa.spv
+glslc "${SRCPATH}/emit.comp" -DSOA -DHALF -o emit_half.spv
+glslc "${SRCPATH}/prepare.comp" -o prepare.spv
\ No newline at end of file
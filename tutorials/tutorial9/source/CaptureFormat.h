@@ -0,0 +1,304 @@
+//
+//  CaptureFormat.h
+//  Tutorial9
+//
+//  The binary format of a frame capture. A capture is a flat list of records,
+//  each an operation code, a payload size, and the payload. The records are
+//  the resources the application created, the data it uploaded, the command
+//  buffers it recorded, and the order it submitted them in, with an end of
+//  frame marker after each frame. Handles are stored as 64-bit ids, which are
+//  simply the handle values at capture time.
+//
+//  Vulkan structs with no pointers are stored as they are in memory, so a
+//  capture can only be replayed on the same architecture it was made on (in
+//  practice, any 64-bit little-endian machine). This header is shared by the
+//  capture layer and the replay tool, so the two must be kept in sync.
+//
+//  Version: 10/18/26
+//
+#ifndef __CAPTURE_FORMAT_H__
+#define __CAPTURE_FORMAT_H__
+#include "VulkanLoader.h"
+#include <type_traits>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <cstring>
+#include <cstdint>
+
+/** The first four bytes of a capture file ("VKCP") */
+const uint32_t CAPTURE_MAGIC = 0x50434B56;
+/** The capture format version, to be bumped on any change to a record */
+const uint32_t CAPTURE_VERSION = 2;
+/** The oldest version that can still be replayed (2 only added commands) */
+const uint32_t CAPTURE_MIN_VERSION = 1;
+
+/**
+ * The operation of a capture record.
+ *
+ * The commands (CMD_*) only appear inside a COMMANDS record, which holds
+ * everything recorded into one command buffer.
+ */
+enum CaptureOp : uint32_t {
+    CAPTURE_OP_BUFFER = 1,
+    CAPTURE_OP_BUFFER_DATA,
+    CAPTURE_OP_IMAGE,
+    CAPTURE_OP_IMAGE_VIEW,
+    CAPTURE_OP_RENDER_PASS,
+    CAPTURE_OP_FRAMEBUFFER,
+    CAPTURE_OP_SHADER_MODULE,
+    CAPTURE_OP_SET_LAYOUT,
+    CAPTURE_OP_PIPELINE_LAYOUT,
+    CAPTURE_OP_GRAPHICS_PIPELINE,
+    CAPTURE_OP_COMPUTE_PIPELINE,
+    CAPTURE_OP_DESCRIPTOR_POOL,
+    CAPTURE_OP_DESCRIPTOR_SETS,
+    CAPTURE_OP_DESCRIPTOR_WRITES,
+    CAPTURE_OP_COMMANDS,
+    CAPTURE_OP_SUBMIT,
+    CAPTURE_OP_FRAME,
+
+    CAPTURE_CMD_PIPELINE_BARRIER = 100,
+    CAPTURE_CMD_BIND_PIPELINE,
+    CAPTURE_CMD_BIND_DESCRIPTOR_SETS,
+    CAPTURE_CMD_DISPATCH,
+    CAPTURE_CMD_BEGIN_RENDER_PASS,
+    CAPTURE_CMD_END_RENDER_PASS,
+    CAPTURE_CMD_SET_VIEWPORT,
+    CAPTURE_CMD_SET_SCISSOR,
+    CAPTURE_CMD_BIND_VERTEX_BUFFERS,
+    CAPTURE_CMD_DRAW,
+    CAPTURE_CMD_COPY_BUFFER,
+    CAPTURE_CMD_BIND_INDEX_BUFFER,
+    CAPTURE_CMD_DISPATCH_INDIRECT,
+    CAPTURE_CMD_DRAW_INDEXED_INDIRECT
+};
+
+/**
+ * Returns the capture id of a Vulkan handle
+ *
+ * Non-dispatchable handles are 64-bit integers on 32-bit platforms, and
+ * pointers elsewhere, so the value is copied rather than cast.
+ *
+ * @param handle    The Vulkan handle
+ *
+ * @return the capture id of a Vulkan handle
+ */
+template <typename T>
+uint64_t capture_id(T handle) {
+    static_assert(sizeof(T) <= sizeof(uint64_t), "handle is too large for an id");
+    uint64_t result = 0;
+    memcpy(&result, &handle, sizeof(T));
+    return result;
+}
+
+/**
+ * A growable byte buffer of capture records.
+ *
+ * A record is started with {@link begin} and closed with {@link end}, which
+ * fills in the payload size. Records do not nest, but a finished writer can
+ * be put into the payload of another as raw bytes.
+ */
+class CaptureWriter {
+private:
+    /** The bytes written so far */
+    std::vector<uint8_t> data;
+    /** The position of the size of the open record */
+    size_t start = 0;
+
+public:
+    /**
+     * Starts a record with the given operation
+     *
+     * @param op    The record operation
+     */
+    void begin(CaptureOp op) {
+        put<uint32_t>(op);
+        start = data.size();
+        put<uint32_t>(0);
+    }
+
+    /**
+     * Closes the open record
+     */
+    void end() {
+        uint32_t size = static_cast<uint32_t>(data.size() - start - sizeof(uint32_t));
+        memcpy(data.data() + start, &size, sizeof(size));
+    }
+
+    /**
+     * Writes the given bytes
+     *
+     * @param bytes The bytes to write
+     * @param size  The number of bytes
+     */
+    void putBytes(const void* bytes, size_t size) {
+        const uint8_t* first = static_cast<const uint8_t*>(bytes);
+        data.insert(data.end(), first, first + size);
+    }
+
+    /**
+     * Writes a value as it is in memory
+     *
+     * @param value The value to write
+     */
+    template <typename T>
+    void put(const T& value) {
+        static_assert(std::is_trivially_copyable<T>::value, "only plain values can be captured");
+        putBytes(&value, sizeof(T));
+    }
+
+    /**
+     * Writes an array of values, prefixed by its length
+     *
+     * @param values    The values to write (may be null if count is 0)
+     * @param count     The number of values
+     */
+    template <typename T>
+    void putArray(const T* values, uint32_t count) {
+        put(count);
+        if (count > 0) {
+            static_assert(std::is_trivially_copyable<T>::value, "only plain values can be captured");
+            putBytes(values, sizeof(T) * count);
+        }
+    }
+
+    /**
+     * Writes the capture id of a Vulkan handle
+     *
+     * @param handle    The Vulkan handle
+     */
+    template <typename T>
+    void putHandle(T handle) {
+        put(capture_id(handle));
+    }
+
+    /**
+     * Writes a string, prefixed by its length
+     *
+     * @param text  The string to write
+     */
+    void putString(const char* text) {
+        putArray(text, static_cast<uint32_t>(strlen(text)));
+    }
+
+    /**
+     * Returns the bytes written so far
+     *
+     * @return the bytes written so far
+     */
+    const std::vector<uint8_t>& getData() const { return data; }
+
+    /**
+     * Discards the bytes written so far
+     */
+    void clear() { data.clear(); }
+};
+
+/**
+ * A cursor over capture records.
+ *
+ * Reading past the end of the data throws a runtime error, so a truncated
+ * or corrupt capture fails cleanly rather than reading garbage.
+ */
+class CaptureReader {
+private:
+    /** The bytes to read */
+    const uint8_t* data;
+    /** The number of bytes */
+    size_t size;
+    /** The read position */
+    size_t pos = 0;
+
+public:
+    /**
+     * Creates a reader over the given bytes, which must outlive it
+     *
+     * @param data  The bytes to read
+     * @param size  The number of bytes
+     */
+    CaptureReader(const uint8_t* data, size_t size) : data(data), size(size) {}
+
+    /**
+     * Returns true if every byte has been read
+     *
+     * @return true if every byte has been read
+     */
+    bool isDone() const { return pos >= size; }
+
+    /**
+     * Returns a pointer to the next bytes, and skips past them
+     *
+     * @param count The number of bytes
+     *
+     * @return a pointer to the next bytes
+     */
+    const uint8_t* getBytes(size_t count) {
+        if (count > size - pos) {
+            throw std::runtime_error("capture is truncated!");
+        }
+        const uint8_t* result = data + pos;
+        pos += count;
+        return result;
+    }
+
+    /**
+     * Returns the next value
+     *
+     * @return the next value
+     */
+    template <typename T>
+    T get() {
+        static_assert(std::is_trivially_copyable<T>::value, "only plain values can be captured");
+        T result;
+        memcpy(&result, getBytes(sizeof(T)), sizeof(T));
+        return result;
+    }
+
+    /**
+     * Returns the next array of values
+     *
+     * @return the next array of values
+     */
+    template <typename T>
+    std::vector<T> getArray() {
+        uint32_t count = get<uint32_t>();
+        std::vector<T> result(count);
+        if (count > 0) {
+            memcpy(result.data(), getBytes(sizeof(T) * count), sizeof(T) * count);
+        }
+        return result;
+    }
+
+    /**
+     * Returns the next handle id
+     *
+     * @return the next handle id
+     */
+    uint64_t getHandle() { return get<uint64_t>(); }
+
+    /**
+     * Returns the next string
+     *
+     * @return the next string
+     */
+    std::string getString() {
+        std::vector<char> text = getArray<char>();
+        return std::string(text.begin(), text.end());
+    }
+
+    /**
+     * Returns a reader over the payload of the next record
+     *
+     * @param op    The record operation
+     *
+     * @return a reader over the payload of the next record
+     */
+    CaptureReader getRecord(CaptureOp& op) {
+        op = static_cast<CaptureOp>(get<uint32_t>());
+        uint32_t length = get<uint32_t>();
+        return CaptureReader(getBytes(length), length);
+    }
+};
+
+#endif /* __CAPTURE_FORMAT_H__ */
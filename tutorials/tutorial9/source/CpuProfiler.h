@@ -0,0 +1,149 @@
+//
+//  CpuProfiler.h
+//  Tutorial9
+//
+//  CPU timing zones for the frame loop. The usual way to time the CPU side
+//  of a frame is to log the gaps between a few timestamps, and comment the
+//  logs out when they get in the way. That does not scale past a handful of
+//  measurements, and it says nothing about how the threads interleave.
+//
+//  Instead, a zone is declared with CPU_ZONE at the top of a block, and it
+//  records its start and end when the block exits. Every thread writes to a
+//  ring buffer of its own, with no locks, so a zone costs two reads of the
+//  CPU counter and a store. The counter is only converted to nanoseconds
+//  when the rings are saved as a Chrome trace, which can happen at any time.
+//  The trace can be opened in chrome://tracing or https://ui.perfetto.dev.
+//
+//  Zones are only recorded if CPU_PROFILE is defined (see config.yml).
+//  Otherwise the macros compile to nothing.
+//
+//  Version: 10/18/26
+//
+#ifndef __CPU_PROFILER_H__
+#define __CPU_PROFILER_H__
+#include <string>
+#include <chrono>
+#include <cstdint>
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#define CPU_ZONE_JOIN2(a, b) a##b
+#define CPU_ZONE_JOIN(a, b) CPU_ZONE_JOIN2(a, b)
+
+#if defined(CPU_PROFILE)
+/** Times the rest of the enclosing block (the name must be a string literal) */
+#define CPU_ZONE(name) CpuProfiler::Zone CPU_ZONE_JOIN(cpuZone, __LINE__)(name)
+/** Names the calling thread in the trace (the name must be a string literal) */
+#define CPU_THREAD(name) CpuProfiler::setThreadName(name)
+#else
+#define CPU_ZONE(name) do {} while (0)
+#define CPU_THREAD(name) do {} while (0)
+#endif
+
+/**
+ * A lock-free recorder of timed zones on every thread.
+ *
+ * Each thread gets a ring buffer the first time it records a zone, which
+ * is the only time a lock is taken. After that, only the owning thread
+ * writes to its ring, and a ring that is full overwrites its oldest zones.
+ * Any thread may save the trace, and zones overwritten while the trace is
+ * read are skipped.
+ */
+class CpuProfiler {
+public:
+    /** The number of zones each thread keeps (a power of two) */
+    static const uint32_t RING_SIZE = 1 << 16;
+
+    /**
+     * A zone that is recorded when it goes out of scope.
+     *
+     * Use CPU_ZONE rather than this class, so that the zone compiles out
+     * when profiling is disabled.
+     */
+    class Zone {
+    private:
+        /** The zone name */
+        const char* name;
+        /** The start of the zone in ticks */
+        uint64_t start;
+
+    public:
+        /**
+         * Starts a zone with the given name
+         *
+         * @param name  The zone name (which must be a string literal)
+         */
+        Zone(const char* name) : name(name), start(CpuProfiler::ticks()) {}
+
+        /**
+         * Ends this zone, and records it
+         */
+        ~Zone() { CpuProfiler::record(name, start, CpuProfiler::ticks()); }
+
+        Zone(const Zone&) = delete;
+        Zone& operator=(const Zone&) = delete;
+    };
+
+    /**
+     * Returns true if zones are recorded (CPU_PROFILE is defined)
+     *
+     * @return true if zones are recorded
+     */
+    static bool isEnabled();
+
+    /**
+     * Returns the current value of the profiler clock.
+     *
+     * This is the invariant CPU counter where there is one, as it is several
+     * times faster to read than the steady clock. Elsewhere, it is the steady
+     * clock in nanoseconds. Either way, ticks are converted to nanoseconds
+     * against the steady clock when the trace is saved.
+     *
+     * @return the current value of the profiler clock
+     */
+    static uint64_t ticks() {
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+        return __rdtsc();
+#elif defined(__aarch64__) && !defined(_MSC_VER)
+        uint64_t value;
+        asm volatile("mrs %0, cntvct_el0" : "=r"(value));
+        return value;
+#else
+        auto time = std::chrono::steady_clock::now().time_since_epoch();
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(time).count());
+#endif
+    }
+
+    /**
+     * Records a zone on the calling thread
+     *
+     * @param name  The zone name (which must be a string literal)
+     * @param start The start of the zone in ticks
+     * @param end   The end of the zone in ticks
+     */
+    static void record(const char* name, uint64_t start, uint64_t end);
+
+    /**
+     * Names the calling thread in the trace
+     *
+     * @param name  The thread name (which must be a string literal)
+     */
+    static void setThreadName(const char* name);
+
+    /**
+     * Saves the zones of every thread as a Chrome trace
+     *
+     * This may be called at any time, from any thread. Only the last
+     * {@link RING_SIZE} zones of each thread are kept.
+     *
+     * @param path  The file to write
+     *
+     * @return true if the file was written
+     */
+    static bool writeTrace(const std::string& path);
+};
+
+#endif /* __CPU_PROFILER_H__ */
@@ -0,0 +1,158 @@
+//
+//  DeletionQueue.cpp
+//  Tutorial9
+//
+//  Frame-fenced destruction of Vulkan objects. The tutorial destroys objects
+//  either in cleanup, after the device is idle, or right away, after it has
+//  waited on the queue. Neither works once objects are replaced while the
+//  GPU is still drawing with them, as with swapchain recreation.
+//
+//  This class takes an object along with the last frame that may use it, and
+//  destroys it once FrameSync reports that frame as finished on every queue.
+//  Objects are collected in bulk once a frame, and checking costs a single
+//  comparison, so nothing ever waits on the GPU.
+//
+//  Version: 10/18/26
+//
+#include "DeletionQueue.h"
+#include <stdexcept>
+
+/**
+ * Creates an empty deletion queue for the given device
+ *
+ * @param device    The logical device
+ */
+DeletionQueue::DeletionQueue(VkDevice device) :
+    device(device) {
+}
+
+/**
+ * Destroys every object still queued. The device must be idle.
+ */
+DeletionQueue::~DeletionQueue() {
+    flush();
+}
+
+/**
+ * Queues an object to be destroyed once the given frame has finished.
+ *
+ * Buffers, images, views, samplers, memory, pipelines and their layouts,
+ * descriptor pools and set layouts, render passes, framebuffers, shader
+ * modules, command pools, query pools, semaphores and fences are all
+ * supported. Memory is only freed, so it should be pushed after anything
+ * bound to it.
+ *
+ * @param type      The object type
+ * @param handle    The object handle
+ * @param frame     The last frame that may use the object
+ */
+void DeletionQueue::push(VkObjectType type, uint64_t handle, uint64_t frame) {
+    switch (type) {
+        case VK_OBJECT_TYPE_BUFFER:
+        case VK_OBJECT_TYPE_IMAGE:
+        case VK_OBJECT_TYPE_IMAGE_VIEW:
+        case VK_OBJECT_TYPE_SAMPLER:
+        case VK_OBJECT_TYPE_DEVICE_MEMORY:
+        case VK_OBJECT_TYPE_PIPELINE:
+        case VK_OBJECT_TYPE_PIPELINE_LAYOUT:
+        case VK_OBJECT_TYPE_DESCRIPTOR_POOL:
+        case VK_OBJECT_TYPE_DESCRIPTOR_SET_LAYOUT:
+        case VK_OBJECT_TYPE_RENDER_PASS:
+        case VK_OBJECT_TYPE_FRAMEBUFFER:
+        case VK_OBJECT_TYPE_SHADER_MODULE:
+        case VK_OBJECT_TYPE_COMMAND_POOL:
+        case VK_OBJECT_TYPE_QUERY_POOL:
+        case VK_OBJECT_TYPE_SEMAPHORE:
+        case VK_OBJECT_TYPE_FENCE:
+            break;
+        default:
+            throw std::runtime_error("cannot defer the destruction of this object type!");
+    }
+    if (handle != 0) {
+        entries.push_back({ type, handle, frame });
+    }
+}
+
+/**
+ * Destroys every object whose frame has finished.
+ *
+ * This never blocks, and should be called once a frame.
+ *
+ * @param completed The last frame that finished on the GPU
+ */
+void DeletionQueue::collect(uint64_t completed) {
+    while (!entries.empty() && entries.front().frame <= completed) {
+        destroy(entries.front());
+        entries.pop_front();
+    }
+}
+
+/**
+ * Destroys every object in the queue. The device must be idle.
+ */
+void DeletionQueue::flush() {
+    for (const auto& entry : entries) {
+        destroy(entry);
+    }
+    entries.clear();
+}
+
+/**
+ * Destroys the object of the given entry
+ *
+ * @param entry The object to destroy
+ */
+void DeletionQueue::destroy(const Entry& entry) {
+    switch (entry.type) {
+        case VK_OBJECT_TYPE_BUFFER:
+            vkDestroyBuffer(device, (VkBuffer) entry.handle, nullptr);
+            break;
+        case VK_OBJECT_TYPE_IMAGE:
+            vkDestroyImage(device, (VkImage) entry.handle, nullptr);
+            break;
+        case VK_OBJECT_TYPE_IMAGE_VIEW:
+            vkDestroyImageView(device, (VkImageView) entry.handle, nullptr);
+            break;
+        case VK_OBJECT_TYPE_SAMPLER:
+            vkDestroySampler(device, (VkSampler) entry.handle, nullptr);
+            break;
+        case VK_OBJECT_TYPE_DEVICE_MEMORY:
+            vkFreeMemory(device, (VkDeviceMemory) entry.handle, nullptr);
+            break;
+        case VK_OBJECT_TYPE_PIPELINE:
+            vkDestroyPipeline(device, (VkPipeline) entry.handle, nullptr);
+            break;
+        case VK_OBJECT_TYPE_PIPELINE_LAYOUT:
+            vkDestroyPipelineLayout(device, (VkPipelineLayout) entry.handle, nullptr);
+            break;
+        case VK_OBJECT_TYPE_DESCRIPTOR_POOL:
+            vkDestroyDescriptorPool(device, (VkDescriptorPool) entry.handle, nullptr);
+            break;
+        case VK_OBJECT_TYPE_DESCRIPTOR_SET_LAYOUT:
+            vkDestroyDescriptorSetLayout(device, (VkDescriptorSetLayout) entry.handle, nullptr);
+            break;
+        case VK_OBJECT_TYPE_RENDER_PASS:
+            vkDestroyRenderPass(device, (VkRenderPass) entry.handle, nullptr);
+            break;
+        case VK_OBJECT_TYPE_FRAMEBUFFER:
+            vkDestroyFramebuffer(device, (VkFramebuffer) entry.handle, nullptr);
+            break;
+        case VK_OBJECT_TYPE_SHADER_MODULE:
+            vkDestroyShaderModule(device, (VkShaderModule) entry.handle, nullptr);
+            break;
+        case VK_OBJECT_TYPE_COMMAND_POOL:
+            vkDestroyCommandPool(device, (VkCommandPool) entry.handle, nullptr);
+            break;
+        case VK_OBJECT_TYPE_QUERY_POOL:
+            vkDestroyQueryPool(device, (VkQueryPool) entry.handle, nullptr);
+            break;
+        case VK_OBJECT_TYPE_SEMAPHORE:
+            vkDestroySemaphore(device, (VkSemaphore) entry.handle, nullptr);
+            break;
+        case VK_OBJECT_TYPE_FENCE:
+            vkDestroyFence(device, (VkFence) entry.handle, nullptr);
+            break;
+        default:
+            break;
+    }
+}
@@ -0,0 +1,248 @@
+//
+//  FrameSync.h
+//  Tutorial9
+//
+//  Frame synchronization built on timeline semaphores. The tutorial keeps a
+//  fence and a binary semaphore per frame in flight for each queue, and waits
+//  on two fences every frame. Every new dependency between the queues needs
+//  yet another array of binary semaphores.
+//
+//  This class gives each queue a single timeline semaphore instead, whose
+//  value is the number of the last frame that queue finished. A submission
+//  signals the current frame number on the timeline of its queue, and may
+//  wait on any value of any other timeline. The CPU waits for a frame to
+//  retire with one vkWaitSemaphores on every timeline, and can check how far
+//  the GPU has gotten (for recycling resources) without waiting at all.
+//
+//  The swapchain still requires binary semaphores for acquire and present,
+//  as timeline semaphores are not allowed there. This class owns those as
+//  well, so the application never creates a semaphore or a fence itself.
+//
+//  Version: 10/18/26
+//
+#ifndef __FRAME_SYNC_H__
+#define __FRAME_SYNC_H__
+#include "VulkanLoader.h"
+#include <vector>
+#include <cstdint>
+
+/**
+ * A timeline per queue, with frame numbers as the timeline values.
+ *
+ * A frame starts with {@link beginFrame}, which blocks until every queue has
+ * retired the frame that used the same resources, as many frames back as
+ * there are frames in flight. Each timeline then gets exactly one submission,
+ * through {@link submit} or {@link submitImage}.
+ * Frame numbers start at 1, so a value of 0 means nothing has finished.
+ */
+class FrameSync {
+public:
+    /** A GPU wait on a value of a timeline */
+    struct Wait {
+        /** The timeline to wait on */
+        uint32_t timeline;
+        /** The frame number to wait for */
+        uint64_t frame;
+        /** The pipeline stages that wait */
+        VkPipelineStageFlags stage;
+    };
+
+private:
+    /** The logical device */
+    VkDevice device;
+    /** The number of frames in flight */
+    uint32_t frameCount;
+    /** The number of frame slots (the largest number of frames in flight) */
+    uint32_t slotCount;
+    /** The current frame number */
+    uint64_t frame;
+
+    /** The queue of each timeline */
+    std::vector<VkQueue> queues;
+    /** The timeline semaphore of each queue */
+    std::vector<VkSemaphore> timelines;
+
+    /** The acquire semaphore of each frame slot */
+    std::vector<VkSemaphore> acquireSemaphores;
+    /** The present semaphore of each swapchain image */
+    std::vector<VkSemaphore> presentSemaphores;
+
+    /** The timeline functions (core in 1.2, or from VK_KHR_timeline_semaphore) */
+    PFN_vkWaitSemaphoresKHR waitSemaphores;
+    PFN_vkGetSemaphoreCounterValueKHR getCounterValue;
+
+    /**
+     * Destroys the binary semaphores of the swapchain
+     */
+    void destroySwapchainSemaphores();
+
+    /**
+     * Submits work to a timeline, signaling the current frame
+     *
+     * @param timeline      The timeline to submit to
+     * @param commandBuffer The command buffer to submit
+     * @param waits         The timeline values to wait on
+     * @param acquire       The acquire semaphore to wait on (or VK_NULL_HANDLE)
+     * @param acquireStage  The pipeline stages that wait on acquire
+     * @param present       The present semaphore to signal (or VK_NULL_HANDLE)
+     */
+    void submit(uint32_t timeline, VkCommandBuffer commandBuffer, const std::vector<Wait>& waits,
+                VkSemaphore acquire, VkPipelineStageFlags acquireStage, VkSemaphore present);
+
+public:
+    /**
+     * Creates the synchronization layer for a device.
+     *
+     * The device must have been created with the timelineSemaphore feature.
+     * Slots are assigned for the largest number of frames in flight, so that
+     * the number can change later without waiting on the GPU.
+     *
+     * @param device        The logical device
+     * @param frameCount    The number of frames in flight
+     * @param slotCount     The largest number of frames in flight
+     */
+    FrameSync(VkDevice device, uint32_t frameCount, uint32_t slotCount);
+
+    /**
+     * Destroys every semaphore. The device must be done with all of them.
+     */
+    ~FrameSync();
+
+    FrameSync(const FrameSync&) = delete;
+    FrameSync& operator=(const FrameSync&) = delete;
+
+    /**
+     * Returns true if the device supports timeline semaphores
+     *
+     * @param device    The physical device
+     *
+     * @return true if the device supports timeline semaphores
+     */
+    static bool isSupported(VkPhysicalDevice device);
+
+    /**
+     * Adds a timeline for the given queue, returning its index.
+     *
+     * Two timelines may share a queue, if they are different roles of it.
+     *
+     * @param queue The queue to submit to
+     *
+     * @return the index of the new timeline
+     */
+    uint32_t addQueue(VkQueue queue);
+
+    /**
+     * Creates the present semaphores for a new swapchain, returning the old ones.
+     *
+     * Pending presents may still wait on the old semaphores, so they are handed
+     * back to be retired along with the old swapchain. The acquire semaphores
+     * carry over, so every image acquired from the old swapchain must have been
+     * submitted (and so its acquire semaphore waited on) before this is called.
+     *
+     * @param imageCount    The number of swapchain images
+     *
+     * @return the present semaphores of the old swapchain
+     */
+    std::vector<VkSemaphore> resetSwapchain(uint32_t imageCount);
+
+    /**
+     * Changes the number of frames in flight.
+     *
+     * This takes effect with the next frame, and does not wait on the GPU. The
+     * slots are always assigned modulo the slot count, so a slot is never reused
+     * before the frame that last used it has finished, whatever the count.
+     *
+     * @param count The number of frames in flight, from 1 to the slot count
+     */
+    void setFrameCount(uint32_t count);
+
+    /**
+     * Starts a new frame, returning its slot.
+     *
+     * This blocks until the frame that is the number of frames in flight behind
+     * has finished on every timeline. The frame that last used the slot is no
+     * later than that one, so anything indexed by slot is then safe to reuse.
+     *
+     * @return the slot of the new frame, in [0, slotCount)
+     */
+    uint32_t beginFrame();
+
+    /**
+     * Blocks until every timeline has finished the given frame
+     *
+     * @param target    The frame number to wait for
+     */
+    void wait(uint64_t target) const;
+
+    /**
+     * Returns the last frame that has finished on every timeline.
+     *
+     * This does not block, so it can be polled to recycle resources.
+     *
+     * @return the last frame that has finished on every timeline
+     */
+    uint64_t getCompletedFrame() const;
+
+    /**
+     * Returns the current frame number
+     *
+     * @return the current frame number
+     */
+    uint64_t getFrame() const { return frame; }
+
+    /**
+     * Returns the number of frames in flight
+     *
+     * @return the number of frames in flight
+     */
+    uint32_t getFrameCount() const { return frameCount; }
+
+    /**
+     * Returns the number of frame slots
+     *
+     * @return the number of frame slots
+     */
+    uint32_t getSlotCount() const { return slotCount; }
+
+    /**
+     * Returns the semaphore to pass to vkAcquireNextImageKHR this frame
+     *
+     * @return the semaphore to pass to vkAcquireNextImageKHR this frame
+     */
+    VkSemaphore getAcquireSemaphore() const;
+
+    /**
+     * Returns the semaphore to wait on when presenting the given image
+     *
+     * @param image The swapchain image index
+     *
+     * @return the semaphore to wait on when presenting the given image
+     */
+    VkSemaphore getPresentSemaphore(uint32_t image) const;
+
+    /**
+     * Submits work to a timeline, signaling the current frame
+     *
+     * @param timeline      The timeline to submit to
+     * @param commandBuffer The command buffer to submit
+     * @param waits         The timeline values to wait on
+     */
+    void submit(uint32_t timeline, VkCommandBuffer commandBuffer, const std::vector<Wait>& waits);
+
+    /**
+     * Submits work that renders to a swapchain image, signaling the current frame.
+     *
+     * This also waits on the acquire semaphore of the frame, and signals the
+     * present semaphore of the image.
+     *
+     * @param timeline      The timeline to submit to
+     * @param commandBuffer The command buffer to submit
+     * @param waits         The timeline values to wait on
+     * @param imageStage    The pipeline stages that wait on the acquired image
+     * @param image         The swapchain image index
+     */
+    void submitImage(uint32_t timeline, VkCommandBuffer commandBuffer, const std::vector<Wait>& waits,
+                     VkPipelineStageFlags imageStage, uint32_t image);
+};
+
+#endif /* __FRAME_SYNC_H__ */
@@ -0,0 +1,365 @@
+//
+//  GpuProfiler.h
+//  Tutorial9
+//
+//  GPU timestamps for the passes of each frame. The CPU cannot see how long
+//  the simulation or the drawing take on the GPU, or whether the compute and
+//  graphics queues actually run at the same time. So this class brackets
+//  named scopes in the command buffers with timestamps, and keeps a rolling
+//  average of each one. The scopes are also emitted as debug utils labels,
+//  so they show up in frame debuggers such as RenderDoc.
+//
+//  Every frame slot has its own query pools, and the results of a frame are
+//  read once the frame has retired, so reading them never stalls. The
+//  averages, and optionally the pipeline statistics, are logged once a
+//  second. The scopes can also be saved as a Chrome trace, which can be
+//  opened in chrome://tracing or https://ui.perfetto.dev.
+//
+//  Version: 10/18/26
+//
+#ifndef __GPU_PROFILER_H__
+#define __GPU_PROFILER_H__
+#include "VulkanLoader.h"
+#include <chrono>
+#include <string>
+#include <vector>
+#include <map>
+#include <cstdint>
+
+/**
+ * A timestamp profiler for named scopes on one or more queues.
+ *
+ * Strictly speaking, Vulkan only promises that timestamps written on the
+ * same queue can be compared. In practice, drivers use one device clock for
+ * every queue, and this class assumes as much when it measures overlap or
+ * writes a trace. A queue whose family has no timestamp support is simply
+ * not timed, although its scopes are still labeled.
+ *
+ * Every command buffer that is profiled must be bracketed by calls to
+ * {@link beginCommands} and {@link endCommands}, and scopes may nest
+ * within them.
+ */
+class GpuProfiler {
+public:
+    /** The rolling average of a scope */
+    struct Average {
+        /** The scope name */
+        std::string name;
+        /** The name of the queue the scope ran on */
+        std::string queue;
+        /** The average GPU time in milliseconds */
+        double milliseconds;
+    };
+
+    /**
+     * A scope that ends when it goes out of scope.
+     *
+     * This is the preferred way to add a scope, as it cannot be left open.
+     */
+    class Scope {
+    private:
+        /** The profiler for this scope */
+        GpuProfiler& profiler;
+        /** The command buffer of this scope */
+        VkCommandBuffer commandBuffer;
+        /** The queue of this scope */
+        uint32_t queue;
+
+    public:
+        /**
+         * Begins a scope with the given name
+         *
+         * @param profiler      The profiler
+         * @param commandBuffer The command buffer to record to
+         * @param queue         The queue the command buffer is submitted to
+         * @param name          The scope name (which must outlive the frame)
+         */
+        Scope(GpuProfiler& profiler, VkCommandBuffer commandBuffer, uint32_t queue, const char* name) :
+            profiler(profiler), commandBuffer(commandBuffer), queue(queue) {
+            profiler.beginScope(commandBuffer, queue, name);
+        }
+
+        /**
+         * Ends this scope
+         */
+        ~Scope() { profiler.endScope(commandBuffer, queue); }
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+    };
+
+private:
+    /** A scope recorded in a frame */
+    struct Marker {
+        /** The scope name */
+        const char* name;
+        /** The query of the start timestamp */
+        uint32_t query;
+        /** The nesting depth of the scope */
+        uint32_t depth;
+    };
+
+    /** The scopes of a queue in one frame slot */
+    struct Frame {
+        /** The recorded scopes, in order of their start */
+        std::vector<Marker> markers;
+        /** The indices of the scopes still open */
+        std::vector<size_t> open;
+        /** The number of timestamp queries written */
+        uint32_t queries;
+        /** Whether the slot has results to collect */
+        bool recorded;
+    };
+
+    /** A queue being profiled */
+    struct Queue {
+        /** The queue name */
+        std::string name;
+        /** The mask of the valid timestamp bits (0 if there are no timestamps) */
+        uint64_t validMask;
+        /** The timestamp query pool of each frame slot */
+        std::vector<VkQueryPool> pools;
+        /** The pipeline statistics query pool, with one query per slot */
+        VkQueryPool statisticsPool;
+        /** The pipeline statistics gathered on this queue */
+        VkQueryPipelineStatisticFlags statisticFlags;
+        /** The scopes of each frame slot */
+        std::vector<Frame> frames;
+        /** The pipeline statistics of the last collected frame */
+        std::vector<uint64_t> statistics;
+        /** The accumulated pipeline statistics since the last log */
+        std::vector<uint64_t> statisticSums;
+        uint32_t statisticSamples;
+        /** The start and end of the work of the queue in the last collected frame */
+        uint64_t spanStart;
+        uint64_t spanEnd;
+    };
+
+    /** The rolling window of a scope */
+    struct Pass {
+        /** The last durations, in milliseconds */
+        std::vector<double> window;
+        /** The position of the next duration in the window */
+        size_t next = 0;
+        /** The sum of the window */
+        double sum = 0;
+    };
+
+    /** A scope in the trace */
+    struct Event {
+        /** The scope name */
+        const char* name;
+        /** The queue of the scope */
+        uint32_t queue;
+        /** The start in microseconds from the first timestamp */
+        double start;
+        /** The duration in microseconds */
+        double duration;
+    };
+
+    /** The logical device */
+    VkDevice device;
+    /** The number of frame slots */
+    uint32_t slotCount;
+    /** The current frame slot */
+    uint32_t slot;
+    /** The nanoseconds per timestamp tick */
+    double period;
+    /** The queue family properties, for the timestamp bits and capabilities */
+    std::vector<VkQueueFamilyProperties> families;
+    /** Whether to gather pipeline statistics */
+    bool statisticsEnabled;
+    /** The debug utils label commands (null if labels are not enabled) */
+    PFN_vkCmdBeginDebugUtilsLabelEXT beginLabel;
+    PFN_vkCmdEndDebugUtilsLabelEXT endLabel;
+
+    /** The queues being profiled */
+    std::vector<Queue> queues;
+    /** The rolling window of each scope, by queue and name */
+    std::map<std::pair<uint32_t, std::string>, Pass> passes;
+
+    /** Whether to keep the scopes for a trace */
+    bool tracing;
+    /** The scopes in the trace */
+    std::vector<Event> events;
+    /** The first timestamp of the trace */
+    uint64_t traceOrigin;
+    bool traceStarted;
+
+    /** The accumulated overlap (in milliseconds) of the first two queues since the last log */
+    double overlapTime;
+    uint32_t overlapSamples;
+    /** The time of the last log */
+    std::chrono::steady_clock::time_point lastLog;
+
+    /**
+     * Collects the results of the given frame slot, which must have retired
+     *
+     * @param index The frame slot
+     */
+    void collect(uint32_t index);
+
+    /**
+     * Adds a duration to the rolling window of a scope
+     *
+     * @param queue         The queue of the scope
+     * @param name          The scope name
+     * @param milliseconds  The duration in milliseconds
+     */
+    void addSample(uint32_t queue, const char* name, double milliseconds);
+
+    /**
+     * Logs the rolling averages and statistics, and resets the accumulators
+     */
+    void log();
+
+public:
+    /** The number of timestamps per queue per frame, or half as many scopes */
+    static const uint32_t MAX_QUERIES = 64;
+    /** The number of frames in a rolling average */
+    static const size_t WINDOW = 120;
+    /** The number of scopes a trace can hold */
+    static const size_t MAX_EVENTS = 1 << 18;
+
+    /**
+     * Creates a profiler for the given device
+     *
+     * Labels require VK_EXT_debug_utils on the instance, and statistics
+     * require the pipelineStatisticsQuery feature on the device.
+     *
+     * @param instance          The Vulkan instance
+     * @param physicalDevice    The physical device
+     * @param device            The logical device
+     * @param slotCount         The number of frame slots
+     * @param labels            Whether to emit debug utils labels
+     * @param statistics        Whether to gather pipeline statistics
+     */
+    GpuProfiler(VkInstance instance, VkPhysicalDevice physicalDevice, VkDevice device, uint32_t slotCount,
+                bool labels, bool statistics);
+
+    /**
+     * Destroys the profiler. The device must be done with its queries.
+     */
+    ~GpuProfiler();
+
+    GpuProfiler(const GpuProfiler&) = delete;
+    GpuProfiler& operator=(const GpuProfiler&) = delete;
+
+    /**
+     * Returns true if the device supports pipeline statistics queries
+     *
+     * @param device    The physical device
+     *
+     * @return true if the device supports pipeline statistics queries
+     */
+    static bool isStatisticsSupported(VkPhysicalDevice device);
+
+    /**
+     * Adds a queue to profile, returning its index
+     *
+     * The first two queues added are the ones whose overlap is measured.
+     *
+     * @param family    The queue family
+     * @param name      The queue name
+     *
+     * @return the index of the queue
+     */
+    uint32_t addQueue(uint32_t family, const std::string& name);
+
+    /**
+     * Sets whether to keep the scopes of every frame for a trace
+     *
+     * @param value Whether to keep the scopes for a trace
+     */
+    void setTracing(bool value) { tracing = value; }
+
+    /**
+     * Starts a new frame in the given slot.
+     *
+     * This collects the results of the last frame in that slot, which must
+     * have retired on every queue, and logs the averages once a second.
+     *
+     * @param index The frame slot
+     */
+    void beginFrame(uint32_t index);
+
+    /**
+     * Collects the results of every slot. The device must be idle.
+     */
+    void finish();
+
+    /**
+     * Starts profiling a command buffer, outside of any render pass
+     *
+     * @param commandBuffer The command buffer to record to
+     * @param queue         The queue the command buffer is submitted to
+     */
+    void beginCommands(VkCommandBuffer commandBuffer, uint32_t queue);
+
+    /**
+     * Stops profiling a command buffer, outside of any render pass
+     *
+     * @param commandBuffer The command buffer to record to
+     * @param queue         The queue the command buffer is submitted to
+     */
+    void endCommands(VkCommandBuffer commandBuffer, uint32_t queue);
+
+    /**
+     * Begins a scope with the given name
+     *
+     * The name is not copied, so it should be a string literal.
+     *
+     * @param commandBuffer The command buffer to record to
+     * @param queue         The queue the command buffer is submitted to
+     * @param name          The scope name
+     */
+    void beginScope(VkCommandBuffer commandBuffer, uint32_t queue, const char* name);
+
+    /**
+     * Ends the innermost open scope
+     *
+     * @param commandBuffer The command buffer to record to
+     * @param queue         The queue the command buffer is submitted to
+     */
+    void endScope(VkCommandBuffer commandBuffer, uint32_t queue);
+
+    /**
+     * Returns the rolling average of every scope timed so far
+     *
+     * @return the rolling average of every scope timed so far
+     */
+    std::vector<Average> getAverages() const;
+
+    /**
+     * Returns the rolling average of a scope in milliseconds (0 if never timed)
+     *
+     * @param queue The queue of the scope
+     * @param name  The scope name
+     *
+     * @return the rolling average of a scope in milliseconds
+     */
+    double getAverage(uint32_t queue, const std::string& name) const;
+
+    /**
+     * Returns a pipeline statistic of the last collected frame of a queue
+     *
+     * This is 0 if statistics are disabled, or not gathered on that queue.
+     *
+     * @param queue     The queue
+     * @param statistic The statistic
+     *
+     * @return a pipeline statistic of the last collected frame of a queue
+     */
+    uint64_t getStatistic(uint32_t queue, VkQueryPipelineStatisticFlagBits statistic) const;
+
+    /**
+     * Saves the scopes kept so far as a Chrome trace
+     *
+     * @param path  The file to write
+     *
+     * @return true if the file was written
+     */
+    bool writeTrace(const std::string& path) const;
+};
+
+#endif /* __GPU_PROFILER_H__ */
@@ -9,7 +9,18 @@
 #include <SDL3/SDL_main.h>
 #include <SDL3/SDL_app.h>
 #include <SDL3/SDL_vulkan.h>
-#include <vulkan/vulkan.h>
+#include "VulkanLoader.h"
+#include "FrameSync.h"
+#include "GpuProfiler.h"
+#include "CpuProfiler.h"
+#include "PresentPacer.h"
+#include "SwapchainRetirer.h"
+#include "DeletionQueue.h"
+#include "OffscreenTarget.h"
+#include "BenchReport.h"
+#include "FrameCapture.h"
+#include "ParticleLayout.h"
+#include "ParticleEmitter.h"
 
 #define GLM_FORCE_RADIANS
 #include <glm/glm.hpp>
@@ -25,10 +36,11 @@
 #include <cstdlib>
 #include <cstdint>
 #include <limits>
+#include <memory>
+#include <functional>
 #include <array>
 #include <optional>
 #include <set>
-#include <random>
 
 /**
  * Prints out the API for the given version.
@@ -81,9 +93,26 @@ static std::string get_asset(const std::string& asset) {
 const uint32_t WIDTH = 800;
 const uint32_t HEIGHT = 600;
 
+// The default particle count, which can change at runtime up to the capacity of the buffers
 const uint32_t PARTICLE_COUNT = 8192;
+// With emitters, each particle lives for a random time in this range (in seconds)
+const float PARTICLE_LIFE_MIN = 2.0f;
+const float PARTICLE_LIFE_MAX = 4.0f;
 
-const int MAX_FRAMES_IN_FLIGHT = 2;
+// The frames in flight can change at runtime, up to this many
+const int MAX_FRAMES_IN_FLIGHT = 3;
+// Compute reads one buffer and writes another while graphics draws the third.
+// The uniform buffers share this ring, so it must cover every frame in flight.
+const int PARTICLE_BUFFERS = 3;
+static_assert(PARTICLE_BUFFERS >= MAX_FRAMES_IN_FLIGHT, "too many frames in flight for the particle buffers");
+
+// A drag-resize recreates the swapchain once the events settle, or at most this often
+const std::chrono::milliseconds RESIZE_SETTLE(50);
+const std::chrono::milliseconds RESIZE_INTERVAL(250);
+
+// Headless runs step a fixed clock from a fixed seed, so every run simulates the same frames
+const float HEADLESS_FRAME_TIME = 1000.0f / 60.0f;
+const unsigned HEADLESS_SEED = 9;
 
 const std::vector<const char*> validationLayers = {
     "VK_LAYER_KHRONOS_validation"
@@ -132,6 +161,8 @@ void DestroyDebugUtilsMessengerEXT(VkInstance instance, VkDebugUtilsMessengerEXT
 struct QueueFamilyIndices {
     std::optional<uint32_t> graphicsAndComputeFamily;
     std::optional<uint32_t> presentFamily;
+    // A compute-only family if one exists, otherwise graphicsAndComputeFamily
+    std::optional<uint32_t> computeFamily;
 
     bool isComplete() {
         return graphicsAndComputeFamily.has_value() && presentFamily.has_value();
@@ -146,40 +177,16 @@ struct SwapChainSupportDetails {
 
 struct UniformBufferObject {
     float deltaTime = 1.0f;
-};
-
-struct Particle {
-    glm::vec2 position;
-    glm::vec2 velocity;
-    glm::vec4 color;
-    glm::vec2 offsides;
-    // Padding required for std140 alignment
-    glm::vec2 padding;
-
-    static VkVertexInputBindingDescription getBindingDescription() {
-        VkVertexInputBindingDescription bindingDescription{};
-        bindingDescription.binding = 0;
-        bindingDescription.stride = sizeof(Particle);
-        bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
-
-        return bindingDescription;
-    }
-
-    static std::array<VkVertexInputAttributeDescription, 2> getAttributeDescriptions() {
-        std::array<VkVertexInputAttributeDescription, 2> attributeDescriptions{};
-
-        attributeDescriptions[0].binding = 0;
-        attributeDescriptions[0].location = 0;
-        attributeDescriptions[0].format = VK_FORMAT_R32G32_SFLOAT;
-        attributeDescriptions[0].offset = offsetof(Particle, position);
-
-        attributeDescriptions[1].binding = 0;
-        attributeDescriptions[1].location = 1;
-        attributeDescriptions[1].format = VK_FORMAT_R32G32B32A32_SFLOAT;
-        attributeDescriptions[1].offset = offsetof(Particle, color);
-
-        return attributeDescriptions;
-    }
+    // The shaders skip the threads past the count, in the last workgroup or past a smaller count
+    uint32_t particleCount = 0;
+    uint32_t seed = 0;
+    // The emitters, which are only used when the particles spawn and die (std140 puts the array at 32)
+    uint32_t emitCount = 0;
+    uint32_t emitterCount = 0;
+    float seconds = 0.0f;
+    float lifeMin = 0.0f;
+    float lifeMax = 0.0f;
+    glm::vec4 emitters[ParticleEmitter::EMITTER_COUNT];
 };
 
 class ComputeShaderApplication {
@@ -188,7 +195,7 @@ private:
 
     VkInstance instance;
     VkDebugUtilsMessengerEXT debugMessenger;
-    VkSurfaceKHR surface;
+    VkSurfaceKHR surface = VK_NULL_HANDLE;
 
     VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
     VkDevice device;
@@ -197,7 +204,7 @@ private:
     VkQueue computeQueue;
     VkQueue presentQueue;
 
-    VkSwapchainKHR swapChain;
+    VkSwapchainKHR swapChain = VK_NULL_HANDLE;
     std::vector<VkImage> swapChainImages;
     VkFormat swapChainImageFormat;
     VkExtent2D swapChainExtent;
@@ -211,11 +218,35 @@ private:
     VkDescriptorSetLayout computeDescriptorSetLayout;
     VkPipelineLayout computePipelineLayout;
     VkPipeline computePipeline;
+    // Only used to set the initial particles
+    VkPipeline initPipeline = VK_NULL_HANDLE;
+    // Only used with emitters, to size the indirect dispatch and to spawn particles
+    VkPipeline preparePipeline = VK_NULL_HANDLE;
+    VkPipeline emitPipeline = VK_NULL_HANDLE;
 
     VkCommandPool commandPool;
+    VkCommandPool computeCommandPool;
+    uint32_t graphicsFamily = 0;
+    uint32_t computeFamily = 0;
 
     std::vector<VkBuffer> shaderStorageBuffers;
     std::vector<VkDeviceMemory> shaderStorageBuffersMemory;
+    // The particle attributes that are never simulated (none in the original layout)
+    VkBuffer particleSharedBuffer = VK_NULL_HANDLE;
+    VkDeviceMemory particleSharedBufferMemory = VK_NULL_HANDLE;
+    // The lifetimes and the dead list, which only compute uses (none without emitters)
+    VkBuffer particlePoolBuffer = VK_NULL_HANDLE;
+    VkDeviceMemory particlePoolBufferMemory = VK_NULL_HANDLE;
+
+    // The buffers hold the requested particles in the chosen layout, but fewer can be simulated
+    std::unique_ptr<ParticleLayout> particleLayout;
+    ParticleLayout::Format particleFormat = ParticleLayout::Format::SOA;
+    uint32_t particleCount = PARTICLE_COUNT;
+    uint32_t particleSeed = 0;
+    // A positive rate spawns particles that die, and the count is then the size of the pool
+    std::unique_ptr<ParticleEmitter> particleEmitter;
+    float emitRate = 0.0f;
+    uint32_t emitCount = 0;
 
     std::vector<VkBuffer> uniformBuffers;
     std::vector<VkDeviceMemory> uniformBuffersMemory;
@@ -227,21 +258,90 @@ private:
     std::vector<VkCommandBuffer> commandBuffers;
     std::vector<VkCommandBuffer> computeCommandBuffers;
 
-    std::vector<VkSemaphore> imageAvailableSemaphores;
-    std::vector<VkSemaphore> renderFinishedSemaphores;
-    std::vector<VkSemaphore> computeFinishedSemaphores;
-    std::vector<VkFence> inFlightFences;
-    std::vector<VkFence> computeInFlightFences;
+    // One timeline per queue replaces the fence and semaphore arrays
+    std::unique_ptr<FrameSync> frameSync;
+    uint32_t graphicsTimeline = 0;
+    uint32_t computeTimeline = 0;
     uint32_t currentFrame = 0;
+    // The particle buffer written this frame (frame number mod PARTICLE_BUFFERS)
+    uint32_t currentBuffer = 0;
+
+    // Named GPU scopes, averaged once a second and optionally saved as a trace
+    std::unique_ptr<GpuProfiler> gpuProfiler;
+    uint32_t computeProfile = 0;
+    uint32_t graphicsProfile = 0;
+    bool statisticsRequested = false;
+    bool statisticsEnabled = false;
+    std::string tracePath;
+    // CPU zones are saved at exit if this is set, and on demand with the T key
+    std::string cpuTracePath;
+
+    // The presentation policy, which can change at runtime
+    VkPresentModeKHR preferredPresentMode = VK_PRESENT_MODE_MAILBOX_KHR;
+    VkPresentModeKHR presentMode = VK_PRESENT_MODE_FIFO_KHR;
+    uint32_t framesInFlight = 2;
+    // 0 asks for one more image than the surface minimum
+    uint32_t preferredImageCount = 0;
+    bool presentationChanged = false;
+    bool presentWaitEnabled = false;
+    std::unique_ptr<PresentPacer> presentPacer;
+
+    // Old swapchains are destroyed once their frames and presents are done
+    bool surfaceMaintenanceEnabled = false;
+    bool swapchainMaintenanceEnabled = false;
+    std::unique_ptr<SwapchainRetirer> swapchainRetirer;
+    // Anything replaced while the GPU may still use it is destroyed here
+    std::unique_ptr<DeletionQueue> deletionQueue;
 
     float lastFrameTime = 0.0f;
 
     bool framebufferResized = false;
+    bool swapchainOutOfDate = false;
+    std::chrono::steady_clock::time_point resizeStart;
+    std::chrono::steady_clock::time_point resizeLast;
     VkExtent2D windowExtent;
 
     double lastTime = 0.0f;
+    // The seconds since startup, which headless runs pin to a fixed step per frame
+    std::function<double()> timeSource = []() { return SDL_GetTicks()/1000.0; };
+
+    // Headless runs render this many frames offscreen, with no window or surface
+    uint32_t headlessFrames = 0;
+    uint32_t headlessRendered = 0;
+    double headlessStart = 0.0;
+    std::string screenshotPath;
+    VkExtent2D headlessExtent = {WIDTH, HEIGHT};
+    std::unique_ptr<OffscreenTarget> offscreenTarget;
+
+    // Benchmark runs time every headless frame and save the results as JSON
+    std::unique_ptr<BenchReport> benchReport;
+    std::string benchPath;
+    bool memoryBudgetEnabled = false;
+
+    // Device functions skip the loader trampolines unless disabled, and the particles can be drawn in pieces
+    bool directDispatch = true;
+    uint32_t drawCount = 1;
+    double recordTime = 0.0;
+
+    // The Vulkan calls of a few frames can be saved for the replay tool
+    std::unique_ptr<FrameCapture> capture;
+    std::string capturePath;
+    uint32_t captureSkip = 0;
+    uint32_t captureFrames = 1;
+
+    bool isHeadless() {
+        return headlessFrames > 0;
+    }
 
     bool initWindow() {
+        if (isHeadless()) {
+            // Vulkan is used without the video subsystem, which needs a display
+            SDL_Init(0);
+            window = NULL;
+            windowExtent = headlessExtent;
+            return true;
+        }
+
         SDL_Init(SDL_INIT_VIDEO);
 
         if (!SDL_Vulkan_LoadLibrary(nullptr)) {
@@ -265,7 +365,7 @@ private:
         windowExtent.width = w;
         windowExtent.height = h;
 
-        lastTime = SDL_GetTicks()/1000.0;
+        lastTime = timeSource();
         return true;
     }
 
@@ -275,6 +375,7 @@ private:
             setupDebugMessenger();
             createSurface();
             pickPhysicalDevice();
+            createParticleLayout();
             createLogicalDevice();
             createSwapChain();
             createImageViews();
@@ -288,6 +389,7 @@ private:
             createUniformBuffers();
             createDescriptorPool();
             createComputeDescriptorSets();
+            initParticles();
             createCommandBuffers();
             createComputeCommandBuffers();
             createSyncObjects();
@@ -307,23 +409,8 @@ private:
             vkDestroyImageView(device, imageView, nullptr);
         }
 
-        vkDestroySwapchainKHR(device, swapChain, nullptr);
-        
-        // Despite the tutorial, it is not safe to reuse these semaphores
-        for (size_t ii = 0; ii < renderFinishedSemaphores.size(); ii++) {
-            vkDestroySemaphore(device, renderFinishedSemaphores[ii], nullptr);
-        }
-        for (size_t ii = 0; ii < imageAvailableSemaphores.size(); ii++) {
-            vkDestroySemaphore(device, imageAvailableSemaphores[ii], nullptr);
-        }
-        for (size_t ii = 0; ii < computeFinishedSemaphores.size(); ii++) {
-            vkDestroySemaphore(device, computeFinishedSemaphores[ii], nullptr);
-        }
-        for (size_t ii = 0; ii < inFlightFences.size(); ii++) {
-            vkDestroyFence(device, inFlightFences[ii], nullptr);
-        }
-        for (size_t ii = 0; ii < computeInFlightFences.size(); ii++) {
-            vkDestroyFence(device, computeInFlightFences[ii], nullptr);
+        if (swapChain != VK_NULL_HANDLE) {
+            vkDestroySwapchainKHR(device, swapChain, nullptr);
         }
     }
 
@@ -334,6 +421,10 @@ private:
         vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
 
         vkDestroyPipeline(device, computePipeline, nullptr);
+        if (preparePipeline != VK_NULL_HANDLE) {
+            vkDestroyPipeline(device, preparePipeline, nullptr);
+            vkDestroyPipeline(device, emitPipeline, nullptr);
+        }
         vkDestroyPipelineLayout(device, computePipelineLayout, nullptr);
 
         vkDestroyRenderPass(device, renderPass, nullptr);
@@ -347,12 +438,36 @@ private:
       
         vkDestroyDescriptorSetLayout(device, computeDescriptorSetLayout, nullptr);
 
-        for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+        for (size_t i = 0; i < PARTICLE_BUFFERS; i++) {
             vkDestroyBuffer(device, shaderStorageBuffers[i], nullptr);
             vkFreeMemory(device, shaderStorageBuffersMemory[i], nullptr);
         }
+        if (particleSharedBuffer != VK_NULL_HANDLE) {
+            vkDestroyBuffer(device, particleSharedBuffer, nullptr);
+            vkFreeMemory(device, particleSharedBufferMemory, nullptr);
+        }
+        if (particlePoolBuffer != VK_NULL_HANDLE) {
+            vkDestroyBuffer(device, particlePoolBuffer, nullptr);
+            vkFreeMemory(device, particlePoolBufferMemory, nullptr);
+        }
 
         vkDestroyCommandPool(device, commandPool, nullptr);
+        vkDestroyCommandPool(device, computeCommandPool, nullptr);
+
+        frameSync.reset();
+        if (gpuProfiler != nullptr && !tracePath.empty()) {
+            gpuProfiler->finish();
+            gpuProfiler->writeTrace(tracePath);
+        }
+        gpuProfiler.reset();
+        if (!cpuTracePath.empty()) {
+            CpuProfiler::writeTrace(cpuTracePath);
+        }
+        presentPacer.reset();
+        swapchainRetirer.reset();
+        deletionQueue.reset();
+        offscreenTarget.reset();
+        capture.reset();
 
         vkDestroyDevice(device, nullptr);
 
@@ -362,25 +477,45 @@ private:
 
         vkDestroySurfaceKHR(instance, surface, nullptr);
         vkDestroyInstance(instance, nullptr);
+        VulkanLoader::dispose();
 
-        SDL_DestroyWindow(window);
+        if (window != NULL) {
+            SDL_DestroyWindow(window);
+        }
         SDL_Quit();
     }
 
+    // The old swapchain is handed off and retired, so the GPU never idles
     void recreateSwapChain() {
-        vkDeviceWaitIdle(device);
-
+        CPU_ZONE("recreateSwapChain");
         framebufferResized = false;
-        cleanupSwapChain();
+        swapchainOutOfDate = false;
 
+        VkSwapchainKHR oldSwapChain = swapChain;
         createSwapChain();
+
+        // Only rendering uses the views and framebuffers, but presents may still use the rest
+        uint64_t lastFrame = frameSync->getFrame();
+        for (auto framebuffer : swapChainFramebuffers) {
+            deletionQueue->push(VK_OBJECT_TYPE_FRAMEBUFFER, (uint64_t) framebuffer, lastFrame);
+        }
+        for (auto imageView : swapChainImageViews) {
+            deletionQueue->push(VK_OBJECT_TYPE_IMAGE_VIEW, (uint64_t) imageView, lastFrame);
+        }
+
+        // Despite the tutorial, it is not safe to reuse the swapchain semaphores
+        swapchainRetirer->retire(oldSwapChain, frameSync->resetSwapchain(static_cast<uint32_t>(swapChainImages.size())), lastFrame);
+
         createImageViews();
         createFramebuffers();
-        createSyncObjects();
-        
+        presentPacer->resetSwapchain(swapChain);
     }
 
     void createInstance() {
+        if (!VulkanLoader::init()) {
+            throw std::runtime_error("failed to load Vulkan!");
+        }
+
         if (enableValidationLayers && !checkValidationLayerSupport()) {
             throw std::runtime_error("validation layers requested, but not available!");
         }
@@ -420,6 +555,9 @@ private:
         extensions.emplace_back(VK_KHR_PORTABILITY_ENUMERATION_EXTENSION_NAME);
         extensions.emplace_back(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME);
 #endif
+
+        // Present fences are optional, as old swapchains can be kept a few frames instead
+        surfaceMaintenanceEnabled = !isHeadless() && SwapchainRetirer::addInstanceExtensions(extensions);
         
         createInfo.enabledExtensionCount = static_cast<uint32_t>(extensions.size());
         createInfo.ppEnabledExtensionNames = extensions.data();
@@ -440,6 +578,7 @@ private:
         if (vkCreateInstance(&createInfo, nullptr, &instance) != VK_SUCCESS) {
             throw std::runtime_error("failed to create instance!");
         }
+        VulkanLoader::loadInstance(instance);
     }
 
     void populateDebugMessengerCreateInfo(VkDebugUtilsMessengerCreateInfoEXT& createInfo) {
@@ -462,6 +601,9 @@ private:
     }
 
     void createSurface() {
+        if (isHeadless()) {
+            return;
+        }
         if (!SDL_Vulkan_CreateSurface(window, instance, NULL, &surface)) {
             throw std::runtime_error("failed to create window surface!");
         }
@@ -494,11 +636,35 @@ private:
         print_version(props.deviceName,props.apiVersion);
     }
 
+    // Each array must fit in a storage buffer descriptor, which limits the count on some devices
+    void createParticleLayout() {
+        VkPhysicalDeviceProperties props;
+        vkGetPhysicalDeviceProperties(physicalDevice, &props);
+
+        uint32_t maxCapacity = ParticleLayout::getMaxCapacity(particleFormat, props.limits.maxStorageBufferRange);
+        if (particleCount > maxCapacity) {
+            SDL_Log("Only %u particles fit the %s layout on this device", maxCapacity, ParticleLayout::getFormatName(particleFormat));
+            particleCount = maxCapacity;
+        }
+        particleLayout = std::make_unique<ParticleLayout>(particleFormat, particleCount, emitRate > 0);
+        SDL_Log("Simulating %u particles in the %s layout (%llu bytes each per frame)", particleCount,
+                ParticleLayout::getFormatName(particleFormat), (unsigned long long) particleLayout->getFrameBytes());
+
+        // The shaders place the emitters with the same aspect as the initial circle
+        if (particleLayout->isEmitting()) {
+            particleEmitter = std::make_unique<ParticleEmitter>(emitRate, PARTICLE_LIFE_MIN, PARTICLE_LIFE_MAX, (float)HEIGHT / WIDTH);
+            SDL_Log("Emitting %.0f particles per second into a pool of %u", emitRate, particleLayout->getCapacity());
+            if (particleEmitter->getPeakCount() > particleLayout->getCapacity()) {
+                SDL_Log("Up to %u particles can be alive, so some spawns will be dropped", particleEmitter->getPeakCount());
+            }
+        }
+    }
+
     void createLogicalDevice() {
         QueueFamilyIndices indices = findQueueFamilies(physicalDevice);
 
         std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
-        std::set<uint32_t> uniqueQueueFamilies = {indices.graphicsAndComputeFamily.value(), indices.presentFamily.value()};
+        std::set<uint32_t> uniqueQueueFamilies = {indices.graphicsAndComputeFamily.value(), indices.presentFamily.value(), indices.computeFamily.value()};
 
         float queuePriority = 1.0f;
         for (uint32_t queueFamily : uniqueQueueFamilies) {
@@ -510,17 +676,75 @@ private:
             queueCreateInfos.push_back(queueCreateInfo);
         }
 
+        // Pipeline statistics are optional, as only the timestamps are needed to profile
+        statisticsEnabled = statisticsRequested && GpuProfiler::isStatisticsSupported(physicalDevice);
+
         VkPhysicalDeviceFeatures deviceFeatures{};
+        deviceFeatures.pipelineStatisticsQuery = statisticsEnabled ? VK_TRUE : VK_FALSE;
+
+        VkPhysicalDeviceTimelineSemaphoreFeatures timelineFeatures{};
+        timelineFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES;
+        timelineFeatures.timelineSemaphore = VK_TRUE;
+
+        // Present wait is optional, as the pacing falls back to frames in flight
+        presentWaitEnabled = !isHeadless() && PresentPacer::isSupported(physicalDevice);
+
+        VkPhysicalDevicePresentWaitFeaturesKHR presentWaitFeatures{};
+        presentWaitFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_WAIT_FEATURES_KHR;
+        presentWaitFeatures.presentWait = VK_TRUE;
+
+        VkPhysicalDevicePresentIdFeaturesKHR presentIdFeatures{};
+        presentIdFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_ID_FEATURES_KHR;
+        presentIdFeatures.pNext = &presentWaitFeatures;
+        presentIdFeatures.presentId = VK_TRUE;
+
+        if (presentWaitEnabled) {
+            timelineFeatures.pNext = &presentIdFeatures;
+        }
+
+        // Present fences also need the surface extensions on the instance
+        swapchainMaintenanceEnabled = surfaceMaintenanceEnabled && SwapchainRetirer::isSupported(physicalDevice);
+
+        VkPhysicalDeviceSwapchainMaintenance1FeaturesEXT maintenanceFeatures{};
+        maintenanceFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SWAPCHAIN_MAINTENANCE_1_FEATURES_EXT;
+        maintenanceFeatures.pNext = timelineFeatures.pNext;
+        maintenanceFeatures.swapchainMaintenance1 = VK_TRUE;
+
+        if (swapchainMaintenanceEnabled) {
+            timelineFeatures.pNext = &maintenanceFeatures;
+        }
 
         VkDeviceCreateInfo createInfo{};
         createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+        createInfo.pNext = &timelineFeatures;
 
         createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
         createInfo.pQueueCreateInfos = queueCreateInfos.data();
 
         createInfo.pEnabledFeatures = &deviceFeatures;
 
-        std::vector<const char*> extensions = deviceExtensions;
+        // Nothing is presented in headless mode, so there is no swapchain either
+        std::vector<const char*> extensions;
+        if (!isHeadless()) {
+            extensions = deviceExtensions;
+        }
+
+        // Timeline semaphores are core in 1.2, but older devices need the extension
+        if (hasDeviceExtension(physicalDevice, VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME)) {
+            extensions.push_back(VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME);
+        }
+        if (presentWaitEnabled) {
+            extensions.push_back(VK_KHR_PRESENT_ID_EXTENSION_NAME);
+            extensions.push_back(VK_KHR_PRESENT_WAIT_EXTENSION_NAME);
+        }
+        if (swapchainMaintenanceEnabled) {
+            extensions.push_back(VK_EXT_SWAPCHAIN_MAINTENANCE_1_EXTENSION_NAME);
+        }
+        // The device memory use is only reported to benchmarks
+        memoryBudgetEnabled = benchReport != nullptr && BenchReport::isDeviceMemorySupported(physicalDevice);
+        if (memoryBudgetEnabled) {
+            extensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+        }
 
 #ifdef USE_MOLTEN
         extensions.push_back("VK_KHR_portability_subset");
@@ -539,20 +763,40 @@ private:
         if (vkCreateDevice(physicalDevice, &createInfo, nullptr, &device) != VK_SUCCESS) {
             throw std::runtime_error("failed to create logical device!");
         }
+        if (directDispatch) {
+            VulkanLoader::loadDevice(device);
+        }
 
-        vkGetDeviceQueue(device, indices.graphicsAndComputeFamily.value(), 0, &graphicsQueue);
-        vkGetDeviceQueue(device, indices.graphicsAndComputeFamily.value(), 0, &computeQueue);
+        graphicsFamily = indices.graphicsAndComputeFamily.value();
+        computeFamily = indices.computeFamily.value();
+        if (computeFamily != graphicsFamily) {
+            SDL_Log("Simulating on dedicated compute queue family %u", computeFamily);
+        }
+
+        vkGetDeviceQueue(device, graphicsFamily, 0, &graphicsQueue);
+        vkGetDeviceQueue(device, computeFamily, 0, &computeQueue);
         vkGetDeviceQueue(device, indices.presentFamily.value(), 0, &presentQueue);
+
+        // Every resource is recorded from here on, even if the captured frames come much later
+        capture = std::make_unique<FrameCapture>(device, capturePath, captureSkip, captureFrames);
     }
 
     void createSwapChain() {
+        if (isHeadless()) {
+            createOffscreenTarget();
+            return;
+        }
+
         SwapChainSupportDetails swapChainSupport = querySwapChainSupport(physicalDevice);
 
         VkSurfaceFormatKHR surfaceFormat = chooseSwapSurfaceFormat(swapChainSupport.formats);
-        VkPresentModeKHR presentMode = chooseSwapPresentMode(swapChainSupport.presentModes);
+        presentMode = chooseSwapPresentMode(swapChainSupport.presentModes);
         VkExtent2D extent = chooseSwapExtent(swapChainSupport.capabilities);
 
         uint32_t imageCount = swapChainSupport.capabilities.minImageCount + 1;
+        if (preferredImageCount > 0) {
+            imageCount = std::max(preferredImageCount, swapChainSupport.capabilities.minImageCount);
+        }
         if (swapChainSupport.capabilities.maxImageCount > 0 && imageCount > swapChainSupport.capabilities.maxImageCount) {
             imageCount = swapChainSupport.capabilities.maxImageCount;
         }
@@ -584,6 +828,9 @@ private:
         createInfo.presentMode = presentMode;
         createInfo.clipped = VK_TRUE;
 
+        // The old swapchain (if any) can keep presenting until this one takes over
+        createInfo.oldSwapchain = swapChain;
+
         if (vkCreateSwapchainKHR(device, &createInfo, nullptr, &swapChain) != VK_SUCCESS) {
             throw std::runtime_error("failed to create swap chain!");
         }
@@ -596,10 +843,30 @@ private:
         swapChainExtent = extent;
     }
 
+    // The offscreen images stand in for the swapchain images, one for each frame slot
+    void createOffscreenTarget() {
+        if (offscreenTarget == nullptr) {
+            offscreenTarget = std::make_unique<OffscreenTarget>(physicalDevice, device, windowExtent, MAX_FRAMES_IN_FLIGHT);
+        }
+
+        swapChainImages = offscreenTarget->getImages();
+        swapChainImageFormat = offscreenTarget->getFormat();
+        swapChainExtent = offscreenTarget->getExtent();
+        presentMode = VK_PRESENT_MODE_IMMEDIATE_KHR;
+    }
+
     void createImageViews() {
         swapChainImageViews.resize(swapChainImages.size());
 
+        // The replay creates its own images in place of these
+        VkImageUsageFlags usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+        if (isHeadless()) {
+            usage |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+        }
+
         for (size_t i = 0; i < swapChainImages.size(); i++) {
+            capture->addImage(swapChainImages[i], swapChainImageFormat, swapChainExtent, usage);
+
             VkImageViewCreateInfo createInfo{};
             createInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
             createInfo.image = swapChainImages[i];
@@ -615,7 +882,7 @@ private:
             createInfo.subresourceRange.baseArrayLayer = 0;
             createInfo.subresourceRange.layerCount = 1;
 
-            if (vkCreateImageView(device, &createInfo, nullptr, &swapChainImageViews[i]) != VK_SUCCESS) {
+            if (capture->createImageView(createInfo, &swapChainImageViews[i]) != VK_SUCCESS) {
                 throw std::runtime_error("failed to create image views!");
             }
         }
@@ -630,7 +897,8 @@ private:
         colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
         colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
         colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-        colorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+        // Offscreen images are left ready to be read back instead
+        colorAttachment.finalLayout = isHeadless() ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
 
         VkAttachmentReference colorAttachmentRef{};
         colorAttachmentRef.attachment = 0;
@@ -658,37 +926,29 @@ private:
         renderPassInfo.dependencyCount = 1;
         renderPassInfo.pDependencies = &dependency;
 
-        if (vkCreateRenderPass(device, &renderPassInfo, nullptr, &renderPass) != VK_SUCCESS) {
+        if (capture->createRenderPass(renderPassInfo, &renderPass) != VK_SUCCESS) {
             throw std::runtime_error("failed to create render pass!");
         }
     }
 
     void createComputeDescriptorSetLayout() {
-        std::array<VkDescriptorSetLayoutBinding, 3> layoutBindings{};
+        std::vector<VkDescriptorSetLayoutBinding> layoutBindings(1);
         layoutBindings[0].binding = 0;
         layoutBindings[0].descriptorCount = 1;
         layoutBindings[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
         layoutBindings[0].pImmutableSamplers = nullptr;
         layoutBindings[0].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
 
-        layoutBindings[1].binding = 1;
-        layoutBindings[1].descriptorCount = 1;
-        layoutBindings[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-        layoutBindings[1].pImmutableSamplers = nullptr;
-        layoutBindings[1].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
-
-        layoutBindings[2].binding = 2;
-        layoutBindings[2].descriptorCount = 1;
-        layoutBindings[2].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-        layoutBindings[2].pImmutableSamplers = nullptr;
-        layoutBindings[2].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+        // The particle arrays read and written by the simulation, then the shared ones
+        auto storageBindings = particleLayout->getStorageBindings();
+        layoutBindings.insert(layoutBindings.end(), storageBindings.begin(), storageBindings.end());
 
         VkDescriptorSetLayoutCreateInfo layoutInfo{};
         layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-        layoutInfo.bindingCount = 3;
+        layoutInfo.bindingCount = static_cast<uint32_t>(layoutBindings.size());
         layoutInfo.pBindings = layoutBindings.data();
 
-        if (vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &computeDescriptorSetLayout) != VK_SUCCESS) {
+        if (capture->createDescriptorSetLayout(layoutInfo, &computeDescriptorSetLayout) != VK_SUCCESS) {
             throw std::runtime_error("failed to create compute descriptor set layout!");
         }
     }
@@ -718,12 +978,13 @@ private:
         VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
         vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
 
-        auto bindingDescription = Particle::getBindingDescription();
-        auto attributeDescriptions = Particle::getAttributeDescriptions();
+        // The structure of arrays layout reads the positions and colors from separate buffers
+        auto bindingDescriptions = particleLayout->getVertexBindings();
+        auto attributeDescriptions = particleLayout->getVertexAttributes();
 
-        vertexInputInfo.vertexBindingDescriptionCount = 1;
+        vertexInputInfo.vertexBindingDescriptionCount = static_cast<uint32_t>(bindingDescriptions.size());
         vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescriptions.size());
-        vertexInputInfo.pVertexBindingDescriptions = &bindingDescription;
+        vertexInputInfo.pVertexBindingDescriptions = bindingDescriptions.data();
         vertexInputInfo.pVertexAttributeDescriptions = attributeDescriptions.data();
 
         VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
@@ -786,7 +1047,7 @@ private:
         pipelineLayoutInfo.setLayoutCount = 0;
         pipelineLayoutInfo.pSetLayouts = nullptr;
 
-        if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS) {
+        if (capture->createPipelineLayout(pipelineLayoutInfo, &pipelineLayout) != VK_SUCCESS) {
             throw std::runtime_error("failed to create pipeline layout!");
         }
 
@@ -806,7 +1067,7 @@ private:
         pipelineInfo.subpass = 0;
         pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
 
-        if (vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &graphicsPipeline) != VK_SUCCESS) {
+        if (capture->createGraphicsPipeline(pipelineInfo, &graphicsPipeline) != VK_SUCCESS) {
             throw std::runtime_error("failed to create graphics pipeline!");
         }
 
@@ -815,7 +1076,7 @@ private:
     }
 
     void createComputePipeline() {
-        auto computeShaderCode = readFile("shaders/comp.spv");
+        auto computeShaderCode = readFile(particleLayout->getComputeShader());
 
         VkShaderModule computeShaderModule = createShaderModule(computeShaderCode);
 
@@ -830,7 +1091,7 @@ private:
         pipelineLayoutInfo.setLayoutCount = 1;
         pipelineLayoutInfo.pSetLayouts = &computeDescriptorSetLayout;
 
-        if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &computePipelineLayout) != VK_SUCCESS) {
+        if (capture->createPipelineLayout(pipelineLayoutInfo, &computePipelineLayout) != VK_SUCCESS) {
             throw std::runtime_error("failed to create compute pipeline layout!");
         }
 
@@ -839,11 +1100,47 @@ private:
         pipelineInfo.layout = computePipelineLayout;
         pipelineInfo.stage = computeShaderStageInfo;
 
-        if (vkCreateComputePipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &computePipeline) != VK_SUCCESS) {
+        if (capture->createComputePipeline(pipelineInfo, &computePipeline) != VK_SUCCESS) {
             throw std::runtime_error("failed to create compute pipeline!");
         }
 
         vkDestroyShaderModule(device, computeShaderModule, nullptr);
+
+        // The initial particles are set by a shader with the same descriptors
+        auto initShaderCode = readFile(particleLayout->getInitShader());
+        VkShaderModule initShaderModule = createShaderModule(initShaderCode);
+        pipelineInfo.stage.module = initShaderModule;
+
+        if (capture->createComputePipeline(pipelineInfo, &initPipeline) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create particle init pipeline!");
+        }
+
+        vkDestroyShaderModule(device, initShaderModule, nullptr);
+
+        if (!particleLayout->isEmitting()) {
+            return;
+        }
+
+        // The emitters add a pass before the simulation and one after, with the same descriptors
+        auto prepareShaderCode = readFile(particleLayout->getPrepareShader());
+        VkShaderModule prepareShaderModule = createShaderModule(prepareShaderCode);
+        pipelineInfo.stage.module = prepareShaderModule;
+
+        if (capture->createComputePipeline(pipelineInfo, &preparePipeline) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create particle prepare pipeline!");
+        }
+
+        vkDestroyShaderModule(device, prepareShaderModule, nullptr);
+
+        auto emitShaderCode = readFile(particleLayout->getEmitShader());
+        VkShaderModule emitShaderModule = createShaderModule(emitShaderCode);
+        pipelineInfo.stage.module = emitShaderModule;
+
+        if (capture->createComputePipeline(pipelineInfo, &emitPipeline) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create particle emit pipeline!");
+        }
+
+        vkDestroyShaderModule(device, emitShaderModule, nullptr);
     }
 
     void createFramebuffers() {
@@ -863,7 +1160,7 @@ private:
             framebufferInfo.height = swapChainExtent.height;
             framebufferInfo.layers = 1;
 
-            if (vkCreateFramebuffer(device, &framebufferInfo, nullptr, &swapChainFramebuffers[i]) != VK_SUCCESS) {
+            if (capture->createFramebuffer(framebufferInfo, &swapChainFramebuffers[i]) != VK_SUCCESS) {
                 throw std::runtime_error("failed to create framebuffer!");
             }
         }
@@ -880,61 +1177,162 @@ private:
         if (vkCreateCommandPool(device, &poolInfo, nullptr, &commandPool) != VK_SUCCESS) {
             throw std::runtime_error("failed to create graphics command pool!");
         }
+
+        poolInfo.queueFamilyIndex = queueFamilyIndices.computeFamily.value();
+
+        if (vkCreateCommandPool(device, &poolInfo, nullptr, &computeCommandPool) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create compute command pool!");
+        }
     }
 
     void createShaderStorageBuffers() {
+        // The particles are set on the GPU by initParticles, so there is nothing to upload
+        shaderStorageBuffers.resize(PARTICLE_BUFFERS);
+        shaderStorageBuffersMemory.resize(PARTICLE_BUFFERS);
+
+        // With emitters, each buffer also holds the draw arguments and the alive list drawn as indices
+        VkBufferUsageFlags usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT;
+        if (particleLayout->isEmitting()) {
+            usage |= VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT;
+        }
+        for (size_t i = 0; i < PARTICLE_BUFFERS; i++) {
+            createBuffer(particleLayout->getBufferSize(), usage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, shaderStorageBuffers[i], shaderStorageBuffersMemory[i]);
+        }
 
-        // Initialize particles
-        std::default_random_engine rndEngine((unsigned)time(nullptr));
-        std::uniform_real_distribution<float> rndDist(0.0f, 1.0f);
+        // Only graphics reads the shared buffer after it is set, so it never changes owner
+        if (particleLayout->getSharedSize() > 0) {
+            createBuffer(particleLayout->getSharedSize(), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, particleSharedBuffer, particleSharedBufferMemory);
+        }
 
-        // Initial particle positions on a circle
-        std::vector<Particle> particles(PARTICLE_COUNT);
-        for (auto& particle : particles) {
-            float r = 0.25f * sqrt(rndDist(rndEngine));
-            float theta = rndDist(rndEngine) * 2.0f * 3.14159265358979323846f;
-            float x = r * cos(theta) * HEIGHT / WIDTH;
-            float y = r * sin(theta);
-            particle.position = glm::vec2(x, y);
-            particle.velocity = glm::normalize(glm::vec2(x,y)) * 0.00025f;
-            particle.color = glm::vec4(rndDist(rndEngine), rndDist(rndEngine), rndDist(rndEngine), 1.0f);
-            particle.offsides = glm::vec2(-1,-1);
+        // The pool also holds the workgroups of the simulation, and is only ever used by compute
+        if (particleLayout->getPoolSize() > 0) {
+            createBuffer(particleLayout->getPoolSize(), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, particlePoolBuffer, particlePoolBufferMemory);
+        }
+    }
+
+    // Every buffer of the ring gets the same particles, replacing the upload of a CPU loop
+    void initParticles() {
+        particleSeed = isHeadless() ? HEADLESS_SEED : (uint32_t)time(nullptr);
+
+        // The whole capacity is set, so that the count can grow later
+        UniformBufferObject ubo{};
+        ubo.deltaTime = 0.0f;
+        ubo.particleCount = particleLayout->getCapacity();
+        ubo.seed = particleSeed;
+        for (size_t i = 0; i < PARTICLE_BUFFERS; i++) {
+            capture->writeBuffer(uniformBuffers[i], uniformBuffersMapped[i], 0, &ubo, sizeof(ubo));
+        }
+
+        // The graphics family can run compute too, and owns the buffers as the upload did
+        submitOnce(commandPool, graphicsQueue, [&](VkCommandBuffer commandBuffer) {
+            capture->cmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, initPipeline);
+
+            VkMemoryBarrier barrier{};
+            barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+            barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+            barrier.dstAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+
+            for (size_t i = 0; i < PARTICLE_BUFFERS; i++) {
+                // Each dispatch writes the shared buffer again
+                if (i > 0) {
+                    capture->cmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                                                0, 1, &barrier, 0, nullptr, 0, nullptr);
+                }
+                capture->cmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, computePipelineLayout, 0, 1, &computeDescriptorSets[i], 0, nullptr);
+                capture->cmdDispatch(commandBuffer, ParticleLayout::getGroupCount(particleLayout->getCapacity()), 1, 1);
+            }
+
+            barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | getDrawAccess();
+            capture->cmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                                        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | getDrawStages(),
+                                        0, 1, &barrier, 0, nullptr, 0, nullptr);
+        });
+
+        vkDestroyPipeline(device, initPipeline, nullptr);
+        initPipeline = VK_NULL_HANDLE;
+
+        // The first frame simulates from buffer 0, so the compute family must own it (and the pool for good)
+        if (computeFamily != graphicsFamily) {
+            std::vector<VkBuffer> transfers = {shaderStorageBuffers[0]};
+            if (particlePoolBuffer != VK_NULL_HANDLE) {
+                transfers.push_back(particlePoolBuffer);
+            }
+            submitOnce(commandPool, graphicsQueue, [&](VkCommandBuffer commandBuffer) {
+                for (VkBuffer buffer : transfers) {
+                    recordOwnershipTransfer(commandBuffer, buffer, graphicsFamily, computeFamily,
+                                            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+                                            VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0);
+                }
+            });
+            submitOnce(computeCommandPool, computeQueue, [&](VkCommandBuffer commandBuffer) {
+                for (VkBuffer buffer : transfers) {
+                    recordOwnershipTransfer(commandBuffer, buffer, graphicsFamily, computeFamily,
+                                            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,
+                                            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+                }
+            });
         }
+    }
+
+    void submitOnce(VkCommandPool pool, VkQueue queue, const std::function<void(VkCommandBuffer)>& record) {
+        VkCommandBufferAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocInfo.commandPool = pool;
+        allocInfo.commandBufferCount = 1;
+
+        VkCommandBuffer commandBuffer;
+        vkAllocateCommandBuffers(device, &allocInfo, &commandBuffer);
+
+        VkCommandBufferBeginInfo beginInfo{};
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
 
-        VkDeviceSize bufferSize = sizeof(Particle) * PARTICLE_COUNT;
+        capture->beginCommandBuffer(commandBuffer, beginInfo);
+        record(commandBuffer);
+        capture->endCommandBuffer(commandBuffer);
 
-        // Create a staging buffer used to upload data to the gpu
-        VkBuffer stagingBuffer;
-        VkDeviceMemory stagingBufferMemory;
-        createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory);
+        VkSubmitInfo submitInfo{};
+        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submitInfo.commandBufferCount = 1;
+        submitInfo.pCommandBuffers = &commandBuffer;
 
-        void* data;
-        vkMapMemory(device, stagingBufferMemory, 0, bufferSize, 0, &data);
-        memcpy(data, particles.data(), (size_t)bufferSize);
-        vkUnmapMemory(device, stagingBufferMemory);
+        vkQueueSubmit(queue, 1, &submitInfo, VK_NULL_HANDLE);
+        capture->submit(commandBuffer);
+        vkQueueWaitIdle(queue);
 
-        shaderStorageBuffers.resize(MAX_FRAMES_IN_FLIGHT);
-        shaderStorageBuffersMemory.resize(MAX_FRAMES_IN_FLIGHT);
+        vkFreeCommandBuffers(device, pool, 1, &commandBuffer);
+    }
 
-        // Copy initial particle data to all storage buffers
-        for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-            createBuffer(bufferSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, shaderStorageBuffers[i], shaderStorageBuffersMemory[i]);
-            copyBuffer(stagingBuffer, shaderStorageBuffers[i], bufferSize);
+    // Exclusive buffers must be released by one queue family and acquired by the other
+    void recordOwnershipTransfer(VkCommandBuffer commandBuffer, VkBuffer buffer, uint32_t srcFamily, uint32_t dstFamily,
+                                 VkPipelineStageFlags srcStage, VkAccessFlags srcAccess,
+                                 VkPipelineStageFlags dstStage, VkAccessFlags dstAccess) {
+        if (srcFamily == dstFamily) {
+            return;
         }
 
-        vkDestroyBuffer(device, stagingBuffer, nullptr);
-        vkFreeMemory(device, stagingBufferMemory, nullptr);
+        VkBufferMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+        barrier.srcAccessMask = srcAccess;
+        barrier.dstAccessMask = dstAccess;
+        barrier.srcQueueFamilyIndex = srcFamily;
+        barrier.dstQueueFamilyIndex = dstFamily;
+        barrier.buffer = buffer;
+        barrier.offset = 0;
+        barrier.size = VK_WHOLE_SIZE;
 
+        capture->cmdPipelineBarrier(commandBuffer, srcStage, dstStage, 0, 0, nullptr, 1, &barrier, 0, nullptr);
     }
 
     void createUniformBuffers() {
         VkDeviceSize bufferSize = sizeof(UniformBufferObject);
 
-        uniformBuffers.resize(MAX_FRAMES_IN_FLIGHT);
-        uniformBuffersMemory.resize(MAX_FRAMES_IN_FLIGHT);
-        uniformBuffersMapped.resize(MAX_FRAMES_IN_FLIGHT);
+        uniformBuffers.resize(PARTICLE_BUFFERS);
+        uniformBuffersMemory.resize(PARTICLE_BUFFERS);
+        uniformBuffersMapped.resize(PARTICLE_BUFFERS);
 
-        for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+        for (size_t i = 0; i < PARTICLE_BUFFERS; i++) {
             createBuffer(bufferSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, uniformBuffers[i], uniformBuffersMemory[i]);
 
             vkMapMemory(device, uniformBuffersMemory[i], 0, bufferSize, 0, &uniformBuffersMapped[i]);
@@ -944,42 +1342,48 @@ private:
     void createDescriptorPool() {
         std::array<VkDescriptorPoolSize, 2> poolSizes{};
         poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-        poolSizes[0].descriptorCount = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
+        poolSizes[0].descriptorCount = static_cast<uint32_t>(PARTICLE_BUFFERS);
         
         poolSizes[1].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-        poolSizes[1].descriptorCount = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT) * 2;
+        poolSizes[1].descriptorCount = static_cast<uint32_t>(PARTICLE_BUFFERS * particleLayout->getStorageBindings().size());
 
         VkDescriptorPoolCreateInfo poolInfo{};
         poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
         poolInfo.poolSizeCount = 2;
         poolInfo.pPoolSizes = poolSizes.data();
-        poolInfo.maxSets = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
+        poolInfo.maxSets = static_cast<uint32_t>(PARTICLE_BUFFERS);
 
-        if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &descriptorPool) != VK_SUCCESS) {
+        if (capture->createDescriptorPool(poolInfo, &descriptorPool) != VK_SUCCESS) {
             throw std::runtime_error("failed to create descriptor pool!");
         }
     }
 
     void createComputeDescriptorSets() {
-        std::vector<VkDescriptorSetLayout> layouts(MAX_FRAMES_IN_FLIGHT, computeDescriptorSetLayout);
+        std::vector<VkDescriptorSetLayout> layouts(PARTICLE_BUFFERS, computeDescriptorSetLayout);
         VkDescriptorSetAllocateInfo allocInfo{};
         allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
         allocInfo.descriptorPool = descriptorPool;
-        allocInfo.descriptorSetCount = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
+        allocInfo.descriptorSetCount = static_cast<uint32_t>(PARTICLE_BUFFERS);
         allocInfo.pSetLayouts = layouts.data();
 
-        computeDescriptorSets.resize(MAX_FRAMES_IN_FLIGHT);
-        if (vkAllocateDescriptorSets(device, &allocInfo, computeDescriptorSets.data()) != VK_SUCCESS) {
+        computeDescriptorSets.resize(PARTICLE_BUFFERS);
+        if (capture->allocateDescriptorSets(allocInfo, computeDescriptorSets.data()) != VK_SUCCESS) {
             throw std::runtime_error("failed to allocate descriptor sets!");
         }
 
-        for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+        for (size_t i = 0; i < PARTICLE_BUFFERS; i++) {
             VkDescriptorBufferInfo uniformBufferInfo{};
             uniformBufferInfo.buffer = uniformBuffers[i];
             uniformBufferInfo.offset = 0;
             uniformBufferInfo.range = sizeof(UniformBufferObject);
 
-            std::array<VkWriteDescriptorSet, 3> descriptorWrites{};
+            // The simulation reads the last buffer of the ring and writes this one
+            std::vector<VkDescriptorBufferInfo> storageBufferInfos = particleLayout->getStorageInfos(
+                shaderStorageBuffers[(i + PARTICLE_BUFFERS - 1) % PARTICLE_BUFFERS], shaderStorageBuffers[i], particleSharedBuffer, particlePoolBuffer);
+            // The lists do not follow on from the arrays, so each write takes the binding of its info
+            auto storageBindings = particleLayout->getStorageBindings();
+
+            std::vector<VkWriteDescriptorSet> descriptorWrites(storageBufferInfos.size() + 1);
             descriptorWrites[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
             descriptorWrites[0].dstSet = computeDescriptorSets[i];
             descriptorWrites[0].dstBinding = 0;
@@ -988,33 +1392,17 @@ private:
             descriptorWrites[0].descriptorCount = 1;
             descriptorWrites[0].pBufferInfo = &uniformBufferInfo;
 
-            VkDescriptorBufferInfo storageBufferInfoLastFrame{};
-            storageBufferInfoLastFrame.buffer = shaderStorageBuffers[(i - 1) % MAX_FRAMES_IN_FLIGHT];
-            storageBufferInfoLastFrame.offset = 0;
-            storageBufferInfoLastFrame.range = sizeof(Particle) * PARTICLE_COUNT;
-
-            descriptorWrites[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-            descriptorWrites[1].dstSet = computeDescriptorSets[i];
-            descriptorWrites[1].dstBinding = 1;
-            descriptorWrites[1].dstArrayElement = 0;
-            descriptorWrites[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-            descriptorWrites[1].descriptorCount = 1;
-            descriptorWrites[1].pBufferInfo = &storageBufferInfoLastFrame;
-
-            VkDescriptorBufferInfo storageBufferInfoCurrentFrame{};
-            storageBufferInfoCurrentFrame.buffer = shaderStorageBuffers[i];
-            storageBufferInfoCurrentFrame.offset = 0;
-            storageBufferInfoCurrentFrame.range = sizeof(Particle) * PARTICLE_COUNT;
-
-            descriptorWrites[2].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-            descriptorWrites[2].dstSet = computeDescriptorSets[i];
-            descriptorWrites[2].dstBinding = 2;
-            descriptorWrites[2].dstArrayElement = 0;
-            descriptorWrites[2].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-            descriptorWrites[2].descriptorCount = 1;
-            descriptorWrites[2].pBufferInfo = &storageBufferInfoCurrentFrame;
+            for (size_t j = 0; j < storageBufferInfos.size(); j++) {
+                descriptorWrites[j + 1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+                descriptorWrites[j + 1].dstSet = computeDescriptorSets[i];
+                descriptorWrites[j + 1].dstBinding = storageBindings[j].binding;
+                descriptorWrites[j + 1].dstArrayElement = 0;
+                descriptorWrites[j + 1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+                descriptorWrites[j + 1].descriptorCount = 1;
+                descriptorWrites[j + 1].pBufferInfo = &storageBufferInfos[j];
+            }
 
-            vkUpdateDescriptorSets(device, 3, descriptorWrites.data(), 0, nullptr);
+            capture->updateDescriptorSets(static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data());
         }
     }
 
@@ -1026,7 +1414,7 @@ private:
         bufferInfo.usage = usage;
         bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 
-        if (vkCreateBuffer(device, &bufferInfo, nullptr, &buffer) != VK_SUCCESS) {
+        if (capture->createBuffer(bufferInfo, properties, &buffer) != VK_SUCCESS) {
             throw std::runtime_error("failed to create buffer!");
         }
 
@@ -1059,13 +1447,13 @@ private:
         beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
         beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
 
-        vkBeginCommandBuffer(commandBuffer, &beginInfo);
+        capture->beginCommandBuffer(commandBuffer, beginInfo);
 
         VkBufferCopy copyRegion{};
         copyRegion.size = size;
-        vkCmdCopyBuffer(commandBuffer, srcBuffer, dstBuffer, 1, &copyRegion);
+        capture->cmdCopyBuffer(commandBuffer, srcBuffer, dstBuffer, 1, &copyRegion);
 
-        vkEndCommandBuffer(commandBuffer);
+        capture->endCommandBuffer(commandBuffer);
 
         VkSubmitInfo submitInfo{};
         submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
@@ -1073,6 +1461,7 @@ private:
         submitInfo.pCommandBuffers = &commandBuffer;
 
         vkQueueSubmit(graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE);
+        capture->submit(commandBuffer);
         vkQueueWaitIdle(graphicsQueue);
 
         vkFreeCommandBuffers(device, commandPool, 1, &commandBuffer);
@@ -1110,7 +1499,7 @@ private:
 
         VkCommandBufferAllocateInfo allocInfo{};
         allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-        allocInfo.commandPool = commandPool;
+        allocInfo.commandPool = computeCommandPool;
         allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
         allocInfo.commandBufferCount = (uint32_t)computeCommandBuffers.size();
 
@@ -1120,13 +1509,18 @@ private:
     }
 
     void recordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t imageIndex) {
+        CPU_ZONE("recordCommandBuffer");
+        auto recordStart = std::chrono::steady_clock::now();
         VkCommandBufferBeginInfo beginInfo{};
         beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
 
-        if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS) {
+        if (capture->beginCommandBuffer(commandBuffer, beginInfo) != VK_SUCCESS) {
             throw std::runtime_error("failed to begin recording command buffer!");
         }
 
+        gpuProfiler->beginCommands(commandBuffer, graphicsProfile);
+        recordParticleAcquire(commandBuffer);
+
         VkRenderPassBeginInfo renderPassInfo{};
         renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
         renderPassInfo.renderPass = renderPass;
@@ -1138,9 +1532,10 @@ private:
         renderPassInfo.clearValueCount = 1;
         renderPassInfo.pClearValues = &clearColor;
 
-        vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+        gpuProfiler->beginScope(commandBuffer, graphicsProfile, "draw");
+        capture->cmdBeginRenderPass(commandBuffer, renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
 
-            vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline);
+            capture->cmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline);
 
             VkViewport viewport{};
             viewport.x = 0.0f;
@@ -1149,157 +1544,344 @@ private:
             viewport.height = (float) swapChainExtent.height;
             viewport.minDepth = 0.0f;
             viewport.maxDepth = 1.0f;
-            vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+            capture->cmdSetViewport(commandBuffer, 0, 1, &viewport);
 
             VkRect2D scissor{};
             scissor.offset = {0, 0};
             scissor.extent = swapChainExtent;
-            vkCmdSetScissor(commandBuffer, 0, 1, &scissor);            
+            capture->cmdSetScissor(commandBuffer, 0, 1, &scissor);
+
+            VkBuffer vertexBuffers[2];
+            VkDeviceSize offsets[2];
+            uint32_t vertexBufferCount = particleLayout->getVertexBuffers(shaderStorageBuffers[getDrawBuffer()], particleSharedBuffer, vertexBuffers, offsets);
+            capture->cmdBindVertexBuffers(commandBuffer, 0, vertexBufferCount, vertexBuffers, offsets);
+
+            if (particleLayout->isEmitting()) {
+                // Only the live particles are drawn, as the alive list is the index buffer and its count the index count
+                capture->cmdBindIndexBuffer(commandBuffer, shaderStorageBuffers[getDrawBuffer()], particleLayout->getIndexOffset(), VK_INDEX_TYPE_UINT32);
+                capture->cmdDrawIndexedIndirect(commandBuffer, shaderStorageBuffers[getDrawBuffer()], particleLayout->getDrawOffset(),
+                                                1, sizeof(VkDrawIndexedIndirectCommand));
+            } else {
+                // Splitting the draw changes nothing on screen, but adds calls to measure the cost of each one
+                uint32_t firstVertex = 0;
+                for (uint32_t ii = 1; ii <= drawCount; ii++) {
+                    uint32_t lastVertex = static_cast<uint32_t>(static_cast<uint64_t>(particleCount) * ii / drawCount);
+                    capture->cmdDraw(commandBuffer, lastVertex - firstVertex, 1, firstVertex, 0);
+                    firstVertex = lastVertex;
+                }
+            }
 
-            VkDeviceSize offsets[] = {0};
-            vkCmdBindVertexBuffers(commandBuffer, 0, 1, &shaderStorageBuffers[currentFrame], offsets);
+        capture->cmdEndRenderPass(commandBuffer);
+        gpuProfiler->endScope(commandBuffer, graphicsProfile);
 
-            vkCmdDraw(commandBuffer, PARTICLE_COUNT, 1, 0, 0);
+        // The last headless frame copies its own image, rather than stalling for a separate copy
+        if (isHeadless() && !screenshotPath.empty() && headlessRendered + 1 == headlessFrames) {
+            offscreenTarget->recordReadback(commandBuffer, imageIndex);
+        }
 
-        vkCmdEndRenderPass(commandBuffer);
+        recordParticleRelease(commandBuffer);
+        gpuProfiler->endCommands(commandBuffer, graphicsProfile);
 
-        if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+        if (capture->endCommandBuffer(commandBuffer) != VK_SUCCESS) {
             throw std::runtime_error("failed to record command buffer!");
         }
+        recordTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - recordStart).count();
     }
 
-    void recordComputeCommandBuffer(VkCommandBuffer commandBuffer) {
+    // Keeps the ownership transfers paired when a frame cannot be drawn
+    void recordTransferCommandBuffer(VkCommandBuffer commandBuffer) {
         VkCommandBufferBeginInfo beginInfo{};
         beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
 
-        if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS) {
-            throw std::runtime_error("failed to begin recording compute command buffer!");
+        if (capture->beginCommandBuffer(commandBuffer, beginInfo) != VK_SUCCESS) {
+            throw std::runtime_error("failed to begin recording command buffer!");
         }
 
-        vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, computePipeline);
+        gpuProfiler->beginCommands(commandBuffer, graphicsProfile);
+        recordParticleAcquire(commandBuffer);
+        recordParticleRelease(commandBuffer);
+        gpuProfiler->endCommands(commandBuffer, graphicsProfile);
 
-        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, computePipelineLayout, 0, 1, &computeDescriptorSets[currentFrame], 0, nullptr);
+        if (capture->endCommandBuffer(commandBuffer) != VK_SUCCESS) {
+            throw std::runtime_error("failed to record command buffer!");
+        }
+    }
 
-        vkCmdDispatch(commandBuffer, PARTICLE_COUNT / 256, 1, 1);
+    // Graphics draws the buffer simulated two frames ago, while compute writes the current one
+    uint32_t getDrawBuffer() {
+        return (currentBuffer + 1) % PARTICLE_BUFFERS;
+    }
 
-        if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
-            throw std::runtime_error("failed to record compute command buffer!");
+    // The indirect draw also reads its arguments and the alive list from the buffer
+    VkPipelineStageFlags getDrawStages() {
+        if (particleLayout->isEmitting()) {
+            return VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT;
         }
+        return VK_PIPELINE_STAGE_VERTEX_INPUT_BIT;
+    }
 
+    VkAccessFlags getDrawAccess() {
+        if (particleLayout->isEmitting()) {
+            return VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_INDEX_READ_BIT | VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT;
+        }
+        return VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT;
     }
 
-    void createSyncObjects() {
-        renderFinishedSemaphores.resize(swapChainImages.size());
-        imageAvailableSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
-        computeFinishedSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
-        inFlightFences.resize(MAX_FRAMES_IN_FLIGHT);
-        computeInFlightFences.resize(MAX_FRAMES_IN_FLIGHT);
-
-        VkSemaphoreCreateInfo semaphoreInfo{};
-        semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
-
-        VkFenceCreateInfo fenceInfo{};
-        fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-        fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
-
-        for (size_t ii = 0; ii < renderFinishedSemaphores.size(); ii++) {
-            if (vkCreateSemaphore(device, &semaphoreInfo, nullptr, &renderFinishedSemaphores[ii]) != VK_SUCCESS) {
-                throw std::runtime_error("failed to create graphics synchronization objects for a frame!");
-            }
+    void recordParticleAcquire(VkCommandBuffer commandBuffer) {
+        // The first frame draws a buffer that graphics has owned since the upload
+        if (frameSync->getFrame() > 1) {
+            recordOwnershipTransfer(commandBuffer, shaderStorageBuffers[getDrawBuffer()], computeFamily, graphicsFamily,
+                                    getDrawStages(), 0,
+                                    getDrawStages(), getDrawAccess());
         }
-        for (size_t ii = 0; ii < imageAvailableSemaphores.size(); ii++) {
-            if (vkCreateSemaphore(device, &semaphoreInfo, nullptr, &imageAvailableSemaphores[ii]) != VK_SUCCESS) {
-                throw std::runtime_error("failed to create graphics synchronization objects for a frame!");
-            }
+    }
+
+    void recordParticleRelease(VkCommandBuffer commandBuffer) {
+        recordOwnershipTransfer(commandBuffer, shaderStorageBuffers[getDrawBuffer()], graphicsFamily, computeFamily,
+                                getDrawStages(), 0,
+                                VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0);
+    }
+
+    // Every pass reads and writes the lists, and the simulation reads its workgroups from the pool
+    void recordListBarrier(VkCommandBuffer commandBuffer) {
+        VkMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+        capture->cmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                                    VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                                    0, 1, &barrier, 0, nullptr, 0, nullptr);
+    }
+
+    void recordComputeCommandBuffer(VkCommandBuffer commandBuffer) {
+        CPU_ZONE("recordComputeCommandBuffer");
+        VkCommandBufferBeginInfo beginInfo{};
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+
+        if (capture->beginCommandBuffer(commandBuffer, beginInfo) != VK_SUCCESS) {
+            throw std::runtime_error("failed to begin recording compute command buffer!");
         }
-        for (size_t ii = 0; ii < inFlightFences.size(); ii++) {
-            if (vkCreateFence(device, &fenceInfo, nullptr, &inFlightFences[ii]) != VK_SUCCESS) {
-                throw std::runtime_error("failed to create graphics synchronization objects for a frame!");
-            }
+
+        gpuProfiler->beginCommands(commandBuffer, computeProfile);
+
+        // The output was drawn by the last frame, which released it (except on the first frame)
+        uint32_t previousBuffer = (currentBuffer + PARTICLE_BUFFERS - 1) % PARTICLE_BUFFERS;
+        if (frameSync->getFrame() > 1) {
+            recordOwnershipTransfer(commandBuffer, shaderStorageBuffers[currentBuffer], graphicsFamily, computeFamily,
+                                    VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,
+                                    VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT);
         }
-        
-        for (size_t ii = 0; ii < computeFinishedSemaphores.size(); ii++) {
-            if (vkCreateSemaphore(device, &semaphoreInfo, nullptr, &computeFinishedSemaphores[ii]) != VK_SUCCESS) {
-                throw std::runtime_error("failed to create compute synchronization objects for a frame!");
-            }
+
+        gpuProfiler->beginScope(commandBuffer, computeProfile, "simulate");
+
+        if (particleLayout->isEmitting()) {
+            // The last frame left its lists and the dead list in the pool, which this frame starts from
+            recordListBarrier(commandBuffer);
+
+            // The workgroups come from the alive count of the input, which the CPU never sees
+            capture->cmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, preparePipeline);
+            capture->cmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, computePipelineLayout, 0, 1, &computeDescriptorSets[currentBuffer], 0, nullptr);
+            capture->cmdDispatch(commandBuffer, 1, 1, 1);
+            recordListBarrier(commandBuffer);
+
+            // The pipelines share a layout, so the descriptors stay bound
+            capture->cmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, computePipeline);
+            capture->cmdDispatchIndirect(commandBuffer, particlePoolBuffer, particleLayout->getDispatchOffset());
+        } else {
+            capture->cmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, computePipeline);
+
+            capture->cmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, computePipelineLayout, 0, 1, &computeDescriptorSets[currentBuffer], 0, nullptr);
+
+            // The count need not be a multiple of the workgroup, as the shader checks the tail
+            capture->cmdDispatch(commandBuffer, ParticleLayout::getGroupCount(particleCount), 1, 1);
         }
-        for (size_t ii = 0; ii < computeInFlightFences.size(); ii++) {
-            if (vkCreateFence(device, &fenceInfo, nullptr, &computeInFlightFences[ii]) != VK_SUCCESS) {
-                throw std::runtime_error("failed to create compute synchronization objects for a frame!");
-            }
+
+        gpuProfiler->endScope(commandBuffer, computeProfile);
+
+        // The spawns take the particles that died in the simulation, and append to its alive list
+        if (particleLayout->isEmitting() && emitCount > 0) {
+            recordListBarrier(commandBuffer);
+            gpuProfiler->beginScope(commandBuffer, computeProfile, "emit");
+            capture->cmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, emitPipeline);
+            capture->cmdDispatch(commandBuffer, ParticleLayout::getGroupCount(emitCount), 1, 1);
+            gpuProfiler->endScope(commandBuffer, computeProfile);
+        }
+
+        // The input is done with the simulation, and is drawn next frame
+        recordOwnershipTransfer(commandBuffer, shaderStorageBuffers[previousBuffer], computeFamily, graphicsFamily,
+                                VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,
+                                VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0);
+
+        gpuProfiler->endCommands(commandBuffer, computeProfile);
+
+        if (capture->endCommandBuffer(commandBuffer) != VK_SUCCESS) {
+            throw std::runtime_error("failed to record compute command buffer!");
+        }
+
+    }
+
+    void createSyncObjects() {
+        frameSync = std::make_unique<FrameSync>(device, framesInFlight, MAX_FRAMES_IN_FLIGHT);
+        graphicsTimeline = frameSync->addQueue(graphicsQueue);
+        computeTimeline = frameSync->addQueue(computeQueue);
+        frameSync->resetSwapchain(static_cast<uint32_t>(swapChainImages.size()));
+
+        // Labels need the debug utils, which are only enabled with the validation layers
+        gpuProfiler = std::make_unique<GpuProfiler>(instance, physicalDevice, device, MAX_FRAMES_IN_FLIGHT,
+                                                    enableValidationLayers, statisticsEnabled);
+        computeProfile = gpuProfiler->addQueue(computeFamily, "compute");
+        graphicsProfile = gpuProfiler->addQueue(graphicsFamily, "graphics");
+        gpuProfiler->setTracing(!tracePath.empty());
+
+        const SDL_DisplayMode* displayMode = window != NULL ? SDL_GetCurrentDisplayMode(SDL_GetDisplayForWindow(window)) : nullptr;
+        presentPacer = std::make_unique<PresentPacer>(device, presentWaitEnabled, displayMode != nullptr ? displayMode->refresh_rate : 0.0f);
+        presentPacer->resetSwapchain(swapChain);
+        swapchainRetirer = std::make_unique<SwapchainRetirer>(device, swapchainMaintenanceEnabled, MAX_FRAMES_IN_FLIGHT);
+        deletionQueue = std::make_unique<DeletionQueue>(device);
+        logPresentation();
+    }
+
+    // The frame slots are sized for the maximum, so none of this waits on the GPU
+    void applyPresentation() {
+        presentationChanged = false;
+
+        frameSync->setFrameCount(framesInFlight);
+        recreateSwapChain();
+        logPresentation();
+    }
+
+    void logPresentation() {
+        SDL_Log("Presenting with %s, %u frames in flight, %u swapchain images",
+                PresentPacer::getModeName(presentMode), framesInFlight, static_cast<uint32_t>(swapChainImages.size()));
+    }
+
+    // Only the FIFO modes queue images behind the vsync
+    bool isPresentPaced() {
+        return presentMode == VK_PRESENT_MODE_FIFO_KHR || presentMode == VK_PRESENT_MODE_FIFO_RELAXED_KHR;
+    }
+
+    // Starts a pending resize, or extends the one in progress
+    void requestResize() {
+        auto now = std::chrono::steady_clock::now();
+        if (!framebufferResized) {
+            framebufferResized = true;
+            resizeStart = now;
         }
+        resizeLast = now;
+    }
+
+    // A drag is over once the events stop, but a long one still recreates now and then
+    bool isResizeSettled() {
+        auto now = std::chrono::steady_clock::now();
+        return now - resizeLast >= RESIZE_SETTLE || now - resizeStart >= RESIZE_INTERVAL;
     }
 
     void updateUniformBuffer(uint32_t currentImage) {
+        CPU_ZONE("updateUniformBuffer");
         UniformBufferObject ubo{};
         ubo.deltaTime = lastFrameTime * 2.0f;
-
-        memcpy(uniformBuffersMapped[currentImage], &ubo, sizeof(ubo));
+        ubo.particleCount = particleCount;
+        ubo.seed = particleSeed;
+
+        // The emitters run on the frame clock, and each frame spawns from a new seed
+        if (particleLayout->isEmitting()) {
+            double seconds = lastFrameTime / 1000.0;
+            emitCount = particleEmitter->advance(seconds, particleLayout->getCapacity());
+            ubo.seed = particleSeed ^ static_cast<uint32_t>(frameSync->getFrame() * 2654435761u);
+            ubo.emitCount = emitCount;
+            ubo.emitterCount = ParticleEmitter::EMITTER_COUNT;
+            ubo.seconds = static_cast<float>(seconds);
+            ubo.lifeMin = particleEmitter->getLifeMin();
+            ubo.lifeMax = particleEmitter->getLifeMax();
+            particleEmitter->getPositions(ubo.emitters);
+        }
+
+        capture->writeBuffer(uniformBuffers[currentImage], uniformBuffersMapped[currentImage], 0, &ubo, sizeof(ubo));
     }
 
     void drawFrame() {
-        VkSubmitInfo submitInfo{};
-        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        CPU_ZONE("drawFrame");
 
-        // Compute submission        
-        vkWaitForFences(device, 1, &computeInFlightFences[currentFrame], VK_TRUE, UINT64_MAX);
+        // Between frames, every acquired image has been presented
+        if (swapchainOutOfDate || (framebufferResized && isResizeSettled())) {
+            recreateSwapChain();
+        }
 
-        updateUniformBuffer(currentFrame);
+        // A single wait on both timelines replaces the two fence waits
+        {
+            CPU_ZONE("beginFrame");
+            currentFrame = frameSync->beginFrame();
+        }
+        uint64_t frame = frameSync->getFrame();
+        currentBuffer = static_cast<uint32_t>(frame % PARTICLE_BUFFERS);
+        uint64_t completed = frameSync->getCompletedFrame();
+        presentPacer->beginFrame(completed, isPresentPaced());
+        swapchainRetirer->collect(completed);
+        deletionQueue->collect(completed);
+        gpuProfiler->beginFrame(currentFrame);
 
-        vkResetFences(device, 1, &computeInFlightFences[currentFrame]);
+        // Compute submission (one frame ahead of graphics, so the two overlap)
+        updateUniformBuffer(currentBuffer);
 
         vkResetCommandBuffer(computeCommandBuffers[currentFrame], /*VkCommandBufferResetFlagBits*/ 0);
         recordComputeCommandBuffer(computeCommandBuffers[currentFrame]);
 
-        submitInfo.commandBufferCount = 1;
-        submitInfo.pCommandBuffers = &computeCommandBuffers[currentFrame];
-        submitInfo.signalSemaphoreCount = 1;
-        submitInfo.pSignalSemaphores = &computeFinishedSemaphores[currentFrame];
+        // The output buffer was last drawn by the previous graphics frame
+        std::vector<FrameSync::Wait> computeWaits = {
+            { graphicsTimeline, frame - 1, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT }
+        };
+        frameSync->submit(computeTimeline, computeCommandBuffers[currentFrame], computeWaits);
+        capture->submit(computeCommandBuffers[currentFrame]);
 
-        if (vkQueueSubmit(computeQueue, 1, &submitInfo, computeInFlightFences[currentFrame]) != VK_SUCCESS) {
-            throw std::runtime_error("failed to submit compute command buffer!");
+        // Graphics submission, drawing what the previous compute frame released
+        std::vector<FrameSync::Wait> graphicsWaits = {
+            { computeTimeline, frame - 1, getDrawStages() }
         };
 
-        // Graphics submission
-        vkWaitForFences(device, 1, &inFlightFences[currentFrame], VK_TRUE, UINT64_MAX);
+        if (isHeadless()) {
+            // The slot is free, so its image is too, and there is nothing to acquire or present
+            vkResetCommandBuffer(commandBuffers[currentFrame], /*VkCommandBufferResetFlagBits*/ 0);
+            recordCommandBuffer(commandBuffers[currentFrame], currentFrame);
+            frameSync->submit(graphicsTimeline, commandBuffers[currentFrame], graphicsWaits);
+            capture->submit(commandBuffers[currentFrame]);
+            return;
+        }
 
         uint32_t imageIndex;
-        VkResult result = vkAcquireNextImageKHR(device, swapChain, UINT64_MAX, imageAvailableSemaphores[currentFrame], VK_NULL_HANDLE, &imageIndex);
-
-        if (result == VK_ERROR_OUT_OF_DATE_KHR || framebufferResized) {
-            recreateSwapChain();
+        VkResult result;
+        {
+            CPU_ZONE("vkAcquireNextImageKHR");
+            result = vkAcquireNextImageKHR(device, swapChain, UINT64_MAX, frameSync->getAcquireSemaphore(), VK_NULL_HANDLE, &imageIndex);
+        }
+
+        if (result == VK_ERROR_OUT_OF_DATE_KHR) {
+            // Nothing was acquired, so the next frame can recreate right away
+            swapchainOutOfDate = true;
+            vkResetCommandBuffer(commandBuffers[currentFrame], /*VkCommandBufferResetFlagBits*/ 0);
+            recordTransferCommandBuffer(commandBuffers[currentFrame]);
+            frameSync->submit(graphicsTimeline, commandBuffers[currentFrame], graphicsWaits);
+            capture->submit(commandBuffers[currentFrame]);
             return;
-        } else if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR) {
+        } else if (result == VK_SUBOPTIMAL_KHR) {
+            // Still presentable, so this is treated like any other resize
+            requestResize();
+        } else if (result != VK_SUCCESS) {
             throw std::runtime_error("failed to acquire swap chain image!");
         }
 
-        vkResetFences(device, 1, &inFlightFences[currentFrame]);
-
         vkResetCommandBuffer(commandBuffers[currentFrame], /*VkCommandBufferResetFlagBits*/ 0);
         recordCommandBuffer(commandBuffers[currentFrame], imageIndex);
 
-        VkSemaphore waitSemaphores[] = { computeFinishedSemaphores[currentFrame], imageAvailableSemaphores[currentFrame] };
-        VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
-        submitInfo = {};
-        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-
-        submitInfo.waitSemaphoreCount = 2;
-        submitInfo.pWaitSemaphores = waitSemaphores;
-        submitInfo.pWaitDstStageMask = waitStages;
-        submitInfo.commandBufferCount = 1;
-        submitInfo.pCommandBuffers = &commandBuffers[currentFrame];
-        submitInfo.signalSemaphoreCount = 1;
-        submitInfo.pSignalSemaphores = &renderFinishedSemaphores[imageIndex];
-
-        if (vkQueueSubmit(graphicsQueue, 1, &submitInfo, inFlightFences[currentFrame]) != VK_SUCCESS) {
-            throw std::runtime_error("failed to submit draw command buffer!");
-        }
+        frameSync->submitImage(graphicsTimeline, commandBuffers[currentFrame], graphicsWaits,
+                               VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, imageIndex);
+        capture->submit(commandBuffers[currentFrame]);
 
         VkPresentInfoKHR presentInfo{};
         presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
 
+        VkSemaphore renderFinished = frameSync->getPresentSemaphore(imageIndex);
         presentInfo.waitSemaphoreCount = 1;
-        presentInfo.pWaitSemaphores = &renderFinishedSemaphores[imageIndex];
+        presentInfo.pWaitSemaphores = &renderFinished;
 
         VkSwapchainKHR swapChains[] = {swapChain};
         presentInfo.swapchainCount = 1;
@@ -1307,16 +1889,20 @@ private:
 
         presentInfo.pImageIndices = &imageIndex;
 
-        result = vkQueuePresentKHR(presentQueue, &presentInfo);
+        swapchainRetirer->chain(presentInfo);
+        presentPacer->chain(presentInfo, frame);
+        {
+            CPU_ZONE("vkQueuePresentKHR");
+            result = vkQueuePresentKHR(presentQueue, &presentInfo);
+        }
 
-        if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR) {
-            framebufferResized = false;
-            recreateSwapChain();
+        if (result == VK_ERROR_OUT_OF_DATE_KHR) {
+            swapchainOutOfDate = true;
+        } else if (result == VK_SUBOPTIMAL_KHR) {
+            requestResize();
         } else if (result != VK_SUCCESS) {
             throw std::runtime_error("failed to present swap chain image!");
         }
-
-        currentFrame = (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
     }
 
     VkShaderModule createShaderModule(const std::vector<char>& code) {
@@ -1326,7 +1912,7 @@ private:
         createInfo.pCode = reinterpret_cast<const uint32_t*>(code.data());
 
         VkShaderModule shaderModule;
-        if (vkCreateShaderModule(device, &createInfo, nullptr, &shaderModule) != VK_SUCCESS) {
+        if (capture->createShaderModule(createInfo, &shaderModule) != VK_SUCCESS) {
             throw std::runtime_error("failed to create shader module!");
         }
 
@@ -1345,11 +1931,15 @@ private:
 
     VkPresentModeKHR chooseSwapPresentMode(const std::vector<VkPresentModeKHR>& availablePresentModes) {
         for (const auto& availablePresentMode : availablePresentModes) {
-            if (availablePresentMode == VK_PRESENT_MODE_MAILBOX_KHR) {
+            if (availablePresentMode == preferredPresentMode) {
                 return availablePresentMode;
             }
         }
 
+        // FIFO is the only mode every device must support
+        if (preferredPresentMode != VK_PRESENT_MODE_FIFO_KHR) {
+            SDL_Log("Present mode %s is not supported, using FIFO", PresentPacer::getModeName(preferredPresentMode));
+        }
         return VK_PRESENT_MODE_FIFO_KHR;
     }
 
@@ -1395,16 +1985,35 @@ private:
 
         bool extensionsSupported = checkDeviceExtensionSupport(device);
 
-        bool swapChainAdequate = false;
-        if (extensionsSupported) {
+        bool swapChainAdequate = isHeadless();
+        if (extensionsSupported && !isHeadless()) {
             SwapChainSupportDetails swapChainSupport = querySwapChainSupport(device);
             swapChainAdequate = !swapChainSupport.formats.empty() && !swapChainSupport.presentModes.empty();
         }
 
-        return indices.isComplete() && extensionsSupported && swapChainAdequate;
+        return indices.isComplete() && extensionsSupported && swapChainAdequate && FrameSync::isSupported(device);
+    }
+
+    bool hasDeviceExtension(VkPhysicalDevice device, const char* name) {
+        uint32_t extensionCount;
+        vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
+
+        std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+        vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, availableExtensions.data());
+
+        for (const auto& extension : availableExtensions) {
+            if (strcmp(extension.extensionName, name) == 0) {
+                return true;
+            }
+        }
+        return false;
     }
 
     bool checkDeviceExtensionSupport(VkPhysicalDevice device) {
+        if (isHeadless()) {
+            return true;
+        }
+
         uint32_t extensionCount;
         vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
 
@@ -1431,31 +2040,54 @@ private:
 
         int i = 0;
         for (const auto& queueFamily : queueFamilies) {
-            if ((queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) && (queueFamily.queueFlags & VK_QUEUE_COMPUTE_BIT)) {
-                indices.graphicsAndComputeFamily = i;
-            }
+            // Keep looking for a compute-only family after the others are found
+            if (!indices.isComplete()) {
+                if ((queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) && (queueFamily.queueFlags & VK_QUEUE_COMPUTE_BIT)) {
+                    indices.graphicsAndComputeFamily = i;
+                }
+
+                // Without a surface, the graphics family stands in for the present family
+                VkBool32 presentSupport = false;
+                if (isHeadless()) {
+                    presentSupport = (queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) ? VK_TRUE : VK_FALSE;
+                } else {
+                    vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &presentSupport);
+                }
 
-            VkBool32 presentSupport = false;
-            vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &presentSupport);
+                if (presentSupport) {
+                    indices.presentFamily = i;
+                }
+            }
 
-            if (presentSupport) {
-                indices.presentFamily = i;
+            if ((queueFamily.queueFlags & VK_QUEUE_COMPUTE_BIT) && !(queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT)) {
+                if (!indices.computeFamily.has_value()) {
+                    indices.computeFamily = i;
+                }
             }
 
-            if (indices.isComplete()) {
+            if (indices.isComplete() && indices.computeFamily.has_value()) {
                 break;
             }
 
             i++;
         }
 
+        // Without an async compute family, compute shares the graphics family
+        if (!indices.computeFamily.has_value()) {
+            indices.computeFamily = indices.graphicsAndComputeFamily;
+        }
+
         return indices;
     }
 
     std::vector<const char*> getRequiredExtensions() {
-        uint32_t extensionCount = 0;
-        const char * const *instance_extensions = SDL_Vulkan_GetInstanceExtensions(&extensionCount);
-        std::vector<const char*> extensions(instance_extensions,instance_extensions+extensionCount);
+        // Headless mode has no surface, so it needs none of the surface extensions
+        std::vector<const char*> extensions;
+        if (!isHeadless()) {
+            uint32_t extensionCount = 0;
+            const char * const *instance_extensions = SDL_Vulkan_GetInstanceExtensions(&extensionCount);
+            extensions.assign(instance_extensions,instance_extensions+extensionCount);
+        }
 
         if (enableValidationLayers) {
             extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
@@ -1521,6 +2153,7 @@ public:
     ~ComputeShaderApplication() { cleanup(); }
     
     bool setup() {
+        CPU_THREAD("main");
         // Set the basic metadata
         if (!SDL_SetAppMetadata("Compute Shader", "1.0.0","com.vulkan-tutorial.tutorial9")) {
             SDL_Log("Setup Error: %s\n", SDL_GetError());
@@ -1535,26 +2168,200 @@ public:
             return false;
         }
 
-        SDL_RaiseWindow(window);
+        if (window != NULL) {
+            SDL_RaiseWindow(window);
+        }
         return true;
     }
     
+    // Takes effect at the start of the next frame
+    void setPresentation(VkPresentModeKHR mode, uint32_t frames, uint32_t images) {
+        preferredPresentMode = mode;
+        framesInFlight = std::clamp(frames, 1u, static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT));
+        preferredImageCount = images;
+        presentationChanged = frameSync != nullptr;
+    }
+    
+    // Must be set before setup
+    void setProfiling(bool statistics, const std::string& trace, const std::string& cpuTrace) {
+        statisticsRequested = statistics;
+        tracePath = trace;
+        cpuTracePath = cpuTrace;
+    }
+    
+    // Must be set before setup (0 frames opens a window as usual)
+    void setHeadless(uint32_t frames, VkExtent2D extent, const std::string& screenshot) {
+        headlessFrames = frames;
+        headlessExtent = extent;
+        screenshotPath = screenshot;
+        if (frames > 0) {
+            setTimeSource([frame = 0u]() mutable { return ++frame * HEADLESS_FRAME_TIME / 1000.0; });
+        }
+    }
+
+    // Must be set before setup, and saves the given frames after skipping the first ones
+    void setCapture(const std::string& path, uint32_t skip, uint32_t frames) {
+        capturePath = path;
+        captureSkip = skip;
+        captureFrames = frames;
+    }
+
+    // Replaces the clock that animates the scene, which is read once per frame
+    void setTimeSource(std::function<double()> source) {
+        timeSource = std::move(source);
+    }
+
+    // Must be set before setup, and only applies to headless runs
+    void setBenchmark(const std::string& path, uint32_t warmup) {
+        benchPath = path;
+        benchReport = std::make_unique<BenchReport>("compute-particles", warmup);
+    }
+
+    // Must be set before setup (the draws are split evenly over the particles)
+    void setDispatch(bool direct, uint32_t draws) {
+        directDispatch = direct;
+        drawCount = std::max(draws, 1u);
+    }
+
+    // Must be set before setup, and the count is also the capacity of the buffers
+    void setParticles(ParticleLayout::Format format, uint32_t count) {
+        particleFormat = format;
+        particleCount = std::max(count, 1u);
+    }
+
+    // Simulates and draws fewer particles (or more, up to the capacity) from the next frame
+    void resizeParticles(uint32_t count) {
+        particleCount = std::clamp(count, 1u, particleLayout->getCapacity());
+        SDL_Log("Simulating %u particles", particleCount);
+    }
+
+    // Must be set before setup, and a rate of 0 keeps every particle alive
+    void setEmitter(float rate) {
+        emitRate = std::max(rate, 0.0f);
+    }
+
+    // Spawns fewer particles (or more) each second from the next frame, in the same pool
+    void scaleEmitter(float scale) {
+        particleEmitter->setRate(particleEmitter->getRate() * scale);
+        SDL_Log("Emitting %.0f particles per second", particleEmitter->getRate());
+    }
+
+    // Saves the benchmark results once the last headless frame is done
+    void writeBenchmark() {
+        vkDeviceWaitIdle(device);
+        gpuProfiler->finish();
+        for (const auto& average : gpuProfiler->getAverages()) {
+            benchReport->addGpuTime(average.queue + "/" + average.name, average.milliseconds);
+        }
+        if (memoryBudgetEnabled) {
+            benchReport->sampleDeviceMemory(physicalDevice);
+        }
+
+        VkPhysicalDeviceProperties props;
+        vkGetPhysicalDeviceProperties(physicalDevice, &props);
+        benchReport->setParameter("tutorial", "tutorial9");
+        benchReport->setParameter("device", props.deviceName);
+        benchReport->setParameter("width", windowExtent.width);
+        benchReport->setParameter("height", windowExtent.height);
+        benchReport->setParameter("particles", particleCount);
+        benchReport->setParameter("layout", ParticleLayout::getFormatName(particleFormat));
+        benchReport->setParameter("particle_bytes", static_cast<double>(particleLayout->getFrameBytes()));
+        benchReport->setParameter("emit_rate", static_cast<double>(particleEmitter != nullptr ? particleEmitter->getRate() : 0.0f));
+        benchReport->setParameter("draws", drawCount);
+        benchReport->setParameter("dispatch", directDispatch ? "direct" : "trampoline");
+        benchReport->write(benchPath);
+    }
+    
     bool consume(SDL_Event *event) {
         if (event->type == SDL_EVENT_QUIT) {
             return false;
         } else if (event->type == SDL_EVENT_WINDOW_RESIZED) {
-            framebufferResized = true;
+            requestResize();
             windowExtent.width  = event->window.data1;
             windowExtent.height = event->window.data2;
+        } else if (event->type == SDL_EVENT_KEY_DOWN && event->key.repeat == 0) {
+            // P cycles the present mode, F the frames in flight, I the swapchain images, and T saves a CPU trace
+            // The brackets halve and double the particles, up to the capacity (or the emit rate with emitters)
+            SDL_Keycode key = event->key.key;
+            if (key == SDLK_P) {
+                const VkPresentModeKHR modes[] = {
+                    VK_PRESENT_MODE_FIFO_KHR, VK_PRESENT_MODE_FIFO_RELAXED_KHR,
+                    VK_PRESENT_MODE_MAILBOX_KHR, VK_PRESENT_MODE_IMMEDIATE_KHR
+                };
+                size_t next = 0;
+                for (size_t ii = 0; ii < 4; ii++) {
+                    if (modes[ii] == presentMode) {
+                        next = (ii + 1) % 4;
+                    }
+                }
+                setPresentation(modes[next], framesInFlight, preferredImageCount);
+            } else if (key == SDLK_F) {
+                setPresentation(presentMode, framesInFlight % MAX_FRAMES_IN_FLIGHT + 1, preferredImageCount);
+            } else if (key == SDLK_I) {
+                uint32_t images = static_cast<uint32_t>(swapChainImages.size()) + 1;
+                setPresentation(presentMode, framesInFlight, images > 4 ? 2 : images);
+            } else if (key == SDLK_T) {
+                // Saves the CPU zones so far, without waiting for exit
+                CpuProfiler::writeTrace(cpuTracePath.empty() ? "cpu-trace.json" : cpuTracePath);
+            } else if (key == SDLK_LEFTBRACKET) {
+                if (particleEmitter != nullptr) {
+                    scaleEmitter(0.5f);
+                } else {
+                    resizeParticles(particleCount / 2);
+                }
+            } else if (key == SDLK_RIGHTBRACKET) {
+                if (particleEmitter != nullptr) {
+                    scaleEmitter(2.0f);
+                } else {
+                    resizeParticles(particleCount * 2);
+                }
+            }
         }
         return true;
     }
     
-    void run() {
+    // Returns false once a headless run has rendered all of its frames
+    bool run() {
+        if (presentationChanged) {
+            applyPresentation();
+        }
+        if (isHeadless() && headlessRendered == 0) {
+            headlessStart = SDL_GetTicks()/1000.0;
+        }
+        auto frameStart = std::chrono::steady_clock::now();
         drawFrame();
-        double currentTime = SDL_GetTicks()/1000.0;
+        capture->endFrame();
+        double currentTime = timeSource();
         lastFrameTime = (currentTime - lastTime) * 1000.0;
         lastTime = currentTime;
+        if (isHeadless()) {
+            headlessRendered++;
+            if (benchReport != nullptr) {
+                std::chrono::duration<double, std::milli> frameTime = std::chrono::steady_clock::now() - frameStart;
+                benchReport->addRecording(recordTime);
+                benchReport->addFrame(frameTime.count());
+                // The budget query is not free, so memory is only sampled twice a second of simulation
+                if (memoryBudgetEnabled && headlessRendered % 30 == 0) {
+                    benchReport->sampleDeviceMemory(physicalDevice);
+                }
+            }
+            if (headlessRendered < headlessFrames) {
+                return true;
+            }
+
+            double elapsed = SDL_GetTicks()/1000.0 - headlessStart;
+            SDL_Log("Rendered %u headless frames in %.3f s", headlessRendered, elapsed);
+            if (!screenshotPath.empty()) {
+                // The last frame already copied its image, so this only waits for that frame
+                vkDeviceWaitIdle(device);
+                offscreenTarget->saveReadback(screenshotPath);
+            }
+            if (benchReport != nullptr) {
+                writeBenchmark();
+            }
+            return false;
+        }
+        return true;
     }
 
     void wait() {
@@ -1567,6 +2374,98 @@ public:
 SDL_AppResult SDL_AppInit(void **appstate, int argc, char *argv[]) {
     ComputeShaderApplication* app = new ComputeShaderApplication();
     *appstate = app;
+
+    // Passing --present MODE, --frames N, or --images N sets the presentation policy
+    VkPresentModeKHR mode = VK_PRESENT_MODE_MAILBOX_KHR;
+    uint32_t frames = 2;
+    uint32_t images = 0;
+    // Passing --gpu-stats gathers pipeline statistics, and --gpu-trace FILE or --cpu-trace FILE saves a trace
+    bool statistics = false;
+    std::string trace;
+    std::string cpuTrace;
+    // Passing --headless FRAMES (or setting VULKANSDL_HEADLESS=FRAMES) renders offscreen, and --screenshot FILE saves the last frame
+    uint32_t headless = 0;
+    std::string screenshot;
+    VkExtent2D size = {WIDTH, HEIGHT};
+    // Passing --bench FILE saves the frame times of a headless run, after --warmup N frames
+    std::string bench;
+    uint32_t warmup = 60;
+    // Passing --capture FILE saves --capture-frames N frames for the replay tool, after --capture-skip K frames
+    std::string capturePath;
+    uint32_t captureFrames = 1;
+    uint32_t captureSkip = 0;
+    // Passing --draws N splits the particle draw into N calls, and --trampolines calls the device through the loader
+    uint32_t draws = 1;
+    bool direct = true;
+    // Passing --particles N sets the particle count (up to 10M), and --layout aos|soa|half how they are stored
+    uint32_t particles = PARTICLE_COUNT;
+    ParticleLayout::Format layout = ParticleLayout::Format::SOA;
+    // Passing --emit RATE spawns RATE particles a second that live a few seconds, in a pool of --particles N
+    float emit = 0.0f;
+    const char* headlessEnv = SDL_getenv("VULKANSDL_HEADLESS");
+    if (headlessEnv != nullptr) {
+        headless = static_cast<uint32_t>(strtoul(headlessEnv, nullptr, 10));
+    }
+    for (int ii = 1; ii < argc; ii++) {
+        if (strcmp(argv[ii], "--gpu-stats") == 0) {
+            statistics = true;
+        } else if (strcmp(argv[ii], "--trampolines") == 0) {
+            direct = false;
+        } else if (ii+1 == argc) {
+            break;
+        } else if (strcmp(argv[ii], "--gpu-trace") == 0) {
+            trace = argv[ii+1];
+        } else if (strcmp(argv[ii], "--cpu-trace") == 0) {
+            cpuTrace = argv[ii+1];
+        } else if (strcmp(argv[ii], "--present") == 0 && !PresentPacer::parseMode(argv[ii+1], mode)) {
+            SDL_Log("Unknown present mode %s", argv[ii+1]);
+        } else if (strcmp(argv[ii], "--frames") == 0) {
+            frames = static_cast<uint32_t>(strtoul(argv[ii+1], nullptr, 10));
+        } else if (strcmp(argv[ii], "--images") == 0) {
+            images = static_cast<uint32_t>(strtoul(argv[ii+1], nullptr, 10));
+        } else if (strcmp(argv[ii], "--headless") == 0) {
+            headless = static_cast<uint32_t>(strtoul(argv[ii+1], nullptr, 10));
+        } else if (strcmp(argv[ii], "--screenshot") == 0) {
+            screenshot = argv[ii+1];
+        } else if (strcmp(argv[ii], "--size") == 0 && SDL_sscanf(argv[ii+1], "%ux%u", &size.width, &size.height) != 2) {
+            SDL_Log("Unknown size %s", argv[ii+1]);
+        } else if (strcmp(argv[ii], "--bench") == 0) {
+            bench = argv[ii+1];
+        } else if (strcmp(argv[ii], "--warmup") == 0) {
+            warmup = static_cast<uint32_t>(strtoul(argv[ii+1], nullptr, 10));
+        } else if (strcmp(argv[ii], "--capture") == 0) {
+            capturePath = argv[ii+1];
+        } else if (strcmp(argv[ii], "--capture-frames") == 0) {
+            captureFrames = static_cast<uint32_t>(strtoul(argv[ii+1], nullptr, 10));
+        } else if (strcmp(argv[ii], "--capture-skip") == 0) {
+            captureSkip = static_cast<uint32_t>(strtoul(argv[ii+1], nullptr, 10));
+        } else if (strcmp(argv[ii], "--draws") == 0) {
+            draws = static_cast<uint32_t>(strtoul(argv[ii+1], nullptr, 10));
+        } else if (strcmp(argv[ii], "--particles") == 0) {
+            particles = static_cast<uint32_t>(strtoul(argv[ii+1], nullptr, 10));
+        } else if (strcmp(argv[ii], "--layout") == 0 && !ParticleLayout::parseFormat(argv[ii+1], layout)) {
+            SDL_Log("Unknown particle layout %s", argv[ii+1]);
+        } else if (strcmp(argv[ii], "--emit") == 0) {
+            emit = strtof(argv[ii+1], nullptr);
+        }
+    }
+    if (!screenshot.empty() && headless == 0) {
+        SDL_Log("Screenshots are only saved in headless mode");
+    }
+    if (!bench.empty() && headless == 0) {
+        SDL_Log("Benchmarks are only run in headless mode");
+    }
+    app->setPresentation(mode, frames, images);
+    app->setProfiling(statistics, trace, cpuTrace);
+    app->setHeadless(headless, size, screenshot);
+    if (!bench.empty() && headless > 0) {
+        app->setBenchmark(bench, warmup);
+    }
+    app->setCapture(capturePath, captureSkip, captureFrames);
+    app->setDispatch(direct, draws);
+    app->setParticles(layout, particles);
+    app->setEmitter(emit);
+
     if (app->setup()) {
         return SDL_APP_CONTINUE;
     }
@@ -1576,7 +2475,9 @@ SDL_AppResult SDL_AppInit(void **appstate, int argc, char *argv[]) {
 SDL_AppResult SDL_AppIterate(void *appstate) {
     ComputeShaderApplication* app = (ComputeShaderApplication*)appstate;
     try {
-        app->run();
+        if (!app->run()) {
+            return SDL_APP_SUCCESS;
+        }
     } catch (const std::exception& e) {
         std::cerr << e.what() << std::endl;
         return SDL_APP_FAILURE;
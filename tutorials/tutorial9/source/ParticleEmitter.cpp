@@ -0,0 +1,103 @@
+//
+//  ParticleEmitter.cpp
+//  Tutorial9
+//
+//  The CPU side of the particle emitters. The particles are spawned, simulated,
+//  and killed entirely on the GPU, but something has to decide how many to
+//  spawn each frame, and where. That is a rate and a clock, so it stays on the
+//  CPU, and is passed to the compute shaders in the uniform buffer. The CPU
+//  never needs to know how many particles are alive, so it never reads back.
+//
+//  The emitters orbit the center of the window, so that the spawned particles
+//  trail behind them. Each particle lives for a random time in a fixed range.
+//
+//  Version: 10/18/26
+//
+#include "ParticleEmitter.h"
+#include <algorithm>
+#include <cmath>
+
+/** The radius of the orbit, in normalized device coordinates */
+static const float ORBIT_RADIUS = 0.5f;
+/** The angle the emitters turn each second */
+static const float ORBIT_SPEED = 0.75f;
+/** A full turn */
+static const float TWO_PI = 6.28318530717958647692f;
+
+/**
+ * Creates emitters with the given rate and lifetimes
+ *
+ * @param rate      The particles spawned per second
+ * @param lifeMin   The shortest lifetime in seconds
+ * @param lifeMax   The longest lifetime in seconds
+ * @param aspect    The ratio of the window height to its width
+ */
+ParticleEmitter::ParticleEmitter(float rate, float lifeMin, float lifeMax, float aspect) :
+    rate(std::max(rate, 0.0f)),
+    lifeMin(lifeMin),
+    lifeMax(std::max(lifeMin, lifeMax)),
+    aspect(aspect),
+    elapsed(0.0),
+    fraction(0.0) {
+}
+
+/**
+ * Sets the particles spawned per second
+ *
+ * @param rate  The particles spawned per second
+ */
+void ParticleEmitter::setRate(float rate) {
+    this->rate = std::max(rate, 0.0f);
+}
+
+/**
+ * Returns the most particles that can be alive at once
+ *
+ * Once the pool is this large, no spawn is ever dropped.
+ *
+ * @return the most particles that can be alive at once
+ */
+uint32_t ParticleEmitter::getPeakCount() const {
+    return static_cast<uint32_t>(std::ceil(static_cast<double>(rate) * lifeMax));
+}
+
+/**
+ * Advances the emitters, returning the particles to spawn this frame
+ *
+ * The count is clamped to the capacity, as there can be no more free
+ * particles than that. The shader also stops when the pool runs out.
+ *
+ * @param seconds   The seconds since the last frame
+ * @param capacity  The number of particles in the pool
+ *
+ * @return the particles to spawn this frame
+ */
+uint32_t ParticleEmitter::advance(double seconds, uint32_t capacity) {
+    elapsed += seconds;
+    fraction += rate * seconds;
+
+    // A long stall would otherwise spawn a burst, so anything past the capacity is dropped
+    double whole = std::floor(fraction);
+    fraction -= whole;
+    if (whole >= capacity) {
+        return capacity;
+    }
+    return static_cast<uint32_t>(whole);
+}
+
+/**
+ * Stores the position of each emitter, in normalized device coordinates
+ *
+ * The array must have room for {@link EMITTER_COUNT} positions. Only x
+ * and y are used, as the uniform buffer pads each position to a vec4.
+ *
+ * @param positions The positions to set
+ */
+void ParticleEmitter::getPositions(glm::vec4* positions) const {
+    // The angle wraps, so that a long run does not lose float precision
+    double turn = std::fmod(elapsed * ORBIT_SPEED, static_cast<double>(TWO_PI));
+    for (uint32_t ii = 0; ii < EMITTER_COUNT; ii++) {
+        float angle = static_cast<float>(turn) + TWO_PI * ii / EMITTER_COUNT;
+        positions[ii] = glm::vec4(ORBIT_RADIUS * std::cos(angle) * aspect, ORBIT_RADIUS * std::sin(angle), 0.0f, 0.0f);
+    }
+}
@@ -0,0 +1,340 @@
+//
+//  ParticleLayout.h
+//  Tutorial9
+//
+//  The memory layout of the particles. The tutorial stores each particle as a
+//  48 byte std140 struct, of which the simulation only needs the position and
+//  the velocity. Every frame reads and writes the whole struct anyway, and the
+//  vertex fetch skips over it, so most of the bandwidth moves padding.
+//
+//  So the particles can instead be stored as a structure of arrays. Each
+//  attribute is its own std430 array, packed end to end in the same buffer,
+//  and bound as its own storage buffer. The colors never change, so they are
+//  not simulated at all. They live in a separate buffer shared by every frame.
+//  The half precision layout also packs the velocity and the color with
+//  packHalf2x16, which halves them again. The positions stay at full
+//  precision, as the small steps of the simulation would round away in half.
+//
+//  The original layout is kept to benchmark against, and each layout has its
+//  own variants of the compute shaders (compiled by compile.sh).
+//
+//  With emitters, the particles also spawn and die. Each buffer of the ring
+//  then ends with a list of the particles alive in it, headed by the draw
+//  arguments of that list. A pool buffer only used by compute holds the
+//  lifetimes and the dead list, headed by the workgroups of the simulation.
+//  So the dispatch and the draw are both indirect, and the CPU never reads
+//  back a count.
+//
+//  Version: 10/18/26
+//
+#ifndef __PARTICLE_LAYOUT_H__
+#define __PARTICLE_LAYOUT_H__
+#include "VulkanLoader.h"
+#include <string>
+#include <vector>
+#include <cstdint>
+
+/**
+ * The layout of the particle buffers, for a fixed capacity.
+ *
+ * The simulated attributes are stored in a ring of buffers (one written by
+ * compute while the others are read), while the shared attributes are stored
+ * once. The descriptor set has the uniform buffer at binding 0, followed by
+ * the simulated arrays of the input buffer, the same arrays of the output
+ * buffer, and then the shared arrays. The original layout has a single array
+ * of structs and nothing shared, so its bindings are the same as before.
+ *
+ * The capacity is rounded up to a whole workgroup, so that every array
+ * starts at an offset aligned for a storage buffer descriptor.
+ *
+ * With emitters, the lists are bound after the arrays, starting at
+ * {@link LIST_BINDING}: the alive list of the input buffer, the alive list
+ * of the output buffer, the pool, and the lifetimes.
+ */
+class ParticleLayout {
+public:
+    /** The particle storage */
+    enum class Format {
+        /** An array of 48 byte std140 structs (the original layout) */
+        AOS,
+        /** A std430 array per attribute */
+        SOA,
+        /** A std430 array per attribute, with half precision velocity and color */
+        HALF
+    };
+
+    /** The local size of the compute shaders */
+    static const uint32_t WORKGROUP_SIZE = 256;
+    /** The largest supported capacity */
+    static const uint32_t MAX_PARTICLES = 10000000;
+    /** The first binding of the lists, which is the same in every layout */
+    static const uint32_t LIST_BINDING = 8;
+    /** The size of the header of a list (the draw or dispatch arguments, padded) */
+    static const VkDeviceSize LIST_HEADER = 32;
+
+private:
+    /** An array of a single attribute (or of the whole struct) */
+    struct Stream {
+        /** The size of an element in bytes */
+        VkDeviceSize stride;
+        /** The offset of the array in its buffer */
+        VkDeviceSize offset;
+    };
+
+    /** The particle storage */
+    Format format;
+    /** The number of particles the buffers hold */
+    uint32_t capacity;
+    /** The simulated arrays, stored in each buffer of the ring */
+    std::vector<Stream> streams;
+    /** The shared arrays, stored once */
+    std::vector<Stream> shared;
+    /** The size of a ring buffer */
+    VkDeviceSize bufferSize;
+    /** The size of the shared buffer (0 if there is nothing shared) */
+    VkDeviceSize sharedSize;
+    /** Whether the particles spawn and die */
+    bool emitting;
+    /** The offset of the alive list in each ring buffer */
+    VkDeviceSize listOffset;
+    /** The size of the pool buffer (0 without emitters) */
+    VkDeviceSize poolSize;
+
+    /**
+     * Returns the bytes of each particle in the given arrays
+     *
+     * @param format    The particle storage
+     * @param simulated Whether to count the simulated (or the shared) arrays
+     *
+     * @return the bytes of each particle in the given arrays
+     */
+    static std::vector<VkDeviceSize> getStrides(Format format, bool simulated);
+
+public:
+    /**
+     * Creates the layout of the given number of particles
+     *
+     * The capacity is rounded up to a whole workgroup, and clamped to
+     * {@link MAX_PARTICLES}. With emitters, the capacity is the size of the
+     * pool rather than the number of particles alive.
+     *
+     * @param format    The particle storage
+     * @param capacity  The number of particles
+     * @param emitting  Whether the particles spawn and die
+     */
+    ParticleLayout(Format format, uint32_t capacity, bool emitting);
+
+    /**
+     * Returns true if the name is a particle format, storing it in format
+     *
+     * The names are "aos", "soa", and "half".
+     *
+     * @param name      The format name
+     * @param format    The format to set
+     *
+     * @return true if the name is a particle format
+     */
+    static bool parseFormat(const std::string& name, Format& format);
+
+    /**
+     * Returns the name of the given format
+     *
+     * @param format    The particle storage
+     *
+     * @return the name of the given format
+     */
+    static const char* getFormatName(Format format);
+
+    /**
+     * Returns the largest capacity that each array can be bound with
+     *
+     * A storage buffer descriptor is only guaranteed 128 MB, so the largest
+     * array limits the capacity, well before the memory runs out. This is
+     * also clamped to {@link MAX_PARTICLES}.
+     *
+     * @param format    The particle storage
+     * @param maxRange  The device limit maxStorageBufferRange
+     *
+     * @return the largest capacity that each array can be bound with
+     */
+    static uint32_t getMaxCapacity(Format format, VkDeviceSize maxRange);
+
+    /**
+     * Returns the number of workgroups to process the given particles
+     *
+     * The last workgroup may be partial, so the shaders check the index
+     * against the particle count.
+     *
+     * @param count The number of particles
+     *
+     * @return the number of workgroups to process the given particles
+     */
+    static uint32_t getGroupCount(uint32_t count) {
+        return (count + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE;
+    }
+
+    /**
+     * Returns the particle storage
+     *
+     * @return the particle storage
+     */
+    Format getFormat() const { return format; }
+
+    /**
+     * Returns the number of particles the buffers hold
+     *
+     * @return the number of particles the buffers hold
+     */
+    uint32_t getCapacity() const { return capacity; }
+
+    /**
+     * Returns the size of each buffer of the ring
+     *
+     * @return the size of each buffer of the ring
+     */
+    VkDeviceSize getBufferSize() const { return bufferSize; }
+
+    /**
+     * Returns the size of the shared buffer (0 if there is nothing shared)
+     *
+     * @return the size of the shared buffer
+     */
+    VkDeviceSize getSharedSize() const { return sharedSize; }
+
+    /**
+     * Returns true if the particles spawn and die
+     *
+     * @return true if the particles spawn and die
+     */
+    bool isEmitting() const { return emitting; }
+
+    /**
+     * Returns the size of the pool buffer (0 without emitters)
+     *
+     * @return the size of the pool buffer
+     */
+    VkDeviceSize getPoolSize() const { return poolSize; }
+
+    /**
+     * Returns the offset of the draw arguments in each ring buffer
+     *
+     * The arguments are a VkDrawIndexedIndirectCommand, whose index count
+     * is the number of particles alive.
+     *
+     * @return the offset of the draw arguments in each ring buffer
+     */
+    VkDeviceSize getDrawOffset() const { return listOffset; }
+
+    /**
+     * Returns the offset of the alive list in each ring buffer
+     *
+     * The alive list is drawn as an index buffer of 32-bit indices.
+     *
+     * @return the offset of the alive list in each ring buffer
+     */
+    VkDeviceSize getIndexOffset() const { return listOffset + LIST_HEADER; }
+
+    /**
+     * Returns the offset of the simulation workgroups in the pool buffer
+     *
+     * The workgroups are a VkDispatchIndirectCommand.
+     *
+     * @return the offset of the simulation workgroups in the pool buffer
+     */
+    VkDeviceSize getDispatchOffset() const;
+
+    /**
+     * Returns the bytes a frame reads and writes for each particle
+     *
+     * This counts the simulated arrays read and written by compute, plus
+     * the position and color read by the vertex fetch.
+     *
+     * @return the bytes a frame reads and writes for each particle
+     */
+    VkDeviceSize getFrameBytes() const;
+
+    /**
+     * Returns the name of the simulation shader
+     *
+     * @return the name of the simulation shader
+     */
+    std::string getComputeShader() const;
+
+    /**
+     * Returns the name of the shader that sets the initial particles
+     *
+     * @return the name of the shader that sets the initial particles
+     */
+    std::string getInitShader() const;
+
+    /**
+     * Returns the name of the shader that spawns particles
+     *
+     * @return the name of the shader that spawns particles
+     */
+    std::string getEmitShader() const;
+
+    /**
+     * Returns the name of the shader that sets up the lists of a frame
+     *
+     * This shader is the same in every layout.
+     *
+     * @return the name of the shader that sets up the lists of a frame
+     */
+    std::string getPrepareShader() const;
+
+    /**
+     * Returns the storage buffer bindings, after the uniform buffer
+     *
+     * The bindings are not contiguous with emitters, as the lists start at
+     * {@link LIST_BINDING}.
+     *
+     * @return the storage buffer bindings
+     */
+    std::vector<VkDescriptorSetLayoutBinding> getStorageBindings() const;
+
+    /**
+     * Returns the storage buffer descriptors, in the order of the bindings
+     *
+     * @param input     The ring buffer the simulation reads
+     * @param output    The ring buffer the simulation writes
+     * @param shared    The shared buffer (ignored if there is nothing shared)
+     * @param pool      The pool buffer (ignored without emitters)
+     *
+     * @return the storage buffer descriptors
+     */
+    std::vector<VkDescriptorBufferInfo> getStorageInfos(VkBuffer input, VkBuffer output, VkBuffer shared, VkBuffer pool) const;
+
+    /**
+     * Returns the vertex buffer bindings of the graphics pipeline
+     *
+     * @return the vertex buffer bindings of the graphics pipeline
+     */
+    std::vector<VkVertexInputBindingDescription> getVertexBindings() const;
+
+    /**
+     * Returns the vertex attributes of the graphics pipeline
+     *
+     * The position is location 0 and the color is location 1, as vec2 and
+     * vec4 in every layout.
+     *
+     * @return the vertex attributes of the graphics pipeline
+     */
+    std::vector<VkVertexInputAttributeDescription> getVertexAttributes() const;
+
+    /**
+     * Stores the vertex buffers and offsets to draw, returning their number
+     *
+     * The arrays must have room for two buffers.
+     *
+     * @param buffer    The ring buffer to draw
+     * @param shared    The shared buffer (ignored if there is nothing shared)
+     * @param buffers   The vertex buffers to bind
+     * @param offsets   The offset of each vertex buffer
+     *
+     * @return the number of vertex buffers
+     */
+    uint32_t getVertexBuffers(VkBuffer buffer, VkBuffer shared, VkBuffer* buffers, VkDeviceSize* offsets) const;
+};
+
+#endif /* __PARTICLE_LAYOUT_H__ */
@@ -0,0 +1,253 @@
+//
+//  PresentPacer.cpp
+//  Tutorial9
+//
+//  Presentation pacing and latency metrics. Frames in flight bound how far
+//  the CPU can run ahead of the GPU, but not how far the GPU can run ahead of
+//  the display. In FIFO mode, finished images queue up behind the vsync, and
+//  input is displayed several refreshes after it was read.
+//
+//  When the device has VK_KHR_present_id and VK_KHR_present_wait, every
+//  present is tagged with its frame number, and the CPU can wait for the
+//  previous frame to reach the display before it starts on the next one.
+//  That bounds the latency to a single queued frame. Without them, there is
+//  nothing to wait on, and the frames in flight are the only bound.
+//
+//  Either way, this class measures the time from the start of a frame on the
+//  CPU to its present (or to its completion on the GPU, as a lower bound if
+//  presents cannot be observed), and counts the refreshes that were missed
+//  between frames. The averages are logged once a second.
+//
+//  Version: 10/18/26
+//
+#include "PresentPacer.h"
+#include <SDL3/SDL.h>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+/**
+ * Creates a pacer for the given device
+ *
+ * If presentWait is true, the device must have been created with the
+ * presentId and presentWait features.
+ *
+ * @param device        The logical device
+ * @param presentWait   Whether to use VK_KHR_present_wait
+ * @param refreshRate   The display refresh rate in Hz (0 if unknown)
+ */
+PresentPacer::PresentPacer(VkDevice device, bool presentWait, float refreshRate) :
+    device(device),
+    swapchain(VK_NULL_HANDLE),
+    waitForPresent(nullptr),
+    refreshPeriod(refreshRate > 0 ? 1000.0 / refreshRate : 0.0),
+    presentValue(0),
+    presentId{},
+    latencyTime(0),
+    latencySamples(0),
+    frameCount(0),
+    missedVsyncs(0) {
+    if (presentWait) {
+        waitForPresent = (PFN_vkWaitForPresentKHR) vkGetDeviceProcAddr(device, "vkWaitForPresentKHR");
+    }
+    if (waitForPresent == nullptr) {
+        SDL_Log("Present wait is not available; latency is only bounded by the frames in flight");
+    }
+    lastLog = std::chrono::steady_clock::now();
+}
+
+/**
+ * Returns true if the device supports VK_KHR_present_id and VK_KHR_present_wait
+ *
+ * @param device    The physical device
+ *
+ * @return true if the device supports VK_KHR_present_id and VK_KHR_present_wait
+ */
+bool PresentPacer::isSupported(VkPhysicalDevice device) {
+    uint32_t extensionCount;
+    vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
+
+    std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+    vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, availableExtensions.data());
+
+    bool presentIdFound = false;
+    bool presentWaitFound = false;
+    for (const auto& extension : availableExtensions) {
+        presentIdFound = presentIdFound || strcmp(extension.extensionName, VK_KHR_PRESENT_ID_EXTENSION_NAME) == 0;
+        presentWaitFound = presentWaitFound || strcmp(extension.extensionName, VK_KHR_PRESENT_WAIT_EXTENSION_NAME) == 0;
+    }
+    if (!presentIdFound || !presentWaitFound) {
+        return false;
+    }
+
+    VkPhysicalDevicePresentWaitFeaturesKHR waitFeatures{};
+    waitFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_WAIT_FEATURES_KHR;
+
+    VkPhysicalDevicePresentIdFeaturesKHR idFeatures{};
+    idFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_ID_FEATURES_KHR;
+    idFeatures.pNext = &waitFeatures;
+
+    VkPhysicalDeviceFeatures2 features{};
+    features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    features.pNext = &idFeatures;
+    vkGetPhysicalDeviceFeatures2(device, &features);
+
+    return idFeatures.presentId == VK_TRUE && waitFeatures.presentWait == VK_TRUE;
+}
+
+/**
+ * Returns the name of a present mode, for logging
+ *
+ * @param mode  The present mode
+ *
+ * @return the name of a present mode, for logging
+ */
+const char* PresentPacer::getModeName(VkPresentModeKHR mode) {
+    switch (mode) {
+        case VK_PRESENT_MODE_IMMEDIATE_KHR:
+            return "IMMEDIATE";
+        case VK_PRESENT_MODE_MAILBOX_KHR:
+            return "MAILBOX";
+        case VK_PRESENT_MODE_FIFO_KHR:
+            return "FIFO";
+        case VK_PRESENT_MODE_FIFO_RELAXED_KHR:
+            return "FIFO_RELAXED";
+        default:
+            return "UNKNOWN";
+    }
+}
+
+/**
+ * Parses the name of a present mode, ignoring case.
+ *
+ * This accepts the names of {@link getModeName}, and "relaxed" as a short
+ * form of FIFO_RELAXED.
+ *
+ * @param name  The name to parse
+ * @param mode  The present mode to set on success
+ *
+ * @return true if the name is a present mode
+ */
+bool PresentPacer::parseMode(const char* name, VkPresentModeKHR& mode) {
+    const VkPresentModeKHR modes[] = {
+        VK_PRESENT_MODE_IMMEDIATE_KHR, VK_PRESENT_MODE_MAILBOX_KHR,
+        VK_PRESENT_MODE_FIFO_KHR, VK_PRESENT_MODE_FIFO_RELAXED_KHR
+    };
+    for (VkPresentModeKHR candidate : modes) {
+        if (SDL_strcasecmp(name, getModeName(candidate)) == 0) {
+            mode = candidate;
+            return true;
+        }
+    }
+    if (SDL_strcasecmp(name, "relaxed") == 0) {
+        mode = VK_PRESENT_MODE_FIFO_RELAXED_KHR;
+        return true;
+    }
+    return false;
+}
+
+/**
+ * Switches to a new swapchain.
+ *
+ * Presents to the old swapchain can no longer be waited on, so the frames
+ * still pending are dropped from the metrics.
+ *
+ * @param swapchain The new swapchain
+ */
+void PresentPacer::resetSwapchain(VkSwapchainKHR swapchain) {
+    this->swapchain = swapchain;
+    pending.clear();
+    // The recreation stall is not a missed vsync
+    lastStart = std::chrono::steady_clock::time_point();
+}
+
+/**
+ * Starts the CPU work of a frame.
+ *
+ * If pace is true and presents can be waited on, this first blocks until
+ * the previous present reaches the display (or a refresh has clearly been
+ * missed). Pacing only makes sense for the FIFO modes, as MAILBOX and
+ * IMMEDIATE never queue images behind the vsync.
+ *
+ * @param completed The last frame that finished on the GPU
+ * @param pace      Whether to wait on the previous present
+ */
+void PresentPacer::beginFrame(uint64_t completed, bool pace) {
+    if (pace && waitForPresent != nullptr && !pending.empty()) {
+        // Give up after two refreshes, so a hidden window cannot stall the loop
+        double timeout = refreshPeriod > 0 ? 2 * refreshPeriod : 100.0;
+        waitForPresent(device, swapchain, pending.back().frame, static_cast<uint64_t>(timeout * 1000000.0));
+    }
+    collect(completed);
+
+    auto now = std::chrono::steady_clock::now();
+    if (refreshPeriod > 0 && lastStart != std::chrono::steady_clock::time_point()) {
+        double interval = std::chrono::duration<double, std::milli>(now - lastStart).count();
+        long refreshes = std::lround(interval / refreshPeriod);
+        missedVsyncs += refreshes > 1 ? static_cast<uint32_t>(refreshes - 1) : 0;
+    }
+    lastStart = now;
+    frameCount++;
+
+    if (now - lastLog >= std::chrono::seconds(1)) {
+        if (latencySamples > 0) {
+            SDL_Log("Present latency %.2f ms (to %s), %u missed vsyncs in %u frames",
+                    latencyTime / latencySamples, waitForPresent != nullptr ? "display" : "GPU completion",
+                    missedVsyncs, frameCount);
+        }
+        latencyTime = 0;
+        latencySamples = 0;
+        frameCount = 0;
+        missedVsyncs = 0;
+        lastLog = now;
+    }
+}
+
+/**
+ * Tags a present with the given frame number.
+ *
+ * The present info must be submitted before the next call to this method.
+ * If presents cannot be waited on, this only records the frame for the metrics.
+ *
+ * @param info  The present info for a single swapchain
+ * @param frame The frame number
+ */
+void PresentPacer::chain(VkPresentInfoKHR& info, uint64_t frame) {
+    pending.push_back({ frame, lastStart });
+    if (waitForPresent == nullptr) {
+        return;
+    }
+
+    presentValue = frame;
+    presentId = {};
+    presentId.sType = VK_STRUCTURE_TYPE_PRESENT_ID_KHR;
+    presentId.pNext = info.pNext;
+    presentId.swapchainCount = 1;
+    presentId.pPresentIds = &presentValue;
+    info.pNext = &presentId;
+}
+
+/**
+ * Records the latency of every pending frame that has been presented
+ *
+ * @param completed The last frame that finished on the GPU
+ */
+void PresentPacer::collect(uint64_t completed) {
+    auto now = std::chrono::steady_clock::now();
+    while (!pending.empty()) {
+        const Pending& next = pending.front();
+        if (waitForPresent != nullptr) {
+            // A zero timeout polls, and presents complete in order
+            VkResult result = waitForPresent(device, swapchain, next.frame, 0);
+            if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR) {
+                break;
+            }
+        } else if (next.frame > completed) {
+            break;
+        }
+
+        latencyTime += std::chrono::duration<double, std::milli>(now - next.start).count();
+        latencySamples++;
+        pending.pop_front();
+    }
+}
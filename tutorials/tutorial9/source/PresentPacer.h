@@ -0,0 +1,168 @@
+//
+//  PresentPacer.h
+//  Tutorial9
+//
+//  Presentation pacing and latency metrics. Frames in flight bound how far
+//  the CPU can run ahead of the GPU, but not how far the GPU can run ahead of
+//  the display. In FIFO mode, finished images queue up behind the vsync, and
+//  input is displayed several refreshes after it was read.
+//
+//  When the device has VK_KHR_present_id and VK_KHR_present_wait, every
+//  present is tagged with its frame number, and the CPU can wait for the
+//  previous frame to reach the display before it starts on the next one.
+//  That bounds the latency to a single queued frame. Without them, there is
+//  nothing to wait on, and the frames in flight are the only bound.
+//
+//  Either way, this class measures the time from the start of a frame on the
+//  CPU to its present (or to its completion on the GPU, as a lower bound if
+//  presents cannot be observed), and counts the refreshes that were missed
+//  between frames. The averages are logged once a second.
+//
+//  Version: 10/18/26
+//
+#ifndef __PRESENT_PACER_H__
+#define __PRESENT_PACER_H__
+#include "VulkanLoader.h"
+#include <chrono>
+#include <deque>
+#include <cstdint>
+
+/**
+ * A present-wait throttle, with latency and missed-vsync counters.
+ *
+ * Present ids are the frame numbers of {@link FrameSync}, which only ever
+ * increase, even across swapchains. Frames that are never presented simply
+ * leave a gap in the ids.
+ */
+class PresentPacer {
+private:
+    /** A frame that has started, but has not been seen on the display */
+    struct Pending {
+        /** The frame number (and present id) */
+        uint64_t frame;
+        /** The time the CPU started the frame */
+        std::chrono::steady_clock::time_point start;
+    };
+
+    /** The logical device */
+    VkDevice device;
+    /** The current swapchain */
+    VkSwapchainKHR swapchain;
+    /** The present wait function (nullptr if present wait is not enabled) */
+    PFN_vkWaitForPresentKHR waitForPresent;
+    /** The display refresh period in milliseconds (0 if unknown) */
+    double refreshPeriod;
+
+    /** The frames not yet presented, oldest first */
+    std::deque<Pending> pending;
+    /** The present id attached to the next present */
+    uint64_t presentValue;
+    VkPresentIdKHR presentId;
+
+    /** The start of the previous frame */
+    std::chrono::steady_clock::time_point lastStart;
+    /** The accumulated metrics since the last log */
+    double latencyTime;
+    uint32_t latencySamples;
+    uint32_t frameCount;
+    uint32_t missedVsyncs;
+    /** The time of the last log */
+    std::chrono::steady_clock::time_point lastLog;
+
+    /**
+     * Records the latency of every pending frame that has been presented
+     *
+     * @param completed The last frame that finished on the GPU
+     */
+    void collect(uint64_t completed);
+
+public:
+    /**
+     * Creates a pacer for the given device
+     *
+     * If presentWait is true, the device must have been created with the
+     * presentId and presentWait features.
+     *
+     * @param device        The logical device
+     * @param presentWait   Whether to use VK_KHR_present_wait
+     * @param refreshRate   The display refresh rate in Hz (0 if unknown)
+     */
+    PresentPacer(VkDevice device, bool presentWait, float refreshRate);
+
+    PresentPacer(const PresentPacer&) = delete;
+    PresentPacer& operator=(const PresentPacer&) = delete;
+
+    /**
+     * Returns true if the device supports VK_KHR_present_id and VK_KHR_present_wait
+     *
+     * @param device    The physical device
+     *
+     * @return true if the device supports VK_KHR_present_id and VK_KHR_present_wait
+     */
+    static bool isSupported(VkPhysicalDevice device);
+
+    /**
+     * Returns the name of a present mode, for logging
+     *
+     * @param mode  The present mode
+     *
+     * @return the name of a present mode, for logging
+     */
+    static const char* getModeName(VkPresentModeKHR mode);
+
+    /**
+     * Parses the name of a present mode, ignoring case.
+     *
+     * This accepts the names of {@link getModeName}, and "relaxed" as a short
+     * form of FIFO_RELAXED.
+     *
+     * @param name  The name to parse
+     * @param mode  The present mode to set on success
+     *
+     * @return true if the name is a present mode
+     */
+    static bool parseMode(const char* name, VkPresentModeKHR& mode);
+
+    /**
+     * Returns true if presents can be waited on
+     *
+     * @return true if presents can be waited on
+     */
+    bool isEnabled() const { return waitForPresent != nullptr; }
+
+    /**
+     * Switches to a new swapchain.
+     *
+     * Presents to the old swapchain can no longer be waited on, so the frames
+     * still pending are dropped from the metrics.
+     *
+     * @param swapchain The new swapchain
+     */
+    void resetSwapchain(VkSwapchainKHR swapchain);
+
+    /**
+     * Starts the CPU work of a frame.
+     *
+     * If pace is true and presents can be waited on, this first blocks until
+     * the previous present reaches the display (or a refresh has clearly been
+     * missed). Pacing only makes sense for the FIFO modes, as MAILBOX and
+     * IMMEDIATE never queue images behind the vsync.
+     *
+     * @param completed The last frame that finished on the GPU
+     * @param pace      Whether to wait on the previous present
+     */
+    void beginFrame(uint64_t completed, bool pace);
+
+    /**
+     * Tags a present with the given frame number.
+     *
+     * The present info must be submitted before the next call to this method.
+     * If presents cannot be waited on, this only records the frame for the metrics.
+     *
+     * @param info  The present info for a single swapchain
+     * @param frame The frame number
+     */
+    void chain(VkPresentInfoKHR& info, uint64_t frame);
+};
+
+#endif /* __PRESENT_PACER_H__ */
@@ -0,0 +1,260 @@
+//
+//  SwapchainRetirer.cpp
+//  Tutorial9
+//
+//  Deferred destruction of old swapchains. The tutorial recreates the
+//  swapchain by idling the device and destroying everything attached to it,
+//  which drains the GPU on every resize event. But a new swapchain can be
+//  created while the old one is still in use, by passing the old one as
+//  oldSwapchain. Only the destruction has to wait.
+//
+//  The image views and framebuffers of a swapchain are only used for
+//  rendering, so they can go to the DeletionQueue with the last frame that
+//  drew to them. The swapchain itself and its present semaphores are harder,
+//  as the present engine may still wait on the semaphores after the frame
+//  is done. This class holds on to those until they are safe to destroy. With
+//  VK_EXT_swapchain_maintenance1, every present signals a fence, and those
+//  fences say exactly when a swapchain is done. Without it, there is no way
+//  to know, and the swapchain is kept for a few more frames as a heuristic.
+//
+//  Version: 10/18/26
+//
+#include "SwapchainRetirer.h"
+#include <SDL3/SDL.h>
+#include <stdexcept>
+#include <cstring>
+
+/**
+ * Creates a retirer for the given device
+ *
+ * If presentFences is true, the device must have been created with the
+ * swapchainMaintenance1 feature. Otherwise, a swapchain is destroyed once
+ * margin frames have finished after its last one.
+ *
+ * @param device        The logical device
+ * @param presentFences Whether to use VK_EXT_swapchain_maintenance1
+ * @param margin        The frames to wait if presents cannot be fenced
+ */
+SwapchainRetirer::SwapchainRetirer(VkDevice device, bool presentFences, uint32_t margin) :
+    device(device),
+    presentFences(presentFences),
+    margin(margin),
+    presentFence(VK_NULL_HANDLE),
+    fenceInfo{} {
+    if (!presentFences) {
+        SDL_Log("Present fences are not available; old swapchains are kept for %u extra frames", margin);
+    }
+}
+
+/**
+ * Destroys every retired swapchain. The device must be idle.
+ */
+SwapchainRetirer::~SwapchainRetirer() {
+    for (auto& entry : retired) {
+        destroy(entry);
+    }
+    for (VkFence fence : active) {
+        vkDestroyFence(device, fence, nullptr);
+    }
+    for (VkFence fence : freeFences) {
+        vkDestroyFence(device, fence, nullptr);
+    }
+}
+
+/**
+ * Adds the instance extensions for present fences, if available.
+ *
+ * The device extension requires VK_EXT_surface_maintenance1, which in
+ * turn requires VK_KHR_get_surface_capabilities2.
+ *
+ * @param extensions    The instance extensions to add to
+ *
+ * @return true if the extensions were added
+ */
+bool SwapchainRetirer::addInstanceExtensions(std::vector<const char*>& extensions) {
+    uint32_t extensionCount;
+    vkEnumerateInstanceExtensionProperties(nullptr, &extensionCount, nullptr);
+
+    std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+    vkEnumerateInstanceExtensionProperties(nullptr, &extensionCount, availableExtensions.data());
+
+    bool surfaceFound = false;
+    bool capabilitiesFound = false;
+    for (const auto& extension : availableExtensions) {
+        surfaceFound = surfaceFound || strcmp(extension.extensionName, VK_EXT_SURFACE_MAINTENANCE_1_EXTENSION_NAME) == 0;
+        capabilitiesFound = capabilitiesFound || strcmp(extension.extensionName, VK_KHR_GET_SURFACE_CAPABILITIES_2_EXTENSION_NAME) == 0;
+    }
+    if (!surfaceFound || !capabilitiesFound) {
+        return false;
+    }
+
+    extensions.push_back(VK_KHR_GET_SURFACE_CAPABILITIES_2_EXTENSION_NAME);
+    extensions.push_back(VK_EXT_SURFACE_MAINTENANCE_1_EXTENSION_NAME);
+    return true;
+}
+
+/**
+ * Returns true if the device supports VK_EXT_swapchain_maintenance1
+ *
+ * @param device    The physical device
+ *
+ * @return true if the device supports VK_EXT_swapchain_maintenance1
+ */
+bool SwapchainRetirer::isSupported(VkPhysicalDevice device) {
+    uint32_t extensionCount;
+    vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
+
+    std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+    vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, availableExtensions.data());
+
+    bool found = false;
+    for (const auto& extension : availableExtensions) {
+        found = found || strcmp(extension.extensionName, VK_EXT_SWAPCHAIN_MAINTENANCE_1_EXTENSION_NAME) == 0;
+    }
+    if (!found) {
+        return false;
+    }
+
+    VkPhysicalDeviceSwapchainMaintenance1FeaturesEXT maintenanceFeatures{};
+    maintenanceFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SWAPCHAIN_MAINTENANCE_1_FEATURES_EXT;
+
+    VkPhysicalDeviceFeatures2 features{};
+    features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    features.pNext = &maintenanceFeatures;
+    vkGetPhysicalDeviceFeatures2(device, &features);
+
+    return maintenanceFeatures.swapchainMaintenance1 == VK_TRUE;
+}
+
+/**
+ * Attaches a present fence to a present of the current swapchain.
+ *
+ * The present info must be submitted before the next call to this method.
+ * If presents cannot be fenced, this does nothing.
+ *
+ * @param info  The present info for a single swapchain
+ */
+void SwapchainRetirer::chain(VkPresentInfoKHR& info) {
+    if (!presentFences) {
+        return;
+    }
+
+    if (freeFences.empty()) {
+        VkFenceCreateInfo createInfo{};
+        createInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+        if (vkCreateFence(device, &createInfo, nullptr, &presentFence) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create present fence!");
+        }
+    } else {
+        presentFence = freeFences.back();
+        freeFences.pop_back();
+    }
+    active.push_back(presentFence);
+
+    fenceInfo = {};
+    fenceInfo.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_PRESENT_FENCE_INFO_EXT;
+    fenceInfo.pNext = info.pNext;
+    fenceInfo.swapchainCount = 1;
+    fenceInfo.pFences = &presentFence;
+    info.pNext = &fenceInfo;
+}
+
+/**
+ * Retires the current swapchain, once it has been replaced.
+ *
+ * The swapchain must have been passed as oldSwapchain to its replacement,
+ * and every image acquired from it must have been presented. This takes
+ * ownership of the semaphores. The image views and framebuffers should
+ * go to the {@link DeletionQueue} instead.
+ *
+ * @param swapchain     The old swapchain
+ * @param semaphores    The present semaphores of the old swapchain
+ * @param frame         The last frame that rendered to the old swapchain
+ */
+void SwapchainRetirer::retire(VkSwapchainKHR swapchain, std::vector<VkSemaphore> semaphores, uint64_t frame) {
+    Retired entry;
+    entry.swapchain = swapchain;
+    entry.semaphores.swap(semaphores);
+    entry.fences.swap(active);
+    entry.frame = frame;
+    retired.push_back(std::move(entry));
+}
+
+/**
+ * Destroys every retired swapchain that is no longer in use.
+ *
+ * This never blocks, and should be called once a frame.
+ *
+ * @param completed The last frame that finished on the GPU
+ */
+void SwapchainRetirer::collect(uint64_t completed) {
+    for (auto it = retired.begin(); it != retired.end();) {
+        bool done = presentFences ? completed >= it->frame && isSignaled(it->fences)
+                                  : completed >= it->frame + margin;
+        if (done) {
+            recycle(it->fences);
+            destroy(*it);
+            it = retired.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    // Recycle the fences of presents that finished on the current swapchain
+    std::vector<VkFence> signaled;
+    for (auto it = active.begin(); it != active.end();) {
+        if (vkGetFenceStatus(device, *it) == VK_SUCCESS) {
+            signaled.push_back(*it);
+            it = active.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    recycle(signaled);
+}
+
+/**
+ * Returns true if every fence in the list has signaled
+ *
+ * @param fences    The fences to check
+ *
+ * @return true if every fence in the list has signaled
+ */
+bool SwapchainRetirer::isSignaled(const std::vector<VkFence>& fences) const {
+    for (VkFence fence : fences) {
+        if (vkGetFenceStatus(device, fence) != VK_SUCCESS) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Moves the given fences to the free list
+ *
+ * @param fences    The signaled fences to recycle
+ */
+void SwapchainRetirer::recycle(std::vector<VkFence>& fences) {
+    if (fences.empty()) {
+        return;
+    }
+    vkResetFences(device, static_cast<uint32_t>(fences.size()), fences.data());
+    freeFences.insert(freeFences.end(), fences.begin(), fences.end());
+    fences.clear();
+}
+
+/**
+ * Destroys a retired swapchain and its present semaphores
+ *
+ * @param entry The retired swapchain
+ */
+void SwapchainRetirer::destroy(Retired& entry) {
+    for (VkSemaphore semaphore : entry.semaphores) {
+        vkDestroySemaphore(device, semaphore, nullptr);
+    }
+    for (VkFence fence : entry.fences) {
+        vkDestroyFence(device, fence, nullptr);
+    }
+    entry.fences.clear();
+    vkDestroySwapchainKHR(device, entry.swapchain, nullptr);
+}
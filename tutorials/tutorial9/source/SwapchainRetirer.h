@@ -0,0 +1,173 @@
+//
+//  SwapchainRetirer.h
+//  Tutorial9
+//
+//  Deferred destruction of old swapchains. The tutorial recreates the
+//  swapchain by idling the device and destroying everything attached to it,
+//  which drains the GPU on every resize event. But a new swapchain can be
+//  created while the old one is still in use, by passing the old one as
+//  oldSwapchain. Only the destruction has to wait.
+//
+//  The image views and framebuffers of a swapchain are only used for
+//  rendering, so they can go to the DeletionQueue with the last frame that
+//  drew to them. The swapchain itself and its present semaphores are harder,
+//  as the present engine may still wait on the semaphores after the frame
+//  is done. This class holds on to those until they are safe to destroy. With
+//  VK_EXT_swapchain_maintenance1, every present signals a fence, and those
+//  fences say exactly when a swapchain is done. Without it, there is no way
+//  to know, and the swapchain is kept for a few more frames as a heuristic.
+//
+//  Version: 10/18/26
+//
+#ifndef __SWAPCHAIN_RETIRER_H__
+#define __SWAPCHAIN_RETIRER_H__
+#include "VulkanLoader.h"
+#include <deque>
+#include <vector>
+#include <cstdint>
+
+/**
+ * A frame-fenced graveyard for old swapchains.
+ *
+ * Every present must go through {@link chain}, so that the present fences
+ * (if enabled) are accounted to the right swapchain. The destructor frees
+ * everything still retired, so the device must be idle by then.
+ */
+class SwapchainRetirer {
+private:
+    /** A swapchain that has been replaced, with its present semaphores */
+    struct Retired {
+        VkSwapchainKHR swapchain;
+        std::vector<VkSemaphore> semaphores;
+        /** The present fences of the swapchain (empty if not enabled) */
+        std::vector<VkFence> fences;
+        /** The last frame that rendered to the swapchain */
+        uint64_t frame;
+    };
+
+    /** The logical device */
+    VkDevice device;
+    /** Whether presents signal fences (VK_EXT_swapchain_maintenance1) */
+    bool presentFences;
+    /** The frames to wait past the last one, if presents cannot be fenced */
+    uint32_t margin;
+
+    /** The retired swapchains, oldest first */
+    std::deque<Retired> retired;
+    /** The present fences of the current swapchain */
+    std::vector<VkFence> active;
+    /** The signaled fences, ready for reuse */
+    std::vector<VkFence> freeFences;
+
+    /** The fence attached to the next present */
+    VkFence presentFence;
+    VkSwapchainPresentFenceInfoEXT fenceInfo;
+
+    /**
+     * Returns true if every fence in the list has signaled
+     *
+     * @param fences    The fences to check
+     *
+     * @return true if every fence in the list has signaled
+     */
+    bool isSignaled(const std::vector<VkFence>& fences) const;
+
+    /**
+     * Moves the given fences to the free list
+     *
+     * @param fences    The signaled fences to recycle
+     */
+    void recycle(std::vector<VkFence>& fences);
+
+    /**
+     * Destroys a retired swapchain and its present semaphores
+     *
+     * @param entry The retired swapchain
+     */
+    void destroy(Retired& entry);
+
+public:
+    /**
+     * Creates a retirer for the given device
+     *
+     * If presentFences is true, the device must have been created with the
+     * swapchainMaintenance1 feature. Otherwise, a swapchain is destroyed once
+     * margin frames have finished after its last one.
+     *
+     * @param device        The logical device
+     * @param presentFences Whether to use VK_EXT_swapchain_maintenance1
+     * @param margin        The frames to wait if presents cannot be fenced
+     */
+    SwapchainRetirer(VkDevice device, bool presentFences, uint32_t margin);
+
+    /**
+     * Destroys every retired swapchain. The device must be idle.
+     */
+    ~SwapchainRetirer();
+
+    SwapchainRetirer(const SwapchainRetirer&) = delete;
+    SwapchainRetirer& operator=(const SwapchainRetirer&) = delete;
+
+    /**
+     * Adds the instance extensions for present fences, if available.
+     *
+     * The device extension requires VK_EXT_surface_maintenance1, which in
+     * turn requires VK_KHR_get_surface_capabilities2.
+     *
+     * @param extensions    The instance extensions to add to
+     *
+     * @return true if the extensions were added
+     */
+    static bool addInstanceExtensions(std::vector<const char*>& extensions);
+
+    /**
+     * Returns true if the device supports VK_EXT_swapchain_maintenance1
+     *
+     * @param device    The physical device
+     *
+     * @return true if the device supports VK_EXT_swapchain_maintenance1
+     */
+    static bool isSupported(VkPhysicalDevice device);
+
+    /**
+     * Returns true if presents signal fences
+     *
+     * @return true if presents signal fences
+     */
+    bool isEnabled() const { return presentFences; }
+
+    /**
+     * Attaches a present fence to a present of the current swapchain.
+     *
+     * The present info must be submitted before the next call to this method.
+     * If presents cannot be fenced, this does nothing.
+     *
+     * @param info  The present info for a single swapchain
+     */
+    void chain(VkPresentInfoKHR& info);
+
+    /**
+     * Retires the current swapchain, once it has been replaced.
+     *
+     * The swapchain must have been passed as oldSwapchain to its replacement,
+     * and every image acquired from it must have been presented. This takes
+     * ownership of the semaphores. The image views and framebuffers should
+     * go to the {@link DeletionQueue} instead.
+     *
+     * @param swapchain     The old swapchain
+     * @param semaphores    The present semaphores of the old swapchain
+     * @param frame         The last frame that rendered to the old swapchain
+     */
+    void retire(VkSwapchainKHR swapchain, std::vector<VkSemaphore> semaphores, uint64_t frame);
+
+    /**
+     * Destroys every retired swapchain that is no longer in use.
+     *
+     * This never blocks, and should be called once a frame.
+     *
+     * @param completed The last frame that finished on the GPU
+     */
+    void collect(uint64_t completed);
+};
+
+#endif /* __SWAPCHAIN_RETIRER_H__ */